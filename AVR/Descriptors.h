@@ -48,14 +48,19 @@
 		/** Size in bytes of the Mouse HID reporting IN endpoint. */
 		#define MOUSE_EPSIZE              8
 
-		/** Endpoint address of the Generic HID reporting IN endpoint. */
-		#define GENERIC_IN_EPADDR         (ENDPOINT_DIR_IN | 1)
+		/** Endpoint address of the vendor bulk data IN endpoint. */
+		#define VENDOR_IN_EPADDR          (ENDPOINT_DIR_IN  | 2)
 
-		/** Size in bytes of the Generic HID reporting endpoint. */
-		#define GENERIC_EPSIZE            8
+		/** Endpoint address of the vendor bulk data OUT endpoint. */
+		#define VENDOR_OUT_EPADDR         (ENDPOINT_DIR_OUT | 3)
 
-		/** Size in bytes of the Generic HID reports (including report ID byte). */
-		#define GENERIC_REPORT_SIZE       8
+		/** Size in bytes of the vendor bulk data endpoints, the maximum for a full speed bulk endpoint. */
+		#define VENDOR_EPSIZE             64
+
+		/** Number of hardware banks for the vendor bulk data endpoints, so the host can fill one bank while
+		 *  the firmware drains the other.
+		 */
+		#define VENDOR_EPBANKS            2
 
 
 		/** Descriptor type value for a DFU class functional descriptor. */
@@ -120,6 +125,11 @@
 			// DFU Interface
 			USB_Descriptor_Interface_t            DFU_Interface;
 			USB_Descriptor_DFU_Functional_t       DFU_Functional;
+
+			// Vendor Bulk Interface
+			USB_Descriptor_Interface_t            Vendor_Interface;
+			USB_Descriptor_Endpoint_t             Vendor_DataINEndpoint;
+			USB_Descriptor_Endpoint_t             Vendor_DataOUTEndpoint;
 		} USB_Descriptor_Configuration_t;
 
 		/** Enum for the device interface descriptor IDs within the device. Each interface descriptor
@@ -128,8 +138,9 @@
 		 */
 		enum InterfaceDescriptors_t
 		{
-			INTERFACE_ID_Mouse = 0, /**< Mouse interface descriptor ID */
-			INTERFACE_ID_DFU   = 1, /**< DFU interface descriptor ID */
+			INTERFACE_ID_Mouse  = 0, /**< Mouse interface descriptor ID */
+			INTERFACE_ID_DFU    = 1, /**< DFU interface descriptor ID */
+			INTERFACE_ID_Vendor = 2, /**< Vendor bulk interface descriptor ID */
 		};
 
 		/** Enum for the device string descriptor IDs within the device. Each string descriptor should
@@ -40,18 +40,18 @@
 /** Buffer to hold the previously generated Mouse HID report, for comparison purposes inside the HID class driver. */
 static uint8_t PrevMouseHIDReportBuffer[sizeof(USB_MouseReport_Data_t)];
 
-/** Current DFU state machine state, one of the values in the DFU_State_t enum. */
-static uint8_t DFU_State = appIDLE;
-
-/** Status code of the last executed DFU command. This is set to one of the values in the DFU_Status_t enum after
- *  each operation, and returned to the host when a Get Status DFU request is issued.
+/** Debounced joystick and button states, sampled once per millisecond from the Start Of Frame event. The
+ *  HID report is built from these rather than the raw port pins so that contact bounce does not turn into
+ *  a burst of IN reports.
  */
-static uint8_t DFU_Status = OK;
+static volatile uint8_t JoyStatus_Debounced    = 0;
+static volatile uint8_t ButtonStatus_Debounced = 0;
 
-/** Flag to indicate if we should switch to bootloader mode when the USB stack
- *  is idle.
- */
-static bool SwitchToBootloader = false;
+/** Current mode of the vendor bulk interface, one of the values in the Vendor_Mode_t enum. */
+static uint8_t Vendor_Mode = VENDOR_MODE_SINK;
+
+/** Running transfer counters for the vendor bulk interface, reset when the mode is set. */
+static Vendor_Stats_t Vendor_Stats;
 
 /** LUFA HID Class driver interface configuration and state information. This structure is
  *  passed to all HID Class driver functions, so that multiple instances of the same class
@@ -138,8 +138,9 @@ int main(void)
 	for (;;)
 	{
 		HID_Device_USBTask(&Mouse_HID_Interface);
+		Vendor_Task();
 		USB_USBTask();
-		if (SwitchToBootloader)
+		if (dfu_runtime_detach_pending())
 			RebootToBootloader();
 	}
 }
@@ -191,103 +192,83 @@ void EVENT_USB_Device_ConfigurationChanged(void)
 	bool ConfigSuccess = true;
 
 	ConfigSuccess &= HID_Device_ConfigureEndpoints(&Mouse_HID_Interface);
+	ConfigSuccess &= Endpoint_ConfigureEndpoint(VENDOR_IN_EPADDR,  EP_TYPE_BULK, VENDOR_EPSIZE, VENDOR_EPBANKS);
+	ConfigSuccess &= Endpoint_ConfigureEndpoint(VENDOR_OUT_EPADDR, EP_TYPE_BULK, VENDOR_EPSIZE, VENDOR_EPBANKS);
+
+	/* The class driver defaults to a 500ms idle rate; only report on change unless the host asks otherwise */
+	Mouse_HID_Interface.State.IdleCount = MOUSE_IDLE_RATE_MS;
 
 	USB_Device_EnableSOFEvents();
 
 	LEDs_SetAllLEDs(ConfigSuccess ? LEDMASK_USB_READY : LEDMASK_USB_ERROR);
 }
 
-/** DFU specific requests */
-enum DfuRequest {
-	DFU_REQ_DETACH			= 0x00,
-	DFU_REQ_DNLOAD			= 0x01,
-	DFU_REQ_UPLOAD			= 0x02,
-	DFU_REQ_GETSTATUS		= 0x03,
-	DFU_REQ_CLRSTATUS		= 0x04,
-	DFU_REQ_GETSTATE		= 0x05,
-	DFU_REQ_ABORT			= 0x06,
-};
-
+/** Processes the DFU runtime class requests, passing them to the shared DFU runtime core. Requests the core
+ *  rejects are left unhandled so that the library stalls them.
+ */
 void DFU_Device_ProcessControlRequest(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo)
 {
+	uint8_t Buffer[DFU_RUNTIME_BUFFER_SIZE];
+	int8_t  Length;
+
 	if (USB_ControlRequest.wIndex != HIDInterfaceInfo->Config.InterfaceNumber)
 	  return;
 
+	if ((USB_ControlRequest.bmRequestType & (CONTROL_REQTYPE_TYPE | CONTROL_REQTYPE_RECIPIENT)) !=
+	    (REQTYPE_CLASS | REQREC_INTERFACE))
+	  return;
+
 	/* Activity - toggle indicator LEDs */
 	LEDs_ToggleLEDs(LEDS_LED1 | LEDS_LED2);
 
-	switch (USB_ControlRequest.bRequest)
-	{
-		case DFU_REQ_DNLOAD:
-		case DFU_REQ_UPLOAD:
-			Endpoint_ClearSETUP();
-			break;
-		case DFU_REQ_GETSTATUS:
-			Endpoint_ClearSETUP();
-
-			while (!(Endpoint_IsINReady()))
-			{
-				if (USB_DeviceState == DEVICE_STATE_Unattached)
-				  return;
-			}
+	Length = dfu_runtime_process_request(USB_ControlRequest.bRequest, USB_ControlRequest.wLength, Buffer);
+	if (Length < 0)
+	  return;
 
-			/* Write 8-bit status value */
-			Endpoint_Write_8(DFU_Status);
+	Endpoint_ClearSETUP();
 
-			/* Write 24-bit poll timeout value */
-			Endpoint_Write_8(0);
-			Endpoint_Write_16_LE(0);
+	if (Length > 0)
+	{
+		Endpoint_Write_Control_Stream_LE(Buffer, Length);
+		Endpoint_ClearOUT();
+	}
+	else
+	{
+		Endpoint_ClearStatusStage();
+	}
+}
 
-			/* Write 8-bit state value */
-			Endpoint_Write_8(DFU_State);
+/** Processes the vendor specific control requests addressed to the vendor bulk interface. */
+static void Vendor_ProcessControlRequest(void)
+{
+	if (USB_ControlRequest.wIndex != INTERFACE_ID_Vendor)
+	  return;
 
-			/* Write 8-bit state string ID number */
-			Endpoint_Write_8(0);
+	switch (USB_ControlRequest.bRequest)
+	{
+		case VENDOR_REQ_SET_MODE:
+			if (USB_ControlRequest.bmRequestType != (REQDIR_HOSTTODEVICE | REQTYPE_VENDOR | REQREC_INTERFACE))
+			  break;
 
-			Endpoint_ClearIN();
+			/* Leave unknown modes unclaimed so the request is stalled and the current run is kept */
+			if ((USB_ControlRequest.wValue != VENDOR_MODE_SINK) && (USB_ControlRequest.wValue != VENDOR_MODE_LOOPBACK))
+			  break;
 
-			Endpoint_ClearStatusStage();
-			break;
-		case DFU_REQ_CLRSTATUS:
 			Endpoint_ClearSETUP();
 
-			/* Reset the status value variable to the default OK status */
-			DFU_Status = OK;
+			/* Start a new run, so the counters only cover the transfer being measured */
+			Vendor_Mode = USB_ControlRequest.wValue;
+			memset(&Vendor_Stats, 0x00, sizeof(Vendor_Stats));
 
 			Endpoint_ClearStatusStage();
 			break;
-		case DFU_REQ_GETSTATE:
-			Endpoint_ClearSETUP();
-
-			while (!(Endpoint_IsINReady()))
-			{
-				if (USB_DeviceState == DEVICE_STATE_Unattached)
-				  return;
-			}
+		case VENDOR_REQ_GET_STATS:
+			if (USB_ControlRequest.bmRequestType != (REQDIR_DEVICETOHOST | REQTYPE_VENDOR | REQREC_INTERFACE))
+			  break;
 
-			/* Write the current device state to the endpoint */
-			Endpoint_Write_8(DFU_State);
-
-			Endpoint_ClearIN();
-
-			Endpoint_ClearStatusStage();
-			break;
-		case DFU_REQ_DETACH:
 			Endpoint_ClearSETUP();
-
-			/* Mark as currently detaching then do the reset idle */
-			DFU_State = appDETACH;
-			SwitchToBootloader = true;
-
-			Endpoint_ClearStatusStage();
-			break;
-		case DFU_REQ_ABORT:
-			Endpoint_ClearSETUP();
-
-			/* Reset the current state variable to the default idle state */
-			DFU_State = appIDLE;
-
-			Endpoint_ClearStatusStage();
+			Endpoint_Write_Control_Stream_LE(&Vendor_Stats, sizeof(Vendor_Stats));
+			Endpoint_ClearOUT();
 			break;
 		default:
 			break;
@@ -299,11 +280,90 @@ void EVENT_USB_Device_ControlRequest(void)
 {
 	HID_Device_ProcessControlRequest(&Mouse_HID_Interface);
 	DFU_Device_ProcessControlRequest(&DFU_Interface);
+	Vendor_ProcessControlRequest();
+}
+
+/** Services the vendor bulk interface, draining one OUT bank per call. The endpoints are double banked so the
+ *  host can transfer the next packet while this one is being processed, which keeps the bulk pipe busy.
+ */
+void Vendor_Task(void)
+{
+	uint8_t  Buffer[VENDOR_EPSIZE];
+	uint16_t Length;
+
+	if (USB_DeviceState != DEVICE_STATE_Configured)
+	  return;
+
+	/* Only take a packet to loop back once there is a free IN bank for it, so a host that stops reading just
+	 * stops the OUT pipe rather than blocking the main loop, and with it the mouse, in the stream write */
+	if (Vendor_Mode == VENDOR_MODE_LOOPBACK)
+	{
+		Endpoint_SelectEndpoint(VENDOR_IN_EPADDR);
+
+		if (!(Endpoint_IsINReady()))
+		  return;
+	}
+
+	Endpoint_SelectEndpoint(VENDOR_OUT_EPADDR);
+
+	if (!(Endpoint_IsOUTReceived()))
+	  return;
+
+	Length = Endpoint_BytesInEndpoint();
+	Endpoint_Read_Stream_LE(Buffer, Length, NULL);
+	Endpoint_ClearOUT();
+
+	Vendor_Stats.BytesReceived += Length;
+
+	if (Vendor_Mode == VENDOR_MODE_LOOPBACK)
+	{
+		Endpoint_SelectEndpoint(VENDOR_IN_EPADDR);
+		Endpoint_Write_Stream_LE(Buffer, Length, NULL);
+		Endpoint_ClearIN();
+
+		Vendor_Stats.BytesSent += Length;
+	}
+	else
+	{
+		for (uint16_t i = 0; i < Length; i++)
+		  Vendor_Stats.PayloadCRC = _crc_xmodem_update(Vendor_Stats.PayloadCRC, Buffer[i]);
+	}
+}
+
+/** Samples the joystick and buttons, updating the debounced states once the raw inputs have been stable for
+ *  \ref INPUT_DEBOUNCE_MS consecutive samples. This is called once per millisecond from the SOF event.
+ */
+static void SampleInputs(void)
+{
+	static uint8_t JoyStatus_Last    = 0;
+	static uint8_t ButtonStatus_Last = 0;
+	static uint8_t StableCount       = 0;
+
+	uint8_t JoyStatus_LCL    = Joystick_GetStatus();
+	uint8_t ButtonStatus_LCL = Buttons_GetStatus();
+
+	if ((JoyStatus_LCL != JoyStatus_Last) || (ButtonStatus_LCL != ButtonStatus_Last))
+	{
+		JoyStatus_Last    = JoyStatus_LCL;
+		ButtonStatus_Last = ButtonStatus_LCL;
+		StableCount       = 0;
+		return;
+	}
+
+	if (StableCount < INPUT_DEBOUNCE_MS)
+	{
+		if (++StableCount < INPUT_DEBOUNCE_MS)
+		  return;
+
+		JoyStatus_Debounced    = JoyStatus_LCL;
+		ButtonStatus_Debounced = ButtonStatus_LCL;
+	}
 }
 
 /** Event handler for the USB device Start Of Frame event. */
 void EVENT_USB_Device_StartOfFrame(void)
 {
+	SampleInputs();
 	HID_Device_MillisecondElapsed(&Mouse_HID_Interface);
 }
 
@@ -316,6 +376,10 @@ void EVENT_USB_Device_StartOfFrame(void)
  *  \param[out]    ReportSize  Number of bytes written in the report (or zero if no report is to be sent)
  *
  *  \return Boolean \c true to force the sending of the report, \c false to let the library determine if it needs to be sent
+ *
+ *  Reports are built from the debounced input states, so the class driver only sends one when the report differs
+ *  from \ref PrevMouseHIDReportBuffer or the idle period expires. Relative motion is the exception: while the
+ *  joystick is held the report is forced so the pointer keeps moving, even though the report contents are unchanged.
  */
 bool CALLBACK_HID_Device_CreateHIDReport(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo,
                                          uint8_t* const ReportID,
@@ -325,8 +389,8 @@ bool CALLBACK_HID_Device_CreateHIDReport(USB_ClassInfo_HID_Device_t* const HIDIn
 {
 	USB_MouseReport_Data_t* MouseReport = (USB_MouseReport_Data_t*)ReportData;
 
-	uint8_t JoyStatus_LCL    = Joystick_GetStatus();
-	uint8_t ButtonStatus_LCL = Buttons_GetStatus();
+	uint8_t JoyStatus_LCL    = JoyStatus_Debounced;
+	uint8_t ButtonStatus_LCL = ButtonStatus_Debounced;
 
 	if (JoyStatus_LCL & JOY_UP)
 	  MouseReport->Y = -1;
@@ -345,7 +409,7 @@ bool CALLBACK_HID_Device_CreateHIDReport(USB_ClassInfo_HID_Device_t* const HIDIn
 	  MouseReport->Button |= (1 << 1);
 
 	*ReportSize = sizeof(USB_MouseReport_Data_t);
-	return true;
+	return (MouseReport->X != 0) || (MouseReport->Y != 0);
 }
 
 /** HID class driver callback function for the processing of HID reports from the host.
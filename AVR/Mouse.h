@@ -43,10 +43,12 @@
 		#include <avr/interrupt.h>
 		#include <avr/power.h>
 		#include <avr/interrupt.h>
+		#include <util/crc16.h>
 		#include <stdbool.h>
 		#include <string.h>
 
 		#include "Descriptors.h"
+		#include "dfu-runtime.h"
 
 		#include <LUFA/Drivers/Board/LEDs.h>
 		#include <LUFA/Drivers/Board/Buttons.h>
@@ -71,50 +73,45 @@
 		/** LED mask for the library LED driver, to indicate that an error has occurred in the USB interface. */
 		#define LEDMASK_USB_ERROR        (LEDS_LED1 | LEDS_LED3)
 
+		/** Number of consecutive identical 1ms samples required before a joystick or button change is reported. */
+		#define INPUT_DEBOUNCE_MS         5
+
+		/** Default HID idle rate in milliseconds, where zero only sends reports when the input state changes. The
+		 *  host may still override this with a HID Set Idle request.
+		 */
+		#define MOUSE_IDLE_RATE_MS        0
+
 	/* Type Defines: */
 		/** Type define for a non-returning function pointer to the loaded application. */
 		typedef void (*AppPtr_t)(void) ATTR_NO_RETURN;
 
 	/* Enums: */
-		/** DFU bootloader states. Refer to the DFU class specification for information on each state. */
-		enum DFU_State_t
+		/** Vendor specific control requests for the vendor bulk interface. */
+		enum Vendor_Request_t
 		{
-			appIDLE                      = 0,
-			appDETACH                    = 1,
-			dfuIDLE                      = 2,
-			dfuDNLOAD_SYNC               = 3,
-			dfuDNBUSY                    = 4,
-			dfuDNLOAD_IDLE               = 5,
-			dfuMANIFEST_SYNC             = 6,
-			dfuMANIFEST                  = 7,
-			dfuMANIFEST_WAIT_RESET       = 8,
-			dfuUPLOAD_IDLE               = 9,
-			dfuERROR                     = 10
+			VENDOR_REQ_SET_MODE          = 0x01, /**< Select a \ref Vendor_Mode_t in wValue and reset the counters */
+			VENDOR_REQ_GET_STATS         = 0x02, /**< Read back a \ref Vendor_Stats_t structure */
 		};
 
-		/** DFU command status error codes. Refer to the DFU class specification for information on each error code. */
-		enum DFU_Status_t
+		/** Modes of operation for the vendor bulk interface. */
+		enum Vendor_Mode_t
 		{
-			OK                           = 0,
-			errTARGET                    = 1,
-			errFILE                      = 2,
-			errWRITE                     = 3,
-			errERASE                     = 4,
-			errCHECK_ERASED              = 5,
-			errPROG                      = 6,
-			errVERIFY                    = 7,
-			errADDRESS                   = 8,
-			errNOTDONE                   = 9,
-			errFIRMWARE                  = 10,
-			errVENDOR                    = 11,
-			errUSBR                      = 12,
-			errPOR                       = 13,
-			errUNKNOWN                   = 14,
-			errSTALLEDPKT                = 15
+			VENDOR_MODE_SINK             = 0, /**< Consume firmware payload data, accumulating a CRC over it */
+			VENDOR_MODE_LOOPBACK         = 1, /**< Echo every OUT packet back on the IN endpoint */
 		};
 
+	/* Type Defines: */
+		/** Type define for the vendor bulk interface statistics, returned by \ref VENDOR_REQ_GET_STATS. */
+		typedef struct
+		{
+			uint32_t BytesReceived; /**< Number of payload bytes read from the OUT endpoint */
+			uint32_t BytesSent; /**< Number of payload bytes written to the IN endpoint */
+			uint16_t PayloadCRC; /**< CRC16 (XMODEM) of all data received in \ref VENDOR_MODE_SINK */
+		} ATTR_PACKED Vendor_Stats_t;
+
 	/* Function Prototypes: */
 		void SetupHardware(void);
+		void Vendor_Task(void);
 
 		void EVENT_USB_Device_Connect(void);
 		void EVENT_USB_Device_Disconnect(void);
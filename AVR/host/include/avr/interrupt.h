@@ -0,0 +1,2 @@
+/* Host build shim, see lufa-shim.h */
+#include <lufa-shim.h>
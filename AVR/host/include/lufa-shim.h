@@ -0,0 +1,481 @@
+/*
+  Copyright 2026  The fwupd-test-firmware authors
+
+  Permission to use, copy, modify, distribute, and sell this
+  software and its documentation for any purpose is hereby granted
+  without fee, provided that the above copyright notice appear in
+  all copies and that both that the copyright notice and this
+  permission notice and warranty disclaimer appear in supporting
+  documentation, and that the name of the author not be used in
+  advertising or publicity pertaining to distribution of the
+  software without specific, written prior permission.
+
+  The author disclaims all warranties with regard to this
+  software, including all implied warranties of merchantability
+  and fitness.  In no event shall the author be liable for any
+  special, indirect or consequential damages or any damages
+  whatsoever resulting from loss of use, data or profits, whether
+  in an action of contract, negligence or other tortious action,
+  arising out of or in connection with the use or performance of
+  this software.
+*/
+
+/** \file
+ *
+ *  Minimal host implementation of the parts of the LUFA and avr-libc APIs used by the Mouse+DFU demo, so that
+ *  Mouse.c and Descriptors.c can be compiled unmodified for a Linux host and driven by the replay harness. Only
+ *  the behaviour the demo depends on is modelled; the names and layouts follow LUFA so the demo sources do
+ *  not need to know they are not running on an AVR.
+ */
+
+#ifndef _LUFA_SHIM_H_
+#define _LUFA_SHIM_H_
+
+	/* Includes: */
+		#include <stdbool.h>
+		#include <stdint.h>
+		#include <stddef.h>
+		#include <string.h>
+
+	/* Architecture and Board Defines: */
+		#define ARCH_AVR8                         0
+		#define ARCH_UC3                          1
+		#define ARCH_XMEGA                        2
+
+		#define BOARD_NONE                        0
+		#define BOARD_USBKEY                      3
+		#define BOARD_A3BU_XPLAINED               40
+
+		#if defined(USE_LUFA_CONFIG_HEADER)
+			#include "LUFAConfig.h"
+		#endif
+
+	/* Common Attributes and Macros: */
+		#define ATTR_NO_RETURN                    __attribute__ ((noreturn))
+		#define ATTR_WARN_UNUSED_RESULT           __attribute__ ((warn_unused_result))
+		#define ATTR_NON_NULL_PTR_ARG(...)        __attribute__ ((nonnull (__VA_ARGS__)))
+		#define ATTR_PACKED                       __attribute__ ((packed))
+		#define PROGMEM
+		#define pgm_read_byte(Address)            (*(const uint8_t*)(Address))
+
+		#define VERSION_BCD(Major, Minor, Revision) \
+		                                          ((((Major) & 0xFF) << 8) | (((Minor) & 0x0F) << 4) | ((Revision) & 0x0F))
+		#define CPU_TO_LE16(x)                    (x)
+
+		#define GlobalInterruptEnable()           do {} while (0)
+		#define GlobalInterruptDisable()          do {} while (0)
+
+	/* avr-libc Register and Watchdog Emulation: */
+		extern volatile uint8_t MCUCR;
+		extern volatile uint8_t MCUSR;
+		extern volatile uint8_t TIMSK1;
+		extern volatile uint8_t TCCR1B;
+
+		#define IVCE                              0
+		#define WDRF                              3
+		#define WDTO_500MS                        5
+
+		#define wdt_enable(Timeout)               do {} while (0)
+		#define wdt_disable()                     do {} while (0)
+		#define clock_prescale_set(Division)      do {} while (0)
+		#define clock_div_1                       0
+
+		static inline uint16_t _crc_xmodem_update(uint16_t crc, uint8_t data)
+		{
+			crc ^= ((uint16_t)data << 8);
+			for (uint8_t i = 0; i < 8; i++)
+			  crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+			return crc;
+		}
+
+	/* Board Driver Emulation: */
+		#define LEDS_LED1                         (1 << 0)
+		#define LEDS_LED2                         (1 << 1)
+		#define LEDS_LED3                         (1 << 2)
+		#define LEDS_LED4                         (1 << 3)
+		#define LEDS_ALL_LEDS                     (LEDS_LED1 | LEDS_LED2 | LEDS_LED3 | LEDS_LED4)
+		#define LEDS_NO_LEDS                      0
+
+		#define JOY_UP                            (1 << 0)
+		#define JOY_DOWN                          (1 << 1)
+		#define JOY_LEFT                          (1 << 2)
+		#define JOY_RIGHT                         (1 << 3)
+		#define JOY_PRESS                         (1 << 4)
+
+		#define BUTTONS_BUTTON1                   (1 << 0)
+
+		/** Emulated board state, set by the replay harness and observed by the board drivers below. */
+		extern uint8_t Shim_LEDs;
+		extern uint8_t Shim_Joystick;
+		extern uint8_t Shim_Buttons;
+
+		#define LEDs_Init()                       do {} while (0)
+		#define LEDs_Disable()                    do {} while (0)
+		#define LEDs_SetAllLEDs(Mask)             do { Shim_LEDs = (Mask); } while (0)
+		#define LEDs_ToggleLEDs(Mask)             do { Shim_LEDs ^= (Mask); } while (0)
+		#define Joystick_Init()                   do {} while (0)
+		#define Joystick_GetStatus()              (Shim_Joystick)
+		#define Buttons_Init()                    do {} while (0)
+		#define Buttons_GetStatus()               (Shim_Buttons)
+
+	/* USB Standard Descriptor Defines: */
+		#define NO_DESCRIPTOR                     0
+		#define USB_CONFIG_POWER_MA(mA)           ((mA) >> 1)
+		#define USB_CONFIG_ATTR_RESERVED          0x80
+		#define LANGUAGE_ID_ENG                   0x0409
+
+		#define USB_CSCP_NoDeviceClass            0x00
+		#define USB_CSCP_NoDeviceSubclass         0x00
+		#define USB_CSCP_NoDeviceProtocol         0x00
+		#define USB_CSCP_VendorSpecificClass      0xFF
+
+		#define ENDPOINT_DIR_MASK                 0x80
+		#define ENDPOINT_DIR_OUT                  0x00
+		#define ENDPOINT_DIR_IN                   0x80
+		#define ENDPOINT_EPNUM_MASK               0x0F
+		#define ENDPOINT_ATTR_NO_SYNC             (0 << 2)
+		#define ENDPOINT_USAGE_DATA               (0 << 4)
+
+		#define EP_TYPE_CONTROL                   0x00
+		#define EP_TYPE_ISOCHRONOUS               0x01
+		#define EP_TYPE_BULK                      0x02
+		#define EP_TYPE_INTERRUPT                 0x03
+
+		enum USB_DescriptorTypes_t
+		{
+			DTYPE_Device                    = 0x01,
+			DTYPE_Configuration             = 0x02,
+			DTYPE_String                    = 0x03,
+			DTYPE_Interface                 = 0x04,
+			DTYPE_Endpoint                  = 0x05,
+		};
+
+		typedef struct
+		{
+			uint8_t Size;
+			uint8_t Type;
+		} ATTR_PACKED USB_Descriptor_Header_t;
+
+		typedef struct
+		{
+			USB_Descriptor_Header_t Header;
+			uint16_t USBSpecification;
+			uint8_t  Class;
+			uint8_t  SubClass;
+			uint8_t  Protocol;
+			uint8_t  Endpoint0Size;
+			uint16_t VendorID;
+			uint16_t ProductID;
+			uint16_t ReleaseNumber;
+			uint8_t  ManufacturerStrIndex;
+			uint8_t  ProductStrIndex;
+			uint8_t  SerialNumStrIndex;
+			uint8_t  NumberOfConfigurations;
+		} ATTR_PACKED USB_Descriptor_Device_t;
+
+		typedef struct
+		{
+			USB_Descriptor_Header_t Header;
+			uint16_t TotalConfigurationSize;
+			uint8_t  TotalInterfaces;
+			uint8_t  ConfigurationNumber;
+			uint8_t  ConfigurationStrIndex;
+			uint8_t  ConfigAttributes;
+			uint8_t  MaxPowerConsumption;
+		} ATTR_PACKED USB_Descriptor_Configuration_Header_t;
+
+		typedef struct
+		{
+			USB_Descriptor_Header_t Header;
+			uint8_t InterfaceNumber;
+			uint8_t AlternateSetting;
+			uint8_t TotalEndpoints;
+			uint8_t Class;
+			uint8_t SubClass;
+			uint8_t Protocol;
+			uint8_t InterfaceStrIndex;
+		} ATTR_PACKED USB_Descriptor_Interface_t;
+
+		typedef struct
+		{
+			USB_Descriptor_Header_t Header;
+			uint8_t  EndpointAddress;
+			uint8_t  Attributes;
+			uint16_t EndpointSize;
+			uint8_t  PollingIntervalMS;
+		} ATTR_PACKED USB_Descriptor_Endpoint_t;
+
+		/** String descriptor; the host build uses -fshort-wchar so wide literals are UTF-16 as on the AVR. */
+		typedef struct
+		{
+			USB_Descriptor_Header_t Header;
+			wchar_t UnicodeString[];
+		} ATTR_PACKED USB_Descriptor_String_t;
+
+		#define USB_STRING_LEN(UnicodeChars)      (sizeof(USB_Descriptor_Header_t) + ((UnicodeChars) << 1))
+		#define USB_STRING_DESCRIPTOR(String)     { .Header = {.Size = sizeof(USB_Descriptor_Header_t) + (sizeof(String) - 2), \
+		                                                       .Type = DTYPE_String}, .UnicodeString = String }
+		#define USB_STRING_DESCRIPTOR_ARRAY(...)  { .Header = {.Size = sizeof(USB_Descriptor_Header_t) + sizeof((uint16_t[]){__VA_ARGS__}), \
+		                                                       .Type = DTYPE_String}, .UnicodeString = {__VA_ARGS__} }
+
+	/* USB Control Request Defines: */
+		#define CONTROL_REQTYPE_DIRECTION         0x80
+		#define CONTROL_REQTYPE_TYPE              0x60
+		#define CONTROL_REQTYPE_RECIPIENT         0x1F
+
+		#define REQDIR_HOSTTODEVICE               (0 << 7)
+		#define REQDIR_DEVICETOHOST               (1 << 7)
+		#define REQTYPE_STANDARD                  (0 << 5)
+		#define REQTYPE_CLASS                     (1 << 5)
+		#define REQTYPE_VENDOR                    (2 << 5)
+		#define REQREC_DEVICE                     (0 << 0)
+		#define REQREC_INTERFACE                  (1 << 0)
+		#define REQREC_ENDPOINT                   (2 << 0)
+
+		enum USB_Control_Request_t
+		{
+			REQ_GetStatus           = 0,
+			REQ_ClearFeature        = 1,
+			REQ_SetFeature          = 3,
+			REQ_SetAddress          = 5,
+			REQ_GetDescriptor       = 6,
+			REQ_SetDescriptor       = 7,
+			REQ_GetConfiguration    = 8,
+			REQ_SetConfiguration    = 9,
+			REQ_GetInterface        = 10,
+			REQ_SetInterface        = 11,
+		};
+
+		typedef struct
+		{
+			uint8_t  bmRequestType;
+			uint8_t  bRequest;
+			uint16_t wValue;
+			uint16_t wIndex;
+			uint16_t wLength;
+		} ATTR_PACKED USB_Request_Header_t;
+
+		enum USB_Device_States_t
+		{
+			DEVICE_STATE_Unattached = 0,
+			DEVICE_STATE_Powered    = 1,
+			DEVICE_STATE_Default    = 2,
+			DEVICE_STATE_Addressed  = 3,
+			DEVICE_STATE_Configured = 4,
+			DEVICE_STATE_Suspended  = 5,
+		};
+
+		extern USB_Request_Header_t USB_ControlRequest;
+		extern volatile uint8_t     USB_DeviceState;
+
+	/* USB Core and Endpoint Emulation: */
+		/** Endpoint configuration, as passed to the class drivers. */
+		typedef struct
+		{
+			uint8_t  Address;
+			uint16_t Size;
+			uint8_t  Type;
+			uint8_t  Banks;
+		} USB_Endpoint_Table_t;
+
+		enum Endpoint_Stream_RW_ErrorCodes_t
+		{
+			ENDPOINT_RWSTREAM_NoError            = 0,
+			ENDPOINT_RWSTREAM_EndpointStalled    = 1,
+			ENDPOINT_RWSTREAM_DeviceDisconnected = 2,
+		};
+
+		enum Endpoint_ControlStream_RW_ErrorCodes_t
+		{
+			ENDPOINT_RWCSTREAM_NoError            = 0,
+			ENDPOINT_RWCSTREAM_HostAborted        = 1,
+			ENDPOINT_RWCSTREAM_DeviceDisconnected = 2,
+		};
+
+		void     USB_Init(void);
+		void     USB_Disable(void);
+		void     USB_USBTask(void);
+		void     USB_Device_ProcessControlRequest(void);
+		void     USB_Device_EnableSOFEvents(void);
+		uint16_t USB_Device_GetFrameNumber(void);
+
+		bool     Endpoint_ConfigureEndpoint(const uint8_t Address, const uint8_t Type, const uint16_t Size, const uint8_t Banks);
+		void     Endpoint_SelectEndpoint(const uint8_t Address);
+		void     Endpoint_ClearSETUP(void);
+		void     Endpoint_ClearIN(void);
+		void     Endpoint_ClearOUT(void);
+		void     Endpoint_ClearStatusStage(void);
+		void     Endpoint_StallTransaction(void);
+		bool     Endpoint_IsINReady(void);
+		bool     Endpoint_IsOUTReceived(void);
+		bool     Endpoint_IsSETUPReceived(void);
+		uint16_t Endpoint_BytesInEndpoint(void);
+		void     Endpoint_Write_8(const uint8_t Data);
+		void     Endpoint_Write_16_LE(const uint16_t Data);
+		uint8_t  Endpoint_Read_8(void);
+		uint8_t  Endpoint_Write_Stream_LE(const void* const Buffer, uint16_t Length, uint16_t* const BytesProcessed);
+		uint8_t  Endpoint_Read_Stream_LE(void* const Buffer, uint16_t Length, uint16_t* const BytesProcessed);
+		uint8_t  Endpoint_Write_Control_Stream_LE(const void* const Buffer, uint16_t Length);
+		uint8_t  Endpoint_Write_Control_PStream_LE(const void* const Buffer, uint16_t Length);
+		uint8_t  Endpoint_Read_Control_Stream_LE(void* const Buffer, uint16_t Length);
+
+		/** Transfer accounting kept by the shim so the harness can inspect what the firmware sent. */
+		typedef struct
+		{
+			uint8_t  ControlIN[512]; /**< Data stage of the last device-to-host control request */
+			uint16_t ControlINLength; /**< Number of valid bytes in ControlIN */
+			bool     ControlStalled; /**< Set if the last control request was stalled */
+			uint32_t PacketsIN[16]; /**< Packets committed on each IN endpoint */
+			uint32_t BytesIN[16]; /**< Bytes committed on each IN endpoint */
+		} Shim_USBStats_t;
+
+		extern Shim_USBStats_t Shim_USBStats;
+
+		/** Queues a packet on an OUT endpoint, as if the host had sent it. Returns false if the endpoint is busy. */
+		bool Shim_Endpoint_QueueOUT(const uint8_t Address, const void* const Data, const uint16_t Length);
+
+		/** Sets the data stage for the next host-to-device control request. */
+		void Shim_SetControlOUT(const uint8_t* Data, const uint16_t Length);
+
+		/** Advances the emulated bus by one Start Of Frame. */
+		void Shim_USB_StartOfFrame(void);
+
+	/* HID Class Driver Emulation: */
+		#define HID_CSCP_HIDClass                 0x03
+		#define HID_CSCP_BootSubclass             0x01
+		#define HID_CSCP_MouseBootProtocol        0x02
+		#define HID_DTYPE_HID                     0x21
+		#define HID_DTYPE_Report                  0x22
+
+		#define HID_REPORT_ITEM_In                0
+		#define HID_REPORT_ITEM_Out               1
+		#define HID_REPORT_ITEM_Feature           2
+
+		#define HID_REQ_GetReport                 0x01
+		#define HID_REQ_GetIdle                   0x02
+		#define HID_REQ_GetProtocol               0x03
+		#define HID_REQ_SetReport                 0x09
+		#define HID_REQ_SetIdle                   0x0A
+		#define HID_REQ_SetProtocol               0x0B
+
+		typedef uint8_t USB_Descriptor_HIDReport_Datatype_t;
+
+		typedef struct
+		{
+			USB_Descriptor_Header_t Header;
+			uint16_t HIDSpec;
+			uint8_t  CountryCode;
+			uint8_t  TotalReportDescriptors;
+			uint8_t  HIDReportType;
+			uint16_t HIDReportLength;
+		} ATTR_PACKED USB_HID_Descriptor_HID_t;
+
+		typedef struct
+		{
+			uint8_t Button;
+			int8_t  X;
+			int8_t  Y;
+		} ATTR_PACKED USB_MouseReport_Data_t;
+
+		typedef struct
+		{
+			struct
+			{
+				uint8_t              InterfaceNumber;
+				USB_Endpoint_Table_t ReportINEndpoint;
+				void*                PrevReportINBuffer;
+				uint8_t              PrevReportINBufferSize;
+			} Config;
+			struct
+			{
+				bool     UsingReportProtocol;
+				uint16_t PrevFrameNum;
+				uint16_t IdleCount;
+				uint16_t IdleMSRemaining;
+			} State;
+		} USB_ClassInfo_HID_Device_t;
+
+		/* Short item encoding, as the LUFA HIDReportData.h macros */
+		#define _HID_RI_ENCODE_0(Data)
+		#define _HID_RI_ENCODE_8(Data)            , ((Data) & 0xFF)
+		#define _HID_RI_ENCODE_16(Data)           _HID_RI_ENCODE_8(Data), (((Data) >> 8) & 0xFF)
+		#define _HID_RI_SIZE_0                    0x00
+		#define _HID_RI_SIZE_8                    0x01
+		#define _HID_RI_SIZE_16                   0x02
+		#define _HID_RI_ENTRY(Prefix, Bits, Data) ((Prefix) | _HID_RI_SIZE_##Bits) _HID_RI_ENCODE_##Bits(Data)
+
+		#define HID_RI_INPUT(Bits, Data)          _HID_RI_ENTRY(0x80, Bits, Data)
+		#define HID_RI_COLLECTION(Bits, Data)     _HID_RI_ENTRY(0xA0, Bits, Data)
+		#define HID_RI_END_COLLECTION(Bits)       _HID_RI_ENTRY(0xC0, Bits, 0)
+		#define HID_RI_USAGE_PAGE(Bits, Data)     _HID_RI_ENTRY(0x04, Bits, Data)
+		#define HID_RI_LOGICAL_MINIMUM(Bits, Data) _HID_RI_ENTRY(0x14, Bits, Data)
+		#define HID_RI_LOGICAL_MAXIMUM(Bits, Data) _HID_RI_ENTRY(0x24, Bits, Data)
+		#define HID_RI_PHYSICAL_MINIMUM(Bits, Data) _HID_RI_ENTRY(0x34, Bits, Data)
+		#define HID_RI_PHYSICAL_MAXIMUM(Bits, Data) _HID_RI_ENTRY(0x44, Bits, Data)
+		#define HID_RI_REPORT_SIZE(Bits, Data)    _HID_RI_ENTRY(0x74, Bits, Data)
+		#define HID_RI_REPORT_COUNT(Bits, Data)   _HID_RI_ENTRY(0x94, Bits, Data)
+		#define HID_RI_USAGE(Bits, Data)          _HID_RI_ENTRY(0x08, Bits, Data)
+		#define HID_RI_USAGE_MINIMUM(Bits, Data)  _HID_RI_ENTRY(0x18, Bits, Data)
+		#define HID_RI_USAGE_MAXIMUM(Bits, Data)  _HID_RI_ENTRY(0x28, Bits, Data)
+
+		#define HID_IOF_CONSTANT                  (1 << 0)
+		#define HID_IOF_DATA                      (0 << 0)
+		#define HID_IOF_VARIABLE                  (1 << 1)
+		#define HID_IOF_ABSOLUTE                  (0 << 2)
+		#define HID_IOF_RELATIVE                  (1 << 2)
+
+		#define HID_DESCRIPTOR_MOUSE(MinAxisVal, MaxAxisVal, MinPhysicalVal, MaxPhysicalVal, Buttons, AbsoluteCoords) \
+			HID_RI_USAGE_PAGE(8, 0x01),                     \
+			HID_RI_USAGE(8, 0x02),                          \
+			HID_RI_COLLECTION(8, 0x01),                     \
+			    HID_RI_USAGE(8, 0x01),                      \
+			    HID_RI_COLLECTION(8, 0x00),                 \
+			        HID_RI_USAGE_PAGE(8, 0x09),             \
+			        HID_RI_USAGE_MINIMUM(8, 0x01),          \
+			        HID_RI_USAGE_MAXIMUM(8, Buttons),       \
+			        HID_RI_LOGICAL_MINIMUM(8, 0x00),        \
+			        HID_RI_LOGICAL_MAXIMUM(8, 0x01),        \
+			        HID_RI_REPORT_COUNT(8, Buttons),        \
+			        HID_RI_REPORT_SIZE(8, 0x01),            \
+			        HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE), \
+			        HID_RI_REPORT_COUNT(8, 0x01),           \
+			        HID_RI_REPORT_SIZE(8, (((Buttons) % 8) ? (8 - ((Buttons) % 8)) : 0)), \
+			        HID_RI_INPUT(8, HID_IOF_CONSTANT),      \
+			        HID_RI_USAGE_PAGE(8, 0x01),             \
+			        HID_RI_USAGE(8, 0x30),                  \
+			        HID_RI_USAGE(8, 0x31),                  \
+			        HID_RI_LOGICAL_MINIMUM(16, MinAxisVal), \
+			        HID_RI_LOGICAL_MAXIMUM(16, MaxAxisVal), \
+			        HID_RI_PHYSICAL_MINIMUM(16, MinPhysicalVal), \
+			        HID_RI_PHYSICAL_MAXIMUM(16, MaxPhysicalVal), \
+			        HID_RI_REPORT_COUNT(8, 0x02),           \
+			        HID_RI_REPORT_SIZE(8, ((((MinAxisVal) >= -128) && ((MaxAxisVal) <= 127)) ? 8 : 16)), \
+			        HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | ((AbsoluteCoords) ? HID_IOF_ABSOLUTE : HID_IOF_RELATIVE)), \
+			    HID_RI_END_COLLECTION(0),                   \
+			HID_RI_END_COLLECTION(0)
+
+		bool HID_Device_ConfigureEndpoints(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo);
+		void HID_Device_ProcessControlRequest(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo);
+		void HID_Device_USBTask(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo);
+		void HID_Device_MillisecondElapsed(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo);
+
+		bool CALLBACK_HID_Device_CreateHIDReport(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo,
+		                                         uint8_t* const ReportID,
+		                                         const uint8_t ReportType,
+		                                         void* ReportData,
+		                                         uint16_t* const ReportSize);
+		void CALLBACK_HID_Device_ProcessHIDReport(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo,
+		                                          const uint8_t ReportID,
+		                                          const uint8_t ReportType,
+		                                          const void* ReportData,
+		                                          const uint16_t ReportSize);
+
+	/* Application Callbacks: */
+		uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
+		                                    const uint16_t wIndex,
+		                                    const void** const DescriptorAddress);
+		void EVENT_USB_Device_ControlRequest(void);
+		void EVENT_USB_Device_ConfigurationChanged(void);
+		void EVENT_USB_Device_StartOfFrame(void);
+
+#endif
@@ -0,0 +1,450 @@
+/*
+  Copyright 2026  The fwupd-test-firmware authors
+
+  Permission to use, copy, modify, distribute, and sell this
+  software and its documentation for any purpose is hereby granted
+  without fee, provided that the above copyright notice appear in
+  all copies and that both that the copyright notice and this
+  permission notice and warranty disclaimer appear in supporting
+  documentation, and that the name of the author not be used in
+  advertising or publicity pertaining to distribution of the
+  software without specific, written prior permission.
+
+  The author disclaims all warranties with regard to this
+  software, including all implied warranties of merchantability
+  and fitness.  In no event shall the author be liable for any
+  special, indirect or consequential damages or any damages
+  whatsoever resulting from loss of use, data or profits, whether
+  in an action of contract, negligence or other tortious action,
+  arising out of or in connection with the use or performance of
+  this software.
+*/
+
+
+/** \file
+ *
+ *  Host implementation of the LUFA USB core, endpoint and HID class driver functions declared in lufa-shim.h.
+ *  Endpoints are modelled as single packet buffers; the control endpoint captures the data stage of each
+ *  request so the replay harness can compare it against the recording.
+ */
+
+#include <lufa-shim.h>
+
+volatile uint8_t MCUCR;
+volatile uint8_t MCUSR;
+volatile uint8_t TIMSK1;
+volatile uint8_t TCCR1B;
+
+uint8_t Shim_LEDs;
+uint8_t Shim_Joystick;
+uint8_t Shim_Buttons;
+
+USB_Request_Header_t USB_ControlRequest;
+volatile uint8_t     USB_DeviceState;
+Shim_USBStats_t      Shim_USBStats;
+
+/** Emulated state of one endpoint; IN endpoints fill Data, OUT endpoints are drained from it. */
+typedef struct
+{
+	uint8_t  Data[64];
+	uint16_t Length;
+	uint16_t Position;
+	uint16_t Size;
+	bool     Configured;
+} Shim_Endpoint_t;
+
+static Shim_Endpoint_t Shim_Endpoints[16];
+static uint8_t         Shim_SelectedEndpoint;
+static bool            Shim_SETUPPending;
+static uint16_t        Shim_FrameNumber;
+
+/** Control OUT data stage supplied by the harness, consumed by \ref Endpoint_Read_Control_Stream_LE. */
+static const uint8_t*  Shim_ControlOUT;
+static uint16_t        Shim_ControlOUTLength;
+
+void USB_Init(void)
+{
+	memset(Shim_Endpoints, 0x00, sizeof(Shim_Endpoints));
+	USB_DeviceState = DEVICE_STATE_Powered;
+}
+
+void USB_Disable(void)
+{
+	USB_DeviceState = DEVICE_STATE_Unattached;
+}
+
+void USB_USBTask(void)
+{
+	/* Control requests are delivered synchronously by the harness through USB_Device_ProcessControlRequest() */
+}
+
+void USB_Device_EnableSOFEvents(void)
+{
+}
+
+uint16_t USB_Device_GetFrameNumber(void)
+{
+	return Shim_FrameNumber;
+}
+
+void Shim_USB_StartOfFrame(void)
+{
+	Shim_FrameNumber = (Shim_FrameNumber + 1) & 0x07FF;
+	EVENT_USB_Device_StartOfFrame();
+}
+
+bool Endpoint_ConfigureEndpoint(const uint8_t Address, const uint8_t Type, const uint16_t Size, const uint8_t Banks)
+{
+	Shim_Endpoint_t* Endpoint = &Shim_Endpoints[Address & ENDPOINT_EPNUM_MASK];
+
+	if ((Size > sizeof(Endpoint->Data)) || (Banks < 1) || (Banks > 2))
+	  return false;
+
+	memset(Endpoint, 0x00, sizeof(Shim_Endpoint_t));
+	Endpoint->Size       = Size;
+	Endpoint->Configured = true;
+	return true;
+}
+
+void Endpoint_SelectEndpoint(const uint8_t Address)
+{
+	Shim_SelectedEndpoint = Address & ENDPOINT_EPNUM_MASK;
+}
+
+void Endpoint_ClearSETUP(void)
+{
+	Shim_SETUPPending = false;
+}
+
+bool Endpoint_IsSETUPReceived(void)
+{
+	return Shim_SETUPPending;
+}
+
+void Endpoint_StallTransaction(void)
+{
+	Shim_USBStats.ControlStalled = true;
+	Shim_SETUPPending = false;
+}
+
+void Endpoint_ClearStatusStage(void)
+{
+}
+
+bool Endpoint_IsINReady(void)
+{
+	return true;
+}
+
+bool Endpoint_IsOUTReceived(void)
+{
+	return Shim_Endpoints[Shim_SelectedEndpoint].Length > 0;
+}
+
+uint16_t Endpoint_BytesInEndpoint(void)
+{
+	Shim_Endpoint_t* Endpoint = &Shim_Endpoints[Shim_SelectedEndpoint];
+
+	return Endpoint->Length - Endpoint->Position;
+}
+
+void Endpoint_ClearIN(void)
+{
+	Shim_Endpoint_t* Endpoint = &Shim_Endpoints[Shim_SelectedEndpoint];
+
+	if (Shim_SelectedEndpoint == 0)
+	  return;
+
+	Shim_USBStats.PacketsIN[Shim_SelectedEndpoint]++;
+	Shim_USBStats.BytesIN[Shim_SelectedEndpoint] += Endpoint->Length;
+	Endpoint->Length = 0;
+}
+
+void Endpoint_ClearOUT(void)
+{
+	Shim_Endpoint_t* Endpoint = &Shim_Endpoints[Shim_SelectedEndpoint];
+
+	Endpoint->Length   = 0;
+	Endpoint->Position = 0;
+}
+
+void Endpoint_Write_8(const uint8_t Data)
+{
+	if (Shim_SelectedEndpoint == 0)
+	{
+		if (Shim_USBStats.ControlINLength < sizeof(Shim_USBStats.ControlIN))
+		  Shim_USBStats.ControlIN[Shim_USBStats.ControlINLength++] = Data;
+		return;
+	}
+
+	Shim_Endpoint_t* Endpoint = &Shim_Endpoints[Shim_SelectedEndpoint];
+
+	if (Endpoint->Length < Endpoint->Size)
+	  Endpoint->Data[Endpoint->Length++] = Data;
+}
+
+void Endpoint_Write_16_LE(const uint16_t Data)
+{
+	Endpoint_Write_8(Data & 0xFF);
+	Endpoint_Write_8(Data >> 8);
+}
+
+uint8_t Endpoint_Read_8(void)
+{
+	Shim_Endpoint_t* Endpoint = &Shim_Endpoints[Shim_SelectedEndpoint];
+
+	if (Endpoint->Position >= Endpoint->Length)
+	  return 0;
+
+	return Endpoint->Data[Endpoint->Position++];
+}
+
+uint8_t Endpoint_Write_Stream_LE(const void* const Buffer, uint16_t Length, uint16_t* const BytesProcessed)
+{
+	Shim_Endpoint_t* Endpoint = &Shim_Endpoints[Shim_SelectedEndpoint];
+	const uint8_t*   DataStream = (const uint8_t*)Buffer;
+
+	while (Length--)
+	{
+		/* Bank full, so send it and carry on in the next one as the real stream functions do */
+		if (Endpoint->Length == Endpoint->Size)
+		  Endpoint_ClearIN();
+
+		Endpoint_Write_8(*DataStream++);
+	}
+
+	if (BytesProcessed != NULL)
+	  *BytesProcessed = DataStream - (const uint8_t*)Buffer;
+
+	return ENDPOINT_RWSTREAM_NoError;
+}
+
+uint8_t Endpoint_Read_Stream_LE(void* const Buffer, uint16_t Length, uint16_t* const BytesProcessed)
+{
+	uint8_t* DataStream = (uint8_t*)Buffer;
+
+	while (Length--)
+	  *DataStream++ = Endpoint_Read_8();
+
+	if (BytesProcessed != NULL)
+	  *BytesProcessed = DataStream - (uint8_t*)Buffer;
+
+	return ENDPOINT_RWSTREAM_NoError;
+}
+
+uint8_t Endpoint_Write_Control_Stream_LE(const void* const Buffer, uint16_t Length)
+{
+	const uint8_t* DataStream = (const uint8_t*)Buffer;
+
+	if (Length > USB_ControlRequest.wLength)
+	  Length = USB_ControlRequest.wLength;
+
+	Endpoint_SelectEndpoint(0);
+	while (Length--)
+	  Endpoint_Write_8(*DataStream++);
+
+	return ENDPOINT_RWCSTREAM_NoError;
+}
+
+uint8_t Endpoint_Write_Control_PStream_LE(const void* const Buffer, uint16_t Length)
+{
+	return Endpoint_Write_Control_Stream_LE(Buffer, Length);
+}
+
+uint8_t Endpoint_Read_Control_Stream_LE(void* const Buffer, uint16_t Length)
+{
+	if (Length > Shim_ControlOUTLength)
+	  return ENDPOINT_RWCSTREAM_HostAborted;
+
+	memcpy(Buffer, Shim_ControlOUT, Length);
+	return ENDPOINT_RWCSTREAM_NoError;
+}
+
+bool Shim_Endpoint_QueueOUT(const uint8_t Address, const void* const Data, const uint16_t Length)
+{
+	Shim_Endpoint_t* Endpoint = &Shim_Endpoints[Address & ENDPOINT_EPNUM_MASK];
+
+	if (!(Endpoint->Configured) || (Endpoint->Length > 0) || (Length > Endpoint->Size))
+	  return false;
+
+	memcpy(Endpoint->Data, Data, Length);
+	Endpoint->Length   = Length;
+	Endpoint->Position = 0;
+	return true;
+}
+
+/** Handles the standard requests the LUFA device core would process itself, after the application has had a
+ *  chance to claim the request in \ref EVENT_USB_Device_ControlRequest().
+ */
+static void USB_Device_ProcessStandardRequest(void)
+{
+	const void* DescriptorPointer;
+	uint16_t    DescriptorSize;
+
+	switch (USB_ControlRequest.bRequest)
+	{
+		case REQ_GetDescriptor:
+			DescriptorSize = CALLBACK_USB_GetDescriptor(USB_ControlRequest.wValue, USB_ControlRequest.wIndex,
+			                                            &DescriptorPointer);
+			if (DescriptorSize == NO_DESCRIPTOR)
+			  return;
+
+			Endpoint_ClearSETUP();
+			Endpoint_Write_Control_PStream_LE(DescriptorPointer, DescriptorSize);
+			break;
+		case REQ_SetAddress:
+			Endpoint_ClearSETUP();
+			USB_DeviceState = (USB_ControlRequest.wValue & 0x7F) ? DEVICE_STATE_Addressed : DEVICE_STATE_Default;
+			break;
+		case REQ_SetConfiguration:
+			if (USB_ControlRequest.wValue > 1)
+			  return;
+
+			Endpoint_ClearSETUP();
+			USB_DeviceState = USB_ControlRequest.wValue ? DEVICE_STATE_Configured : DEVICE_STATE_Addressed;
+			EVENT_USB_Device_ConfigurationChanged();
+			break;
+		case REQ_GetConfiguration:
+			Endpoint_ClearSETUP();
+			Endpoint_Write_8(USB_DeviceState == DEVICE_STATE_Configured);
+			break;
+		case REQ_GetStatus:
+			Endpoint_ClearSETUP();
+			Endpoint_Write_16_LE(0);
+			break;
+	}
+}
+
+void USB_Device_ProcessControlRequest(void)
+{
+	Shim_USBStats.ControlINLength = 0;
+	Shim_USBStats.ControlStalled  = false;
+	Shim_SETUPPending             = true;
+
+	EVENT_USB_Device_ControlRequest();
+
+	if (Shim_SETUPPending &&
+	    ((USB_ControlRequest.bmRequestType & CONTROL_REQTYPE_TYPE) == REQTYPE_STANDARD))
+	{
+		Endpoint_SelectEndpoint(0);
+		USB_Device_ProcessStandardRequest();
+	}
+
+	/* Unclaimed requests are stalled, as in the real device core */
+	if (Shim_SETUPPending)
+	  Endpoint_StallTransaction();
+}
+
+/** Sets the data stage for the next host-to-device control request. */
+void Shim_SetControlOUT(const uint8_t* Data, const uint16_t Length)
+{
+	Shim_ControlOUT       = Data;
+	Shim_ControlOUTLength = Length;
+}
+
+bool HID_Device_ConfigureEndpoints(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo)
+{
+	memset(&HIDInterfaceInfo->State, 0x00, sizeof(HIDInterfaceInfo->State));
+	HIDInterfaceInfo->State.UsingReportProtocol = true;
+	HIDInterfaceInfo->State.IdleCount           = 500;
+
+	HIDInterfaceInfo->Config.ReportINEndpoint.Type = EP_TYPE_INTERRUPT;
+	return Endpoint_ConfigureEndpoint(HIDInterfaceInfo->Config.ReportINEndpoint.Address,
+	                                  HIDInterfaceInfo->Config.ReportINEndpoint.Type,
+	                                  HIDInterfaceInfo->Config.ReportINEndpoint.Size,
+	                                  HIDInterfaceInfo->Config.ReportINEndpoint.Banks);
+}
+
+void HID_Device_ProcessControlRequest(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo)
+{
+	if (!(Endpoint_IsSETUPReceived()))
+	  return;
+
+	if ((USB_ControlRequest.wIndex != HIDInterfaceInfo->Config.InterfaceNumber) ||
+	    ((USB_ControlRequest.bmRequestType & CONTROL_REQTYPE_TYPE) != REQTYPE_CLASS))
+	  return;
+
+	switch (USB_ControlRequest.bRequest)
+	{
+		case HID_REQ_GetReport:
+		{
+			uint8_t  ReportData[64];
+			uint8_t  ReportID   = (USB_ControlRequest.wValue & 0xFF);
+			uint16_t ReportSize = 0;
+
+			memset(ReportData, 0x00, sizeof(ReportData));
+			CALLBACK_HID_Device_CreateHIDReport(HIDInterfaceInfo, &ReportID, (USB_ControlRequest.wValue >> 8) - 1,
+			                                    ReportData, &ReportSize);
+
+			Endpoint_ClearSETUP();
+			Endpoint_Write_Control_Stream_LE(ReportData, ReportSize);
+			Endpoint_ClearOUT();
+			break;
+		}
+		case HID_REQ_GetProtocol:
+			Endpoint_ClearSETUP();
+			Endpoint_Write_8(HIDInterfaceInfo->State.UsingReportProtocol);
+			Endpoint_ClearIN();
+			Endpoint_ClearStatusStage();
+			break;
+		case HID_REQ_SetProtocol:
+			Endpoint_ClearSETUP();
+			Endpoint_ClearStatusStage();
+			HIDInterfaceInfo->State.UsingReportProtocol = ((USB_ControlRequest.wValue & 0xFF) != 0x00);
+			break;
+		case HID_REQ_SetIdle:
+			Endpoint_ClearSETUP();
+			Endpoint_ClearStatusStage();
+			HIDInterfaceInfo->State.IdleCount = ((USB_ControlRequest.wValue & 0xFF00) >> 6);
+			break;
+		case HID_REQ_GetIdle:
+			Endpoint_ClearSETUP();
+			Endpoint_Write_8(HIDInterfaceInfo->State.IdleCount >> 2);
+			Endpoint_ClearIN();
+			Endpoint_ClearStatusStage();
+			break;
+	}
+}
+
+void HID_Device_USBTask(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo)
+{
+	if (USB_DeviceState != DEVICE_STATE_Configured)
+	  return;
+
+	if (HIDInterfaceInfo->State.PrevFrameNum == USB_Device_GetFrameNumber())
+	  return;
+
+	uint8_t  ReportINData[64];
+	uint8_t  ReportID     = 0;
+	uint16_t ReportINSize = 0;
+
+	memset(ReportINData, 0x00, sizeof(ReportINData));
+
+	bool ForceSend         = CALLBACK_HID_Device_CreateHIDReport(HIDInterfaceInfo, &ReportID, HID_REPORT_ITEM_In,
+	                                                             ReportINData, &ReportINSize);
+	bool StatesChanged     = false;
+	bool IdlePeriodElapsed = (HIDInterfaceInfo->State.IdleCount && !(HIDInterfaceInfo->State.IdleMSRemaining));
+
+	if (HIDInterfaceInfo->Config.PrevReportINBuffer != NULL)
+	{
+		StatesChanged = (memcmp(ReportINData, HIDInterfaceInfo->Config.PrevReportINBuffer, ReportINSize) != 0);
+		memcpy(HIDInterfaceInfo->Config.PrevReportINBuffer, ReportINData, HIDInterfaceInfo->Config.PrevReportINBufferSize);
+	}
+
+	if (ReportINSize && (ForceSend || StatesChanged || IdlePeriodElapsed))
+	{
+		HIDInterfaceInfo->State.IdleMSRemaining = HIDInterfaceInfo->State.IdleCount;
+
+		Endpoint_SelectEndpoint(HIDInterfaceInfo->Config.ReportINEndpoint.Address);
+		Endpoint_Write_Stream_LE(ReportINData, ReportINSize, NULL);
+		Endpoint_ClearIN();
+	}
+
+	HIDInterfaceInfo->State.PrevFrameNum = USB_Device_GetFrameNumber();
+}
+
+void HID_Device_MillisecondElapsed(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo)
+{
+	if (HIDInterfaceInfo->State.IdleMSRemaining)
+	  HIDInterfaceInfo->State.IdleMSRemaining--;
+}
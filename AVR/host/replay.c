@@ -0,0 +1,367 @@
+/*
+  Copyright 2026  The fwupd-test-firmware authors
+
+  Permission to use, copy, modify, distribute, and sell this
+  software and its documentation for any purpose is hereby granted
+  without fee, provided that the above copyright notice appear in
+  all copies and that both that the copyright notice and this
+  permission notice and warranty disclaimer appear in supporting
+  documentation, and that the name of the author not be used in
+  advertising or publicity pertaining to distribution of the
+  software without specific, written prior permission.
+
+  The author disclaims all warranties with regard to this
+  software, including all implied warranties of merchantability
+  and fitness.  In no event shall the author be liable for any
+  special, indirect or consequential damages or any damages
+  whatsoever resulting from loss of use, data or profits, whether
+  in an action of contract, negligence or other tortious action,
+  arising out of or in connection with the use or performance of
+  this software.
+*/
+
+
+/** \file
+ *
+ *  Replay harness for the host build of the Mouse+DFU demo. Recorded host traffic is read from a text file and
+ *  fed to the unmodified Mouse.c and Descriptors.c through the LUFA shim, timing each request. Each line of the
+ *  recording is one of:
+ *
+ *    ctrl <bmRequestType> <bRequest> <wValue> <wIndex> <wLength> [<out-data>] [expect=<in-data>|expect=stall]
+ *    bulk <endpoint> <data>
+ *    sof <frames>
+ *    joystick <mask>
+ *    buttons <mask>
+ *
+ *  where numbers are hexadecimal and data is a string of hex bytes. Blank lines and lines starting with '#' are
+ *  ignored. A mismatch against an expect= field is reported and makes the harness exit with a failure.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "Mouse.h"
+
+extern USB_ClassInfo_HID_Device_t Mouse_HID_Interface;
+
+/** Maximum length of a single line in a recording, enough for a 512 byte data stage in hex. */
+#define REPLAY_LINE_MAX               2048
+
+/** Maximum number of distinct request kinds reported separately. */
+#define REPLAY_KINDS_MAX              64
+
+/** Accumulated handling cost for one kind of request. */
+typedef struct
+{
+	char     Name[48];
+	uint64_t Count;
+	uint64_t Total;
+	uint64_t Min;
+	uint64_t Max;
+} Replay_Kind_t;
+
+static Replay_Kind_t Replay_Kinds[REPLAY_KINDS_MAX];
+static unsigned      Replay_KindCount;
+static unsigned      Replay_Failures;
+static unsigned      Replay_Detaches;
+
+/** Returns a timestamp in CPU cycles where the TSC is available, or in nanoseconds elsewhere. */
+static inline uint64_t Replay_Now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+static void Replay_Account(const char* Name, const uint64_t Cost)
+{
+	Replay_Kind_t* Kind = NULL;
+
+	for (unsigned i = 0; i < Replay_KindCount; i++)
+	{
+		if (strcmp(Replay_Kinds[i].Name, Name) == 0)
+		{
+			Kind = &Replay_Kinds[i];
+			break;
+		}
+	}
+
+	if (Kind == NULL)
+	{
+		if (Replay_KindCount == REPLAY_KINDS_MAX)
+		  return;
+
+		Kind = &Replay_Kinds[Replay_KindCount++];
+		snprintf(Kind->Name, sizeof(Kind->Name), "%s", Name);
+		Kind->Min = UINT64_MAX;
+	}
+
+	Kind->Count++;
+	Kind->Total += Cost;
+	if (Cost < Kind->Min)
+	  Kind->Min = Cost;
+	if (Cost > Kind->Max)
+	  Kind->Max = Cost;
+}
+
+/** Parses a string of hex bytes into Buffer, returning the number of bytes or -1 on error. */
+static int Replay_ParseHex(const char* Hex, uint8_t* Buffer, const size_t BufferSize)
+{
+	size_t Length = strlen(Hex);
+
+	if ((Length % 2) || ((Length / 2) > BufferSize))
+	  return -1;
+
+	for (size_t i = 0; i < Length / 2; i++)
+	{
+		unsigned Byte;
+
+		if (sscanf(&Hex[i * 2], "%2x", &Byte) != 1)
+		  return -1;
+
+		Buffer[i] = Byte;
+	}
+
+	return Length / 2;
+}
+
+/** Returns the emulated device to its power-on state, as happens when it reboots into the bootloader. */
+static void Replay_ResetDevice(void)
+{
+	dfu_runtime_init();
+	SetupHardware();
+	EVENT_USB_Device_Connect();
+}
+
+static bool Replay_Control(char* Args, const unsigned LineNumber)
+{
+	static uint8_t OutData[512];
+	uint8_t  Expected[512];
+	int      ExpectedLength = -1;
+	bool     ExpectStall    = false;
+	int      OutLength      = 0;
+	unsigned bmRequestType, bRequest, wValue, wIndex, wLength;
+	char     Name[48];
+	char*    Token;
+
+	if (sscanf(Args, "%x %x %x %x %x", &bmRequestType, &bRequest, &wValue, &wIndex, &wLength) != 5)
+	  return false;
+
+	/* Skip the five numeric fields, then look for the optional data and expectation */
+	Token = strtok(Args, " \t");
+	for (int i = 0; (i < 5) && (Token != NULL); i++)
+	  Token = strtok(NULL, " \t");
+
+	for (; Token != NULL; Token = strtok(NULL, " \t"))
+	{
+		if (strcmp(Token, "expect=stall") == 0)
+		  ExpectStall = true;
+		else if (strncmp(Token, "expect=", 7) == 0)
+		  ExpectedLength = Replay_ParseHex(&Token[7], Expected, sizeof(Expected));
+		else
+		  OutLength = Replay_ParseHex(Token, OutData, sizeof(OutData));
+
+		if ((OutLength < 0) || (Token[0] == 'e' && !ExpectStall && (ExpectedLength < 0)))
+		  return false;
+	}
+
+	USB_ControlRequest.bmRequestType = bmRequestType;
+	USB_ControlRequest.bRequest      = bRequest;
+	USB_ControlRequest.wValue        = wValue;
+	USB_ControlRequest.wIndex        = wIndex;
+	USB_ControlRequest.wLength       = wLength;
+	Shim_SetControlOUT(OutData, OutLength);
+
+	uint64_t Start = Replay_Now();
+	USB_Device_ProcessControlRequest();
+	uint64_t Cost = Replay_Now() - Start;
+
+	snprintf(Name, sizeof(Name), "ctrl %02x/%02x", bmRequestType, bRequest);
+	Replay_Account(Name, Cost);
+
+	if (ExpectStall != Shim_USBStats.ControlStalled)
+	{
+		fprintf(stderr, "line %u: request was %sstalled\n", LineNumber, Shim_USBStats.ControlStalled ? "" : "not ");
+		Replay_Failures++;
+	}
+	else if ((ExpectedLength >= 0) &&
+	         ((ExpectedLength != Shim_USBStats.ControlINLength) ||
+	          (memcmp(Expected, Shim_USBStats.ControlIN, ExpectedLength) != 0)))
+	{
+		fprintf(stderr, "line %u: data stage did not match the recording\n", LineNumber);
+		Replay_Failures++;
+	}
+
+	/* The real device reboots into the bootloader here, so the rest of the recording sees a fresh device */
+	if (dfu_runtime_detach_pending())
+	{
+		Replay_Detaches++;
+		Replay_ResetDevice();
+	}
+
+	return true;
+}
+
+static bool Replay_Bulk(char* Args)
+{
+	uint8_t  Data[4096];
+	unsigned Endpoint;
+	char     Hex[REPLAY_LINE_MAX];
+	char     Name[48];
+	int      Length;
+
+	if ((sscanf(Args, "%x %2047s", &Endpoint, Hex) != 2) ||
+	    ((Length = Replay_ParseHex(Hex, Data, sizeof(Data))) < 0))
+	  return false;
+
+	uint64_t Start = Replay_Now();
+	for (int Offset = 0; Offset < Length; Offset += VENDOR_EPSIZE)
+	{
+		uint16_t PacketLength = ((Length - Offset) > VENDOR_EPSIZE) ? VENDOR_EPSIZE : (Length - Offset);
+
+		if (!(Shim_Endpoint_QueueOUT(Endpoint, &Data[Offset], PacketLength)))
+		  return false;
+
+		Vendor_Task();
+	}
+	uint64_t Cost = Replay_Now() - Start;
+
+	snprintf(Name, sizeof(Name), "bulk %02x", Endpoint);
+	Replay_Account(Name, Cost);
+	return true;
+}
+
+static bool Replay_StartOfFrame(const char* Args)
+{
+	unsigned long Frames = strtoul(Args, NULL, 16);
+
+	for (unsigned long i = 0; i < Frames; i++)
+	{
+		uint64_t Start = Replay_Now();
+		Shim_USB_StartOfFrame();
+		HID_Device_USBTask(&Mouse_HID_Interface);
+		Vendor_Task();
+		Replay_Account("sof", Replay_Now() - Start);
+	}
+
+	return true;
+}
+
+static bool Replay_File(const char* Filename)
+{
+	char     Line[REPLAY_LINE_MAX];
+	unsigned LineNumber = 0;
+	FILE*    File       = fopen(Filename, "r");
+
+	if (File == NULL)
+	{
+		fprintf(stderr, "%s: %s\n", Filename, strerror(errno));
+		return false;
+	}
+
+	while (fgets(Line, sizeof(Line), File) != NULL)
+	{
+		char* Command = Line;
+		char* Args;
+		bool  Success = true;
+
+		LineNumber++;
+		Line[strcspn(Line, "\r\n")] = '\0';
+		while ((*Command == ' ') || (*Command == '\t'))
+		  Command++;
+
+		if ((*Command == '\0') || (*Command == '#'))
+		  continue;
+
+		Args = Command + strcspn(Command, " \t");
+		if (*Args != '\0')
+		  *Args++ = '\0';
+
+		if (strcmp(Command, "ctrl") == 0)
+		  Success = Replay_Control(Args, LineNumber);
+		else if (strcmp(Command, "bulk") == 0)
+		  Success = Replay_Bulk(Args);
+		else if (strcmp(Command, "sof") == 0)
+		  Success = Replay_StartOfFrame(Args);
+		else if (strcmp(Command, "joystick") == 0)
+		  Shim_Joystick = strtoul(Args, NULL, 16);
+		else if (strcmp(Command, "buttons") == 0)
+		  Shim_Buttons = strtoul(Args, NULL, 16);
+		else
+		  Success = false;
+
+		if (!(Success))
+		{
+			fprintf(stderr, "%s:%u: cannot parse '%s'\n", Filename, LineNumber, Command);
+			fclose(File);
+			return false;
+		}
+	}
+
+	fclose(File);
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned long Iterations = 1;
+	uint64_t      Total      = 0;
+	int           FirstFile  = 1;
+
+	if ((argc > 2) && (strcmp(argv[1], "-n") == 0))
+	{
+		Iterations = strtoul(argv[2], NULL, 10);
+		FirstFile  = 3;
+	}
+
+	if (FirstFile >= argc)
+	{
+		fprintf(stderr, "Usage: %s [-n ITERATIONS] RECORDING...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	for (unsigned long i = 0; i < Iterations; i++)
+	{
+		for (int j = FirstFile; j < argc; j++)
+		{
+			Replay_ResetDevice();
+			if (!(Replay_File(argv[j])))
+			  return EXIT_FAILURE;
+		}
+	}
+
+#if defined(__x86_64__) || defined(__i386__)
+	const char* Unit = "cycles";
+#else
+	const char* Unit = "ns";
+#endif
+
+	printf("%-16s %10s %12s %10s %10s\n", "request", "count", "mean", "min", "max");
+	for (unsigned i = 0; i < Replay_KindCount; i++)
+	{
+		Replay_Kind_t* Kind = &Replay_Kinds[i];
+
+		printf("%-16s %10llu %12.1f %10llu %10llu\n", Kind->Name, (unsigned long long)Kind->Count,
+		       (double)Kind->Total / Kind->Count, (unsigned long long)Kind->Min, (unsigned long long)Kind->Max);
+		Total += Kind->Total;
+	}
+
+	printf("total %s: %llu\n", Unit, (unsigned long long)Total);
+	printf("detaches: %u\n", Replay_Detaches);
+	printf("HID reports: %u\n", Shim_USBStats.PacketsIN[MOUSE_EPADDR & ENDPOINT_EPNUM_MASK]);
+
+	if (Replay_Failures)
+	{
+		fprintf(stderr, "%u mismatches against the recording\n", Replay_Failures);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
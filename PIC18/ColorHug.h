@@ -26,6 +26,7 @@
 
 #define CH_EP0_TRANSFER_SIZE		0x400
 #define CH_USB_INTERFACE		0x00
+#define CH_DFU_INTERFACE		0x01
 
 typedef enum {
 	/* dummy */
@@ -0,0 +1,44 @@
+# Shared by the bootloader and firmware builds.
+#
+# Each source is compiled to a p-code file with --pass1 and the p-code is then
+# linked, so only the sources that changed are recompiled. The ColorHug helpers
+# do not depend on usb_config.h, so they are compiled once into ../obj and
+# linked into both images.
+#
+# The .hex images are converted to .dfu by contrib/hex2dfu, which is built with
+# the host compiler.
+
+PK2CMD_DIR="../../../../pk2cmd/pk2cmd"
+CC="/opt/microchip/xc8/v1.34/bin/xc8"
+
+# common to bootloader and firmware
+CFLAGS="--chip=18F46J50 "
+CFLAGS+="--asmlist "
+CFLAGS+="--opt=+speed "
+CFLAGS+="-w3 "
+CFLAGS+="-nw=3004 "
+
+CHUG_H =						\
+	../ch-config.h					\
+	../ch-errno.h					\
+	../ch-flash.h					\
+	../ColorHug.h
+CHUG_P1 =						\
+	../obj/ch-config.p1				\
+	../obj/ch-errno.p1				\
+	../obj/ch-flash.p1
+
+HEX2DFU = ../../contrib/hex2dfu
+
+shared: $(CHUG_P1) $(HEX2DFU)
+
+../obj:
+	mkdir -p $@
+
+../obj/%.p1: ../%.c $(CHUG_H) | ../obj
+	$(CC) $(CFLAGS) --pass1 --outdir=../obj $<
+
+$(HEX2DFU): ../../contrib/hex2dfu.c
+	$(MAKE) -C ../../contrib hex2dfu
+
+.PHONY: shared
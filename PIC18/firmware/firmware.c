@@ -32,6 +32,7 @@
 #include "ch-config.h"
 #include "ch-errno.h"
 #include "ch-flash.h"
+#include "dfu-runtime.h"
 
 static CHugConfig		 _cfg;
 static ChError			 _last_error = CH_ERROR_NONE;
@@ -124,19 +125,48 @@ _send_data_stage_cb(bool transfer_ok, void *context)
 	return 0;
 }
 
+static int8_t
+_dfu_detach_cb(bool transfer_ok, void *context)
+{
+	/* the host has seen the status stage, so detach ourselves */
+	if (transfer_ok && dfu_runtime_detach_pending())
+		RESET();
+	return 0;
+}
+
+static int8_t
+process_dfu_runtime_setup_request(const struct setup_packet *setup)
+{
+	int8_t len;
+
+	if (setup->REQUEST.destination != DEST_INTERFACE)
+		return -1;
+	if (setup->REQUEST.type != REQUEST_TYPE_CLASS)
+		return -1;
+	if (setup->wIndex != CH_DFU_INTERFACE)
+		return -1;
+
+	len = dfu_runtime_process_request(setup->bRequest,
+					  setup->wLength,
+					  _chug_buf);
+	if (len < 0)
+		return -1;
+	if (len == 0) {
+		usb_send_data_stage(NULL, 0, _dfu_detach_cb, NULL);
+		return 0;
+	}
+	usb_send_data_stage(_chug_buf, len, _send_data_stage_cb, NULL);
+	return 0;
+}
+
 int
 main(void)
 {
-	uint8_t dfu_interfaces[] = { 0x01 };
-
 	/* read config */
 	chug_config_read(&_cfg);
-	usb_dfu_set_state(DFU_STATE_APP_IDLE);
+	dfu_runtime_init();
 	usb_init();
 
-	/* we have to tell the USB stack which interfaces to use */
-	dfu_set_interface_list(dfu_interfaces, 1);
-
 	while (1) {
 		/* clear watchdog */
 		CLRWDT();
@@ -243,7 +273,7 @@ process_chug_setup_request(struct setup_packet *setup)
 int8_t
 chug_unknown_setup_request_callback(const struct setup_packet *setup)
 {
-	if (process_dfu_setup_request(setup) == 0)
+	if (process_dfu_runtime_setup_request(setup) == 0)
 		return 0;
 	if (process_chug_setup_request((struct setup_packet *) setup) == 0)
 		return 0;
@@ -254,7 +284,7 @@ void
 chug_usb_reset_callback(void)
 {
 	/* reset back into DFU mode */
-	if (usb_dfu_get_state() == DFU_STATE_APP_DETACH)
+	if (dfu_runtime_detach_pending())
 		RESET();
 }
 
@@ -49,7 +49,9 @@
 /* DFU configuration functions */
 #define USB_DFU_USE_RUNTIME
 #define DFU_TRANSFER_SIZE		64	/* bytes */
-#define USB_DFU_SUCCESS_FUNC		chug_usb_dfu_set_success_callback
+
+/* the runtime requests are handled by ../../common/dfu-runtime.c, which calls
+ * DFU_RUNTIME_SUCCESS_FUNC (set in the Makefile) once the host reads the status */
 
 /* we expose CHUG _and_ DFU classes */
 #define MULTI_CLASS_DEVICE
@@ -0,0 +1,560 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Builds server sized DMAR, IVRS and PHAT tables from the small ones in
+ * ci-tests, keeping the header, flags and OEM fields of the seed:
+ *
+ *  - DMAR: DMA remapping units spread over PCI segments of 16 units, the
+ *    last of each segment with INCLUDE_PCI_ALL, each other unit with PCI
+ *    endpoint device scopes, and reserved memory regions that point at
+ *    those endpoints.
+ *  - IVRS: one set of the seed's IVHD block types per IOMMU, with eight
+ *    IOMMUs per PCI segment, each with its own device entries.
+ *  - PHAT: firmware version data records holding many version elements,
+ *    and many firmware health data records, copied from the seed ones with
+ *    their GUIDs made unique.
+ *
+ * FACP has a fixed layout, so there is nothing to scale.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ci-acpi.h"
+
+#define GEN_UNITS_DEFAULT		64
+#define GEN_ENTRIES_DEFAULT		16
+#define GEN_RESERVED_DEFAULT		64
+#define GEN_VERSIONS_DEFAULT		4096
+#define GEN_HEALTH_DEFAULT		512
+#define GEN_ENTRIES_MAX			4096
+#define GEN_DMAR_UNITS_PER_SEGMENT	16
+#define GEN_DMAR_BASE			0xfc000000
+#define GEN_IVRS_IOMMUS_PER_SEGMENT	8
+#define GEN_PHAT_VERSIONS_PER_RECORD	2048
+#define GEN_PHAT_VERSION_LEN		28
+
+typedef struct {
+	unsigned	 units;			/* DMAR units, IOMMUs */
+	unsigned	 entries;		/* per unit */
+	unsigned	 reserved;		/* RMRRs */
+	unsigned	 versions;
+	unsigned	 health;
+} GenOptions;
+
+typedef struct {
+	uint8_t		*buf;
+	size_t		 len;
+	size_t		 size;
+} GenBuf;
+
+static uint8_t *
+gen_read_file(const char *filename, size_t *len)
+{
+	struct stat st;
+	uint8_t *buf = NULL;
+	size_t done = 0;
+	int fd = open(filename, O_RDONLY);
+
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "failed to open %s: %s\n", filename, strerror(errno));
+		goto out;
+	}
+	buf = malloc(st.st_size + 1);
+	if (buf == NULL)
+		goto out;
+	while (done < (size_t) st.st_size) {
+		ssize_t n = read(fd, buf + done, st.st_size - done);
+		if (n <= 0) {
+			fprintf(stderr, "failed to read %s\n", filename);
+			free(buf);
+			buf = NULL;
+			goto out;
+		}
+		done += n;
+	}
+	*len = done;
+out:
+	if (fd >= 0)
+		close(fd);
+	return buf;
+}
+
+static uint16_t
+gen_get_u16(const uint8_t *buf)
+{
+	return buf[0] | buf[1] << 8;
+}
+
+static uint32_t
+gen_get_u32(const uint8_t *buf)
+{
+	return buf[0] | buf[1] << 8 | buf[2] << 16 | (uint32_t) buf[3] << 24;
+}
+
+static uint64_t
+gen_get_u64(const uint8_t *buf)
+{
+	return gen_get_u32(buf) | (uint64_t) gen_get_u32(buf + 4) << 32;
+}
+
+static void
+gen_put_u16(uint8_t *buf, uint16_t val)
+{
+	buf[0] = val;
+	buf[1] = val >> 8;
+}
+
+static void
+gen_put_u32(uint8_t *buf, uint32_t val)
+{
+	for (unsigned i = 0; i < 4; i++)
+		buf[i] = val >> (i * 8);
+}
+
+static void
+gen_put_u64(uint8_t *buf, uint64_t val)
+{
+	for (unsigned i = 0; i < 8; i++)
+		buf[i] = val >> (i * 8);
+}
+
+/* returns where the data went, which moves when the buffer grows */
+static uint8_t *
+gen_append(GenBuf *b, const void *data, size_t len)
+{
+	uint8_t *dst;
+
+	if (b->len + len > b->size) {
+		size_t size = b->size > 0 ? b->size * 2 : 64 * 1024;
+		uint8_t *tmp;
+		while (size < b->len + len)
+			size *= 2;
+		tmp = realloc(b->buf, size);
+		if (tmp == NULL)
+			return NULL;
+		b->buf = tmp;
+		b->size = size;
+	}
+	dst = b->buf + b->len;
+	if (data != NULL)
+		memcpy(dst, data, len);
+	else
+		memset(dst, 0, len);
+	b->len += len;
+	return dst;
+}
+
+/* the seed structure of a DMAR type, optionally with some flags set */
+static const uint8_t *
+gen_dmar_find(const uint8_t *seed, size_t len, uint16_t type, int include_all)
+{
+	for (size_t pos = CI_ACPI_DMAR_HEADER_LEN; pos + 4 <= len;) {
+		uint16_t st_len = gen_get_u16(seed + pos + 2);
+		if (gen_get_u16(seed + pos) == type &&
+		    (type != 0 || (seed[pos + 4] & 1) == include_all))
+			return seed + pos;
+		pos += st_len;
+	}
+	return NULL;
+}
+
+/* the PCI endpoint behind a unit, as bus, device and function */
+static void
+gen_dmar_endpoint(unsigned unit, unsigned entry, uint8_t path[3])
+{
+	unsigned k = unit % GEN_DMAR_UNITS_PER_SEGMENT;
+
+	path[0] = k * 16 + entry / 256;
+	path[1] = entry / 8 % 32;
+	path[2] = entry % 8;
+}
+
+static int
+gen_dmar(GenBuf *b, const uint8_t *seed, size_t len, const GenOptions *opts)
+{
+	const uint8_t *drhd = gen_dmar_find(seed, len, 0, 0);
+	const uint8_t *drhd_all = gen_dmar_find(seed, len, 0, 1);
+	const uint8_t *rmrr = gen_dmar_find(seed, len, 1, 0);
+	unsigned n_segments = (opts->units + GEN_DMAR_UNITS_PER_SEGMENT - 1) / GEN_DMAR_UNITS_PER_SEGMENT;
+	unsigned n_endpoint_units = 0;
+
+	if (drhd == NULL)
+		drhd = drhd_all;
+	if (drhd_all == NULL)
+		drhd_all = drhd;
+	if (drhd == NULL) {
+		fprintf(stderr, "seed has no DRHD structure\n");
+		return -1;
+	}
+	if (gen_append(b, seed, CI_ACPI_DMAR_HEADER_LEN) == NULL)
+		return -1;
+
+	/* the INCLUDE_PCI_ALL unit of a segment has to be its last */
+	for (unsigned u = 0; u < opts->units; u++) {
+		unsigned segment = u / GEN_DMAR_UNITS_PER_SEGMENT;
+		int include_all = u == opts->units - 1 || u % GEN_DMAR_UNITS_PER_SEGMENT == GEN_DMAR_UNITS_PER_SEGMENT - 1;
+		const uint8_t *tmpl = include_all ? drhd_all : drhd;
+		uint16_t tmpl_len = gen_get_u16(tmpl + 2);
+		uint8_t *st;
+		size_t st_len = 16;
+
+		if (include_all && segment == 0)
+			st_len = tmpl_len;
+		else if (!include_all)
+			st_len += opts->entries * 8;
+		if (st_len > 0xffff) {
+			fprintf(stderr, "too many device scopes for one unit\n");
+			return -1;
+		}
+		st = gen_append(b, NULL, st_len);
+		if (st == NULL)
+			return -1;
+		memcpy(st, tmpl, include_all && segment == 0 ? tmpl_len : 16);
+		gen_put_u16(st + 2, st_len);
+		st[4] = include_all ? 1 : 0;
+		gen_put_u16(st + 6, segment);
+		if (!include_all || segment != 0)
+			gen_put_u64(st + 8, GEN_DMAR_BASE + (uint64_t) u * 0x1000);
+		if (include_all)
+			continue;
+		n_endpoint_units++;
+		for (unsigned e = 0; e < opts->entries; e++) {
+			uint8_t *scope = st + 16 + e * 8;
+			uint8_t path[3];
+			gen_dmar_endpoint(u, e, path);
+			scope[0] = 1;			/* PCI endpoint */
+			scope[1] = 8;
+			scope[5] = path[0];
+			scope[6] = path[1];
+			scope[7] = path[2];
+		}
+	}
+
+	/* each region is for an endpoint of a unit, in turn */
+	for (unsigned i = 0; rmrr != NULL && i < opts->reserved; i++) {
+		uint16_t rmrr_len = gen_get_u16(rmrr + 2);
+		uint64_t base = gen_get_u64(rmrr + 8);
+		uint64_t size = gen_get_u64(rmrr + 16) - base + 1;
+		uint64_t stride = (size + 0xfffff) & ~(uint64_t) 0xfffff;
+		uint8_t *st = gen_append(b, rmrr, rmrr_len);
+		if (st == NULL)
+			return -1;
+		gen_put_u64(st + 8, base + i * stride);
+		gen_put_u64(st + 16, base + i * stride + size - 1);
+		if (n_endpoint_units > 0 && opts->entries > 0 && rmrr_len >= 32) {
+			unsigned unit = i % n_endpoint_units;
+			unsigned entry = i / n_endpoint_units % opts->entries;
+			uint8_t path[3];
+			/* the endpoint units are all but the last of each segment */
+			unit = unit / (GEN_DMAR_UNITS_PER_SEGMENT - 1) * GEN_DMAR_UNITS_PER_SEGMENT +
+			       unit % (GEN_DMAR_UNITS_PER_SEGMENT - 1);
+			gen_dmar_endpoint(unit, entry, path);
+			gen_put_u16(st + 6, unit / GEN_DMAR_UNITS_PER_SEGMENT);
+			st[24] = 1;
+			st[25] = 8;
+			st[29] = path[0];
+			st[30] = path[1];
+			st[31] = path[2];
+		}
+	}
+
+	/* ATSR, RHSA, ANDD and SATC follow in the seed order */
+	for (size_t pos = CI_ACPI_DMAR_HEADER_LEN; pos + 4 <= len;) {
+		uint16_t st_len = gen_get_u16(seed + pos + 2);
+		if (gen_get_u16(seed + pos) > 1 && gen_append(b, seed + pos, st_len) == NULL)
+			return -1;
+		pos += st_len;
+	}
+	printf("DMAR: %u units on %u segments, %u device scopes each, %u reserved regions\n",
+	       opts->units, n_segments, opts->entries, rmrr != NULL ? opts->reserved : 0);
+	return 0;
+}
+
+static size_t
+gen_ivhd_header_len(uint8_t type)
+{
+	return type == 0x10 ? 24 : 40;
+}
+
+static int
+gen_ivrs(GenBuf *b, const uint8_t *seed, size_t len, const GenOptions *opts)
+{
+	const uint8_t *templates[3] = { NULL, NULL, NULL };
+	static const uint8_t types[3] = { 0x10, 0x11, 0x40 };
+	unsigned n_blocks = 0;
+
+	/* the IVHD of each type with the most device entries */
+	for (size_t pos = CI_ACPI_IVRS_HEADER_LEN; pos + 4 <= len;) {
+		uint16_t block_len = gen_get_u16(seed + pos + 2);
+		for (unsigned t = 0; t < 3; t++) {
+			if (seed[pos] == types[t] && block_len >= gen_ivhd_header_len(types[t]) &&
+			    (templates[t] == NULL || block_len > gen_get_u16(templates[t] + 2)))
+				templates[t] = seed + pos;
+		}
+		pos += block_len;
+	}
+	if (gen_append(b, seed, CI_ACPI_IVRS_HEADER_LEN) == NULL)
+		return -1;
+	for (unsigned i = 0; i < opts->units; i++) {
+		unsigned segment = i / GEN_IVRS_IOMMUS_PER_SEGMENT;
+		uint8_t bus = i % GEN_IVRS_IOMMUS_PER_SEGMENT * 0x20;
+		for (unsigned t = 0; t < 3; t++) {
+			const uint8_t *tmpl = templates[t];
+			size_t hdr_len = gen_ivhd_header_len(types[t]);
+			size_t block_len;
+			size_t block_start = b->len;
+			uint8_t *block;
+			if (tmpl == NULL)
+				continue;
+
+			/* the seed entries are kept for the first IOMMU only */
+			block_len = i == 0 ? gen_get_u16(tmpl + 2) : hdr_len;
+			block = gen_append(b, tmpl, block_len);
+			if (block == NULL)
+				return -1;
+			gen_put_u16(block + 4, bus << 8 | 0x02);
+			gen_put_u64(block + 8, gen_get_u64(tmpl + 8) + (uint64_t) i * 0x80000);
+			gen_put_u16(block + 16, segment);
+
+			/* selects on the buses behind the IOMMU, some extended */
+			for (unsigned e = 0; e < opts->entries; e++) {
+				uint16_t devid = (bus + 1 + e / 256) << 8 | e % 256;
+				uint8_t *entry = gen_append(b, NULL, e % 16 == 15 ? 8 : 4);
+				if (entry == NULL)
+					return -1;
+				entry[0] = e % 16 == 15 ? 0x46 : 0x02;
+				gen_put_u16(entry + 1, devid);
+			}
+			block_len = b->len - block_start;
+			if (block_len > 0xffff) {
+				fprintf(stderr, "too many device entries for one IVHD\n");
+				return -1;
+			}
+			gen_put_u16(b->buf + block_start + 2, block_len);
+			n_blocks++;
+		}
+	}
+
+	/* IVMD blocks */
+	for (size_t pos = CI_ACPI_IVRS_HEADER_LEN; pos + 4 <= len;) {
+		uint16_t block_len = gen_get_u16(seed + pos + 2);
+		if (seed[pos] >= 0x20 && seed[pos] <= 0x22 && gen_append(b, seed + pos, block_len) == NULL)
+			return -1;
+		pos += block_len;
+	}
+	printf("IVRS: %u IOMMUs, %u IVHD blocks, %u device entries each\n",
+	       opts->units, n_blocks, opts->entries);
+	return 0;
+}
+
+/* makes a copy of a seed GUID unique, for copies after the first */
+static void
+gen_guid_mutate(uint8_t *guid, unsigned copy)
+{
+	gen_put_u32(guid + 12, gen_get_u32(guid + 12) ^ copy);
+}
+
+static int
+gen_phat(GenBuf *b, const uint8_t *seed, size_t len, const GenOptions *opts)
+{
+	const uint8_t *elements = NULL;
+	const uint8_t *health[256];
+	unsigned n_elements = 0;
+	unsigned n_health = 0;
+
+	for (size_t pos = CI_ACPI_HEADER_LEN; pos + 5 <= len;) {
+		uint16_t type = gen_get_u16(seed + pos);
+		uint16_t rec_len = gen_get_u16(seed + pos + 2);
+		if (type == 0 && elements == NULL && rec_len >= 12) {
+			elements = seed + pos + 12;
+			n_elements = gen_get_u32(seed + pos + 8);
+		} else if (type == 1 && n_health < 256) {
+			health[n_health++] = seed + pos;
+		}
+		pos += rec_len;
+	}
+	if ((opts->versions > 0 && n_elements == 0) || (opts->health > 0 && n_health == 0)) {
+		fprintf(stderr, "seed has no records to repeat\n");
+		return -1;
+	}
+	if (gen_append(b, seed, CI_ACPI_HEADER_LEN) == NULL)
+		return -1;
+	for (unsigned v = 0; v < opts->versions; v += GEN_PHAT_VERSIONS_PER_RECORD) {
+		unsigned count = opts->versions - v;
+		uint8_t *rec;
+		if (count > GEN_PHAT_VERSIONS_PER_RECORD)
+			count = GEN_PHAT_VERSIONS_PER_RECORD;
+		rec = gen_append(b, NULL, 12 + count * GEN_PHAT_VERSION_LEN);
+		if (rec == NULL)
+			return -1;
+		gen_put_u16(rec + 2, 12 + count * GEN_PHAT_VERSION_LEN);
+		rec[4] = 1;
+		gen_put_u32(rec + 8, count);
+		for (unsigned i = 0; i < count; i++) {
+			unsigned k = v + i;
+			uint8_t *el = rec + 12 + i * GEN_PHAT_VERSION_LEN;
+			memcpy(el, elements + k % n_elements * GEN_PHAT_VERSION_LEN, GEN_PHAT_VERSION_LEN);
+			gen_guid_mutate(el, k / n_elements);
+			gen_put_u64(el + 16, gen_get_u64(el + 16) + k / n_elements);
+		}
+	}
+	for (unsigned h = 0; h < opts->health; h++) {
+		const uint8_t *tmpl = health[h % n_health];
+		uint8_t *rec = gen_append(b, tmpl, gen_get_u16(tmpl + 2));
+		if (rec == NULL)
+			return -1;
+		gen_guid_mutate(rec + 8, h / n_health);
+	}
+
+	/* any other record types */
+	for (size_t pos = CI_ACPI_HEADER_LEN; pos + 5 <= len;) {
+		uint16_t rec_len = gen_get_u16(seed + pos + 2);
+		if (gen_get_u16(seed + pos) > 1 && gen_append(b, seed + pos, rec_len) == NULL)
+			return -1;
+		pos += rec_len;
+	}
+	printf("PHAT: %u version elements, %u health records\n", opts->versions, opts->health);
+	return 0;
+}
+
+static void
+gen_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [OPTION...] SEED OUTPUT\n"
+		"  -n, --units=N            DMAR units or IOMMUs, default %u\n"
+		"  -e, --entries=N          device scopes or entries per unit, default %u\n"
+		"  -r, --reserved=N         DMAR reserved memory regions, default %u\n"
+		"  -v, --versions=N         PHAT version elements, default %u\n"
+		"  -h, --health=N           PHAT health records, default %u\n"
+		"The table type is that of SEED: DMAR, IVRS or PHAT.\n",
+		argv0, GEN_UNITS_DEFAULT, GEN_ENTRIES_DEFAULT, GEN_RESERVED_DEFAULT,
+		GEN_VERSIONS_DEFAULT, GEN_HEALTH_DEFAULT);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct option options[] = {
+		{ "units",		required_argument, NULL, 'n' },
+		{ "entries",		required_argument, NULL, 'e' },
+		{ "reserved",		required_argument, NULL, 'r' },
+		{ "versions",		required_argument, NULL, 'v' },
+		{ "health",		required_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+	GenOptions opts = {
+		.units = GEN_UNITS_DEFAULT,
+		.entries = GEN_ENTRIES_DEFAULT,
+		.reserved = GEN_RESERVED_DEFAULT,
+		.versions = GEN_VERSIONS_DEFAULT,
+		.health = GEN_HEALTH_DEFAULT,
+	};
+	CiAcpiSummary summary;
+	CiAcpiHeader hdr;
+	GenBuf b = { NULL, 0, 0 };
+	uint8_t *seed;
+	size_t seed_len = 0;
+	int rc = EXIT_FAILURE;
+	int ret;
+	int opt;
+	FILE *f;
+
+	while ((opt = getopt_long(argc, argv, "n:e:r:v:h:", options, NULL)) != -1) {
+		switch (opt) {
+		case 'n':
+			opts.units = strtoul(optarg, NULL, 0);
+			break;
+		case 'e':
+			opts.entries = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			opts.reserved = strtoul(optarg, NULL, 0);
+			break;
+		case 'v':
+			opts.versions = strtoul(optarg, NULL, 0);
+			break;
+		case 'h':
+			opts.health = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			gen_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (argc - optind != 2 || opts.units == 0 || opts.units > 0xffff ||
+	    opts.entries > GEN_ENTRIES_MAX) {
+		gen_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	seed = gen_read_file(argv[optind], &seed_len);
+	if (seed == NULL)
+		return EXIT_FAILURE;
+	if (ci_acpi_parse(seed, seed_len, &summary) < 0 ||
+	    ci_acpi_header_parse(seed, seed_len, &hdr) < 0) {
+		fprintf(stderr, "%s is not a valid ACPI table\n", argv[optind]);
+		goto out;
+	}
+	if (strcmp(hdr.signature, "DMAR") == 0) {
+		ret = gen_dmar(&b, seed, hdr.length, &opts);
+	} else if (strcmp(hdr.signature, "IVRS") == 0) {
+		ret = gen_ivrs(&b, seed, hdr.length, &opts);
+	} else if (strcmp(hdr.signature, "PHAT") == 0) {
+		ret = gen_phat(&b, seed, hdr.length, &opts);
+	} else {
+		fprintf(stderr, "cannot scale a %s table\n", hdr.signature);
+		goto out;
+	}
+	if (ret < 0)
+		goto out;
+	gen_put_u32(b.buf + 4, b.len);
+	ci_acpi_checksum_update(b.buf, b.len);
+
+	/* whatever was generated has to parse */
+	if (ci_acpi_parse(b.buf, b.len, &summary) < 0) {
+		fprintf(stderr, "generated table does not parse\n");
+		goto out;
+	}
+	f = fopen(argv[optind + 1], "wb");
+	if (f == NULL) {
+		fprintf(stderr, "failed to open %s: %s\n", argv[optind + 1], strerror(errno));
+		goto out;
+	}
+	if (fwrite(b.buf, 1, b.len, f) != b.len || fclose(f) != 0) {
+		fprintf(stderr, "failed to write %s\n", argv[optind + 1]);
+		goto out;
+	}
+	printf("%s: %zu bytes, %u structures, %u entries\n", argv[optind + 1],
+	       b.len, summary.n_structures, summary.n_entries);
+	rc = EXIT_SUCCESS;
+out:
+	free(b.buf);
+	free(seed);
+	return rc;
+}
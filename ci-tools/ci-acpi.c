@@ -0,0 +1,283 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "ci-acpi.h"
+
+static uint16_t
+ci_acpi_u16(const uint8_t *buf)
+{
+	return buf[0] | buf[1] << 8;
+}
+
+static uint32_t
+ci_acpi_u32(const uint8_t *buf)
+{
+	return buf[0] | buf[1] << 8 | buf[2] << 16 | (uint32_t) buf[3] << 24;
+}
+
+/* checks the length and checksum, returns -1 if either is wrong */
+int
+ci_acpi_header_parse(const uint8_t *buf, size_t len, CiAcpiHeader *hdr)
+{
+	uint8_t sum = 0;
+
+	if (len < CI_ACPI_HEADER_LEN)
+		return -1;
+	memset(hdr, 0, sizeof(CiAcpiHeader));
+	memcpy(hdr->signature, buf, 4);
+	hdr->length = ci_acpi_u32(buf + 4);
+	hdr->revision = buf[8];
+	memcpy(hdr->oem_id, buf + 10, 6);
+	memcpy(hdr->oem_table_id, buf + 16, 8);
+	if (hdr->length < CI_ACPI_HEADER_LEN || hdr->length > len)
+		return -1;
+	for (size_t i = 0; i < hdr->length; i++)
+		sum += buf[i];
+	return sum == 0 ? 0 : -1;
+}
+
+/* sets the checksum byte so the first len bytes sum to zero */
+void
+ci_acpi_checksum_update(uint8_t *buf, size_t len)
+{
+	uint8_t sum = 0;
+
+	buf[9] = 0;
+	for (size_t i = 0; i < len; i++)
+		sum += buf[i];
+	buf[9] = -sum;
+}
+
+/* a PCI device scope: type, length, reserved, enumeration ID, bus, path */
+static int
+ci_acpi_dmar_scopes(const uint8_t *buf, size_t len, CiAcpiSummary *summary)
+{
+	size_t pos = 0;
+
+	while (pos < len) {
+		uint8_t scope_len;
+		if (len - pos < 6)
+			return -1;
+		scope_len = buf[pos + 1];
+		if (scope_len < 6 || scope_len > len - pos || (scope_len - 6) % 2 != 0)
+			return -1;
+		summary->n_entries++;
+		pos += scope_len;
+	}
+	return 0;
+}
+
+int
+ci_acpi_dmar_parse(const uint8_t *buf, size_t len, CiAcpiSummary *summary)
+{
+	CiAcpiHeader hdr;
+	size_t pos = CI_ACPI_DMAR_HEADER_LEN;
+
+	memset(summary, 0, sizeof(CiAcpiSummary));
+	if (ci_acpi_header_parse(buf, len, &hdr) < 0 || memcmp(hdr.signature, "DMAR", 4) != 0 ||
+	    hdr.length < CI_ACPI_DMAR_HEADER_LEN)
+		return -1;
+	summary->flags = buf[37];
+	while (pos < hdr.length) {
+		uint16_t type;
+		uint16_t st_len;
+		size_t scopes = 0;
+		if (hdr.length - pos < 4)
+			return -1;
+		type = ci_acpi_u16(buf + pos);
+		st_len = ci_acpi_u16(buf + pos + 2);
+		if (st_len < 4 || st_len > hdr.length - pos)
+			return -1;
+		switch (type) {
+		case 0:		/* DRHD */
+			scopes = 16;
+			break;
+		case 1:		/* RMRR */
+			scopes = 24;
+			break;
+		case 2:		/* ATSR */
+		case 5:		/* SATC */
+			scopes = 8;
+			break;
+		default:	/* RHSA, ANDD and anything newer have none */
+			break;
+		}
+		if (scopes > st_len)
+			return -1;
+		if (scopes > 0 && ci_acpi_dmar_scopes(buf + pos + scopes, st_len - scopes, summary) < 0)
+			return -1;
+		summary->n_structures++;
+		pos += st_len;
+	}
+	return 0;
+}
+
+/*
+ * The length of an IVHD device entry, as Linux computes it: types below
+ * 0x80 encode it in their top bits, ACPI HID entries end with the length
+ * of their UID. Returns -1 for anything else, or if buf is too short.
+ */
+int
+ci_acpi_ivrs_entry_length(const uint8_t *buf, size_t len)
+{
+	int entry_len;
+
+	if (len < 1)
+		return -1;
+	if (buf[0] < 0x80)
+		entry_len = 4 << (buf[0] >> 6);
+	else if (buf[0] == 0xf0 && len >= 22)
+		entry_len = 22 + buf[21];
+	else
+		return -1;
+	return (size_t) entry_len <= len ? entry_len : -1;
+}
+
+int
+ci_acpi_ivrs_parse(const uint8_t *buf, size_t len, CiAcpiSummary *summary)
+{
+	CiAcpiHeader hdr;
+	size_t pos = CI_ACPI_IVRS_HEADER_LEN;
+
+	memset(summary, 0, sizeof(CiAcpiSummary));
+	if (ci_acpi_header_parse(buf, len, &hdr) < 0 || memcmp(hdr.signature, "IVRS", 4) != 0 ||
+	    hdr.length < CI_ACPI_IVRS_HEADER_LEN)
+		return -1;
+	summary->flags = ci_acpi_u32(buf + 36);
+	while (pos < hdr.length) {
+		uint8_t type;
+		uint16_t block_len;
+		size_t entries = 0;
+		if (hdr.length - pos < 4)
+			return -1;
+		type = buf[pos];
+		block_len = ci_acpi_u16(buf + pos + 2);
+		if (block_len < 4 || block_len > hdr.length - pos)
+			return -1;
+		if (type == 0x10)
+			entries = 24;
+		else if (type == 0x11 || type == 0x40)
+			entries = 40;
+		if (entries > block_len)
+			return -1;
+		if (entries > 0) {
+			for (size_t off = entries; off < block_len;) {
+				int entry_len = ci_acpi_ivrs_entry_length(buf + pos + off, block_len - off);
+				if (entry_len < 0)
+					return -1;
+				summary->n_entries++;
+				off += entry_len;
+			}
+		}
+		summary->n_structures++;
+		pos += block_len;
+	}
+	return 0;
+}
+
+/*
+ * Firmware version data records hold 28 byte elements, firmware health
+ * data records a device path in UTF-16 and then device specific data.
+ */
+int
+ci_acpi_phat_parse(const uint8_t *buf, size_t len, CiAcpiSummary *summary)
+{
+	CiAcpiHeader hdr;
+	size_t pos = CI_ACPI_HEADER_LEN;
+
+	memset(summary, 0, sizeof(CiAcpiSummary));
+	if (ci_acpi_header_parse(buf, len, &hdr) < 0 || memcmp(hdr.signature, "PHAT", 4) != 0)
+		return -1;
+	while (pos < hdr.length) {
+		const uint8_t *rec = buf + pos;
+		uint16_t type;
+		uint16_t rec_len;
+		if (hdr.length - pos < 5)
+			return -1;
+		type = ci_acpi_u16(rec);
+		rec_len = ci_acpi_u16(rec + 2);
+		if (rec_len < 5 || rec_len > hdr.length - pos)
+			return -1;
+		if (type == 0) {
+			uint32_t count;
+			if (rec_len < 12)
+				return -1;
+			count = ci_acpi_u32(rec + 8);
+			if (count > (uint32_t) (rec_len - 12) / 28)
+				return -1;
+			summary->n_entries += count;
+		} else if (type == 1) {
+			uint32_t data_offset;
+			size_t path_end;
+			size_t off = 28;
+			if (rec_len < 28)
+				return -1;
+			data_offset = ci_acpi_u32(rec + 24);
+			if (data_offset > rec_len)
+				return -1;
+			path_end = data_offset != 0 ? data_offset : rec_len;
+			for (; off + 2 <= path_end; off += 2) {
+				if (rec[off] == 0 && rec[off + 1] == 0)
+					break;
+			}
+			if (off + 2 > path_end)
+				return -1;
+		}
+		summary->n_structures++;
+		pos += rec_len;
+	}
+	return 0;
+}
+
+int
+ci_acpi_facp_parse(const uint8_t *buf, size_t len, CiAcpiSummary *summary)
+{
+	CiAcpiHeader hdr;
+
+	memset(summary, 0, sizeof(CiAcpiSummary));
+	if (ci_acpi_header_parse(buf, len, &hdr) < 0 || memcmp(hdr.signature, "FACP", 4) != 0)
+		return -1;
+	if (hdr.length >= 116)
+		summary->flags = ci_acpi_u32(buf + 112);
+	return 0;
+}
+
+/* picks the parser by signature, other tables only get their header checked */
+int
+ci_acpi_parse(const uint8_t *buf, size_t len, CiAcpiSummary *summary)
+{
+	CiAcpiHeader hdr;
+
+	memset(summary, 0, sizeof(CiAcpiSummary));
+	if (len < 4)
+		return -1;
+	if (memcmp(buf, "DMAR", 4) == 0)
+		return ci_acpi_dmar_parse(buf, len, summary);
+	if (memcmp(buf, "IVRS", 4) == 0)
+		return ci_acpi_ivrs_parse(buf, len, summary);
+	if (memcmp(buf, "PHAT", 4) == 0)
+		return ci_acpi_phat_parse(buf, len, summary);
+	if (memcmp(buf, "FACP", 4) == 0)
+		return ci_acpi_facp_parse(buf, len, summary);
+	return ci_acpi_header_parse(buf, len, &hdr);
+}
@@ -0,0 +1,83 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CI_ACPI_H
+#define __CI_ACPI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * ACPI tables as dumped from /sys/firmware/acpi/tables. Every table starts
+ * with the same 36 byte header, and all bytes up to its length sum to zero.
+ * Anything in the file after that length is ignored.
+ */
+
+#define CI_ACPI_HEADER_LEN		36
+#define CI_ACPI_DMAR_HEADER_LEN		48
+#define CI_ACPI_IVRS_HEADER_LEN		48
+
+typedef struct {
+	char		 signature[5];
+	uint32_t	 length;
+	uint8_t		 revision;
+	char		 oem_id[7];
+	char		 oem_table_id[9];
+} CiAcpiHeader;
+
+/*
+ * What parsing a table found. Structures are the DMAR remapping
+ * structures, the IVRS IVHD and IVMD blocks or the PHAT records, and
+ * entries are the DMAR device scopes, the IVHD device entries or the PHAT
+ * firmware version elements. The flags are those of the DMAR, the IVRS
+ * IVinfo or the FACP flags.
+ */
+typedef struct {
+	uint32_t	 flags;
+	uint32_t	 n_structures;
+	uint32_t	 n_entries;
+} CiAcpiSummary;
+
+int		 ci_acpi_header_parse		(const uint8_t		*buf,
+						 size_t			 len,
+						 CiAcpiHeader		*hdr);
+void		 ci_acpi_checksum_update	(uint8_t		*buf,
+						 size_t			 len);
+
+int		 ci_acpi_parse			(const uint8_t		*buf,
+						 size_t			 len,
+						 CiAcpiSummary		*summary);
+int		 ci_acpi_dmar_parse		(const uint8_t		*buf,
+						 size_t			 len,
+						 CiAcpiSummary		*summary);
+int		 ci_acpi_ivrs_parse		(const uint8_t		*buf,
+						 size_t			 len,
+						 CiAcpiSummary		*summary);
+int		 ci_acpi_ivrs_entry_length	(const uint8_t		*buf,
+						 size_t			 len);
+int		 ci_acpi_phat_parse		(const uint8_t		*buf,
+						 size_t			 len,
+						 CiAcpiSummary		*summary);
+int		 ci_acpi_facp_parse		(const uint8_t		*buf,
+						 size_t			 len,
+						 CiAcpiSummary		*summary);
+
+#endif /* __CI_ACPI_H */
@@ -0,0 +1,136 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ci-authenticode.h"
+
+#define CI_AUTHENTICODE_SECTIONS_MAX	96
+
+typedef struct {
+	uint32_t	 offset;
+	uint32_t	 size;
+} CiAuthenticodeSection;
+
+static uint16_t
+ci_authenticode_u16(const uint8_t *buf)
+{
+	return buf[0] | buf[1] << 8;
+}
+
+static uint32_t
+ci_authenticode_u32(const uint8_t *buf)
+{
+	return buf[0] | buf[1] << 8 | buf[2] << 16 | (uint32_t) buf[3] << 24;
+}
+
+static int
+ci_authenticode_section_cmp(const void *a, const void *b)
+{
+	const CiAuthenticodeSection *sa = a;
+	const CiAuthenticodeSection *sb = b;
+	return sa->offset < sb->offset ? -1 : sa->offset > sb->offset;
+}
+
+/*
+ * The Authenticode digest of a PE image, as dbx entries and signatures use:
+ * the headers without the checksum and the certificate table entry, the
+ * sections in file order, then anything after them up to the certificate
+ * table. Returns -1 if buf is not a PE image.
+ */
+int
+ci_authenticode_sha256(const uint8_t *buf, size_t len, uint8_t digest[CI_SHA256_LEN])
+{
+	CiAuthenticodeSection sections[CI_AUTHENTICODE_SECTIONS_MAX];
+	CiSha256 ctx;
+	uint32_t pe;
+	uint32_t opt;
+	uint32_t dirs;
+	uint32_t n_dirs;
+	uint32_t headers;
+	uint32_t cert_offset = 0;
+	uint32_t cert_size = 0;
+	uint16_t n_sections;
+	size_t hashed;
+	size_t end;
+
+	if (len < 0x40 || memcmp(buf, "MZ", 2) != 0)
+		return -1;
+	pe = ci_authenticode_u32(buf + 0x3c);
+	if (pe > len - 24 || memcmp(buf + pe, "PE\0\0", 4) != 0)
+		return -1;
+	n_sections = ci_authenticode_u16(buf + pe + 6);
+	opt = pe + 24;
+	if (opt + 96 > len || n_sections > CI_AUTHENTICODE_SECTIONS_MAX)
+		return -1;
+	switch (ci_authenticode_u16(buf + opt)) {
+	case 0x10b:
+		n_dirs = ci_authenticode_u32(buf + opt + 92);
+		dirs = opt + 96;
+		break;
+	case 0x20b:
+		n_dirs = ci_authenticode_u32(buf + opt + 108);
+		dirs = opt + 112;
+		break;
+	default:
+		return -1;
+	}
+	headers = ci_authenticode_u32(buf + opt + 60);
+	if (n_dirs < 5 || dirs + 5 * 8 > len || headers > len || headers < dirs + 5 * 8)
+		return -1;
+	cert_offset = ci_authenticode_u32(buf + dirs + 4 * 8);
+	cert_size = ci_authenticode_u32(buf + dirs + 4 * 8 + 4);
+	if (cert_size > 0 && (cert_offset > len || cert_size > len - cert_offset))
+		return -1;
+
+	ci_sha256_init(&ctx);
+	ci_sha256_update(&ctx, buf, opt + 64);
+	ci_sha256_update(&ctx, buf + opt + 68, dirs + 4 * 8 - (opt + 68));
+	ci_sha256_update(&ctx, buf + dirs + 5 * 8, headers - (dirs + 5 * 8));
+	hashed = headers;
+
+	/* the section table follows the optional header */
+	for (uint16_t i = 0; i < n_sections; i++) {
+		size_t off = opt + ci_authenticode_u16(buf + pe + 20) + i * 40;
+		if (off + 40 > len)
+			return -1;
+		sections[i].size = ci_authenticode_u32(buf + off + 16);
+		sections[i].offset = ci_authenticode_u32(buf + off + 20);
+		if (sections[i].offset > len || sections[i].size > len - sections[i].offset)
+			return -1;
+	}
+	qsort(sections, n_sections, sizeof(CiAuthenticodeSection), ci_authenticode_section_cmp);
+	for (uint16_t i = 0; i < n_sections; i++) {
+		if (sections[i].size == 0)
+			continue;
+		ci_sha256_update(&ctx, buf + sections[i].offset, sections[i].size);
+		hashed += sections[i].size;
+	}
+
+	/* trailing data, but not the certificate table */
+	end = cert_size > 0 ? cert_offset : len;
+	if (hashed < end)
+		ci_sha256_update(&ctx, buf + hashed, end - hashed);
+	ci_sha256_final(&ctx, digest);
+	return 0;
+}
@@ -0,0 +1,540 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Content addressed store for the ci-tests and installed-tests trees.
+ *
+ * Each tree is described by a manifest in manifests/, and every distinct
+ * file content is kept once in the store as STORE/AB/CDEF..., named by its
+ * SHA-256. Installing a manifest materialises its files from the store
+ * with a reflink, then a hardlink, then a copy, whichever the filesystem
+ * supports first, and a digest installed twice is linked to the first copy
+ * rather than fetched from the store again.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <linux/fs.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ci-hash.h"
+#include "ci-manifest.h"
+
+typedef enum {
+	CI_BLOBS_LINK_REFLINK		= 1 << 0,
+	CI_BLOBS_LINK_HARDLINK		= 1 << 1,
+} CiBlobsLinkFlags;
+
+typedef enum {
+	CI_BLOBS_HOW_REFLINK,
+	CI_BLOBS_HOW_HARDLINK,
+	CI_BLOBS_HOW_COPY,
+	CI_BLOBS_HOW_LAST
+} CiBlobsHow;
+
+typedef struct {
+	CiManifest	 manifest;
+	const char	*filename;
+	const char	*root;			/* NULL for the store */
+} CiBlobsSet;
+
+typedef struct {
+	CiBlobsSet	*sets;
+	size_t		 n_sets;
+	const char	*store;
+	unsigned	 n_threads;
+	CiBlobsLinkFlags link_flags;
+} CiBlobs;
+
+static char *
+ci_blobs_blob_path(const char *store, const uint8_t digest[CI_SHA256_LEN])
+{
+	char hex[CI_SHA256_HEX_LEN + 1];
+	char rel[CI_SHA256_HEX_LEN + 2];
+
+	ci_sha256_to_hex(digest, hex);
+	memcpy(rel, hex, 2);
+	rel[2] = '/';
+	strcpy(rel + 3, hex + 2);
+	return ci_manifest_path(store, rel);
+}
+
+static char *
+ci_blobs_entry_path(const CiBlobs *self, const CiBlobsSet *set, const CiManifestEntry *entry)
+{
+	if (set->root != NULL)
+		return ci_manifest_path(set->root, entry->path);
+	return ci_blobs_blob_path(self->store, entry->digest);
+}
+
+static int
+ci_blobs_mkdir_parents(const char *filename)
+{
+	char *tmp = strdup(filename);
+
+	if (tmp == NULL)
+		return -1;
+	for (char *p = strchr(tmp + 1, '/'); p != NULL; p = strchr(p + 1, '/')) {
+		*p = '\0';
+		if (mkdir(tmp, 0755) < 0 && errno != EEXIST) {
+			fprintf(stderr, "%s: %s\n", tmp, strerror(errno));
+			free(tmp);
+			return -1;
+		}
+		*p = '/';
+	}
+	free(tmp);
+	return 0;
+}
+
+static int
+ci_blobs_copy_fd(int src_fd, int dest_fd)
+{
+	uint8_t buf[64 * 1024];
+	ssize_t n;
+
+	while ((n = read(src_fd, buf, sizeof(buf))) > 0) {
+		for (ssize_t done = 0; done < n;) {
+			ssize_t wrote = write(dest_fd, buf + done, n - done);
+			if (wrote < 0)
+				return -1;
+			done += wrote;
+		}
+	}
+	return n < 0 ? -1 : 0;
+}
+
+/*
+ * Creates dest with the contents of src, preferring a reflink (a copy on
+ * write clone that shares the blocks), then a hardlink, then a plain copy.
+ * Hardlinks are only used where allowed, as they share the file mode too.
+ */
+static int
+ci_blobs_materialise(const char *src, const char *dest, CiBlobsLinkFlags flags, CiBlobsHow *how)
+{
+	int src_fd;
+	int dest_fd = -1;
+	int rc = -1;
+
+	if (ci_blobs_mkdir_parents(dest) < 0)
+		return -1;
+	if (unlink(dest) < 0 && errno != ENOENT) {
+		fprintf(stderr, "%s: %s\n", dest, strerror(errno));
+		return -1;
+	}
+	src_fd = open(src, O_RDONLY);
+	if (src_fd < 0) {
+		fprintf(stderr, "%s: %s\n", src, strerror(errno));
+		return -1;
+	}
+	if (flags & CI_BLOBS_LINK_REFLINK) {
+		dest_fd = open(dest, O_WRONLY | O_CREAT | O_EXCL, 0644);
+		if (dest_fd >= 0 && ioctl(dest_fd, FICLONE, src_fd) == 0) {
+			*how = CI_BLOBS_HOW_REFLINK;
+			rc = 0;
+			goto out;
+		}
+		if (dest_fd >= 0) {
+			close(dest_fd);
+			dest_fd = -1;
+			unlink(dest);
+		}
+	}
+	if ((flags & CI_BLOBS_LINK_HARDLINK) && link(src, dest) == 0) {
+		*how = CI_BLOBS_HOW_HARDLINK;
+		rc = 0;
+		goto out;
+	}
+	dest_fd = open(dest, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (dest_fd < 0 || ci_blobs_copy_fd(src_fd, dest_fd) < 0) {
+		fprintf(stderr, "%s: %s\n", dest, strerror(errno));
+		goto out;
+	}
+	*how = CI_BLOBS_HOW_COPY;
+	rc = 0;
+out:
+	if (dest_fd >= 0 && close(dest_fd) < 0 && rc == 0) {
+		fprintf(stderr, "%s: %s\n", dest, strerror(errno));
+		rc = -1;
+	}
+	close(src_fd);
+	return rc;
+}
+
+static double
+ci_blobs_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Hashes the files of every set in a single parallel pass and compares
+ * them with their manifests. Each distinct file is read once, so the
+ * installed-tests symlinks into ci-tests and the store blobs shared by
+ * several entries do not cost anything extra.
+ */
+static int
+ci_blobs_check(CiBlobs *self)
+{
+	CiHashJob *jobs;
+	size_t n_jobs = 0;
+	size_t n_failed = 0;
+	uint64_t total = 0;
+	double start = ci_blobs_now();
+	int rc = -1;
+
+	for (size_t s = 0; s < self->n_sets; s++)
+		n_jobs += self->sets[s].manifest.n_entries;
+	jobs = calloc(n_jobs + 1, sizeof(CiHashJob));
+	if (jobs == NULL)
+		return -1;
+	n_jobs = 0;
+	for (size_t s = 0; s < self->n_sets; s++) {
+		CiBlobsSet *set = &self->sets[s];
+		for (size_t i = 0; i < set->manifest.n_entries; i++) {
+			jobs[n_jobs].path = ci_blobs_entry_path(self, set, &set->manifest.entries[i]);
+			if (jobs[n_jobs++].path == NULL)
+				goto out;
+		}
+	}
+	if (ci_hash_files(jobs, n_jobs, 0, self->n_threads) < 0)
+		goto out;
+
+	n_jobs = 0;
+	for (size_t s = 0; s < self->n_sets; s++) {
+		CiBlobsSet *set = &self->sets[s];
+		for (size_t i = 0; i < set->manifest.n_entries; i++) {
+			const CiManifestEntry *entry = &set->manifest.entries[i];
+			const CiHashJob *job = &jobs[n_jobs++];
+			if (job->error != 0) {
+				fprintf(stderr, "%s: %s\n", job->path, strerror(job->error));
+				n_failed++;
+			} else if (job->size != entry->size) {
+				fprintf(stderr, "%s: %" PRIu64 " bytes, expected %" PRIu64 "\n",
+					job->path, job->size, entry->size);
+				n_failed++;
+			} else if (memcmp(job->digest, entry->digest, CI_SHA256_LEN) != 0) {
+				fprintf(stderr, "%s: digest does not match %s\n",
+					job->path, set->filename);
+				n_failed++;
+			}
+			total += entry->size;
+		}
+	}
+	printf("%zu files, %.1f KiB, %zu failed in %.3f s\n",
+	       n_jobs, total / 1024.0, n_failed, ci_blobs_now() - start);
+	rc = n_failed > 0 ? -1 : 0;
+out:
+	for (size_t i = 0; i < n_jobs; i++)
+		free((char *) jobs[i].path);
+	free(jobs);
+	return rc;
+}
+
+/* adds the files of every checked tree that the store does not have yet */
+static int
+ci_blobs_store(CiBlobs *self)
+{
+	size_t n_added = 0;
+	uint64_t added = 0;
+
+	if (ci_blobs_check(self) < 0)
+		return -1;
+	for (size_t s = 0; s < self->n_sets; s++) {
+		CiBlobsSet *set = &self->sets[s];
+		for (size_t i = 0; i < set->manifest.n_entries; i++) {
+			const CiManifestEntry *entry = &set->manifest.entries[i];
+			struct stat st;
+			CiBlobsHow how;
+			char *blob = ci_blobs_blob_path(self->store, entry->digest);
+			char *src = ci_manifest_path(set->root, entry->path);
+			char tmp_name[32];
+			char *tmp;
+			int rc = -1;
+
+			snprintf(tmp_name, sizeof(tmp_name), "blob.tmp.%ld", (long) getpid());
+			tmp = ci_manifest_path(self->store, tmp_name);
+
+			if (blob == NULL || src == NULL || tmp == NULL)
+				goto next;
+			if (stat(blob, &st) == 0) {
+				rc = 0;
+				goto next;
+			}
+			/* never hardlink, the checkout may be edited in place */
+			if (ci_blobs_materialise(src, tmp, CI_BLOBS_LINK_REFLINK, &how) < 0)
+				goto next;
+			if (chmod(tmp, 0444) < 0 || ci_blobs_mkdir_parents(blob) < 0 ||
+			    rename(tmp, blob) < 0) {
+				fprintf(stderr, "%s: %s\n", blob, strerror(errno));
+				goto next;
+			}
+			n_added++;
+			added += entry->size;
+			rc = 0;
+next:
+			free(tmp);
+			free(src);
+			free(blob);
+			if (rc < 0)
+				return -1;
+		}
+	}
+	printf("%s: added %zu blobs, %.1f KiB\n", self->store, n_added, added / 1024.0);
+	return 0;
+}
+
+typedef struct {
+	const CiManifestEntry	*entry;
+	char			*dest;
+} CiBlobsInstallItem;
+
+static int
+ci_blobs_install_item_cmp(const void *a, const void *b)
+{
+	const CiBlobsInstallItem *ia = a;
+	const CiBlobsInstallItem *ib = b;
+	int rc = memcmp(ia->entry->digest, ib->entry->digest, CI_SHA256_LEN);
+	if (rc != 0)
+		return rc;
+	return strcmp(ia->dest, ib->dest);
+}
+
+/*
+ * Installs every manifest to its destination. The entries of all the sets
+ * are sorted by digest, so the first of each is fetched from the store and
+ * the others are linked to it; on a filesystem without reflinks the store
+ * can then be elsewhere and each content still lands on disk only once.
+ */
+static int
+ci_blobs_install(CiBlobs *self)
+{
+	CiBlobsInstallItem *items;
+	size_t counts[CI_BLOBS_HOW_LAST] = { 0 };
+	uint64_t copied = 0;
+	size_t n_items = 0;
+	int rc = -1;
+
+	for (size_t s = 0; s < self->n_sets; s++)
+		n_items += self->sets[s].manifest.n_entries;
+	items = calloc(n_items + 1, sizeof(CiBlobsInstallItem));
+	if (items == NULL)
+		return -1;
+	n_items = 0;
+	for (size_t s = 0; s < self->n_sets; s++) {
+		CiBlobsSet *set = &self->sets[s];
+		for (size_t i = 0; i < set->manifest.n_entries; i++) {
+			items[n_items].entry = &set->manifest.entries[i];
+			items[n_items].dest = ci_manifest_path(set->root, set->manifest.entries[i].path);
+			if (items[n_items++].dest == NULL)
+				goto out;
+		}
+	}
+	qsort(items, n_items, sizeof(CiBlobsInstallItem), ci_blobs_install_item_cmp);
+
+	for (size_t i = 0; i < n_items; i++) {
+		const CiBlobsInstallItem *first = NULL;
+		CiBlobsHow how;
+		char *src;
+		int ret;
+
+		if (i > 0 && memcmp(items[i - 1].entry->digest, items[i].entry->digest,
+				    CI_SHA256_LEN) == 0)
+			first = &items[i - 1];
+		src = first != NULL ? strdup(first->dest) :
+				      ci_blobs_blob_path(self->store, items[i].entry->digest);
+		if (src == NULL)
+			goto out;
+		ret = ci_blobs_materialise(src, items[i].dest, self->link_flags, &how);
+		free(src);
+		if (ret < 0)
+			goto out;
+		counts[how]++;
+		if (how == CI_BLOBS_HOW_COPY)
+			copied += items[i].entry->size;
+	}
+	printf("%zu files: %zu reflinked, %zu hardlinked, %zu copied (%.1f KiB)\n",
+	       n_items, counts[CI_BLOBS_HOW_REFLINK], counts[CI_BLOBS_HOW_HARDLINK],
+	       counts[CI_BLOBS_HOW_COPY], copied / 1024.0);
+	rc = 0;
+out:
+	for (size_t i = 0; i < n_items; i++)
+		free(items[i].dest);
+	free(items);
+	return rc;
+}
+
+static int
+ci_blobs_manifest(const char *root, const char *output, unsigned n_threads)
+{
+	CiManifest m;
+	int rc;
+
+	if (ci_manifest_scan(&m, root, n_threads) < 0)
+		return -1;
+	rc = ci_manifest_save(&m, output);
+	ci_manifest_clear(&m);
+	return rc;
+}
+
+static void
+ci_blobs_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s manifest [-j N] -o OUTPUT ROOT\n"
+		"       %s check [-j N] [-s STORE] [-C ROOT] MANIFEST...\n"
+		"       %s store [-j N] -s STORE -C ROOT MANIFEST...\n"
+		"       %s install [-m MODE] -s STORE -C DEST MANIFEST...\n"
+		"  -j, --jobs=N             hash with N threads, default one per CPU\n"
+		"  -o, --output=FILE        manifest to write\n"
+		"  -s, --store=DIR          the blob store\n"
+		"  -C, --directory=DIR      tree of the manifests that follow; without\n"
+		"                           it check verifies the store\n"
+		"  -m, --mode=MODE          auto, reflink, hardlink or copy\n",
+		argv0, argv0, argv0, argv0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct option options[] = {
+		{ "jobs",		required_argument, NULL, 'j' },
+		{ "output",		required_argument, NULL, 'o' },
+		{ "store",		required_argument, NULL, 's' },
+		{ "directory",		required_argument, NULL, 'C' },
+		{ "mode",		required_argument, NULL, 'm' },
+		{ NULL, 0, NULL, 0 }
+	};
+	CiBlobs self = { 0 };
+	const char *cmd;
+	const char *output = NULL;
+	const char *root = NULL;
+	int rc = EXIT_FAILURE;
+	int opt;
+
+	if (argc < 2) {
+		ci_blobs_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	cmd = argv[1];
+	self.link_flags = CI_BLOBS_LINK_REFLINK | CI_BLOBS_LINK_HARDLINK;
+	self.sets = calloc(argc, sizeof(CiBlobsSet));
+	if (self.sets == NULL)
+		return EXIT_FAILURE;
+
+	/* manifests are taken in order, each with the -C before it */
+	optind = 2;
+	while ((opt = getopt_long(argc, argv, "-j:o:s:C:m:", options, NULL)) != -1) {
+		switch (opt) {
+		case 1:
+			if (strcmp(cmd, "manifest") == 0) {
+				root = optarg;
+				break;
+			}
+			self.sets[self.n_sets].filename = optarg;
+			self.sets[self.n_sets].root = root;
+			if (ci_manifest_load(&self.sets[self.n_sets].manifest, optarg) < 0)
+				goto out;
+			self.n_sets++;
+			break;
+		case 'j':
+			self.n_threads = strtoul(optarg, NULL, 10);
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 's':
+			self.store = optarg;
+			break;
+		case 'C':
+			root = optarg;
+			break;
+		case 'm':
+			if (strcmp(optarg, "auto") == 0) {
+				self.link_flags = CI_BLOBS_LINK_REFLINK | CI_BLOBS_LINK_HARDLINK;
+			} else if (strcmp(optarg, "reflink") == 0) {
+				self.link_flags = CI_BLOBS_LINK_REFLINK;
+			} else if (strcmp(optarg, "hardlink") == 0) {
+				self.link_flags = CI_BLOBS_LINK_HARDLINK;
+			} else if (strcmp(optarg, "copy") == 0) {
+				self.link_flags = 0;
+			} else {
+				ci_blobs_usage(argv[0]);
+				goto out;
+			}
+			break;
+		default:
+			ci_blobs_usage(argv[0]);
+			goto out;
+		}
+	}
+
+	if (strcmp(cmd, "manifest") == 0) {
+		if (output == NULL || root == NULL) {
+			ci_blobs_usage(argv[0]);
+			goto out;
+		}
+		if (ci_blobs_manifest(root, output, self.n_threads) == 0)
+			rc = EXIT_SUCCESS;
+		goto out;
+	}
+	if (self.n_sets == 0) {
+		ci_blobs_usage(argv[0]);
+		goto out;
+	}
+	for (size_t i = 0; i < self.n_sets; i++) {
+		if (self.sets[i].root == NULL && self.store == NULL) {
+			fprintf(stderr, "%s: needs -C or --store\n", self.sets[i].filename);
+			goto out;
+		}
+		if (strcmp(cmd, "check") != 0 && self.sets[i].root == NULL) {
+			fprintf(stderr, "%s: needs -C\n", self.sets[i].filename);
+			goto out;
+		}
+	}
+	if (strcmp(cmd, "check") == 0) {
+		if (ci_blobs_check(&self) == 0)
+			rc = EXIT_SUCCESS;
+	} else if (strcmp(cmd, "store") == 0 && self.store != NULL) {
+		if (ci_blobs_store(&self) == 0)
+			rc = EXIT_SUCCESS;
+	} else if (strcmp(cmd, "install") == 0 && self.store != NULL) {
+		if (ci_blobs_install(&self) == 0)
+			rc = EXIT_SUCCESS;
+	} else {
+		ci_blobs_usage(argv[0]);
+	}
+out:
+	for (size_t i = 0; i < self.n_sets; i++)
+		ci_manifest_clear(&self.sets[i].manifest);
+	free(self.sets);
+	return rc;
+}
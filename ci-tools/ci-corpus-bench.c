@@ -0,0 +1,276 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Compares how parallel test processes load the fixtures of a corpus: each
+ * reading its own copy of every file into memory, as the tests do now, the
+ * same with the digest of every file checked, or mapping them with
+ * ci_fixture_open() and verifying only the ranges they use.
+ *
+ * Every process loads every fixture in the manifest and holds them all, as
+ * one test binary would, then reads the anonymous memory it allocated from
+ * /proc/self/status. Only the first --prefix bytes of each fixture are used,
+ * to model tests that only parse a header.
+ */
+
+#include <getopt.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ci-corpus.h"
+#include "ci-hash.h"
+
+#define CORPUS_ITERATIONS_DEFAULT	100
+
+typedef enum {
+	CORPUS_MODE_READ,
+	CORPUS_MODE_READ_VERIFY,
+	CORPUS_MODE_MAP,
+	CORPUS_MODE_LAST
+} CorpusMode;
+
+static const char *corpus_mode_names[] = { "read", "read+verify", "map" };
+
+typedef struct {
+	double		 elapsed;		/* per pass */
+	long		 anon_kib;		/* held with every fixture loaded */
+	int		 failed;
+} CorpusResult;
+
+static double
+corpus_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long
+corpus_rss_anon(void)
+{
+	FILE *f = fopen("/proc/self/status", "r");
+	char line[256];
+	long kib = -1;
+
+	if (f == NULL)
+		return -1;
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (sscanf(line, "RssAnon: %ld kB", &kib) == 1)
+			break;
+	}
+	fclose(f);
+	return kib;
+}
+
+static uint8_t *
+corpus_read_file(const char *filename, uint64_t size)
+{
+	uint8_t *buf = malloc(size + 1);
+	int fd = open(filename, O_RDONLY);
+	uint64_t done = 0;
+
+	if (buf == NULL || fd < 0)
+		goto fail;
+	while (done < size) {
+		ssize_t n = read(fd, buf + done, size - done);
+		if (n <= 0)
+			goto fail;
+		done += n;
+	}
+	close(fd);
+	return buf;
+fail:
+	if (fd >= 0)
+		close(fd);
+	free(buf);
+	return NULL;
+}
+
+static unsigned
+corpus_touch(const uint8_t *buf, size_t len)
+{
+	unsigned sum = 0;
+	for (size_t i = 0; i < len; i += 64)
+		sum += buf[i];
+	return sum;
+}
+
+static void
+corpus_worker(const CiCorpus *corpus, CorpusMode mode, unsigned iterations,
+	      uint64_t prefix, CorpusResult *result)
+{
+	const CiManifest *m = &corpus->manifest;
+	uint8_t **bufs = calloc(m->n_entries + 1, sizeof(uint8_t *));
+	CiFixture *fxs = calloc(m->n_entries + 1, sizeof(CiFixture));
+	volatile unsigned sum = 0;
+	double start = corpus_now();
+
+	if (bufs == NULL || fxs == NULL) {
+		result->failed = 1;
+		goto out;
+	}
+	for (unsigned it = 0; it < iterations && !result->failed; it++) {
+		for (size_t i = 0; i < m->n_entries; i++) {
+			const CiManifestEntry *entry = &m->entries[i];
+			uint64_t len = entry->size < prefix ? entry->size : prefix;
+			const uint8_t *data;
+			if (mode != CORPUS_MODE_MAP) {
+				char *filename = ci_manifest_path(corpus->root, entry->path);
+				uint8_t digest[CI_SHA256_LEN];
+				bufs[i] = filename != NULL ? corpus_read_file(filename, entry->size) : NULL;
+				free(filename);
+				data = bufs[i];
+				if (data != NULL && mode == CORPUS_MODE_READ_VERIFY) {
+					ci_sha256(data, entry->size, digest);
+					if (memcmp(digest, entry->digest, CI_SHA256_LEN) != 0)
+						data = NULL;
+				}
+			} else if (ci_fixture_open(&fxs[i], corpus, entry->path) == 0) {
+				data = ci_fixture_get(&fxs[i], 0, len);
+			} else {
+				data = NULL;
+			}
+			if (data == NULL) {
+				result->failed = 1;
+				break;
+			}
+			sum += corpus_touch(data, len);
+		}
+		if (it == 0)
+			result->anon_kib = corpus_rss_anon();
+		for (size_t i = 0; i < m->n_entries; i++) {
+			free(bufs[i]);
+			bufs[i] = NULL;
+			if (fxs[i].entry != NULL)
+				ci_fixture_close(&fxs[i]);
+		}
+	}
+	result->elapsed = (corpus_now() - start) / iterations;
+out:
+	free(fxs);
+	free(bufs);
+}
+
+static int
+corpus_run(const CiCorpus *corpus, CorpusMode mode, unsigned n_jobs,
+	   unsigned iterations, uint64_t prefix)
+{
+	CorpusResult total = { 0 };
+	long baseline;
+	int fds[2];
+
+	if (pipe(fds) < 0)
+		return -1;
+	for (unsigned j = 0; j < n_jobs; j++) {
+		if (fork() == 0) {
+			CorpusResult result = { 0 };
+			close(fds[0]);
+			baseline = corpus_rss_anon();
+			corpus_worker(corpus, mode, iterations, prefix, &result);
+			result.anon_kib -= baseline;
+			if (write(fds[1], &result, sizeof(result)) != sizeof(result))
+				_exit(1);
+			_exit(0);
+		}
+	}
+	close(fds[1]);
+	for (unsigned j = 0; j < n_jobs; j++) {
+		CorpusResult result;
+		if (read(fds[0], &result, sizeof(result)) != sizeof(result)) {
+			total.failed = 1;
+			break;
+		}
+		total.elapsed += result.elapsed;
+		total.anon_kib += result.anon_kib;
+		total.failed |= result.failed;
+	}
+	close(fds[0]);
+	while (wait(NULL) > 0)
+		;
+	if (total.failed)
+		return -1;
+	printf("%-12s %4u processes %10.3f ms per pass %10ld KiB private per process\n",
+	       corpus_mode_names[mode], n_jobs,
+	       total.elapsed * 1e3 / n_jobs, total.anon_kib / (long) n_jobs);
+	return 0;
+}
+
+static void
+corpus_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [OPTION...] MANIFEST ROOT\n"
+		"  -j, --jobs=N             run N processes, default one per CPU\n"
+		"  -n, --iterations=N       load the corpus N times, default %u\n"
+		"  -p, --prefix=BYTES       only use the start of each fixture\n",
+		argv0, CORPUS_ITERATIONS_DEFAULT);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct option options[] = {
+		{ "jobs",		required_argument, NULL, 'j' },
+		{ "iterations",		required_argument, NULL, 'n' },
+		{ "prefix",		required_argument, NULL, 'p' },
+		{ NULL, 0, NULL, 0 }
+	};
+	unsigned n_jobs = ci_hash_default_threads();
+	unsigned iterations = CORPUS_ITERATIONS_DEFAULT;
+	uint64_t prefix = UINT64_MAX;
+	CiCorpus corpus;
+	int rc = EXIT_SUCCESS;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "j:n:p:", options, NULL)) != -1) {
+		switch (opt) {
+		case 'j':
+			n_jobs = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			prefix = strtoull(optarg, NULL, 0);
+			break;
+		default:
+			corpus_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (argc - optind != 2 || n_jobs == 0 || iterations == 0) {
+		corpus_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (ci_corpus_open(&corpus, argv[optind], argv[optind + 1]) < 0)
+		return EXIT_FAILURE;
+	for (CorpusMode mode = 0; mode < CORPUS_MODE_LAST; mode++) {
+		if (corpus_run(&corpus, mode, n_jobs, iterations, prefix) < 0)
+			rc = EXIT_FAILURE;
+	}
+	ci_corpus_close(&corpus);
+	return rc;
+}
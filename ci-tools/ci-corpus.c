@@ -0,0 +1,173 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ci-corpus.h"
+
+int
+ci_corpus_open(CiCorpus *corpus, const char *manifest, const char *root)
+{
+	memset(corpus, 0, sizeof(CiCorpus));
+	corpus->root = strdup(root);
+	if (corpus->root == NULL)
+		return -1;
+	if (ci_manifest_load(&corpus->manifest, manifest) < 0) {
+		free(corpus->root);
+		corpus->root = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+void
+ci_corpus_close(CiCorpus *corpus)
+{
+	ci_manifest_clear(&corpus->manifest);
+	free(corpus->root);
+	memset(corpus, 0, sizeof(CiCorpus));
+}
+
+/*
+ * Maps a fixture by its path in the manifest. Only the size is checked
+ * here; the contents are checked as they are used.
+ */
+int
+ci_fixture_open(CiFixture *fx, const CiCorpus *corpus, const char *path)
+{
+	const CiManifestEntry *entry;
+	struct stat st;
+	void *map = NULL;
+	int fd;
+
+	memset(fx, 0, sizeof(CiFixture));
+	entry = ci_manifest_lookup(&corpus->manifest, path);
+	if (entry == NULL) {
+		fprintf(stderr, "%s: not in the manifest\n", path);
+		return -1;
+	}
+	fx->filename = ci_manifest_path(corpus->root, path);
+	if (fx->filename == NULL)
+		return -1;
+	fd = open(fx->filename, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "%s: %s\n", fx->filename, strerror(errno));
+		goto fail;
+	}
+	if ((uint64_t) st.st_size != entry->size) {
+		fprintf(stderr, "%s: %lu bytes, the manifest has %lu\n", fx->filename,
+			(unsigned long) st.st_size, (unsigned long) entry->size);
+		goto fail;
+	}
+	if (entry->size > 0) {
+		map = mmap(NULL, entry->size, PROT_READ, MAP_SHARED, fd, 0);
+		if (map == MAP_FAILED) {
+			fprintf(stderr, "%s: %s\n", fx->filename, strerror(errno));
+			map = NULL;
+			goto fail;
+		}
+	}
+	fx->n_ranges = entry->n_ranges > 0 ? entry->n_ranges : 1;
+	fx->verified = calloc((fx->n_ranges + 7) / 8, 1);
+	if (fx->verified == NULL)
+		goto fail;
+	close(fd);
+	fx->entry = entry;
+	fx->data = map;
+	return 0;
+fail:
+	if (map != NULL)
+		munmap(map, entry->size);
+	if (fd >= 0)
+		close(fd);
+	free(fx->filename);
+	memset(fx, 0, sizeof(CiFixture));
+	return -1;
+}
+
+static int
+ci_fixture_verify_range(CiFixture *fx, size_t r)
+{
+	const CiManifestEntry *entry = fx->entry;
+	const uint8_t *expected = entry->n_ranges > 0 ? entry->ranges + r * CI_SHA256_LEN :
+							 entry->digest;
+	uint64_t offset = (uint64_t) r * CI_MANIFEST_RANGE_SIZE;
+	uint64_t len = entry->size - offset;
+	uint8_t digest[CI_SHA256_LEN];
+
+	if (fx->verified[r / 8] & (1 << (r % 8)))
+		return 0;
+	if (entry->n_ranges > 0 && len > CI_MANIFEST_RANGE_SIZE)
+		len = CI_MANIFEST_RANGE_SIZE;
+	ci_sha256(fx->data + offset, len, digest);
+	if (memcmp(digest, expected, CI_SHA256_LEN) != 0) {
+		fprintf(stderr, "%s: bytes 0x%lx+0x%lx do not match the manifest\n",
+			fx->filename, (unsigned long) offset, (unsigned long) len);
+		return -1;
+	}
+	fx->verified[r / 8] |= 1 << (r % 8);
+	return 0;
+}
+
+/*
+ * Returns len bytes at offset, or NULL if the range is outside the file or
+ * any part of the ranges covering it does not match the manifest.
+ */
+const uint8_t *
+ci_fixture_get(CiFixture *fx, uint64_t offset, size_t len)
+{
+	uint64_t size = fx->entry->size;
+	size_t first;
+	size_t last;
+
+	if (offset > size || len > size - offset) {
+		errno = ERANGE;
+		return NULL;
+	}
+	if (len == 0)
+		return fx->data != NULL ? fx->data + offset : (const uint8_t *) "";
+	first = fx->entry->n_ranges > 0 ? offset / CI_MANIFEST_RANGE_SIZE : 0;
+	last = fx->entry->n_ranges > 0 ? (offset + len - 1) / CI_MANIFEST_RANGE_SIZE : 0;
+	for (size_t r = first; r <= last; r++) {
+		if (ci_fixture_verify_range(fx, r) < 0) {
+			errno = EBADMSG;
+			return NULL;
+		}
+	}
+	return fx->data + offset;
+}
+
+void
+ci_fixture_close(CiFixture *fx)
+{
+	if (fx->data != NULL)
+		munmap((void *) fx->data, fx->entry->size);
+	free(fx->verified);
+	free(fx->filename);
+	memset(fx, 0, sizeof(CiFixture));
+}
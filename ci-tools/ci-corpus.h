@@ -0,0 +1,75 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CI_CORPUS_H
+#define __CI_CORPUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ci-manifest.h"
+
+/*
+ * Read-only access to the fixtures of a tree described by a manifest.
+ *
+ * A fixture is mapped shared rather than read into memory, so parallel
+ * test processes use the same page cache copy. Nothing is hashed when it
+ * is opened: ci_fixture_get() verifies each range of the file against the
+ * manifest the first time any part of it is used, and a fixture that is
+ * only partly read is only partly hashed.
+ *
+ * A CiFixture is not thread safe; open one per thread instead, they still
+ * share the pages.
+ */
+
+typedef struct {
+	CiManifest	 manifest;
+	char		*root;
+} CiCorpus;
+
+typedef struct {
+	const CiManifestEntry	*entry;
+	char			*filename;
+	const uint8_t		*data;		/* entry->size bytes */
+	size_t			 n_ranges;
+	uint8_t			*verified;	/* one bit per range */
+} CiFixture;
+
+int		 ci_corpus_open		(CiCorpus		*corpus,
+					 const char		*manifest,
+					 const char		*root);
+void		 ci_corpus_close	(CiCorpus		*corpus);
+
+int		 ci_fixture_open	(CiFixture		*fx,
+					 const CiCorpus		*corpus,
+					 const char		*path);
+const uint8_t	*ci_fixture_get		(CiFixture		*fx,
+					 uint64_t		 offset,
+					 size_t			 len);
+void		 ci_fixture_close	(CiFixture		*fx);
+
+static inline uint64_t
+ci_fixture_size(const CiFixture *fx)
+{
+	return fx->entry->size;
+}
+
+#endif /* __CI_CORPUS_H */
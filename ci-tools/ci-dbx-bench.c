@@ -0,0 +1,424 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Times the lookups the uefi-dbx plugin makes: whether a digest is in dbx,
+ * whether an update adds anything to it, and whether it revokes a binary.
+ * Each is done with a linear scan of the signature lists, a sorted copy of
+ * the digests and a hash table, with the time to build the sorted copy and
+ * the table given separately.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ci-authenticode.h"
+#include "ci-manifest.h"
+#include "ci-siglist.h"
+
+#define DBX_FILENAME			"dbx-d719b2cb-3d3a-4596-a3bc-dad00e67656f"
+#define DBX_UPDATE_FILENAME		"dbx-update.auth"
+#define DBX_MIN_TIME_DEFAULT		0.1
+#define DBX_PROBES_MAX			4096
+
+typedef struct {
+	const char	*name;
+	void		*(*init)	(const CiSiglist *siglist);
+	void		 (*free)	(void *index);
+	int		 (*contains)	(const void *index, const uint8_t *digest);
+} DbxMethod;
+
+typedef struct {
+	uint8_t		*digests;
+	size_t		 n_digests;
+} DbxProbes;
+
+static volatile unsigned dbx_sink;
+
+static double
+dbx_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint8_t *
+dbx_read_file(const char *filename, size_t *len)
+{
+	struct stat st;
+	uint8_t *buf = NULL;
+	size_t done = 0;
+	int fd = open(filename, O_RDONLY);
+
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "failed to open %s: %s\n", filename, strerror(errno));
+		goto out;
+	}
+	buf = malloc(st.st_size + 1);
+	if (buf == NULL)
+		goto out;
+	while (done < (size_t) st.st_size) {
+		ssize_t n = read(fd, buf + done, st.st_size - done);
+		if (n <= 0) {
+			fprintf(stderr, "failed to read %s\n", filename);
+			free(buf);
+			buf = NULL;
+			goto out;
+		}
+		done += n;
+	}
+	*len = done;
+out:
+	if (fd >= 0)
+		close(fd);
+	return buf;
+}
+
+/* the linear scan needs no index, the lists themselves are searched */
+static void *
+dbx_linear_init(const CiSiglist *siglist)
+{
+	return (void *) siglist;
+}
+
+static void
+dbx_linear_free(void *index)
+{
+	(void) index;
+}
+
+static int
+dbx_linear_contains(const void *index, const uint8_t *digest)
+{
+	return ci_siglist_contains(index, digest);
+}
+
+static void *
+dbx_sorted_init(const CiSiglist *siglist)
+{
+	CiSiglistSorted *sorted = malloc(sizeof(CiSiglistSorted));
+	if (sorted != NULL && ci_siglist_sorted_init(sorted, siglist) < 0) {
+		free(sorted);
+		return NULL;
+	}
+	return sorted;
+}
+
+static void
+dbx_sorted_free(void *index)
+{
+	ci_siglist_sorted_clear(index);
+	free(index);
+}
+
+static int
+dbx_sorted_contains(const void *index, const uint8_t *digest)
+{
+	return ci_siglist_sorted_contains(index, digest);
+}
+
+static void *
+dbx_table_init(const CiSiglist *siglist)
+{
+	CiSiglistTable *table = malloc(sizeof(CiSiglistTable));
+	if (table != NULL && ci_siglist_table_init(table, siglist) < 0) {
+		free(table);
+		return NULL;
+	}
+	return table;
+}
+
+static void
+dbx_table_free(void *index)
+{
+	ci_siglist_table_clear(index);
+	free(index);
+}
+
+static int
+dbx_table_contains(const void *index, const uint8_t *digest)
+{
+	return ci_siglist_table_contains(index, digest);
+}
+
+static const DbxMethod dbx_methods[] = {
+	{ "linear",	dbx_linear_init,	dbx_linear_free,	dbx_linear_contains },
+	{ "sorted",	dbx_sorted_init,	dbx_sorted_free,	dbx_sorted_contains },
+	{ "hashed",	dbx_table_init,		dbx_table_free,		dbx_table_contains },
+};
+
+/* digests in dbx, and the digests of those, which are not */
+static int
+dbx_probes_init(DbxProbes *hits, DbxProbes *misses, const CiSiglist *dbx)
+{
+	size_t n = dbx->n_sha256 < DBX_PROBES_MAX ? dbx->n_sha256 : DBX_PROBES_MAX;
+
+	hits->digests = malloc(n * CI_SHA256_LEN + 1);
+	misses->digests = malloc(n * CI_SHA256_LEN + 1);
+	if (hits->digests == NULL || misses->digests == NULL)
+		return -1;
+	for (size_t i = 0; i < n; i++) {
+		const uint8_t *digest = dbx->sha256[i * dbx->n_sha256 / n];
+		memcpy(hits->digests + i * CI_SHA256_LEN, digest, CI_SHA256_LEN);
+		ci_sha256(digest, CI_SHA256_LEN, misses->digests + i * CI_SHA256_LEN);
+	}
+	hits->n_digests = n;
+	misses->n_digests = n;
+	return 0;
+}
+
+/* returns the time per lookup, or zero if there is nothing to look up */
+static double
+dbx_bench_lookup(const DbxMethod *method, const void *index, const DbxProbes *probes,
+		 double min_time)
+{
+	unsigned long iterations = 0;
+	unsigned found = 0;
+	double elapsed;
+	double start;
+	size_t i = 0;
+
+	if (probes->n_digests == 0)
+		return 0;
+	start = dbx_now();
+	do {
+		for (unsigned j = 0; j < 16; j++) {
+			found += method->contains(index, probes->digests + i * CI_SHA256_LEN);
+			if (++i == probes->n_digests)
+				i = 0;
+		}
+		iterations += 16;
+		elapsed = dbx_now() - start;
+	} while (elapsed < min_time);
+	dbx_sink = found;
+	return elapsed / iterations;
+}
+
+/* a dash when the dbx has no digests to look up */
+static const char *
+dbx_format_ns(char *buf, size_t len, double elapsed)
+{
+	if (elapsed <= 0)
+		return "-";
+	snprintf(buf, len, "%.1f", elapsed * 1e9);
+	return buf;
+}
+
+/* returns the time to build the index, or -1 on failure */
+static double
+dbx_bench_init(const DbxMethod *method, const CiSiglist *dbx, double min_time)
+{
+	unsigned long iterations = 0;
+	double elapsed;
+	double start = dbx_now();
+
+	do {
+		void *index = method->init(dbx);
+		if (index == NULL)
+			return -1;
+		method->free(index);
+		iterations++;
+		elapsed = dbx_now() - start;
+	} while (elapsed < min_time);
+	return elapsed / iterations;
+}
+
+/*
+ * The update applies if it has a digest that is not in dbx yet; this is
+ * timed from the lists as read, so it includes building the index.
+ */
+static double
+dbx_bench_update(const DbxMethod *method, const CiSiglist *dbx, const CiSiglist *update,
+		 double min_time, size_t *n_new)
+{
+	unsigned long iterations = 0;
+	double elapsed;
+	double start = dbx_now();
+
+	do {
+		void *index = method->init(dbx);
+		if (index == NULL)
+			return -1;
+		*n_new = 0;
+		for (size_t i = 0; i < update->n_sha256; i++) {
+			if (!method->contains(index, update->sha256[i]))
+				(*n_new)++;
+		}
+		method->free(index);
+		iterations++;
+		elapsed = dbx_now() - start;
+	} while (elapsed < min_time);
+	return elapsed / iterations;
+}
+
+static int
+dbx_bench_pe(const char *filename, const CiSiglist *dbx, const CiSiglist *update,
+	     double min_time)
+{
+	uint8_t digest[CI_SHA256_LEN];
+	unsigned long iterations = 0;
+	double elapsed;
+	double start;
+	size_t len = 0;
+	uint8_t *buf;
+	const char *basename = strrchr(filename, '/');
+
+	buf = dbx_read_file(filename, &len);
+	if (buf == NULL)
+		return -1;
+	start = dbx_now();
+	do {
+		if (ci_authenticode_sha256(buf, len, digest) < 0) {
+			fprintf(stderr, "%s is not a PE image\n", filename);
+			free(buf);
+			return -1;
+		}
+		iterations++;
+		elapsed = dbx_now() - start;
+	} while (elapsed < min_time);
+	free(buf);
+	printf("  %-24s %9zu bytes %10.1f us Authenticode   in dbx: %-3s  in update: %s\n",
+	       basename != NULL ? basename + 1 : filename, len, elapsed / iterations * 1e6,
+	       ci_siglist_contains(dbx, digest) ? "yes" : "no",
+	       ci_siglist_contains(update, digest) ? "yes" : "no");
+	return 0;
+}
+
+static int
+dbx_bench(const char *dir, char **pe, int n_pe, double min_time)
+{
+	CiSiglist dbx = { 0 };
+	CiSiglist update = { 0 };
+	DbxProbes hits = { NULL, 0 };
+	DbxProbes misses = { NULL, 0 };
+	char *dbx_filename = ci_manifest_path(dir, DBX_FILENAME);
+	char *update_filename = ci_manifest_path(dir, DBX_UPDATE_FILENAME);
+	uint8_t *dbx_buf = NULL;
+	uint8_t *update_buf = NULL;
+	size_t dbx_len = 0;
+	size_t update_len = 0;
+	int rc = -1;
+
+	if (dbx_filename == NULL || update_filename == NULL)
+		goto out;
+	dbx_buf = dbx_read_file(dbx_filename, &dbx_len);
+	update_buf = dbx_read_file(update_filename, &update_len);
+	if (dbx_buf == NULL || update_buf == NULL)
+		goto out;
+	if (ci_siglist_parse(&dbx, dbx_buf, dbx_len) < 0 ||
+	    ci_siglist_parse(&update, update_buf, update_len) < 0) {
+		fprintf(stderr, "%s does not have a valid dbx and update\n", dir);
+		goto out;
+	}
+	if (dbx_probes_init(&hits, &misses, &dbx) < 0)
+		goto out;
+
+	printf("%s: dbx %zu bytes, %zu SHA-256 %zu X.509; update %zu bytes, %zu SHA-256\n",
+	       dir, dbx_len, dbx.n_sha256, dbx.n_x509, update_len, update.n_sha256);
+	for (size_t i = 0; i < sizeof(dbx_methods) / sizeof(dbx_methods[0]); i++) {
+		const DbxMethod *method = &dbx_methods[i];
+		double build = dbx_bench_init(method, &dbx, min_time);
+		char hit_str[32];
+		char miss_str[32];
+		double hit;
+		double miss;
+		double apply;
+		size_t n_new = 0;
+		void *index;
+		if (build < 0)
+			goto out;
+		index = method->init(&dbx);
+		if (index == NULL)
+			goto out;
+		hit = dbx_bench_lookup(method, index, &hits, min_time);
+		miss = dbx_bench_lookup(method, index, &misses, min_time);
+		method->free(index);
+		apply = dbx_bench_update(method, &dbx, &update, min_time, &n_new);
+		if (apply < 0)
+			goto out;
+		printf("  %-6s build %10.1f us   hit %10s ns   miss %10s ns   "
+		       "update %10.1f us, %zu new\n",
+		       method->name, build * 1e6,
+		       dbx_format_ns(hit_str, sizeof(hit_str), hit),
+		       dbx_format_ns(miss_str, sizeof(miss_str), miss), apply * 1e6, n_new);
+	}
+	for (int i = 0; i < n_pe; i++) {
+		if (dbx_bench_pe(pe[i], &dbx, &update, min_time) < 0)
+			goto out;
+	}
+	rc = 0;
+out:
+	ci_siglist_clear(&dbx);
+	ci_siglist_clear(&update);
+	free(hits.digests);
+	free(misses.digests);
+	free(dbx_buf);
+	free(update_buf);
+	free(dbx_filename);
+	free(update_filename);
+	return rc;
+}
+
+static void
+dbx_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [OPTION...] DIR [PE...]\n"
+		"  -t, --time=SECONDS       repeat each measurement for this long, default %.1f\n",
+		argv0, DBX_MIN_TIME_DEFAULT);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct option options[] = {
+		{ "time",		required_argument, NULL, 't' },
+		{ NULL, 0, NULL, 0 }
+	};
+	double min_time = DBX_MIN_TIME_DEFAULT;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "t:", options, NULL)) != -1) {
+		switch (opt) {
+		case 't':
+			min_time = strtod(optarg, NULL);
+			break;
+		default:
+			dbx_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (argc - optind < 1 || min_time <= 0) {
+		dbx_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (dbx_bench(argv[optind], argv + optind + 1, argc - optind - 1, min_time) < 0)
+		return EXIT_FAILURE;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,401 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Builds dbx and KEK variables and a dbx update of any size from the ones
+ * in the uefi-dbx tests, with the same file names, so the plugin tests can
+ * be pointed at them:
+ *
+ *  - the dbx efivarfs dump keeps the seed's lists and adds one
+ *    EFI_CERT_SHA256 list with --hashes digests,
+ *  - dbx-update.auth has the seed's EFI_VARIABLE_AUTHENTICATION_2 header
+ *    and all of those digests, plus --update new ones and the Authenticode
+ *    digest of each --revoke binary,
+ *  - the KEK efivarfs dump holds --kek copies of the seed certificate, each
+ *    in its own list with its own serial number and owner.
+ *
+ * The PKCS#7 signature of the update is the seed's, so it does not match
+ * the new payload; only the structure is valid.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ci-authenticode.h"
+#include "ci-manifest.h"
+#include "ci-siglist.h"
+
+#define GEN_DBX_FILENAME		"dbx-d719b2cb-3d3a-4596-a3bc-dad00e67656f"
+#define GEN_KEK_FILENAME		"KEK-8be4df61-93ca-11d2-aa0d-00e098032b8c"
+#define GEN_UPDATE_FILENAME		"dbx-update.auth"
+#define GEN_HASHES_DEFAULT		1024
+#define GEN_UPDATE_DEFAULT		64
+#define GEN_KEK_DEFAULT			8
+#define GEN_REVOKE_MAX			16
+
+/* 77fa9abd-0359-4d32-bd60-28f4e78f784b, as Microsoft dbx entries use */
+static const uint8_t gen_owner_microsoft[CI_SIGLIST_GUID_LEN] = {
+	0xbd, 0x9a, 0xfa, 0x77, 0x59, 0x03, 0x32, 0x4d,
+	0xbd, 0x60, 0x28, 0xf4, 0xe7, 0x8f, 0x78, 0x4b
+};
+
+typedef struct {
+	uint8_t		*buf;
+	size_t		 len;
+	size_t		 size;
+} GenBuf;
+
+typedef struct {
+	unsigned	 hashes;
+	unsigned	 update;
+	unsigned	 kek;
+	uint8_t		 revoke[GEN_REVOKE_MAX][CI_SHA256_LEN];
+	unsigned	 n_revoke;
+} GenOptions;
+
+static uint8_t *
+gen_read_file(const char *filename, size_t *len)
+{
+	struct stat st;
+	uint8_t *buf = NULL;
+	size_t done = 0;
+	int fd = open(filename, O_RDONLY);
+
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "failed to open %s: %s\n", filename, strerror(errno));
+		goto out;
+	}
+	buf = malloc(st.st_size + 1);
+	if (buf == NULL)
+		goto out;
+	while (done < (size_t) st.st_size) {
+		ssize_t n = read(fd, buf + done, st.st_size - done);
+		if (n <= 0) {
+			fprintf(stderr, "failed to read %s\n", filename);
+			free(buf);
+			buf = NULL;
+			goto out;
+		}
+		done += n;
+	}
+	*len = done;
+out:
+	if (fd >= 0)
+		close(fd);
+	return buf;
+}
+
+static uint8_t *
+gen_read_seed(const char *dir, const char *basename, size_t *len)
+{
+	char *filename = ci_manifest_path(dir, basename);
+	uint8_t *buf = filename != NULL ? gen_read_file(filename, len) : NULL;
+	free(filename);
+	return buf;
+}
+
+static int
+gen_write_file(const char *dir, const char *basename, const GenBuf *b)
+{
+	char *filename = ci_manifest_path(dir, basename);
+	FILE *f;
+	int rc = -1;
+
+	if (filename == NULL)
+		return -1;
+	f = fopen(filename, "wb");
+	if (f == NULL) {
+		fprintf(stderr, "failed to open %s: %s\n", filename, strerror(errno));
+		goto out;
+	}
+	if (fwrite(b->buf, 1, b->len, f) != b->len || fclose(f) != 0) {
+		fprintf(stderr, "failed to write %s\n", filename);
+		goto out;
+	}
+	printf("%s: %zu bytes\n", filename, b->len);
+	rc = 0;
+out:
+	free(filename);
+	return rc;
+}
+
+static void
+gen_put_u32(uint8_t *buf, uint32_t val)
+{
+	for (unsigned i = 0; i < 4; i++)
+		buf[i] = val >> (i * 8);
+}
+
+static uint8_t *
+gen_append(GenBuf *b, const void *data, size_t len)
+{
+	uint8_t *dst;
+
+	if (b->len + len > b->size) {
+		size_t size = b->size > 0 ? b->size * 2 : 64 * 1024;
+		uint8_t *tmp;
+		while (size < b->len + len)
+			size *= 2;
+		tmp = realloc(b->buf, size);
+		if (tmp == NULL)
+			return NULL;
+		b->buf = tmp;
+		b->size = size;
+	}
+	dst = b->buf + b->len;
+	if (data != NULL)
+		memcpy(dst, data, len);
+	b->len += len;
+	return dst;
+}
+
+/* a digest nothing real has, different for every counter */
+static void
+gen_digest(uint32_t counter, uint8_t digest[CI_SHA256_LEN])
+{
+	uint8_t buf[8] = { 'd', 'b', 'x', 0 };
+	gen_put_u32(buf + 4, counter);
+	ci_sha256(buf, sizeof(buf), digest);
+}
+
+/* the seed lists, then one EFI_CERT_SHA256 list */
+static int
+gen_dbx_lists(GenBuf *b, const CiSiglist *seed, const GenOptions *opts, int update)
+{
+	unsigned n = opts->hashes + (update ? opts->update + opts->n_revoke : 0);
+	uint8_t *list;
+
+	if (gen_append(b, seed->lists, seed->lists_len) == NULL)
+		return -1;
+	list = gen_append(b, NULL, CI_SIGLIST_HEADER_LEN);
+	if (list == NULL)
+		return -1;
+	memcpy(list, ci_siglist_guid_sha256, CI_SIGLIST_GUID_LEN);
+	gen_put_u32(list + 16, CI_SIGLIST_HEADER_LEN + n * (CI_SIGLIST_GUID_LEN + CI_SHA256_LEN));
+	gen_put_u32(list + 20, 0);
+	gen_put_u32(list + 24, CI_SIGLIST_GUID_LEN + CI_SHA256_LEN);
+	for (unsigned i = 0; i < n; i++) {
+		uint8_t *sig = gen_append(b, gen_owner_microsoft, CI_SIGLIST_GUID_LEN);
+		uint8_t *digest = gen_append(b, NULL, CI_SHA256_LEN);
+		if (sig == NULL || digest == NULL)
+			return -1;
+		if (i >= opts->hashes + opts->update)
+			memcpy(digest, opts->revoke[i - opts->hashes - opts->update], CI_SHA256_LEN);
+		else
+			gen_digest(i, digest);
+	}
+	return 0;
+}
+
+/* the serial number follows the explicit v3 version of the TBSCertificate */
+static void
+gen_cert_mutate(uint8_t *cert, size_t len, uint32_t counter)
+{
+	static const uint8_t version[] = { 0xa0, 0x03, 0x02, 0x01, 0x02, 0x02 };
+
+	for (size_t i = 0; i + sizeof(version) + 1 < len; i++) {
+		uint8_t serial_len;
+		if (memcmp(cert + i, version, sizeof(version)) != 0)
+			continue;
+		serial_len = cert[i + sizeof(version)];
+		if (serial_len >= 4 && i + sizeof(version) + 1 + serial_len <= len) {
+			uint8_t *serial = cert + i + sizeof(version) + 1 + serial_len - 4;
+			for (unsigned j = 0; j < 4; j++)
+				serial[j] ^= counter >> (j * 8);
+		}
+		return;
+	}
+}
+
+static int
+gen_kek(GenBuf *b, const uint8_t *seed, const CiSiglist *seed_kek, unsigned n)
+{
+	const uint8_t *list = seed_kek->lists;
+	uint32_t list_size;
+
+	if (seed_kek->lists_len < CI_SIGLIST_HEADER_LEN) {
+		fprintf(stderr, "seed KEK has no signature list\n");
+		return -1;
+	}
+	list_size = list[16] | list[17] << 8 | list[18] << 16 | (uint32_t) list[19] << 24;
+	if (gen_append(b, seed, seed_kek->lists - seed) == NULL)
+		return -1;
+	for (unsigned i = 0; i < n; i++) {
+		uint8_t *copy = gen_append(b, list, list_size);
+		uint32_t header_size;
+		uint8_t *owner;
+		if (copy == NULL)
+			return -1;
+		if (i == 0)
+			continue;
+		header_size = copy[20] | copy[21] << 8;
+		owner = copy + CI_SIGLIST_HEADER_LEN + header_size;
+		gen_put_u32(owner + 12, i);
+		gen_cert_mutate(owner + CI_SIGLIST_GUID_LEN,
+				list_size - CI_SIGLIST_HEADER_LEN - header_size - CI_SIGLIST_GUID_LEN, i);
+	}
+	return 0;
+}
+
+static int
+gen_run(const char *seed_dir, const char *output_dir, const GenOptions *opts)
+{
+	CiSiglist dbx = { 0 };
+	CiSiglist kek = { 0 };
+	CiSiglist update = { 0 };
+	GenBuf b = { NULL, 0, 0 };
+	uint8_t *seed_dbx;
+	uint8_t *seed_kek;
+	uint8_t *seed_update;
+	size_t dbx_len = 0;
+	size_t kek_len = 0;
+	size_t update_len = 0;
+	int rc = -1;
+
+	seed_dbx = gen_read_seed(seed_dir, GEN_DBX_FILENAME, &dbx_len);
+	seed_kek = gen_read_seed(seed_dir, GEN_KEK_FILENAME, &kek_len);
+	seed_update = gen_read_seed(seed_dir, GEN_UPDATE_FILENAME, &update_len);
+	if (seed_dbx == NULL || seed_kek == NULL || seed_update == NULL)
+		goto out;
+	if (ci_siglist_parse(&dbx, seed_dbx, dbx_len) < 0 || dbx.kind != CI_SIGLIST_KIND_EFIVAR ||
+	    ci_siglist_parse(&kek, seed_kek, kek_len) < 0 || kek.kind != CI_SIGLIST_KIND_EFIVAR ||
+	    ci_siglist_parse(&update, seed_update, update_len) < 0 ||
+	    update.kind != CI_SIGLIST_KIND_AUTH) {
+		fprintf(stderr, "%s does not have valid dbx, KEK and update seeds\n", seed_dir);
+		goto out;
+	}
+	if (mkdir(output_dir, 0755) < 0 && errno != EEXIST) {
+		fprintf(stderr, "failed to create %s: %s\n", output_dir, strerror(errno));
+		goto out;
+	}
+
+	/* the efivarfs attributes, then the lists */
+	if (gen_append(&b, seed_dbx, 4) == NULL || gen_dbx_lists(&b, &dbx, opts, 0) < 0 ||
+	    gen_write_file(output_dir, GEN_DBX_FILENAME, &b) < 0)
+		goto out;
+	b.len = 0;
+	if (gen_append(&b, seed_update, update.lists - seed_update) == NULL ||
+	    gen_dbx_lists(&b, &dbx, opts, 1) < 0 ||
+	    gen_write_file(output_dir, GEN_UPDATE_FILENAME, &b) < 0)
+		goto out;
+	b.len = 0;
+	if (gen_kek(&b, seed_kek, &kek, opts->kek) < 0 ||
+	    gen_write_file(output_dir, GEN_KEK_FILENAME, &b) < 0)
+		goto out;
+	rc = 0;
+out:
+	ci_siglist_clear(&dbx);
+	ci_siglist_clear(&kek);
+	ci_siglist_clear(&update);
+	free(b.buf);
+	free(seed_dbx);
+	free(seed_kek);
+	free(seed_update);
+	return rc;
+}
+
+static int
+gen_add_revoke(GenOptions *opts, const char *filename)
+{
+	uint8_t *buf;
+	size_t len = 0;
+	int rc;
+
+	if (opts->n_revoke == GEN_REVOKE_MAX) {
+		fprintf(stderr, "cannot revoke more than %u binaries\n", GEN_REVOKE_MAX);
+		return -1;
+	}
+	buf = gen_read_file(filename, &len);
+	if (buf == NULL)
+		return -1;
+	rc = ci_authenticode_sha256(buf, len, opts->revoke[opts->n_revoke]);
+	free(buf);
+	if (rc < 0) {
+		fprintf(stderr, "%s is not a PE image\n", filename);
+		return -1;
+	}
+	opts->n_revoke++;
+	return 0;
+}
+
+static void
+gen_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [OPTION...] SEED_DIR OUTPUT_DIR\n"
+		"  -n, --hashes=N           SHA-256 digests in dbx, default %u\n"
+		"  -u, --update=N           digests the update adds, default %u\n"
+		"  -k, --kek=N              KEK certificates, default %u\n"
+		"  -r, --revoke=FILE        add the digest of a PE binary to the update\n",
+		argv0, GEN_HASHES_DEFAULT, GEN_UPDATE_DEFAULT, GEN_KEK_DEFAULT);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct option options[] = {
+		{ "hashes",		required_argument, NULL, 'n' },
+		{ "update",		required_argument, NULL, 'u' },
+		{ "kek",		required_argument, NULL, 'k' },
+		{ "revoke",		required_argument, NULL, 'r' },
+		{ NULL, 0, NULL, 0 }
+	};
+	GenOptions opts = {
+		.hashes = GEN_HASHES_DEFAULT,
+		.update = GEN_UPDATE_DEFAULT,
+		.kek = GEN_KEK_DEFAULT,
+	};
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "n:u:k:r:", options, NULL)) != -1) {
+		switch (opt) {
+		case 'n':
+			opts.hashes = strtoul(optarg, NULL, 0);
+			break;
+		case 'u':
+			opts.update = strtoul(optarg, NULL, 0);
+			break;
+		case 'k':
+			opts.kek = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			if (gen_add_revoke(&opts, optarg) < 0)
+				return EXIT_FAILURE;
+			break;
+		default:
+			gen_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (argc - optind != 2 || opts.kek == 0 || opts.hashes + opts.update > 16 * 1024 * 1024) {
+		gen_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (gen_run(argv[optind], argv[optind + 1], &opts) < 0)
+		return EXIT_FAILURE;
+	return EXIT_SUCCESS;
+}
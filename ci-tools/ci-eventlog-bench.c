@@ -0,0 +1,206 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Measures how fast event logs are walked and replayed: the parse pass reads
+ * every event header and digest, the replay pass also extends every PCR
+ * bank with the logged digests, as attestation does before it compares the
+ * result with the TPM quote.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ci-eventlog.h"
+
+#define EVENTLOG_ITERATIONS_DEFAULT	10
+
+static double
+eventlog_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint8_t *
+eventlog_read_file(const char *filename, size_t *len)
+{
+	struct stat st;
+	uint8_t *buf = NULL;
+	size_t done = 0;
+	int fd = open(filename, O_RDONLY);
+
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "failed to open %s: %s\n", filename, strerror(errno));
+		goto out;
+	}
+	buf = malloc(st.st_size + 1);
+	if (buf == NULL)
+		goto out;
+	while (done < (size_t) st.st_size) {
+		ssize_t n = read(fd, buf + done, st.st_size - done);
+		if (n <= 0) {
+			fprintf(stderr, "failed to read %s\n", filename);
+			free(buf);
+			buf = NULL;
+			goto out;
+		}
+		done += n;
+	}
+	*len = done;
+out:
+	if (fd >= 0)
+		close(fd);
+	return buf;
+}
+
+/* returns the number of events, or -1 if the log is invalid */
+static long
+eventlog_parse(const uint8_t *buf, size_t len)
+{
+	CiEventlogReader reader;
+	CiEventlogEvent event;
+	volatile unsigned sum = 0;
+	long n_events = 0;
+	int rc;
+
+	if (ci_eventlog_reader_init(&reader, buf, len) < 0)
+		return -1;
+	while ((rc = ci_eventlog_reader_next(&reader, &event)) > 0) {
+		for (unsigned i = 0; i < reader.n_algs; i++) {
+			if (event.digests[i] != NULL)
+				sum += event.digests[i][0];
+		}
+		n_events++;
+	}
+	return rc < 0 ? -1 : n_events;
+}
+
+static void
+eventlog_print_pcrs(const CiEventlogPcrs *pcrs)
+{
+	for (unsigned b = 0; b < pcrs->n_banks; b++) {
+		for (unsigned i = 0; i < CI_EVENTLOG_N_PCRS; i++) {
+			printf("  %s PCR%02u ", ci_eventlog_alg_name(pcrs->algs[b].alg_id), i);
+			for (unsigned j = 0; j < pcrs->algs[b].digest_size; j++)
+				printf("%02x", pcrs->values[b][i][j]);
+			printf("\n");
+		}
+	}
+}
+
+static int
+eventlog_bench(const char *filename, unsigned iterations, int verbose)
+{
+	CiEventlogPcrs pcrs;
+	uint8_t *buf;
+	size_t len = 0;
+	long n_events = 0;
+	double parse;
+	double replay;
+	double start;
+	int rc = -1;
+
+	buf = eventlog_read_file(filename, &len);
+	if (buf == NULL)
+		return -1;
+	start = eventlog_now();
+	for (unsigned it = 0; it < iterations; it++) {
+		n_events = eventlog_parse(buf, len);
+		if (n_events < 0) {
+			fprintf(stderr, "%s is not a valid event log\n", filename);
+			goto out;
+		}
+	}
+	parse = (eventlog_now() - start) / iterations;
+	start = eventlog_now();
+	for (unsigned it = 0; it < iterations; it++) {
+		if (ci_eventlog_replay(buf, len, &pcrs) < 0) {
+			fprintf(stderr, "failed to replay %s\n", filename);
+			goto out;
+		}
+	}
+	replay = (eventlog_now() - start) / iterations;
+	printf("%s: %zu bytes, %ld events, %u banks\n", filename, len, n_events, pcrs.n_banks);
+	printf("  parse  %10.1f MB/s %12.0f events/s\n", len / parse / 1e6, n_events / parse);
+	printf("  replay %10.1f MB/s %12.0f events/s\n", len / replay / 1e6, n_events / replay);
+	if (verbose)
+		eventlog_print_pcrs(&pcrs);
+	rc = 0;
+out:
+	free(buf);
+	return rc;
+}
+
+static void
+eventlog_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [OPTION...] EVENTLOG...\n"
+		"  -n, --iterations=N       walk each log N times, default %u\n"
+		"  -v, --verbose            print the replayed PCR values\n",
+		argv0, EVENTLOG_ITERATIONS_DEFAULT);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct option options[] = {
+		{ "iterations",		required_argument, NULL, 'n' },
+		{ "verbose",		no_argument, NULL, 'v' },
+		{ NULL, 0, NULL, 0 }
+	};
+	unsigned iterations = EVENTLOG_ITERATIONS_DEFAULT;
+	int verbose = 0;
+	int rc = EXIT_SUCCESS;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "n:v", options, NULL)) != -1) {
+		switch (opt) {
+		case 'n':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			eventlog_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (argc - optind < 1 || iterations == 0) {
+		eventlog_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	for (int i = optind; i < argc; i++) {
+		if (eventlog_bench(argv[i], iterations, verbose) < 0)
+			rc = EXIT_FAILURE;
+	}
+	return rc;
+}
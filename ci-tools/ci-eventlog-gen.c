@@ -0,0 +1,465 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Grows a crypto agile TPM event log to an arbitrary size, so the parser
+ * and the PCR replay can be measured on logs as large as the ones servers
+ * produce.
+ *
+ * The output starts with a Spec ID Event03 header for the chosen digest
+ * banks and every event of the seed log. It then repeats the seed's EFI
+ * variable, boot services application and IPL events, each changed a
+ * little so no two events share a digest, and optionally IMA-like file
+ * measurements into PCR 10, until the log reaches the requested size.
+ * Digests the seed logged for a bank are kept; every other digest is that
+ * of the event data.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ci-eventlog.h"
+#include "ci-sha256.h"
+
+#define GEN_SIZE_DEFAULT		(1024 * 1024)
+#define GEN_ALGS_DEFAULT		"sha1,sha256,sha384"
+#define GEN_IMA_PCR			10
+#define GEN_EVENT_MAX			(64 * 1024)
+
+typedef struct {
+	FILE		*f;
+	uint64_t	 size;
+	uint64_t	 n_events;
+	CiEventlogAlg	 algs[CI_EVENTLOG_MAX_ALGS];
+	unsigned	 n_algs;
+	int		 seed_bank[CI_EVENTLOG_MAX_ALGS];	/* or -1 */
+} GenWriter;
+
+static uint8_t *
+gen_read_file(const char *filename, size_t *len)
+{
+	struct stat st;
+	uint8_t *buf = NULL;
+	size_t done = 0;
+	int fd = open(filename, O_RDONLY);
+
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "failed to open %s: %s\n", filename, strerror(errno));
+		goto out;
+	}
+	buf = malloc(st.st_size + 1);
+	if (buf == NULL)
+		goto out;
+	while (done < (size_t) st.st_size) {
+		ssize_t n = read(fd, buf + done, st.st_size - done);
+		if (n <= 0) {
+			fprintf(stderr, "failed to read %s\n", filename);
+			free(buf);
+			buf = NULL;
+			goto out;
+		}
+		done += n;
+	}
+	*len = done;
+out:
+	if (fd >= 0)
+		close(fd);
+	return buf;
+}
+
+static void
+gen_put_u16(uint8_t *buf, uint16_t val)
+{
+	buf[0] = val;
+	buf[1] = val >> 8;
+}
+
+static void
+gen_put_u32(uint8_t *buf, uint32_t val)
+{
+	for (unsigned i = 0; i < 4; i++)
+		buf[i] = val >> (i * 8);
+}
+
+static void
+gen_put_u64(uint8_t *buf, uint64_t val)
+{
+	for (unsigned i = 0; i < 8; i++)
+		buf[i] = val >> (i * 8);
+}
+
+static uint64_t
+gen_get_u64(const uint8_t *buf)
+{
+	uint64_t val = 0;
+	for (unsigned i = 0; i < 8; i++)
+		val |= (uint64_t) buf[i] << (i * 8);
+	return val;
+}
+
+static int
+gen_write(GenWriter *w, const void *buf, size_t len)
+{
+	if (fwrite(buf, 1, len, w->f) != len)
+		return -1;
+	w->size += len;
+	return 0;
+}
+
+/* the header event is always in the SHA-1 format */
+static int
+gen_write_spec_id(GenWriter *w, const CiEventlogReader *seed)
+{
+	uint8_t hdr[32] = { 0 };
+	uint8_t data[28 + CI_EVENTLOG_MAX_ALGS * 4 + 1] = { 0 };
+	size_t size = 0;
+
+	if (seed->spec_id != NULL) {
+		/* signature, platformClass, versions and uintnSize */
+		memcpy(data, seed->spec_id, 24);
+	} else {
+		memcpy(data, CI_EVENTLOG_SPEC_ID, sizeof(CI_EVENTLOG_SPEC_ID));
+		data[21] = 2;
+		data[23] = 2;
+	}
+	gen_put_u32(data + 24, w->n_algs);
+	size = 28;
+	for (unsigned i = 0; i < w->n_algs; i++) {
+		gen_put_u16(data + size, w->algs[i].alg_id);
+		gen_put_u16(data + size + 2, w->algs[i].digest_size);
+		size += 4;
+	}
+	data[size++] = 0;	/* vendorInfoSize */
+	gen_put_u32(hdr + 4, CI_EVENTLOG_EV_NO_ACTION);
+	gen_put_u32(hdr + 28, size);
+	if (gen_write(w, hdr, sizeof(hdr)) < 0 || gen_write(w, data, size) < 0)
+		return -1;
+	return 0;
+}
+
+/* seed_digests is indexed by seed bank and may be NULL */
+static int
+gen_write_event(GenWriter *w, uint32_t pcr, uint32_t type,
+		const uint8_t *const *seed_digests, const uint8_t *data, uint32_t size)
+{
+	uint8_t buf[12 + CI_EVENTLOG_MAX_ALGS * (2 + CI_EVENTLOG_MAX_DIGEST) + 4];
+	size_t pos = 12;
+
+	gen_put_u32(buf, pcr);
+	gen_put_u32(buf + 4, type);
+	gen_put_u32(buf + 8, w->n_algs);
+	for (unsigned i = 0; i < w->n_algs; i++) {
+		int bank = w->seed_bank[i];
+		uint8_t *digest = buf + pos + 2;
+		gen_put_u16(buf + pos, w->algs[i].alg_id);
+		if (type == CI_EVENTLOG_EV_NO_ACTION)
+			memset(digest, 0, w->algs[i].digest_size);
+		else if (seed_digests != NULL && bank >= 0 && seed_digests[bank] != NULL)
+			memcpy(digest, seed_digests[bank], w->algs[i].digest_size);
+		else
+			ci_eventlog_hash(w->algs[i].alg_id, data, size, NULL, 0, digest);
+		pos += 2 + w->algs[i].digest_size;
+	}
+	gen_put_u32(buf + pos, size);
+	pos += 4;
+	if (gen_write(w, buf, pos) < 0 || gen_write(w, data, size) < 0)
+		return -1;
+	w->n_events++;
+	return 0;
+}
+
+static int
+gen_is_template(uint32_t type)
+{
+	switch (type) {
+	case CI_EVENTLOG_EV_IPL:
+	case CI_EVENTLOG_EV_EFI_VARIABLE_DRIVER_CONFIG:
+	case CI_EVENTLOG_EV_EFI_VARIABLE_BOOT:
+	case CI_EVENTLOG_EV_EFI_BOOT_SERVICES_APPLICATION:
+	case CI_EVENTLOG_EV_EFI_VARIABLE_AUTHORITY:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/*
+ * Changes a copy of a seed event so it measures something new: the data of
+ * a UEFI_VARIABLE_DATA, the load address of an UEFI_IMAGE_LOAD_EVENT, or the
+ * string of an IPL event.
+ */
+static uint32_t
+gen_mutate(const CiEventlogEvent *event, uint64_t counter, uint8_t *buf)
+{
+	uint32_t size = event->data_size;
+
+	memcpy(buf, event->data, size);
+	switch (event->type) {
+	case CI_EVENTLOG_EV_EFI_VARIABLE_DRIVER_CONFIG:
+	case CI_EVENTLOG_EV_EFI_VARIABLE_BOOT:
+	case CI_EVENTLOG_EV_EFI_VARIABLE_AUTHORITY:
+		if (size >= 32) {
+			uint64_t name_len = gen_get_u64(buf + 16);
+			uint64_t data_len = gen_get_u64(buf + 24);
+			if (name_len < size && data_len >= 8 &&
+			    32 + name_len * 2 + data_len == size) {
+				gen_put_u64(buf + 32 + name_len * 2, counter);
+				return size;
+			}
+		}
+		break;
+	case CI_EVENTLOG_EV_EFI_BOOT_SERVICES_APPLICATION:
+		if (size >= 8) {
+			gen_put_u64(buf, gen_get_u64(buf) + counter * 0x100000);
+			return size;
+		}
+		break;
+	default:
+		break;
+	}
+	if (size > 0 && buf[size - 1] == '\0')
+		size--;
+	return size + snprintf((char *) buf + size, 24, " #%llu", (unsigned long long) counter) + 1;
+}
+
+/* the ima-ng template data, as IMA would log it for a file */
+static uint32_t
+gen_ima(uint64_t counter, uint8_t *buf)
+{
+	uint8_t digest[CI_SHA256_LEN];
+	char hex[CI_SHA256_HEX_LEN + 1];
+
+	ci_sha256(&counter, sizeof(counter), digest);
+	ci_sha256_to_hex(digest, hex);
+	return snprintf((char *) buf, GEN_EVENT_MAX,
+			"ima-ng sha256:%s /usr/lib/modules/ci/kernel/%08llx.ko",
+			hex, (unsigned long long) counter) + 1;
+}
+
+static int
+gen_parse_algs(GenWriter *w, const char *list)
+{
+	char *tmp = strdup(list);
+	char *saveptr = NULL;
+	int rc = -1;
+
+	w->n_algs = 0;
+	for (char *tok = strtok_r(tmp, ",", &saveptr); tok != NULL;
+	     tok = strtok_r(NULL, ",", &saveptr)) {
+		uint16_t alg_id = 0;
+		for (uint16_t id = CI_EVENTLOG_ALG_SHA1; id <= CI_EVENTLOG_ALG_SHA512; id++) {
+			const char *name = ci_eventlog_alg_name(id);
+			if (name != NULL && strcmp(name, tok) == 0)
+				alg_id = id;
+		}
+		if (alg_id == 0) {
+			fprintf(stderr, "unknown digest algorithm %s\n", tok);
+			goto out;
+		}
+		for (unsigned i = 0; i < w->n_algs; i++) {
+			if (w->algs[i].alg_id == alg_id) {
+				fprintf(stderr, "%s listed twice\n", tok);
+				goto out;
+			}
+		}
+		if (w->n_algs == CI_EVENTLOG_MAX_ALGS) {
+			fprintf(stderr, "too many digest algorithms\n");
+			goto out;
+		}
+		w->algs[w->n_algs].alg_id = alg_id;
+		w->algs[w->n_algs].digest_size = ci_eventlog_digest_size(alg_id);
+		w->n_algs++;
+	}
+	rc = w->n_algs > 0 ? 0 : -1;
+out:
+	free(tmp);
+	return rc;
+}
+
+/* accepts a K, M or G suffix */
+static uint64_t
+gen_parse_size(const char *str)
+{
+	char *end = NULL;
+	uint64_t val = strtoull(str, &end, 0);
+
+	switch (*end) {
+	case 'K':
+		return val << 10;
+	case 'M':
+		return val << 20;
+	case 'G':
+		return val << 30;
+	default:
+		return val;
+	}
+}
+
+static int
+gen_run(GenWriter *w, const uint8_t *seed, size_t seed_len, uint64_t size, unsigned ima)
+{
+	CiEventlogReader reader;
+	CiEventlogEvent event;
+	CiEventlogEvent *templates = NULL;
+	size_t n_templates = 0;
+	uint8_t *buf = malloc(GEN_EVENT_MAX + 32);
+	int rc = -1;
+	int ret;
+
+	if (buf == NULL)
+		goto out;
+	if (ci_eventlog_reader_init(&reader, seed, seed_len) < 0) {
+		fprintf(stderr, "seed is not a valid event log\n");
+		goto out;
+	}
+	for (unsigned i = 0; i < w->n_algs; i++) {
+		w->seed_bank[i] = -1;
+		for (unsigned j = 0; j < reader.n_algs; j++) {
+			if (reader.algs[j].alg_id == w->algs[i].alg_id)
+				w->seed_bank[i] = j;
+		}
+	}
+	templates = calloc(seed_len / 12 + 1, sizeof(CiEventlogEvent));
+	if (templates == NULL || gen_write_spec_id(w, &reader) < 0)
+		goto out;
+	while ((ret = ci_eventlog_reader_next(&reader, &event)) > 0) {
+		if (gen_write_event(w, event.pcr, event.type, event.digests,
+				    event.data, event.data_size) < 0)
+			goto out;
+		if (gen_is_template(event.type) && event.data_size <= GEN_EVENT_MAX)
+			templates[n_templates++] = event;
+	}
+	if (ret < 0) {
+		fprintf(stderr, "seed is not a valid event log\n");
+		goto out;
+	}
+	if (n_templates == 0 && ima == 0 && w->size < size) {
+		fprintf(stderr, "seed has no events to repeat\n");
+		goto out;
+	}
+
+	/* the IMA share is spread evenly through the log */
+	for (uint64_t counter = 0, acc = 0; w->size < size; counter++) {
+		uint32_t len;
+		acc += ima;
+		if (acc >= 100 || n_templates == 0) {
+			acc = acc >= 100 ? acc - 100 : acc;
+			len = gen_ima(counter, buf);
+			ret = gen_write_event(w, GEN_IMA_PCR, CI_EVENTLOG_EV_IPL, NULL, buf, len);
+		} else {
+			const CiEventlogEvent *tmpl = &templates[counter % n_templates];
+			len = gen_mutate(tmpl, counter, buf);
+			ret = gen_write_event(w, tmpl->pcr, tmpl->type, NULL, buf, len);
+		}
+		if (ret < 0)
+			goto out;
+	}
+	rc = 0;
+out:
+	free(templates);
+	free(buf);
+	return rc;
+}
+
+static void
+gen_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [OPTION...] SEED OUTPUT\n"
+		"  -a, --algs=LIST          digest banks, default %s\n"
+		"  -i, --ima=PERCENT        share of IMA-like events, default 0\n"
+		"  -s, --size=BYTES         grow the log to at least this size, default 1M\n",
+		argv0, GEN_ALGS_DEFAULT);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct option options[] = {
+		{ "algs",		required_argument, NULL, 'a' },
+		{ "ima",		required_argument, NULL, 'i' },
+		{ "size",		required_argument, NULL, 's' },
+		{ NULL, 0, NULL, 0 }
+	};
+	const char *algs = GEN_ALGS_DEFAULT;
+	uint64_t size = GEN_SIZE_DEFAULT;
+	unsigned ima = 0;
+	GenWriter w = { 0 };
+	uint8_t *seed = NULL;
+	size_t seed_len = 0;
+	int rc = EXIT_FAILURE;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "a:i:s:", options, NULL)) != -1) {
+		switch (opt) {
+		case 'a':
+			algs = optarg;
+			break;
+		case 'i':
+			ima = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			size = gen_parse_size(optarg);
+			break;
+		default:
+			gen_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (argc - optind != 2 || ima > 100) {
+		gen_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (gen_parse_algs(&w, algs) < 0)
+		return EXIT_FAILURE;
+	seed = gen_read_file(argv[optind], &seed_len);
+	if (seed == NULL)
+		return EXIT_FAILURE;
+	w.f = fopen(argv[optind + 1], "wb");
+	if (w.f == NULL) {
+		fprintf(stderr, "failed to open %s: %s\n", argv[optind + 1], strerror(errno));
+		goto out;
+	}
+	if (gen_run(&w, seed, seed_len, size, ima) < 0)
+		goto out;
+	if (fclose(w.f) != 0) {
+		w.f = NULL;
+		fprintf(stderr, "failed to write %s\n", argv[optind + 1]);
+		goto out;
+	}
+	w.f = NULL;
+	printf("%s: %llu bytes, %llu events\n", argv[optind + 1],
+	       (unsigned long long) w.size, (unsigned long long) w.n_events);
+	rc = EXIT_SUCCESS;
+out:
+	if (w.f != NULL) {
+		fclose(w.f);
+		unlink(argv[optind + 1]);
+	}
+	free(seed);
+	return rc;
+}
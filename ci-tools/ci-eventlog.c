@@ -0,0 +1,275 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "ci-eventlog.h"
+#include "ci-sha1.h"
+#include "ci-sha256.h"
+#include "ci-sha512.h"
+
+/* the SHA-1 format header: pcr, type, digest[20], size */
+#define CI_EVENTLOG_SHA1_HEADER		32
+
+static uint16_t
+ci_eventlog_u16(const uint8_t *buf)
+{
+	return buf[0] | buf[1] << 8;
+}
+
+static uint32_t
+ci_eventlog_u32(const uint8_t *buf)
+{
+	return buf[0] | buf[1] << 8 | buf[2] << 16 | (uint32_t) buf[3] << 24;
+}
+
+size_t
+ci_eventlog_digest_size(uint16_t alg_id)
+{
+	switch (alg_id) {
+	case CI_EVENTLOG_ALG_SHA1:
+		return CI_SHA1_LEN;
+	case CI_EVENTLOG_ALG_SHA256:
+		return CI_SHA256_LEN;
+	case CI_EVENTLOG_ALG_SHA384:
+		return CI_SHA384_LEN;
+	case CI_EVENTLOG_ALG_SHA512:
+		return CI_SHA512_LEN;
+	default:
+		return 0;
+	}
+}
+
+const char *
+ci_eventlog_alg_name(uint16_t alg_id)
+{
+	switch (alg_id) {
+	case CI_EVENTLOG_ALG_SHA1:
+		return "sha1";
+	case CI_EVENTLOG_ALG_SHA256:
+		return "sha256";
+	case CI_EVENTLOG_ALG_SHA384:
+		return "sha384";
+	case CI_EVENTLOG_ALG_SHA512:
+		return "sha512";
+	default:
+		return NULL;
+	}
+}
+
+/* digest of a followed by b, which is a PCR extend when a is the old value */
+int
+ci_eventlog_hash(uint16_t alg_id, const void *a, size_t a_len,
+		 const void *b, size_t b_len, uint8_t *digest)
+{
+	switch (alg_id) {
+	case CI_EVENTLOG_ALG_SHA1: {
+		CiSha1 ctx;
+		ci_sha1_init(&ctx);
+		ci_sha1_update(&ctx, a, a_len);
+		ci_sha1_update(&ctx, b, b_len);
+		ci_sha1_final(&ctx, digest);
+		return 0;
+	}
+	case CI_EVENTLOG_ALG_SHA256: {
+		CiSha256 ctx;
+		ci_sha256_init(&ctx);
+		ci_sha256_update(&ctx, a, a_len);
+		ci_sha256_update(&ctx, b, b_len);
+		ci_sha256_final(&ctx, digest);
+		return 0;
+	}
+	case CI_EVENTLOG_ALG_SHA384:
+	case CI_EVENTLOG_ALG_SHA512: {
+		CiSha512 ctx;
+		if (alg_id == CI_EVENTLOG_ALG_SHA384)
+			ci_sha384_init(&ctx);
+		else
+			ci_sha512_init(&ctx);
+		ci_sha512_update(&ctx, a, a_len);
+		ci_sha512_update(&ctx, b, b_len);
+		ci_sha512_final(&ctx, digest);
+		return 0;
+	}
+	default:
+		return -1;
+	}
+}
+
+/*
+ * Reads the Spec ID Event03 header if there is one. Returns -1 if the log
+ * is truncated or the header lists algorithms without a usable size.
+ */
+int
+ci_eventlog_reader_init(CiEventlogReader *reader, const uint8_t *buf, size_t len)
+{
+	const uint8_t *data;
+	uint32_t size;
+	uint32_t n_algs;
+
+	memset(reader, 0, sizeof(CiEventlogReader));
+	reader->buf = buf;
+	reader->len = len;
+	reader->algs[0].alg_id = CI_EVENTLOG_ALG_SHA1;
+	reader->algs[0].digest_size = CI_SHA1_LEN;
+	reader->n_algs = 1;
+	if (len < CI_EVENTLOG_SHA1_HEADER)
+		return len == 0 ? 0 : -1;
+	size = ci_eventlog_u32(buf + 28);
+	if (size > len - CI_EVENTLOG_SHA1_HEADER)
+		return -1;
+	data = buf + CI_EVENTLOG_SHA1_HEADER;
+	if (ci_eventlog_u32(buf + 4) != CI_EVENTLOG_EV_NO_ACTION || size < 28 ||
+	    memcmp(data, CI_EVENTLOG_SPEC_ID, sizeof(CI_EVENTLOG_SPEC_ID)) != 0)
+		return 0;
+
+	/* signature, platformClass, versions, uintnSize, numberOfAlgorithms */
+	n_algs = ci_eventlog_u32(data + 24);
+	if (n_algs == 0 || n_algs > CI_EVENTLOG_MAX_ALGS || size < 28 + n_algs * 4)
+		return -1;
+	for (uint32_t i = 0; i < n_algs; i++) {
+		reader->algs[i].alg_id = ci_eventlog_u16(data + 28 + i * 4);
+		reader->algs[i].digest_size = ci_eventlog_u16(data + 28 + i * 4 + 2);
+		if (reader->algs[i].digest_size == 0 ||
+		    reader->algs[i].digest_size > CI_EVENTLOG_MAX_DIGEST)
+			return -1;
+	}
+	reader->n_algs = n_algs;
+	reader->crypto_agile = 1;
+	reader->spec_id = data;
+	reader->spec_id_size = size;
+	reader->pos = CI_EVENTLOG_SHA1_HEADER + size;
+	return 0;
+}
+
+static int
+ci_eventlog_reader_next_agile(CiEventlogReader *reader, CiEventlogEvent *event)
+{
+	const uint8_t *buf = reader->buf;
+	size_t pos = reader->pos;
+	size_t end = reader->len;
+	uint32_t count;
+
+	if (end - pos < 12)
+		return -1;
+	event->pcr = ci_eventlog_u32(buf + pos);
+	event->type = ci_eventlog_u32(buf + pos + 4);
+	count = ci_eventlog_u32(buf + pos + 8);
+	if (count > reader->n_algs)
+		return -1;
+	pos += 12;
+	memset(event->digests, 0, sizeof(event->digests));
+	for (uint32_t i = 0; i < count; i++) {
+		uint16_t alg_id;
+		unsigned bank;
+		if (end - pos < 2)
+			return -1;
+		alg_id = ci_eventlog_u16(buf + pos);
+		for (bank = 0; bank < reader->n_algs; bank++) {
+			if (reader->algs[bank].alg_id == alg_id)
+				break;
+		}
+		if (bank == reader->n_algs ||
+		    end - pos - 2 < reader->algs[bank].digest_size)
+			return -1;
+		event->digests[bank] = buf + pos + 2;
+		pos += 2 + reader->algs[bank].digest_size;
+	}
+	if (end - pos < 4)
+		return -1;
+	event->data_size = ci_eventlog_u32(buf + pos);
+	pos += 4;
+	if (event->data_size > end - pos)
+		return -1;
+	event->data = buf + pos;
+	reader->pos = pos + event->data_size;
+	return 1;
+}
+
+/* returns 1 for an event, 0 at the end of the log and -1 if it is invalid */
+int
+ci_eventlog_reader_next(CiEventlogReader *reader, CiEventlogEvent *event)
+{
+	const uint8_t *buf = reader->buf + reader->pos;
+	size_t left = reader->len - reader->pos;
+
+	if (left == 0)
+		return 0;
+	if (reader->crypto_agile)
+		return ci_eventlog_reader_next_agile(reader, event);
+	if (left < CI_EVENTLOG_SHA1_HEADER)
+		return -1;
+	event->pcr = ci_eventlog_u32(buf);
+	event->type = ci_eventlog_u32(buf + 4);
+	memset(event->digests, 0, sizeof(event->digests));
+	event->digests[0] = buf + 8;
+	event->data_size = ci_eventlog_u32(buf + 28);
+	if (event->data_size > left - CI_EVENTLOG_SHA1_HEADER)
+		return -1;
+	event->data = buf + CI_EVENTLOG_SHA1_HEADER;
+	reader->pos += CI_EVENTLOG_SHA1_HEADER + event->data_size;
+	return 1;
+}
+
+/*
+ * Computes the PCR values the log should have produced, for every bank
+ * with a known algorithm. EV_NO_ACTION events are not extended, except
+ * that a StartupLocality event sets the initial value of PCR 0.
+ */
+int
+ci_eventlog_replay(const uint8_t *buf, size_t len, CiEventlogPcrs *pcrs)
+{
+	CiEventlogReader reader;
+	CiEventlogEvent event;
+	unsigned banks[CI_EVENTLOG_MAX_ALGS];
+	int rc;
+
+	memset(pcrs, 0, sizeof(CiEventlogPcrs));
+	if (ci_eventlog_reader_init(&reader, buf, len) < 0)
+		return -1;
+	for (unsigned i = 0; i < reader.n_algs; i++) {
+		if (ci_eventlog_digest_size(reader.algs[i].alg_id) != reader.algs[i].digest_size)
+			continue;
+		banks[pcrs->n_banks] = i;
+		pcrs->algs[pcrs->n_banks++] = reader.algs[i];
+	}
+	while ((rc = ci_eventlog_reader_next(&reader, &event)) > 0) {
+		if (event.pcr >= CI_EVENTLOG_N_PCRS)
+			return -1;
+		if (event.type == CI_EVENTLOG_EV_NO_ACTION) {
+			if (event.pcr == 0 && event.data_size >= 17 &&
+			    memcmp(event.data, "StartupLocality", 16) == 0) {
+				for (unsigned b = 0; b < pcrs->n_banks; b++)
+					pcrs->values[b][0][pcrs->algs[b].digest_size - 1] = event.data[16];
+			}
+			continue;
+		}
+		for (unsigned b = 0; b < pcrs->n_banks; b++) {
+			uint8_t *value = pcrs->values[b][event.pcr];
+			const uint8_t *digest = event.digests[banks[b]];
+			size_t size = pcrs->algs[b].digest_size;
+			if (digest == NULL)
+				continue;
+			ci_eventlog_hash(pcrs->algs[b].alg_id, value, size, digest, size, value);
+		}
+	}
+	return rc;
+}
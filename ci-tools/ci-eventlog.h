@@ -0,0 +1,113 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CI_EVENTLOG_H
+#define __CI_EVENTLOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * TCG PC Client event logs, as read from binary_bios_measurements.
+ *
+ * A crypto agile log starts with a TCG_PCClientPCREvent in the SHA-1 format
+ * holding the "Spec ID Event03" structure, which lists the digest
+ * algorithms every following TCG_PCR_EVENT2 may use:
+ *
+ *   uint32 pcr, uint32 type, uint32 count, { uint16 alg, digest }[count],
+ *   uint32 size, event[size]
+ *
+ * Logs without that header are read as SHA-1 only logs, where every event
+ * is a TCG_PCClientPCREvent with one 20 byte digest.
+ */
+
+#define CI_EVENTLOG_MAX_ALGS		5
+#define CI_EVENTLOG_MAX_DIGEST		64
+#define CI_EVENTLOG_N_PCRS		24
+#define CI_EVENTLOG_SPEC_ID		"Spec ID Event03"
+
+typedef enum {
+	CI_EVENTLOG_ALG_SHA1		= 0x0004,
+	CI_EVENTLOG_ALG_SHA256		= 0x000b,
+	CI_EVENTLOG_ALG_SHA384		= 0x000c,
+	CI_EVENTLOG_ALG_SHA512		= 0x000d,
+} CiEventlogAlgId;
+
+typedef enum {
+	CI_EVENTLOG_EV_NO_ACTION			= 0x00000003,
+	CI_EVENTLOG_EV_SEPARATOR			= 0x00000004,
+	CI_EVENTLOG_EV_IPL				= 0x0000000d,
+	CI_EVENTLOG_EV_EFI_VARIABLE_DRIVER_CONFIG	= 0x80000001,
+	CI_EVENTLOG_EV_EFI_VARIABLE_BOOT		= 0x80000002,
+	CI_EVENTLOG_EV_EFI_BOOT_SERVICES_APPLICATION	= 0x80000003,
+	CI_EVENTLOG_EV_EFI_VARIABLE_AUTHORITY		= 0x800000e0,
+} CiEventlogEventType;
+
+typedef struct {
+	uint16_t	 alg_id;
+	uint16_t	 digest_size;
+} CiEventlogAlg;
+
+typedef struct {
+	uint32_t	 pcr;
+	uint32_t	 type;
+	const uint8_t	*digests[CI_EVENTLOG_MAX_ALGS];	/* by bank, NULL if not logged */
+	const uint8_t	*data;
+	uint32_t	 data_size;
+} CiEventlogEvent;
+
+typedef struct {
+	const uint8_t	*buf;
+	size_t		 len;
+	size_t		 pos;
+	int		 crypto_agile;
+	const uint8_t	*spec_id;		/* the header event data, or NULL */
+	uint32_t	 spec_id_size;
+	CiEventlogAlg	 algs[CI_EVENTLOG_MAX_ALGS];
+	unsigned	 n_algs;
+} CiEventlogReader;
+
+typedef struct {
+	unsigned	 n_banks;
+	CiEventlogAlg	 algs[CI_EVENTLOG_MAX_ALGS];
+	uint8_t		 values[CI_EVENTLOG_MAX_ALGS][CI_EVENTLOG_N_PCRS][CI_EVENTLOG_MAX_DIGEST];
+} CiEventlogPcrs;
+
+size_t		 ci_eventlog_digest_size	(uint16_t		 alg_id);
+const char	*ci_eventlog_alg_name		(uint16_t		 alg_id);
+int		 ci_eventlog_hash		(uint16_t		 alg_id,
+						 const void		*a,
+						 size_t			 a_len,
+						 const void		*b,
+						 size_t			 b_len,
+						 uint8_t		*digest);
+
+int		 ci_eventlog_reader_init	(CiEventlogReader	*reader,
+						 const uint8_t		*buf,
+						 size_t			 len);
+int		 ci_eventlog_reader_next	(CiEventlogReader	*reader,
+						 CiEventlogEvent	*event);
+
+int		 ci_eventlog_replay		(const uint8_t		*buf,
+						 size_t			 len,
+						 CiEventlogPcrs		*pcrs);
+
+#endif /* __CI_EVENTLOG_H */
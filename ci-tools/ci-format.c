@@ -0,0 +1,178 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "ci-format.h"
+
+static uint16_t
+ci_format_u16(const uint8_t *buf)
+{
+	return buf[0] | buf[1] << 8;
+}
+
+static uint32_t
+ci_format_u32(const uint8_t *buf)
+{
+	return buf[0] | buf[1] << 8 | buf[2] << 16 | (uint32_t) buf[3] << 24;
+}
+
+static int
+ci_format_is_pe(const uint8_t *buf, size_t len)
+{
+	uint32_t pe;
+
+	if (len < 0x40 || memcmp(buf, "MZ", 2) != 0)
+		return 0;
+	pe = ci_format_u32(buf + 0x3c);
+	return pe <= len - 4 && memcmp(buf + pe, "PE\0\0", 4) == 0;
+}
+
+/* a table with a 4 character signature, its length and a zero checksum */
+static int
+ci_format_is_acpi(const uint8_t *buf, size_t len)
+{
+	uint8_t sum = 0;
+
+	if (len < 36 || ci_format_u32(buf + 4) != len)
+		return 0;
+	for (int i = 0; i < 4; i++) {
+		if (!((buf[i] >= 'A' && buf[i] <= 'Z') || (buf[i] >= '0' && buf[i] <= '9')))
+			return 0;
+	}
+	for (size_t i = 0; i < len; i++)
+		sum += buf[i];
+	return sum == 0;
+}
+
+/* the DFU 1.0 suffix: ..., "UFD", bLength of 16, CRC */
+static int
+ci_format_is_dfu(const uint8_t *buf, size_t len)
+{
+	return len >= 16 && memcmp(buf + len - 8, "UFD", 3) == 0 && buf[len - 5] == 16;
+}
+
+/* every structure is walked, up to the end-of-table structure */
+static int
+ci_format_is_smbios(const uint8_t *buf, size_t len)
+{
+	size_t pos = 0;
+	unsigned n = 0;
+
+	while (pos + 4 <= len) {
+		uint8_t type = buf[pos];
+		uint8_t length = buf[pos + 1];
+		if (length < 4 || pos + length + 2 > len)
+			return 0;
+		pos += length;
+		while (pos + 1 < len && (buf[pos] != 0 || buf[pos + 1] != 0))
+			pos++;
+		pos += 2;
+		n++;
+		if (type == 127)
+			return pos <= len;
+	}
+	return n > 0 && pos == len;
+}
+
+/* TCG PC Client event log; crypto agile ones start with Spec ID Event03 */
+static const char *
+ci_format_tpm_eventlog(const uint8_t *buf, size_t len)
+{
+	size_t pos = 0;
+
+	if (len < 32 + 16)
+		return NULL;
+	if (ci_format_u32(buf) == 0 && ci_format_u32(buf + 4) == 0x3 &&
+	    memcmp(buf + 32, "Spec ID Event03", 16) == 0)
+		return "tpm-eventlog-v2";
+
+	/* SHA-1 only: pcr, type, digest, size, event, to the end exactly */
+	while (pos + 32 <= len) {
+		uint32_t event_size = ci_format_u32(buf + pos + 28);
+		if (ci_format_u32(buf + pos) >= 24 || event_size > len - pos - 32)
+			return NULL;
+		pos += 32 + event_size;
+	}
+	return pos == len ? "tpm-eventlog-v1" : NULL;
+}
+
+static int
+ci_format_is_efivar(const uint8_t *buf, size_t len)
+{
+	/* EFI_CERT_X509_GUID and EFI_CERT_SHA256_GUID */
+	static const uint8_t guids[][16] = {
+		{ 0xa1, 0x59, 0xc0, 0xa5, 0xe4, 0x94, 0xa7, 0x4a,
+		  0x87, 0xb5, 0xab, 0x15, 0x5c, 0x2b, 0xf0, 0x72 },
+		{ 0x26, 0x16, 0xc4, 0xc1, 0x4c, 0x50, 0x92, 0x40,
+		  0xac, 0xa9, 0x41, 0xf9, 0x36, 0x93, 0x43, 0x28 },
+	};
+
+	/* efivarfs attributes, then the first EFI_SIGNATURE_LIST */
+	if (len < 4 + 28 || ci_format_u32(buf) & ~0x7fu)
+		return 0;
+	if (ci_format_u32(buf + 4 + 16) > len - 4)
+		return 0;
+	for (size_t i = 0; i < sizeof(guids) / sizeof(guids[0]); i++) {
+		if (memcmp(buf + 4, guids[i], 16) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+/* EFI_VARIABLE_AUTHENTICATION_2: EFI_TIME, then WIN_CERT_TYPE_EFI_GUID */
+static int
+ci_format_is_efi_auth(const uint8_t *buf, size_t len)
+{
+	return len >= 16 + 24 &&
+	       ci_format_u32(buf + 16) <= len - 16 &&
+	       ci_format_u16(buf + 20) == 0x0200 &&
+	       ci_format_u16(buf + 22) == 0x0ef1;
+}
+
+const char *
+ci_format_detect(const uint8_t *buf, size_t len)
+{
+	const char *tmp;
+
+	if (len == 0)
+		return "empty";
+	if (len >= 16 && memcmp(buf, "SQLite format 3", 16) == 0)
+		return "sqlite";
+	if (ci_format_is_pe(buf, len))
+		return "pe";
+	if (len <= 32 && (memcmp(buf, "_SM_", 4) == 0 || memcmp(buf, "_SM3_", 5) == 0))
+		return "smbios-entry-point";
+	if (ci_format_is_acpi(buf, len))
+		return "acpi";
+	if (ci_format_is_dfu(buf, len))
+		return "dfu";
+	if (ci_format_is_efi_auth(buf, len))
+		return "efi-auth";
+	if (ci_format_is_efivar(buf, len))
+		return "efivar";
+	tmp = ci_format_tpm_eventlog(buf, len);
+	if (tmp != NULL)
+		return tmp;
+	if (ci_format_is_smbios(buf, len))
+		return "smbios";
+	return "data";
+}
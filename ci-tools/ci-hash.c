@@ -0,0 +1,258 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ci-hash.h"
+
+#define CI_HASH_BUFSZ			(128 * 1024)
+
+typedef struct {
+	CiHashJob	*job;
+	dev_t		 dev;
+	ino_t		 ino;
+	off_t		 size;
+	size_t		 same_as;		/* index of the job read instead */
+} CiHashItem;
+
+typedef struct {
+	CiHashItem	**queue;		/* distinct files, largest first */
+	size_t		 n_queue;
+	size_t		 next;
+	size_t		 range_size;
+	pthread_mutex_t	 lock;
+} CiHashPool;
+
+static void
+ci_hash_file(CiHashJob *job, uint8_t *buf, size_t range_size, off_t size)
+{
+	CiSha256 ctx;
+	CiSha256 range;
+	size_t range_used = 0;
+	size_t n_alloc = 0;
+	ssize_t n;
+	int fd;
+
+	fd = open(job->path, O_RDONLY);
+	if (fd < 0) {
+		job->error = errno;
+		return;
+	}
+	if (range_size > 0 && (uint64_t) size > range_size) {
+		n_alloc = (size + range_size - 1) / range_size;
+		job->ranges = malloc(n_alloc * CI_SHA256_LEN);
+		if (job->ranges == NULL) {
+			job->error = ENOMEM;
+			close(fd);
+			return;
+		}
+		ci_sha256_init(&range);
+	}
+	ci_sha256_init(&ctx);
+	while ((n = read(fd, buf, CI_HASH_BUFSZ)) > 0) {
+		ci_sha256_update(&ctx, buf, n);
+		for (ssize_t done = 0; job->ranges != NULL && done < n;) {
+			size_t take = range_size - range_used;
+			if (take > (size_t) (n - done))
+				take = n - done;
+			ci_sha256_update(&range, buf + done, take);
+			range_used += take;
+			done += take;
+			if (range_used == range_size && job->n_ranges < n_alloc) {
+				ci_sha256_final(&range, job->ranges + job->n_ranges++ * CI_SHA256_LEN);
+				ci_sha256_init(&range);
+				range_used = 0;
+			}
+		}
+	}
+	if (n < 0)
+		job->error = errno;
+	if (job->ranges != NULL && range_used > 0 && job->n_ranges < n_alloc)
+		ci_sha256_final(&range, job->ranges + job->n_ranges++ * CI_SHA256_LEN);
+	job->size = ctx.len;
+	ci_sha256_final(&ctx, job->digest);
+
+	/* the file changed while it was read */
+	if (job->ranges != NULL && job->error == 0 &&
+	    (job->n_ranges != n_alloc || job->size != (uint64_t) size))
+		job->error = EAGAIN;
+	close(fd);
+}
+
+static void *
+ci_hash_thread(void *user_data)
+{
+	CiHashPool *pool = user_data;
+	uint8_t *buf = malloc(CI_HASH_BUFSZ);
+
+	for (;;) {
+		CiHashItem *item;
+		pthread_mutex_lock(&pool->lock);
+		item = pool->next < pool->n_queue ? pool->queue[pool->next++] : NULL;
+		pthread_mutex_unlock(&pool->lock);
+		if (item == NULL)
+			break;
+		if (buf == NULL)
+			item->job->error = ENOMEM;
+		else
+			ci_hash_file(item->job, buf, pool->range_size, item->size);
+	}
+	free(buf);
+	return NULL;
+}
+
+static int
+ci_hash_item_cmp_inode(const void *a, const void *b)
+{
+	const CiHashItem *ia = a;
+	const CiHashItem *ib = b;
+	if (ia->dev != ib->dev)
+		return ia->dev < ib->dev ? -1 : 1;
+	if (ia->ino != ib->ino)
+		return ia->ino < ib->ino ? -1 : 1;
+	return 0;
+}
+
+static int
+ci_hash_item_cmp_size(const void *a, const void *b)
+{
+	const CiHashItem *ia = *(CiHashItem *const *) a;
+	const CiHashItem *ib = *(CiHashItem *const *) b;
+	if (ia->size != ib->size)
+		return ia->size > ib->size ? -1 : 1;
+	return 0;
+}
+
+unsigned
+ci_hash_default_threads(void)
+{
+	long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	return jobs > 0 ? jobs : 1;
+}
+
+/*
+ * Returns -1 only if the pass could not run; a file that cannot be read
+ * has its error set instead.
+ */
+int
+ci_hash_files(CiHashJob *jobs, size_t n_jobs, size_t range_size, unsigned n_threads)
+{
+	CiHashPool pool = { 0 };
+	CiHashItem *items;
+	pthread_t *threads = NULL;
+	unsigned n_started = 0;
+	int rc = -1;
+
+	items = calloc(n_jobs + 1, sizeof(CiHashItem));
+	pool.queue = calloc(n_jobs + 1, sizeof(CiHashItem *));
+	if (items == NULL || pool.queue == NULL)
+		goto out;
+	pool.range_size = range_size;
+	for (size_t i = 0; i < n_jobs; i++) {
+		struct stat st;
+		items[i].job = &jobs[i];
+		jobs[i].error = 0;
+		jobs[i].size = 0;
+		jobs[i].ranges = NULL;
+		jobs[i].n_ranges = 0;
+		if (stat(jobs[i].path, &st) < 0) {
+			jobs[i].error = errno;
+			continue;
+		}
+		items[i].dev = st.st_dev;
+		items[i].ino = st.st_ino;
+		items[i].size = st.st_size;
+	}
+
+	/* queue each inode once */
+	qsort(items, n_jobs, sizeof(CiHashItem), ci_hash_item_cmp_inode);
+	for (size_t i = 0; i < n_jobs; i++) {
+		items[i].same_as = i;
+		if (items[i].job->error != 0)
+			continue;
+		if (pool.n_queue > 0 &&
+		    ci_hash_item_cmp_inode(pool.queue[pool.n_queue - 1], &items[i]) == 0) {
+			items[i].same_as = pool.queue[pool.n_queue - 1] - items;
+			continue;
+		}
+		pool.queue[pool.n_queue++] = &items[i];
+	}
+	qsort(pool.queue, pool.n_queue, sizeof(CiHashItem *), ci_hash_item_cmp_size);
+
+	if (n_threads == 0)
+		n_threads = ci_hash_default_threads();
+	if (n_threads > pool.n_queue)
+		n_threads = pool.n_queue;
+	pthread_mutex_init(&pool.lock, NULL);
+	threads = calloc(n_threads + 1, sizeof(pthread_t));
+	if (threads != NULL) {
+		for (; n_started < n_threads; n_started++) {
+			if (pthread_create(&threads[n_started], NULL, ci_hash_thread, &pool) != 0)
+				break;
+		}
+	}
+	/* the caller helps, so this finishes even if no thread started */
+	ci_hash_thread(&pool);
+	for (unsigned i = 0; i < n_started; i++)
+		pthread_join(threads[i], NULL);
+	pthread_mutex_destroy(&pool.lock);
+
+	for (size_t i = 0; i < n_jobs; i++) {
+		const CiHashJob *src = items[items[i].same_as].job;
+		CiHashJob *dst = items[i].job;
+		if (src == dst || dst->error != 0)
+			continue;
+		dst->size = src->size;
+		dst->error = src->error;
+		memcpy(dst->digest, src->digest, CI_SHA256_LEN);
+		if (src->ranges != NULL) {
+			dst->ranges = malloc(src->n_ranges * CI_SHA256_LEN);
+			if (dst->ranges == NULL) {
+				dst->error = ENOMEM;
+				continue;
+			}
+			memcpy(dst->ranges, src->ranges, src->n_ranges * CI_SHA256_LEN);
+			dst->n_ranges = src->n_ranges;
+		}
+	}
+	rc = 0;
+out:
+	free(threads);
+	free(pool.queue);
+	free(items);
+	return rc;
+}
+
+void
+ci_hash_jobs_free_ranges(CiHashJob *jobs, size_t n_jobs)
+{
+	for (size_t i = 0; i < n_jobs; i++) {
+		free(jobs[i].ranges);
+		jobs[i].ranges = NULL;
+		jobs[i].n_ranges = 0;
+	}
+}
@@ -0,0 +1,57 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CI_HASH_H
+#define __CI_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ci-sha256.h"
+
+/*
+ * Hashes a list of files in one parallel pass. Paths that resolve to the
+ * same inode, such as the installed-tests symlinks into ci-tests or the
+ * blobs of a store, are only read once, and the largest files are started
+ * first so one big file does not run on alone at the end.
+ *
+ * With a range size, files larger than one range also get the digest of
+ * each range, so a reader can check just the part it uses.
+ */
+
+typedef struct {
+	const char	*path;
+	uint64_t	 size;			/* set by ci_hash_files() */
+	uint8_t		 digest[CI_SHA256_LEN];
+	uint8_t		*ranges;		/* n_ranges digests, or NULL */
+	size_t		 n_ranges;
+	int		 error;			/* errno, or 0 */
+} CiHashJob;
+
+unsigned	 ci_hash_default_threads	(void);
+int		 ci_hash_files			(CiHashJob	*jobs,
+						 size_t		 n_jobs,
+						 size_t		 range_size,
+						 unsigned	 n_threads);
+void		 ci_hash_jobs_free_ranges	(CiHashJob	*jobs,
+						 size_t		 n_jobs);
+
+#endif /* __CI_HASH_H */
@@ -0,0 +1,383 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ci-hash.h"
+#include "ci-manifest.h"
+
+/* symlinked directories are followed, so stop a loop going any deeper */
+#define CI_MANIFEST_MAX_DEPTH		32
+
+char *
+ci_manifest_path(const char *root, const char *path)
+{
+	size_t root_len = strlen(root);
+	char *tmp = malloc(root_len + strlen(path) + 2);
+
+	if (tmp == NULL)
+		return NULL;
+	strcpy(tmp, root);
+	if (root_len > 0 && root[root_len - 1] != '/')
+		strcat(tmp, "/");
+	strcat(tmp, path);
+	return tmp;
+}
+
+static CiManifestEntry *
+ci_manifest_add(CiManifest *m, char *path)
+{
+	CiManifestEntry *entry;
+
+	if (m->n_entries == m->n_alloc) {
+		size_t n_alloc = m->n_alloc > 0 ? m->n_alloc * 2 : 64;
+		CiManifestEntry *tmp = realloc(m->entries, n_alloc * sizeof(CiManifestEntry));
+		if (tmp == NULL)
+			return NULL;
+		m->entries = tmp;
+		m->n_alloc = n_alloc;
+	}
+	entry = &m->entries[m->n_entries++];
+	memset(entry, 0, sizeof(CiManifestEntry));
+	entry->path = path;
+	return entry;
+}
+
+static int
+ci_manifest_walk(CiManifest *m, const char *root, const char *rel, int depth)
+{
+	char *dirname = ci_manifest_path(root, rel);
+	struct dirent *d;
+	DIR *dir;
+	int rc = 0;
+
+	if (dirname == NULL)
+		return -1;
+	if (depth > CI_MANIFEST_MAX_DEPTH) {
+		fprintf(stderr, "%s: too deep, symlink loop?\n", dirname);
+		free(dirname);
+		return -1;
+	}
+	dir = opendir(dirname);
+	if (dir == NULL) {
+		fprintf(stderr, "%s: %s\n", dirname, strerror(errno));
+		free(dirname);
+		return -1;
+	}
+	while (rc == 0 && (d = readdir(dir)) != NULL) {
+		struct stat st;
+		char *path;
+		char *child;
+		if (strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0)
+			continue;
+		child = rel[0] == '\0' ? strdup(d->d_name) : ci_manifest_path(rel, d->d_name);
+		path = ci_manifest_path(dirname, d->d_name);
+		if (child == NULL || path == NULL) {
+			free(child);
+			free(path);
+			rc = -1;
+			break;
+		}
+		if (stat(path, &st) < 0) {
+			fprintf(stderr, "%s: %s\n", path, strerror(errno));
+			free(child);
+			rc = -1;
+		} else if (S_ISDIR(st.st_mode)) {
+			rc = ci_manifest_walk(m, root, child, depth + 1);
+			free(child);
+		} else if (S_ISREG(st.st_mode)) {
+			if (strchr(child, '\n') != NULL) {
+				fprintf(stderr, "%s: newline in filename\n", path);
+				free(child);
+				rc = -1;
+			} else if (ci_manifest_add(m, child) == NULL) {
+				free(child);
+				rc = -1;
+			}
+		} else {
+			free(child);
+		}
+		free(path);
+	}
+	closedir(dir);
+	free(dirname);
+	return rc;
+}
+
+static int
+ci_manifest_entry_cmp(const void *a, const void *b)
+{
+	const CiManifestEntry *ea = a;
+	const CiManifestEntry *eb = b;
+	return strcmp(ea->path, eb->path);
+}
+
+static int
+ci_manifest_detect(const char *filename, uint64_t size, char format[CI_FORMAT_MAX])
+{
+	void *map = NULL;
+	int fd = open(filename, O_RDONLY);
+
+	if (fd < 0) {
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+		return -1;
+	}
+	if (size > 0) {
+		map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+		if (map == MAP_FAILED) {
+			fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+			close(fd);
+			return -1;
+		}
+	}
+	snprintf(format, CI_FORMAT_MAX, "%s", ci_format_detect(map, size));
+	if (map != NULL)
+		munmap(map, size);
+	close(fd);
+	return 0;
+}
+
+/*
+ * Lists every file under root and hashes them all, with their ranges, in
+ * one parallel pass.
+ */
+int
+ci_manifest_scan(CiManifest *m, const char *root, unsigned n_threads)
+{
+	CiHashJob *jobs;
+	int rc = 0;
+
+	memset(m, 0, sizeof(CiManifest));
+	if (ci_manifest_walk(m, root, "", 0) < 0) {
+		ci_manifest_clear(m);
+		return -1;
+	}
+	qsort(m->entries, m->n_entries, sizeof(CiManifestEntry), ci_manifest_entry_cmp);
+
+	jobs = calloc(m->n_entries + 1, sizeof(CiHashJob));
+	if (jobs == NULL) {
+		ci_manifest_clear(m);
+		return -1;
+	}
+	for (size_t i = 0; i < m->n_entries; i++) {
+		jobs[i].path = ci_manifest_path(root, m->entries[i].path);
+		if (jobs[i].path == NULL)
+			rc = -1;
+	}
+	if (rc == 0)
+		rc = ci_hash_files(jobs, m->n_entries, CI_MANIFEST_RANGE_SIZE, n_threads);
+	for (size_t i = 0; rc == 0 && i < m->n_entries; i++) {
+		CiManifestEntry *entry = &m->entries[i];
+		if (jobs[i].error != 0) {
+			fprintf(stderr, "%s: %s\n", jobs[i].path, strerror(jobs[i].error));
+			rc = -1;
+			break;
+		}
+		entry->size = jobs[i].size;
+		memcpy(entry->digest, jobs[i].digest, CI_SHA256_LEN);
+		entry->ranges = jobs[i].ranges;
+		entry->n_ranges = jobs[i].n_ranges;
+		jobs[i].ranges = NULL;
+		rc = ci_manifest_detect(jobs[i].path, entry->size, entry->format);
+	}
+	ci_hash_jobs_free_ranges(jobs, m->n_entries);
+	for (size_t i = 0; i < m->n_entries; i++)
+		free((char *) jobs[i].path);
+	free(jobs);
+	if (rc < 0)
+		ci_manifest_clear(m);
+	return rc;
+}
+
+static int
+ci_manifest_add_range(CiManifestEntry *entry, const char *hex)
+{
+	size_t n_alloc = (entry->size + CI_MANIFEST_RANGE_SIZE - 1) / CI_MANIFEST_RANGE_SIZE;
+
+	if (entry->size <= CI_MANIFEST_RANGE_SIZE || entry->n_ranges >= n_alloc)
+		return -1;
+	if (entry->ranges == NULL) {
+		entry->ranges = malloc(n_alloc * CI_SHA256_LEN);
+		if (entry->ranges == NULL)
+			return -1;
+	}
+	if (ci_sha256_from_hex(hex, entry->ranges + entry->n_ranges * CI_SHA256_LEN) < 0)
+		return -1;
+	entry->n_ranges++;
+	return 0;
+}
+
+static int
+ci_manifest_entry_complete(const CiManifestEntry *entry)
+{
+	size_t n_ranges = (entry->size + CI_MANIFEST_RANGE_SIZE - 1) / CI_MANIFEST_RANGE_SIZE;
+	return entry->size <= CI_MANIFEST_RANGE_SIZE ? entry->n_ranges == 0 :
+						       entry->n_ranges == n_ranges;
+}
+
+int
+ci_manifest_load(CiManifest *m, const char *filename)
+{
+	FILE *f = fopen(filename, "r");
+	CiManifestEntry *entry = NULL;
+	char *line = NULL;
+	size_t line_alloc = 0;
+	ssize_t len;
+	unsigned lineno = 0;
+	int rc = 0;
+
+	memset(m, 0, sizeof(CiManifest));
+	if (f == NULL) {
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+		return -1;
+	}
+	while ((len = getline(&line, &line_alloc, f)) > 0) {
+		uint8_t digest[CI_SHA256_LEN];
+		uint64_t size;
+		char *end;
+		char *format;
+		char *path;
+
+		lineno++;
+		if (line[len - 1] == '\n')
+			line[--len] = '\0';
+		if (lineno == 1) {
+			if (strcmp(line, CI_MANIFEST_HEADER) != 0) {
+				fprintf(stderr, "%s: not a version 2 manifest\n", filename);
+				rc = -1;
+				break;
+			}
+			continue;
+		}
+		if (line[0] == '#' || line[0] == '\0')
+			continue;
+		if (line[0] == '+') {
+			if (entry == NULL || len != CI_SHA256_HEX_LEN + 1 ||
+			    ci_manifest_add_range(entry, line + 1) < 0)
+				goto invalid;
+			continue;
+		}
+		if (entry != NULL && !ci_manifest_entry_complete(entry))
+			goto invalid;
+		if (len < CI_SHA256_HEX_LEN + 6 ||
+		    line[CI_SHA256_HEX_LEN] != ' ' ||
+		    ci_sha256_from_hex(line, digest) < 0)
+			goto invalid;
+		errno = 0;
+		size = strtoull(line + CI_SHA256_HEX_LEN + 1, &end, 10);
+		if (errno != 0 || end == line + CI_SHA256_HEX_LEN + 1 || *end != ' ')
+			goto invalid;
+		format = end + 1;
+		end = strchr(format, ' ');
+		if (end == NULL || end == format || end - format >= CI_FORMAT_MAX || end[1] == '\0')
+			goto invalid;
+		path = strdup(end + 1);
+		if (path == NULL) {
+			rc = -1;
+			break;
+		}
+		entry = ci_manifest_add(m, path);
+		if (entry == NULL) {
+			free(path);
+			rc = -1;
+			break;
+		}
+		entry->size = size;
+		memcpy(entry->digest, digest, CI_SHA256_LEN);
+		memcpy(entry->format, format, end - format);
+		continue;
+invalid:
+		fprintf(stderr, "%s:%u: invalid manifest line\n", filename, lineno);
+		rc = -1;
+		break;
+	}
+	if (rc == 0 && lineno == 0) {
+		fprintf(stderr, "%s: not a manifest\n", filename);
+		rc = -1;
+	}
+	if (rc == 0 && entry != NULL && !ci_manifest_entry_complete(entry)) {
+		fprintf(stderr, "%s: %s: missing range digests\n", filename, entry->path);
+		rc = -1;
+	}
+	free(line);
+	fclose(f);
+	if (rc < 0) {
+		ci_manifest_clear(m);
+		return -1;
+	}
+	qsort(m->entries, m->n_entries, sizeof(CiManifestEntry), ci_manifest_entry_cmp);
+	return 0;
+}
+
+int
+ci_manifest_save(const CiManifest *m, const char *filename)
+{
+	FILE *f = fopen(filename, "w");
+
+	if (f == NULL) {
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+		return -1;
+	}
+	fprintf(f, "%s\n", CI_MANIFEST_HEADER);
+	for (size_t i = 0; i < m->n_entries; i++) {
+		const CiManifestEntry *entry = &m->entries[i];
+		char hex[CI_SHA256_HEX_LEN + 1];
+		ci_sha256_to_hex(entry->digest, hex);
+		fprintf(f, "%s %" PRIu64 " %s %s\n", hex, entry->size, entry->format, entry->path);
+		for (size_t j = 0; j < entry->n_ranges; j++) {
+			ci_sha256_to_hex(entry->ranges + j * CI_SHA256_LEN, hex);
+			fprintf(f, "+%s\n", hex);
+		}
+	}
+	if (fclose(f) != 0) {
+		fprintf(stderr, "%s: failed to write\n", filename);
+		return -1;
+	}
+	return 0;
+}
+
+void
+ci_manifest_clear(CiManifest *m)
+{
+	for (size_t i = 0; i < m->n_entries; i++) {
+		free(m->entries[i].path);
+		free(m->entries[i].ranges);
+	}
+	free(m->entries);
+	memset(m, 0, sizeof(CiManifest));
+}
+
+const CiManifestEntry *
+ci_manifest_lookup(const CiManifest *m, const char *path)
+{
+	CiManifestEntry key = { .path = (char *) path };
+	return bsearch(&key, m->entries, m->n_entries, sizeof(CiManifestEntry),
+		       ci_manifest_entry_cmp);
+}
@@ -0,0 +1,77 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CI_MANIFEST_H
+#define __CI_MANIFEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ci-format.h"
+#include "ci-sha256.h"
+
+/*
+ * A manifest lists every file of a tree with its size, SHA-256 and format
+ * tag from ci-format.h, one per line and sorted by path. Files larger than
+ * one range are followed by the SHA-256 of each range, so a reader can
+ * verify only the part it maps:
+ *
+ *   # ci-manifest 2
+ *   DIGEST SIZE FORMAT PATH
+ *   +RANGE_DIGEST
+ *
+ * Symlinks are followed, so a file reachable under two paths is listed
+ * under both. The blob store in ci-blobs.c keeps each digest once.
+ */
+
+#define CI_MANIFEST_HEADER		"# ci-manifest 2"
+#define CI_MANIFEST_RANGE_SIZE		(64 * 1024)
+
+typedef struct {
+	char		*path;			/* relative to the tree */
+	uint64_t	 size;
+	uint8_t		 digest[CI_SHA256_LEN];
+	char		 format[CI_FORMAT_MAX];
+	uint8_t		*ranges;		/* n_ranges digests, or NULL */
+	size_t		 n_ranges;
+} CiManifestEntry;
+
+typedef struct {
+	CiManifestEntry	*entries;
+	size_t		 n_entries;
+	size_t		 n_alloc;
+} CiManifest;
+
+int		 ci_manifest_scan	(CiManifest		*m,
+					 const char		*root,
+					 unsigned		 n_threads);
+int		 ci_manifest_load	(CiManifest		*m,
+					 const char		*filename);
+int		 ci_manifest_save	(const CiManifest	*m,
+					 const char		*filename);
+void		 ci_manifest_clear	(CiManifest		*m);
+const CiManifestEntry *ci_manifest_lookup(const CiManifest	*m,
+					 const char		*path);
+
+char		*ci_manifest_path	(const char		*root,
+					 const char		*path);
+
+#endif /* __CI_MANIFEST_H */
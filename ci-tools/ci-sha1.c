@@ -0,0 +1,133 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "ci-sha1.h"
+
+#define ROTL(x, n)		(((x) << (n)) | ((x) >> (32 - (n))))
+
+static void
+ci_sha1_block(uint32_t state[5], const uint8_t *p)
+{
+	uint32_t w[80];
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+	for (int i = 0; i < 16; i++)
+		w[i] = (uint32_t) p[i * 4] << 24 | (uint32_t) p[i * 4 + 1] << 16 |
+		       (uint32_t) p[i * 4 + 2] << 8 | p[i * 4 + 3];
+	for (int i = 16; i < 80; i++)
+		w[i] = ROTL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+	for (int i = 0; i < 80; i++) {
+		uint32_t f, k, t;
+		if (i < 20) {
+			f = (b & c) | (~b & d);
+			k = 0x5a827999;
+		} else if (i < 40) {
+			f = b ^ c ^ d;
+			k = 0x6ed9eba1;
+		} else if (i < 60) {
+			f = (b & c) | (b & d) | (c & d);
+			k = 0x8f1bbcdc;
+		} else {
+			f = b ^ c ^ d;
+			k = 0xca62c1d6;
+		}
+		t = ROTL(a, 5) + f + e + k + w[i];
+		e = d;
+		d = c;
+		c = ROTL(b, 30);
+		b = a;
+		a = t;
+	}
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+}
+
+void
+ci_sha1_init(CiSha1 *ctx)
+{
+	static const uint32_t iv[5] = {
+		0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0,
+	};
+	memcpy(ctx->state, iv, sizeof(iv));
+	ctx->len = 0;
+}
+
+void
+ci_sha1_update(CiSha1 *ctx, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	size_t used = ctx->len % 64;
+
+	/* data may be NULL when there is nothing to add */
+	if (len == 0)
+		return;
+	ctx->len += len;
+	if (used > 0) {
+		size_t n = 64 - used < len ? 64 - used : len;
+		memcpy(ctx->buf + used, p, n);
+		p += n;
+		len -= n;
+		if (used + n < 64)
+			return;
+		ci_sha1_block(ctx->state, ctx->buf);
+	}
+	for (; len >= 64; p += 64, len -= 64)
+		ci_sha1_block(ctx->state, p);
+	memcpy(ctx->buf, p, len);
+}
+
+void
+ci_sha1_final(CiSha1 *ctx, uint8_t digest[CI_SHA1_LEN])
+{
+	uint64_t bits = ctx->len * 8;
+	size_t used = ctx->len % 64;
+
+	ctx->buf[used++] = 0x80;
+	if (used > 56) {
+		memset(ctx->buf + used, 0, 64 - used);
+		ci_sha1_block(ctx->state, ctx->buf);
+		used = 0;
+	}
+	memset(ctx->buf + used, 0, 56 - used);
+	for (int i = 0; i < 8; i++)
+		ctx->buf[56 + i] = bits >> (56 - i * 8);
+	ci_sha1_block(ctx->state, ctx->buf);
+	for (int i = 0; i < 5; i++) {
+		digest[i * 4] = ctx->state[i] >> 24;
+		digest[i * 4 + 1] = ctx->state[i] >> 16;
+		digest[i * 4 + 2] = ctx->state[i] >> 8;
+		digest[i * 4 + 3] = ctx->state[i];
+	}
+}
+
+void
+ci_sha1(const void *data, size_t len, uint8_t digest[CI_SHA1_LEN])
+{
+	CiSha1 ctx;
+	ci_sha1_init(&ctx);
+	ci_sha1_update(&ctx, data, len);
+	ci_sha1_final(&ctx, digest);
+}
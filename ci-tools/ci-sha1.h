@@ -0,0 +1,48 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CI_SHA1_H
+#define __CI_SHA1_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* SHA-1 from FIPS 180-4, only for the SHA-1 banks of TPM event logs */
+
+#define CI_SHA1_LEN			20
+
+typedef struct {
+	uint32_t	 state[5];
+	uint64_t	 len;			/* bytes hashed so far */
+	uint8_t		 buf[64];
+} CiSha1;
+
+void		 ci_sha1_init		(CiSha1			*ctx);
+void		 ci_sha1_update		(CiSha1			*ctx,
+					 const void		*data,
+					 size_t			 len);
+void		 ci_sha1_final		(CiSha1			*ctx,
+					 uint8_t		 digest[CI_SHA1_LEN]);
+void		 ci_sha1		(const void		*data,
+					 size_t			 len,
+					 uint8_t		 digest[CI_SHA1_LEN]);
+
+#endif /* __CI_SHA1_H */
@@ -0,0 +1,54 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CI_SHA256_H
+#define __CI_SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* SHA-256 from FIPS 180-4, so the tools do not need a crypto library */
+
+#define CI_SHA256_LEN			32
+#define CI_SHA256_HEX_LEN		(CI_SHA256_LEN * 2)
+
+typedef struct {
+	uint32_t	 state[8];
+	uint64_t	 len;			/* bytes hashed so far */
+	uint8_t		 buf[64];
+} CiSha256;
+
+void		 ci_sha256_init		(CiSha256		*ctx);
+void		 ci_sha256_update	(CiSha256		*ctx,
+					 const void		*data,
+					 size_t			 len);
+void		 ci_sha256_final	(CiSha256		*ctx,
+					 uint8_t		 digest[CI_SHA256_LEN]);
+void		 ci_sha256		(const void		*data,
+					 size_t			 len,
+					 uint8_t		 digest[CI_SHA256_LEN]);
+
+void		 ci_sha256_to_hex	(const uint8_t		 digest[CI_SHA256_LEN],
+					 char			 hex[CI_SHA256_HEX_LEN + 1]);
+int		 ci_sha256_from_hex	(const char		*hex,
+					 uint8_t		 digest[CI_SHA256_LEN]);
+
+#endif /* __CI_SHA256_H */
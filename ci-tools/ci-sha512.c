@@ -0,0 +1,178 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "ci-sha512.h"
+
+static const uint64_t ci_sha512_k[80] = {
+	0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc,
+	0x3956c25bf348b538, 0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118,
+	0xd807aa98a3030242, 0x12835b0145706fbe, 0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2,
+	0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235, 0xc19bf174cf692694,
+	0xe49b69c19ef14ad2, 0xefbe4786384f25e3, 0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
+	0x2de92c6f592b0275, 0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5,
+	0x983e5152ee66dfab, 0xa831c66d2db43210, 0xb00327c898fb213f, 0xbf597fc7beef0ee4,
+	0xc6e00bf33da88fc2, 0xd5a79147930aa725, 0x06ca6351e003826f, 0x142929670a0e6e70,
+	0x27b70a8546d22ffc, 0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed, 0x53380d139d95b3df,
+	0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6, 0x92722c851482353b,
+	0xa2bfe8a14cf10364, 0xa81a664bbc423001, 0xc24b8b70d0f89791, 0xc76c51a30654be30,
+	0xd192e819d6ef5218, 0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8,
+	0x19a4c116b8d2d0c8, 0x1e376c085141ab53, 0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8,
+	0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb, 0x5b9cca4f7763e373, 0x682e6ff3d6b2b8a3,
+	0x748f82ee5defb2fc, 0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+	0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915, 0xc67178f2e372532b,
+	0xca273eceea26619c, 0xd186b8c721c0c207, 0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178,
+	0x06f067aa72176fba, 0x0a637dc5a2c898a6, 0x113f9804bef90dae, 0x1b710b35131c471b,
+	0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc, 0x431d67c49c100d4c,
+	0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817,
+};
+
+#define ROTR(x, n)		(((x) >> (n)) | ((x) << (64 - (n))))
+
+static void
+ci_sha512_block(uint64_t state[8], const uint8_t *p)
+{
+	uint64_t w[80];
+	uint64_t a = state[0], b = state[1], c = state[2], d = state[3];
+	uint64_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+	for (int i = 0; i < 16; i++) {
+		w[i] = 0;
+		for (int j = 0; j < 8; j++)
+			w[i] = w[i] << 8 | p[i * 8 + j];
+	}
+	for (int i = 16; i < 80; i++) {
+		uint64_t s0 = ROTR(w[i - 15], 1) ^ ROTR(w[i - 15], 8) ^ (w[i - 15] >> 7);
+		uint64_t s1 = ROTR(w[i - 2], 19) ^ ROTR(w[i - 2], 61) ^ (w[i - 2] >> 6);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+	for (int i = 0; i < 80; i++) {
+		uint64_t t1 = h + (ROTR(e, 14) ^ ROTR(e, 18) ^ ROTR(e, 41)) +
+			      ((e & f) ^ (~e & g)) + ci_sha512_k[i] + w[i];
+		uint64_t t2 = (ROTR(a, 28) ^ ROTR(a, 34) ^ ROTR(a, 39)) +
+			      ((a & b) ^ (a & c) ^ (b & c));
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
+
+void
+ci_sha384_init(CiSha512 *ctx)
+{
+	static const uint64_t iv[8] = {
+		0xcbbb9d5dc1059ed8, 0x629a292a367cd507, 0x9159015a3070dd17, 0x152fecd8f70e5939,
+		0x67332667ffc00b31, 0x8eb44a8768581511, 0xdb0c2e0d64f98fa7, 0x47b5481dbefa4fa4,
+	};
+	memcpy(ctx->state, iv, sizeof(iv));
+	ctx->len = 0;
+	ctx->digest_len = CI_SHA384_LEN;
+}
+
+void
+ci_sha512_init(CiSha512 *ctx)
+{
+	static const uint64_t iv[8] = {
+		0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+		0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179,
+	};
+	memcpy(ctx->state, iv, sizeof(iv));
+	ctx->len = 0;
+	ctx->digest_len = CI_SHA512_LEN;
+}
+
+void
+ci_sha512_update(CiSha512 *ctx, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	size_t used = ctx->len % 128;
+
+	/* data may be NULL when there is nothing to add */
+	if (len == 0)
+		return;
+	ctx->len += len;
+	if (used > 0) {
+		size_t n = 128 - used < len ? 128 - used : len;
+		memcpy(ctx->buf + used, p, n);
+		p += n;
+		len -= n;
+		if (used + n < 128)
+			return;
+		ci_sha512_block(ctx->state, ctx->buf);
+	}
+	for (; len >= 128; p += 128, len -= 128)
+		ci_sha512_block(ctx->state, p);
+	memcpy(ctx->buf, p, len);
+}
+
+/* writes digest_len bytes: 48 for SHA-384 and 64 for SHA-512 */
+void
+ci_sha512_final(CiSha512 *ctx, uint8_t *digest)
+{
+	uint64_t bits = ctx->len * 8;
+	size_t used = ctx->len % 128;
+
+	ctx->buf[used++] = 0x80;
+	if (used > 112) {
+		memset(ctx->buf + used, 0, 128 - used);
+		ci_sha512_block(ctx->state, ctx->buf);
+		used = 0;
+	}
+	/* the length is 128 bits, and the upper half is always zero here */
+	memset(ctx->buf + used, 0, 120 - used);
+	for (int i = 0; i < 8; i++)
+		ctx->buf[120 + i] = bits >> (56 - i * 8);
+	ci_sha512_block(ctx->state, ctx->buf);
+	for (size_t i = 0; i < ctx->digest_len; i++)
+		digest[i] = ctx->state[i / 8] >> (56 - (i % 8) * 8);
+}
+
+void
+ci_sha384(const void *data, size_t len, uint8_t digest[CI_SHA384_LEN])
+{
+	CiSha512 ctx;
+	ci_sha384_init(&ctx);
+	ci_sha512_update(&ctx, data, len);
+	ci_sha512_final(&ctx, digest);
+}
+
+void
+ci_sha512(const void *data, size_t len, uint8_t digest[CI_SHA512_LEN])
+{
+	CiSha512 ctx;
+	ci_sha512_init(&ctx);
+	ci_sha512_update(&ctx, data, len);
+	ci_sha512_final(&ctx, digest);
+}
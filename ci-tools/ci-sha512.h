@@ -0,0 +1,54 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CI_SHA512_H
+#define __CI_SHA512_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* SHA-512 and SHA-384 from FIPS 180-4, which only differ in IV and length */
+
+#define CI_SHA384_LEN			48
+#define CI_SHA512_LEN			64
+
+typedef struct {
+	uint64_t	 state[8];
+	uint64_t	 len;			/* bytes hashed so far */
+	uint8_t		 buf[128];
+	size_t		 digest_len;
+} CiSha512;
+
+void		 ci_sha384_init		(CiSha512		*ctx);
+void		 ci_sha512_init		(CiSha512		*ctx);
+void		 ci_sha512_update	(CiSha512		*ctx,
+					 const void		*data,
+					 size_t			 len);
+void		 ci_sha512_final	(CiSha512		*ctx,
+					 uint8_t		*digest);
+void		 ci_sha384		(const void		*data,
+					 size_t			 len,
+					 uint8_t		 digest[CI_SHA384_LEN]);
+void		 ci_sha512		(const void		*data,
+					 size_t			 len,
+					 uint8_t		 digest[CI_SHA512_LEN]);
+
+#endif /* __CI_SHA512_H */
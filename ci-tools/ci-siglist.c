@@ -0,0 +1,235 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ci-siglist.h"
+
+/* c1c41626-504c-4092-aca9-41f936934328 */
+const uint8_t ci_siglist_guid_sha256[CI_SIGLIST_GUID_LEN] = {
+	0x26, 0x16, 0xc4, 0xc1, 0x4c, 0x50, 0x92, 0x40,
+	0xac, 0xa9, 0x41, 0xf9, 0x36, 0x93, 0x43, 0x28
+};
+
+/* a5c059a1-94e4-4aa7-87b5-ab155c2bf072 */
+const uint8_t ci_siglist_guid_x509[CI_SIGLIST_GUID_LEN] = {
+	0xa1, 0x59, 0xc0, 0xa5, 0xe4, 0x94, 0xa7, 0x4a,
+	0x87, 0xb5, 0xab, 0x15, 0x5c, 0x2b, 0xf0, 0x72
+};
+
+/* 4aafd29d-68df-49ee-8aa9-347d375665a7 */
+const uint8_t ci_siglist_guid_pkcs7[CI_SIGLIST_GUID_LEN] = {
+	0x9d, 0xd2, 0xaf, 0x4a, 0xdf, 0x68, 0xee, 0x49,
+	0x8a, 0xa9, 0x34, 0x7d, 0x37, 0x56, 0x65, 0xa7
+};
+
+static uint32_t
+ci_siglist_u32(const uint8_t *buf)
+{
+	return buf[0] | buf[1] << 8 | buf[2] << 16 | (uint32_t) buf[3] << 24;
+}
+
+/* returns the number of signatures, or -1 if the lists are invalid */
+static long
+ci_siglist_walk(const uint8_t *buf, size_t len, CiSiglist *siglist)
+{
+	size_t pos = 0;
+	long n = 0;
+
+	while (pos < len) {
+		const uint8_t *list = buf + pos;
+		uint32_t list_size;
+		uint32_t header_size;
+		uint32_t sig_size;
+		uint32_t count;
+		if (len - pos < CI_SIGLIST_HEADER_LEN)
+			return -1;
+		list_size = ci_siglist_u32(list + 16);
+		header_size = ci_siglist_u32(list + 20);
+		sig_size = ci_siglist_u32(list + 24);
+		if (list_size < CI_SIGLIST_HEADER_LEN || list_size > len - pos ||
+		    header_size > list_size - CI_SIGLIST_HEADER_LEN ||
+		    sig_size <= CI_SIGLIST_GUID_LEN ||
+		    (list_size - CI_SIGLIST_HEADER_LEN - header_size) % sig_size != 0)
+			return -1;
+		count = (list_size - CI_SIGLIST_HEADER_LEN - header_size) / sig_size;
+		if (memcmp(list, ci_siglist_guid_sha256, CI_SIGLIST_GUID_LEN) == 0) {
+			if (sig_size != CI_SIGLIST_GUID_LEN + CI_SHA256_LEN)
+				return -1;
+			for (uint32_t i = 0; siglist != NULL && i < count; i++) {
+				siglist->sha256[siglist->n_sha256++] = list + CI_SIGLIST_HEADER_LEN +
+					header_size + i * sig_size + CI_SIGLIST_GUID_LEN;
+			}
+		} else if (siglist != NULL) {
+			if (memcmp(list, ci_siglist_guid_x509, CI_SIGLIST_GUID_LEN) == 0)
+				siglist->n_x509 += count;
+			else
+				siglist->n_other += count;
+		}
+		n += count;
+		pos += list_size;
+	}
+	return n;
+}
+
+/*
+ * Finds the signature lists in buf, which may be an authenticated update,
+ * an efivarfs dump or just the lists, and indexes the SHA-256 digests.
+ */
+int
+ci_siglist_parse(CiSiglist *siglist, const uint8_t *buf, size_t len)
+{
+	size_t offset = 0;
+	long n;
+
+	memset(siglist, 0, sizeof(CiSiglist));
+	siglist->kind = CI_SIGLIST_KIND_LISTS;
+
+	/* WIN_CERTIFICATE_UEFI_GUID with a PKCS#7 signature after the EFI_TIME */
+	if (len >= CI_SIGLIST_AUTH_HEADER_LEN && buf[20] == 0x00 && buf[21] == 0x02 &&
+	    buf[22] == 0xf1 && buf[23] == 0x0e &&
+	    memcmp(buf + 24, ci_siglist_guid_pkcs7, CI_SIGLIST_GUID_LEN) == 0) {
+		uint32_t cert_len = ci_siglist_u32(buf + 16);
+		if (cert_len < 24 || cert_len > len - 16)
+			return -1;
+		siglist->kind = CI_SIGLIST_KIND_AUTH;
+		offset = 16 + cert_len;
+	} else if (ci_siglist_walk(buf, len, NULL) < 0 && len >= 4) {
+		siglist->kind = CI_SIGLIST_KIND_EFIVAR;
+		offset = 4;
+	}
+	n = ci_siglist_walk(buf + offset, len - offset, NULL);
+	if (n < 0)
+		return -1;
+	siglist->sha256 = malloc((n + 1) * sizeof(const uint8_t *));
+	if (siglist->sha256 == NULL)
+		return -1;
+	siglist->lists = buf + offset;
+	siglist->lists_len = len - offset;
+	ci_siglist_walk(buf + offset, len - offset, siglist);
+	return 0;
+}
+
+void
+ci_siglist_clear(CiSiglist *siglist)
+{
+	free(siglist->sha256);
+	memset(siglist, 0, sizeof(CiSiglist));
+}
+
+/* a linear scan, as checking an update against the lists is done now */
+int
+ci_siglist_contains(const CiSiglist *siglist, const uint8_t digest[CI_SHA256_LEN])
+{
+	for (size_t i = 0; i < siglist->n_sha256; i++) {
+		if (memcmp(siglist->sha256[i], digest, CI_SHA256_LEN) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+static int
+ci_siglist_digest_cmp(const void *a, const void *b)
+{
+	return memcmp(a, b, CI_SHA256_LEN);
+}
+
+int
+ci_siglist_sorted_init(CiSiglistSorted *sorted, const CiSiglist *siglist)
+{
+	sorted->n_digests = siglist->n_sha256;
+	sorted->digests = malloc(siglist->n_sha256 * CI_SHA256_LEN + 1);
+	if (sorted->digests == NULL)
+		return -1;
+	for (size_t i = 0; i < siglist->n_sha256; i++)
+		memcpy(sorted->digests + i * CI_SHA256_LEN, siglist->sha256[i], CI_SHA256_LEN);
+	qsort(sorted->digests, sorted->n_digests, CI_SHA256_LEN, ci_siglist_digest_cmp);
+	return 0;
+}
+
+void
+ci_siglist_sorted_clear(CiSiglistSorted *sorted)
+{
+	free(sorted->digests);
+	memset(sorted, 0, sizeof(CiSiglistSorted));
+}
+
+int
+ci_siglist_sorted_contains(const CiSiglistSorted *sorted, const uint8_t digest[CI_SHA256_LEN])
+{
+	return bsearch(digest, sorted->digests, sorted->n_digests, CI_SHA256_LEN,
+		       ci_siglist_digest_cmp) != NULL;
+}
+
+/* digests are uniformly distributed already, so their start is the key */
+static size_t
+ci_siglist_table_key(const uint8_t *digest)
+{
+	size_t key = 0;
+	memcpy(&key, digest, sizeof(key));
+	return key;
+}
+
+int
+ci_siglist_table_init(CiSiglistTable *table, const CiSiglist *siglist)
+{
+	size_t n_slots = 16;
+
+	while (n_slots < siglist->n_sha256 * 2)
+		n_slots *= 2;
+	table->mask = n_slots - 1;
+	table->slots = calloc(n_slots, sizeof(const uint8_t *));
+	if (table->slots == NULL)
+		return -1;
+	for (size_t i = 0; i < siglist->n_sha256; i++) {
+		const uint8_t *digest = siglist->sha256[i];
+		size_t slot = ci_siglist_table_key(digest) & table->mask;
+		while (table->slots[slot] != NULL) {
+			if (memcmp(table->slots[slot], digest, CI_SHA256_LEN) == 0)
+				break;
+			slot = (slot + 1) & table->mask;
+		}
+		table->slots[slot] = digest;
+	}
+	return 0;
+}
+
+void
+ci_siglist_table_clear(CiSiglistTable *table)
+{
+	free(table->slots);
+	memset(table, 0, sizeof(CiSiglistTable));
+}
+
+int
+ci_siglist_table_contains(const CiSiglistTable *table, const uint8_t digest[CI_SHA256_LEN])
+{
+	size_t slot = ci_siglist_table_key(digest) & table->mask;
+
+	while (table->slots[slot] != NULL) {
+		if (memcmp(table->slots[slot], digest, CI_SHA256_LEN) == 0)
+			return 1;
+		slot = (slot + 1) & table->mask;
+	}
+	return 0;
+}
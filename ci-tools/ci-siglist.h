@@ -0,0 +1,97 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CI_SIGLIST_H
+#define __CI_SIGLIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ci-sha256.h"
+
+/*
+ * EFI_SIGNATURE_LIST payloads, as in the db, dbx and KEK variables:
+ *
+ *   SignatureType GUID, uint32 ListSize, uint32 HeaderSize,
+ *   uint32 SignatureSize, header[HeaderSize],
+ *   { SignatureOwner GUID, data }[...]
+ *
+ * They are found on their own, after the four attribute bytes of an
+ * efivarfs dump, or after the EFI_VARIABLE_AUTHENTICATION_2 header of an
+ * authenticated update.
+ */
+
+#define CI_SIGLIST_GUID_LEN		16
+#define CI_SIGLIST_HEADER_LEN		28
+#define CI_SIGLIST_AUTH_HEADER_LEN	40	/* EFI_TIME and WIN_CERTIFICATE_UEFI_GUID */
+
+extern const uint8_t ci_siglist_guid_sha256[CI_SIGLIST_GUID_LEN];
+extern const uint8_t ci_siglist_guid_x509[CI_SIGLIST_GUID_LEN];
+extern const uint8_t ci_siglist_guid_pkcs7[CI_SIGLIST_GUID_LEN];
+
+typedef enum {
+	CI_SIGLIST_KIND_LISTS,
+	CI_SIGLIST_KIND_EFIVAR,
+	CI_SIGLIST_KIND_AUTH,
+} CiSiglistKind;
+
+typedef struct {
+	CiSiglistKind	 kind;
+	const uint8_t	*lists;			/* the first EFI_SIGNATURE_LIST */
+	size_t		 lists_len;
+	const uint8_t	**sha256;		/* the EFI_CERT_SHA256 digests */
+	size_t		 n_sha256;
+	size_t		 n_x509;
+	size_t		 n_other;
+} CiSiglist;
+
+/* the digests of a list, sorted for binary search */
+typedef struct {
+	uint8_t		*digests;
+	size_t		 n_digests;
+} CiSiglistSorted;
+
+/* the digests of a list, in an open addressing hash table */
+typedef struct {
+	const uint8_t	**slots;
+	size_t		 mask;
+} CiSiglistTable;
+
+int		 ci_siglist_parse		(CiSiglist		*siglist,
+						 const uint8_t		*buf,
+						 size_t			 len);
+void		 ci_siglist_clear		(CiSiglist		*siglist);
+int		 ci_siglist_contains		(const CiSiglist	*siglist,
+						 const uint8_t		 digest[CI_SHA256_LEN]);
+
+int		 ci_siglist_sorted_init		(CiSiglistSorted	*sorted,
+						 const CiSiglist	*siglist);
+void		 ci_siglist_sorted_clear	(CiSiglistSorted	*sorted);
+int		 ci_siglist_sorted_contains	(const CiSiglistSorted	*sorted,
+						 const uint8_t		 digest[CI_SHA256_LEN]);
+
+int		 ci_siglist_table_init		(CiSiglistTable		*table,
+						 const CiSiglist	*siglist);
+void		 ci_siglist_table_clear		(CiSiglistTable		*table);
+int		 ci_siglist_table_contains	(const CiSiglistTable	*table,
+						 const uint8_t		 digest[CI_SHA256_LEN]);
+
+#endif /* __CI_SIGLIST_H */
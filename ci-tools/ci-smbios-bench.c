@@ -0,0 +1,322 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Times loading SMBIOS tables the way fwupd does at startup: reading the
+ * entry point and the DMI file, checking the entry point, splitting every
+ * structure into its strings and looking up the string fields of the
+ * common types.
+ *
+ * The cold pass drops the files from the page cache and evicts the CPU
+ * caches before every load, the warm pass loads the same files again and
+ * again. String lookups are also timed on their own, walking the string
+ * set of the structure on every lookup and using the index built by
+ * ci_smbios_parse().
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ci-manifest.h"
+#include "ci-smbios.h"
+
+#define SMBIOS_COLD_ITERATIONS_DEFAULT	20
+#define SMBIOS_WARM_ITERATIONS_DEFAULT	1000
+#define SMBIOS_EVICT_SIZE		(64 * 1024 * 1024)
+#define SMBIOS_FIELDS_MAX		8
+
+/* the string fields of the structures fwupd and dmidecode read most */
+static const struct {
+	uint8_t		 type;
+	uint8_t		 offsets[SMBIOS_FIELDS_MAX];	/* ends at 0 */
+} smbios_string_fields[] = {
+	{ 0,	{ 0x04, 0x05, 0x08 } },
+	{ 1,	{ 0x04, 0x05, 0x06, 0x07, 0x19, 0x1a } },
+	{ 2,	{ 0x04, 0x05, 0x06, 0x07, 0x08, 0x0a } },
+	{ 3,	{ 0x04, 0x06, 0x07, 0x08 } },
+	{ 4,	{ 0x04, 0x07, 0x10, 0x20, 0x21, 0x22 } },
+	{ 7,	{ 0x04 } },
+	{ 8,	{ 0x04, 0x06 } },
+	{ 9,	{ 0x04 } },
+	{ 17,	{ 0x10, 0x11, 0x17, 0x18, 0x19, 0x1a } },
+};
+
+/* keeps the lookups from being optimized away */
+static volatile unsigned smbios_sink;
+
+typedef struct {
+	char		*table;			/* DMI */
+	char		*entry_point;		/* or NULL */
+} SmbiosFiles;
+
+static double
+smbios_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint8_t *
+smbios_read_file(const char *filename, size_t *len, int drop_cache)
+{
+	struct stat st;
+	uint8_t *buf = NULL;
+	size_t done = 0;
+	int fd = open(filename, O_RDONLY);
+
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "failed to open %s: %s\n", filename, strerror(errno));
+		goto out;
+	}
+	if (drop_cache)
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	buf = malloc(st.st_size + 1);
+	if (buf == NULL)
+		goto out;
+	while (done < (size_t) st.st_size) {
+		ssize_t n = read(fd, buf + done, st.st_size - done);
+		if (n <= 0) {
+			fprintf(stderr, "failed to read %s\n", filename);
+			free(buf);
+			buf = NULL;
+			goto out;
+		}
+		done += n;
+	}
+	*len = done;
+out:
+	if (fd >= 0)
+		close(fd);
+	return buf;
+}
+
+static const uint8_t *
+smbios_fields(uint8_t type)
+{
+	for (size_t i = 0; i < sizeof(smbios_string_fields) / sizeof(smbios_string_fields[0]); i++) {
+		if (smbios_string_fields[i].type == type)
+			return smbios_string_fields[i].offsets;
+	}
+	return NULL;
+}
+
+/* looks up every known string field, returns the number of lookups */
+static unsigned long
+smbios_lookup_all(const CiSmbios *smbios, int use_index)
+{
+	unsigned long n = 0;
+
+	for (size_t i = 0; i < smbios->n_structures; i++) {
+		const CiSmbiosStructure *st = &smbios->structures[i];
+		const uint8_t *offsets = smbios_fields(st->type);
+		for (unsigned j = 0; offsets != NULL && j < SMBIOS_FIELDS_MAX && offsets[j] != 0; j++) {
+			const char *str = use_index ?
+				ci_smbios_get_string(smbios, st, offsets[j]) :
+				ci_smbios_structure_string(st, offsets[j]);
+			if (str != NULL)
+				smbios_sink += str[0];
+			n++;
+		}
+	}
+	return n;
+}
+
+/* one load, as a process starting up would do it; out keeps the result */
+static int
+smbios_load(const SmbiosFiles *files, int cold, CiSmbios *out, uint8_t **out_buf, size_t *out_len)
+{
+	CiSmbiosEntryPoint ep;
+	CiSmbios smbios;
+	uint8_t *ep_buf = NULL;
+	uint8_t *buf;
+	size_t ep_len = 0;
+	size_t len = 0;
+	int rc = -1;
+
+	if (files->entry_point != NULL) {
+		ep_buf = smbios_read_file(files->entry_point, &ep_len, cold);
+		if (ep_buf == NULL || ci_smbios_entry_point_parse(ep_buf, ep_len, &ep) < 0) {
+			fprintf(stderr, "%s is not a valid entry point\n", files->entry_point);
+			goto out;
+		}
+	}
+	buf = smbios_read_file(files->table, &len, cold);
+	if (buf == NULL)
+		goto out;
+	if (files->entry_point != NULL && len > ep.table_size) {
+		fprintf(stderr, "%s is larger than its entry point allows\n", files->table);
+		free(buf);
+		goto out;
+	}
+	if (ci_smbios_parse(&smbios, buf, len) < 0) {
+		fprintf(stderr, "%s is not a valid SMBIOS table\n", files->table);
+		free(buf);
+		goto out;
+	}
+	smbios_lookup_all(&smbios, 1);
+	if (out != NULL) {
+		*out = smbios;
+		*out_buf = buf;
+		*out_len = len;
+		rc = 0;
+		goto out;
+	}
+	ci_smbios_clear(&smbios);
+	free(buf);
+	rc = 0;
+out:
+	free(ep_buf);
+	return rc;
+}
+
+static void
+smbios_evict(uint8_t *scratch)
+{
+	for (size_t i = 0; i < SMBIOS_EVICT_SIZE; i += 64)
+		scratch[i]++;
+}
+
+static int
+smbios_bench(const SmbiosFiles *files, unsigned cold_iterations,
+	     unsigned warm_iterations, uint8_t *scratch)
+{
+	CiSmbios smbios;
+	uint8_t *buf = NULL;
+	unsigned long n_lookups = 0;
+	double cold = 0;
+	double warm;
+	double scan;
+	double indexed;
+	double start;
+	size_t len;
+
+	if (smbios_load(files, 0, &smbios, &buf, &len) < 0)
+		return -1;
+	for (unsigned it = 0; it < cold_iterations; it++) {
+		smbios_evict(scratch);
+		start = smbios_now();
+		if (smbios_load(files, 1, NULL, NULL, NULL) < 0)
+			goto fail;
+		cold += smbios_now() - start;
+	}
+	cold /= cold_iterations;
+	start = smbios_now();
+	for (unsigned it = 0; it < warm_iterations; it++) {
+		if (smbios_load(files, 0, NULL, NULL, NULL) < 0)
+			goto fail;
+	}
+	warm = (smbios_now() - start) / warm_iterations;
+	start = smbios_now();
+	for (unsigned it = 0; it < warm_iterations; it++)
+		n_lookups = smbios_lookup_all(&smbios, 0);
+	scan = (smbios_now() - start) / warm_iterations;
+	start = smbios_now();
+	for (unsigned it = 0; it < warm_iterations; it++)
+		n_lookups = smbios_lookup_all(&smbios, 1);
+	indexed = (smbios_now() - start) / warm_iterations;
+
+	printf("%s: %zu bytes, %zu structures, %zu strings\n",
+	       files->table, len, smbios.n_structures, smbios.n_strings);
+	printf("  load   cold %9.1f us %8.1f MB/s   warm %9.1f us %8.1f MB/s %10.0f structures/s\n",
+	       cold * 1e6, len / cold / 1e6, warm * 1e6, len / warm / 1e6,
+	       smbios.n_structures / warm);
+	printf("  lookup scan %9.1f ns        index %9.1f ns   (%lu fields)\n",
+	       scan * 1e9 / n_lookups, indexed * 1e9 / n_lookups, n_lookups);
+	ci_smbios_clear(&smbios);
+	free(buf);
+	return 0;
+fail:
+	ci_smbios_clear(&smbios);
+	free(buf);
+	return -1;
+}
+
+static void
+smbios_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [OPTION...] DIR|TABLE...\n"
+		"  -c, --cold=N             cold loads per table, default %u\n"
+		"  -n, --iterations=N       warm loads per table, default %u\n"
+		"A DIR holds DMI and smbios_entry_point, as in /sys/firmware/dmi/tables.\n",
+		argv0, SMBIOS_COLD_ITERATIONS_DEFAULT, SMBIOS_WARM_ITERATIONS_DEFAULT);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct option options[] = {
+		{ "cold",		required_argument, NULL, 'c' },
+		{ "iterations",		required_argument, NULL, 'n' },
+		{ NULL, 0, NULL, 0 }
+	};
+	unsigned cold_iterations = SMBIOS_COLD_ITERATIONS_DEFAULT;
+	unsigned warm_iterations = SMBIOS_WARM_ITERATIONS_DEFAULT;
+	uint8_t *scratch;
+	int rc = EXIT_SUCCESS;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "c:n:", options, NULL)) != -1) {
+		switch (opt) {
+		case 'c':
+			cold_iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			warm_iterations = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			smbios_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (argc - optind < 1 || cold_iterations == 0 || warm_iterations == 0) {
+		smbios_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	scratch = calloc(1, SMBIOS_EVICT_SIZE);
+	if (scratch == NULL)
+		return EXIT_FAILURE;
+	for (int i = optind; i < argc; i++) {
+		SmbiosFiles files = { NULL, NULL };
+		struct stat st;
+		if (stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode)) {
+			files.table = ci_manifest_path(argv[i], "DMI");
+			files.entry_point = ci_manifest_path(argv[i], "smbios_entry_point");
+		} else {
+			files.table = strdup(argv[i]);
+		}
+		if (files.table == NULL ||
+		    smbios_bench(&files, cold_iterations, warm_iterations, scratch) < 0)
+			rc = EXIT_FAILURE;
+		free(files.table);
+		free(files.entry_point);
+	}
+	free(scratch);
+	return rc;
+}
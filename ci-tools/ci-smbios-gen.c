@@ -0,0 +1,669 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Builds the SMBIOS 3.x tables of a multi-socket server from those of a
+ * client machine, as /sys/firmware/dmi/tables would export them: a DMI file
+ * and a 24 byte _SM3_ smbios_entry_point.
+ *
+ * Every structure of the seed is kept, except that the processors and
+ * their caches, system slots, memory arrays, memory devices and memory
+ * array mapped addresses are replaced with one set per socket, made from
+ * the first seed structure of each type. Handles, locators and serial
+ * numbers are unique, and handles and sizes are kept consistent between
+ * the structures that refer to each other.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ci-manifest.h"
+#include "ci-smbios.h"
+
+#define GEN_SOCKETS_DEFAULT		2
+#define GEN_DIMMS_DEFAULT		32
+#define GEN_SLOTS_DEFAULT		16
+#define GEN_CACHES_MAX			8
+#define GEN_STRINGS_MAX			32
+#define GEN_STRING_LEN			256
+#define GEN_HANDLE_FIRST		0x1000
+#define GEN_HANDLE_LAST			0xfefe
+
+typedef enum {
+	GEN_TYPE_PROCESSOR		= 4,
+	GEN_TYPE_CACHE			= 7,
+	GEN_TYPE_SLOT			= 9,
+	GEN_TYPE_MEMORY_ARRAY		= 16,
+	GEN_TYPE_MEMORY_DEVICE		= 17,
+	GEN_TYPE_MEMORY_MAPPED		= 19,
+} GenType;
+
+/* a structure being rewritten */
+typedef struct {
+	uint8_t		 data[256];
+	uint8_t		 length;
+	char		 strings[GEN_STRINGS_MAX][GEN_STRING_LEN];
+	unsigned	 n_strings;
+} GenStruct;
+
+typedef struct {
+	uint8_t		*buf;
+	size_t		 len;
+	size_t		 size;
+	unsigned	 n_structures;
+	uint8_t		 used[0x10000 / 8];	/* handles */
+	uint16_t	 next_handle;
+	unsigned	 sockets;
+	unsigned	 dimms;
+	unsigned	 slots;
+	CiSmbiosStructure caches[GEN_CACHES_MAX];
+	unsigned	 n_caches;
+	uint16_t	 cache_handles[GEN_CACHES_MAX * 256];
+	uint16_t	 array_handles[256];
+	uint64_t	 dimm_kib;
+} GenTable;
+
+static uint8_t *
+gen_read_file(const char *filename, size_t *len)
+{
+	struct stat st;
+	uint8_t *buf = NULL;
+	size_t done = 0;
+	int fd = open(filename, O_RDONLY);
+
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "failed to open %s: %s\n", filename, strerror(errno));
+		goto out;
+	}
+	buf = malloc(st.st_size + 1);
+	if (buf == NULL)
+		goto out;
+	while (done < (size_t) st.st_size) {
+		ssize_t n = read(fd, buf + done, st.st_size - done);
+		if (n <= 0) {
+			fprintf(stderr, "failed to read %s\n", filename);
+			free(buf);
+			buf = NULL;
+			goto out;
+		}
+		done += n;
+	}
+	*len = done;
+out:
+	if (fd >= 0)
+		close(fd);
+	return buf;
+}
+
+static int
+gen_write_file(const char *filename, const uint8_t *buf, size_t len)
+{
+	FILE *f = fopen(filename, "wb");
+
+	if (f == NULL) {
+		fprintf(stderr, "failed to open %s: %s\n", filename, strerror(errno));
+		return -1;
+	}
+	if (fwrite(buf, 1, len, f) != len) {
+		fprintf(stderr, "failed to write %s\n", filename);
+		fclose(f);
+		return -1;
+	}
+	if (fclose(f) != 0) {
+		fprintf(stderr, "failed to write %s\n", filename);
+		return -1;
+	}
+	return 0;
+}
+
+static uint16_t
+gen_get_u16(const uint8_t *buf)
+{
+	return buf[0] | buf[1] << 8;
+}
+
+static void
+gen_put_u16(uint8_t *buf, uint16_t val)
+{
+	buf[0] = val;
+	buf[1] = val >> 8;
+}
+
+static void
+gen_put_u32(uint8_t *buf, uint32_t val)
+{
+	for (unsigned i = 0; i < 4; i++)
+		buf[i] = val >> (i * 8);
+}
+
+static void
+gen_put_u64(uint8_t *buf, uint64_t val)
+{
+	for (unsigned i = 0; i < 8; i++)
+		buf[i] = val >> (i * 8);
+}
+
+static int
+gen_handle_used(const GenTable *t, uint16_t handle)
+{
+	return t->used[handle / 8] & (1 << (handle % 8));
+}
+
+static void
+gen_handle_set_used(GenTable *t, uint16_t handle)
+{
+	t->used[handle / 8] |= 1 << (handle % 8);
+}
+
+static int
+gen_handle_new(GenTable *t, uint16_t *handle)
+{
+	while (t->next_handle <= GEN_HANDLE_LAST) {
+		uint16_t h = t->next_handle++;
+		if (!gen_handle_used(t, h)) {
+			gen_handle_set_used(t, h);
+			*handle = h;
+			return 0;
+		}
+	}
+	fprintf(stderr, "out of structure handles\n");
+	return -1;
+}
+
+static int
+gen_append(GenTable *t, const void *buf, size_t len)
+{
+	if (t->len + len > t->size) {
+		size_t size = t->size > 0 ? t->size * 2 : 64 * 1024;
+		uint8_t *tmp;
+		while (size < t->len + len)
+			size *= 2;
+		tmp = realloc(t->buf, size);
+		if (tmp == NULL)
+			return -1;
+		t->buf = tmp;
+		t->size = size;
+	}
+	memcpy(t->buf + t->len, buf, len);
+	t->len += len;
+	return 0;
+}
+
+static int
+gen_copy(GenTable *t, const CiSmbiosStructure *st)
+{
+	t->n_structures++;
+	return gen_append(t, st->data, st->length + st->strings_len + 1);
+}
+
+static int
+gen_struct_init(GenStruct *gs, const CiSmbiosStructure *st)
+{
+	const char *str = st->strings;
+	const char *end = st->strings + st->strings_len;
+
+	memcpy(gs->data, st->data, st->length);
+	gs->length = st->length;
+	gs->n_strings = 0;
+	while (st->strings_len > 1 && str < end) {
+		size_t n = strlen(str);
+		if (gs->n_strings == GEN_STRINGS_MAX || n >= GEN_STRING_LEN) {
+			fprintf(stderr, "type %u structure has too many strings\n", st->type);
+			return -1;
+		}
+		memcpy(gs->strings[gs->n_strings++], str, n + 1);
+		str += n + 1;
+	}
+	return 0;
+}
+
+/* sets the string a field refers to, adding one if it had none */
+static void
+gen_struct_set_string(GenStruct *gs, uint8_t offset, const char *fmt, ...)
+	__attribute__((format(printf, 3, 4)));
+
+static void
+gen_struct_set_string(GenStruct *gs, uint8_t offset, const char *fmt, ...)
+{
+	va_list args;
+	unsigned idx;
+
+	if (offset >= gs->length)
+		return;
+	idx = gs->data[offset];
+	if (idx == 0 || idx > gs->n_strings) {
+		if (gs->n_strings == GEN_STRINGS_MAX)
+			return;
+		idx = ++gs->n_strings;
+		gs->data[offset] = idx;
+	}
+	va_start(args, fmt);
+	vsnprintf(gs->strings[idx - 1], GEN_STRING_LEN, fmt, args);
+	va_end(args);
+}
+
+static int
+gen_struct_emit(GenTable *t, GenStruct *gs, uint16_t handle)
+{
+	static const uint8_t nul = 0;
+
+	gen_put_u16(gs->data + 2, handle);
+	if (gen_append(t, gs->data, gs->length) < 0)
+		return -1;
+	for (unsigned i = 0; i < gs->n_strings; i++) {
+		if (gen_append(t, gs->strings[i], strlen(gs->strings[i]) + 1) < 0)
+			return -1;
+	}
+	if (gs->n_strings == 0 && gen_append(t, &nul, 1) < 0)
+		return -1;
+	t->n_structures++;
+	return gen_append(t, &nul, 1);
+}
+
+static int
+gen_processors(GenTable *t, const CiSmbiosStructure *st)
+{
+	GenStruct gs;
+
+	for (unsigned s = 0; s < t->sockets; s++) {
+		uint16_t handle;
+		if (gen_struct_init(&gs, st) < 0 || gen_handle_new(t, &handle) < 0)
+			return -1;
+		gen_struct_set_string(&gs, 0x04, "CPU%u", s);
+		if (gs.length >= 0x23) {
+			gen_struct_set_string(&gs, 0x20, "CI%04X%08X", s, handle);
+			gen_struct_set_string(&gs, 0x21, "CPU%u Asset", s);
+		}
+		/* the L1, L2 and L3 cache handles */
+		for (unsigned f = 0x1a; f + 2 <= 0x20 && f + 2 <= gs.length; f += 2) {
+			for (unsigned c = 0; c < t->n_caches; c++) {
+				if (gen_get_u16(gs.data + f) == t->caches[c].handle)
+					gen_put_u16(gs.data + f, t->cache_handles[s * GEN_CACHES_MAX + c]);
+			}
+		}
+		if (gen_struct_emit(t, &gs, handle) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+static int
+gen_caches(GenTable *t)
+{
+	GenStruct gs;
+
+	for (unsigned s = 0; s < t->sockets; s++) {
+		for (unsigned c = 0; c < t->n_caches; c++) {
+			if (gen_struct_init(&gs, &t->caches[c]) < 0)
+				return -1;
+			if (gs.data[0x04] != 0 && gs.data[0x04] <= gs.n_strings) {
+				char name[GEN_STRING_LEN];
+				snprintf(name, sizeof(name), "%s", gs.strings[gs.data[0x04] - 1]);
+				gen_struct_set_string(&gs, 0x04, "CPU%u %.200s", s, name);
+			}
+			if (gen_struct_emit(t, &gs, t->cache_handles[s * GEN_CACHES_MAX + c]) < 0)
+				return -1;
+		}
+	}
+	return 0;
+}
+
+static int
+gen_slots(GenTable *t, const CiSmbiosStructure *st)
+{
+	GenStruct gs;
+
+	for (unsigned s = 0; s < t->sockets; s++) {
+		for (unsigned i = 0; i < t->slots; i++) {
+			uint16_t handle;
+			unsigned id = s * t->slots + i;
+			if (gen_struct_init(&gs, st) < 0 || gen_handle_new(t, &handle) < 0)
+				return -1;
+			gen_struct_set_string(&gs, 0x04, "CPU%u SLOT%u", s, i);
+			if (gs.length >= 0x0b)
+				gen_put_u16(gs.data + 0x09, id);
+			/* segment group, bus and device/function */
+			if (gs.length >= 0x11) {
+				gen_put_u16(gs.data + 0x0d, s);
+				gs.data[0x0f] = 0x10 + i;
+				gs.data[0x10] = 0;
+			}
+			if (gen_struct_emit(t, &gs, handle) < 0)
+				return -1;
+		}
+	}
+	return 0;
+}
+
+static int
+gen_memory_arrays(GenTable *t, const CiSmbiosStructure *st)
+{
+	GenStruct gs;
+	uint64_t kib = t->dimm_kib * t->dimms;
+
+	for (unsigned s = 0; s < t->sockets; s++) {
+		if (gen_struct_init(&gs, st) < 0)
+			return -1;
+		if (gs.length >= 0x0f) {
+			if (kib < 0x80000000) {
+				gen_put_u32(gs.data + 0x07, kib);
+			} else if (gs.length >= 0x17) {
+				gen_put_u32(gs.data + 0x07, 0x80000000);
+				gen_put_u64(gs.data + 0x0f, kib * 1024);
+			}
+			gen_put_u16(gs.data + 0x0d, t->dimms);
+		}
+		if (gen_struct_emit(t, &gs, t->array_handles[s]) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+static int
+gen_memory_devices(GenTable *t, const CiSmbiosStructure *st)
+{
+	GenStruct gs;
+
+	for (unsigned s = 0; s < t->sockets; s++) {
+		for (unsigned i = 0; i < t->dimms; i++) {
+			uint16_t handle;
+			if (gen_struct_init(&gs, st) < 0 || gen_handle_new(t, &handle) < 0)
+				return -1;
+			if (gs.length >= 0x06)
+				gen_put_u16(gs.data + 0x04, t->array_handles[s]);
+			/* channels of two DIMMs named A to Z, like server boards */
+			gen_struct_set_string(&gs, 0x10, "CPU%u_DIMM_%c%u", s,
+					      'A' + (i / 2) % 26, i % 2 + 1 + i / 52 * 2);
+			gen_struct_set_string(&gs, 0x11, "NODE %u", s);
+			if (gs.length >= 0x1b) {
+				gen_struct_set_string(&gs, 0x18, "%08X", s << 16 | handle);
+				gen_struct_set_string(&gs, 0x19, "CPU%u_DIMM%u_AssetTag", s, i);
+			}
+			if (gen_struct_emit(t, &gs, handle) < 0)
+				return -1;
+		}
+	}
+	return 0;
+}
+
+static int
+gen_memory_mapped(GenTable *t, const CiSmbiosStructure *st)
+{
+	GenStruct gs;
+	uint64_t kib = t->dimm_kib * t->dimms;
+
+	for (unsigned s = 0; s < t->sockets; s++) {
+		uint64_t start = kib * s;
+		uint64_t end = kib * (s + 1) - 1;
+		uint16_t handle;
+		if (gen_struct_init(&gs, st) < 0 || gen_handle_new(t, &handle) < 0)
+			return -1;
+		if (gs.length >= 0x0f) {
+			if (end < 0xffffffff) {
+				gen_put_u32(gs.data + 0x04, start);
+				gen_put_u32(gs.data + 0x08, end);
+			} else if (gs.length >= 0x1f) {
+				gen_put_u32(gs.data + 0x04, 0xffffffff);
+				gen_put_u32(gs.data + 0x08, 0xffffffff);
+				gen_put_u64(gs.data + 0x0f, start * 1024);
+				gen_put_u64(gs.data + 0x17, (end + 1) * 1024 - 1);
+			}
+			gen_put_u16(gs.data + 0x0c, t->array_handles[s]);
+		}
+		if (gen_struct_emit(t, &gs, handle) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+/* the seed DIMM size, from the size or extended size field */
+static uint64_t
+gen_dimm_kib(const CiSmbiosStructure *st)
+{
+	uint16_t size;
+
+	if (st->length < 0x0e)
+		return 0;
+	size = gen_get_u16(st->data + 0x0c);
+	if (size == 0x7fff && st->length >= 0x20)
+		return (uint64_t) (st->data[0x1c] | st->data[0x1d] << 8 |
+				   st->data[0x1e] << 16 | (st->data[0x1f] & 0x7f) << 24) * 1024;
+	if (size == 0xffff)
+		return 0;
+	return size & 0x8000 ? size & 0x7fff : (uint64_t) size * 1024;
+}
+
+static int
+gen_is_replaced(uint8_t type)
+{
+	switch (type) {
+	case GEN_TYPE_PROCESSOR:
+	case GEN_TYPE_CACHE:
+	case GEN_TYPE_SLOT:
+	case GEN_TYPE_MEMORY_ARRAY:
+	case GEN_TYPE_MEMORY_DEVICE:
+	case GEN_TYPE_MEMORY_MAPPED:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static int
+gen_run(GenTable *t, const uint8_t *seed, size_t seed_len)
+{
+	CiSmbiosReader reader;
+	CiSmbiosStructure st;
+	uint8_t emitted[256] = { 0 };
+	int have_end = 0;
+	int rc;
+
+	/* the handles other structures refer to are allocated first */
+	ci_smbios_reader_init(&reader, seed, seed_len);
+	while ((rc = ci_smbios_reader_next(&reader, &st)) > 0) {
+		gen_handle_set_used(t, st.handle);
+		if (st.type == GEN_TYPE_CACHE && t->n_caches < GEN_CACHES_MAX)
+			t->caches[t->n_caches++] = st;
+		if (st.type == GEN_TYPE_MEMORY_DEVICE && t->dimm_kib == 0)
+			t->dimm_kib = gen_dimm_kib(&st);
+	}
+	if (rc < 0) {
+		fprintf(stderr, "seed is not a valid SMBIOS table\n");
+		return -1;
+	}
+	if (t->dimm_kib == 0)
+		t->dimm_kib = 16 * 1024 * 1024;
+	t->next_handle = GEN_HANDLE_FIRST;
+	for (unsigned s = 0; s < t->sockets; s++) {
+		if (gen_handle_new(t, &t->array_handles[s]) < 0)
+			return -1;
+		for (unsigned c = 0; c < t->n_caches; c++) {
+			if (gen_handle_new(t, &t->cache_handles[s * GEN_CACHES_MAX + c]) < 0)
+				return -1;
+		}
+	}
+
+	ci_smbios_reader_init(&reader, seed, seed_len);
+	while ((rc = ci_smbios_reader_next(&reader, &st)) > 0) {
+		if (!gen_is_replaced(st.type)) {
+			have_end |= st.type == CI_SMBIOS_TYPE_END;
+			if (gen_copy(t, &st) < 0)
+				return -1;
+			continue;
+		}
+		if (emitted[st.type])
+			continue;
+		emitted[st.type] = 1;
+		switch (st.type) {
+		case GEN_TYPE_PROCESSOR:
+			rc = gen_processors(t, &st);
+			break;
+		case GEN_TYPE_CACHE:
+			rc = gen_caches(t);
+			break;
+		case GEN_TYPE_SLOT:
+			rc = gen_slots(t, &st);
+			break;
+		case GEN_TYPE_MEMORY_ARRAY:
+			rc = gen_memory_arrays(t, &st);
+			break;
+		case GEN_TYPE_MEMORY_DEVICE:
+			rc = gen_memory_devices(t, &st);
+			break;
+		default:
+			rc = gen_memory_mapped(t, &st);
+			break;
+		}
+		if (rc < 0)
+			return -1;
+	}
+	if (!have_end) {
+		static const uint8_t end[] = { CI_SMBIOS_TYPE_END, 4, 0xff, 0xfe, 0, 0 };
+		t->n_structures++;
+		return gen_append(t, end, sizeof(end));
+	}
+	return 0;
+}
+
+/* a 3.x entry point keeping the version and address of a 3.x seed */
+static void
+gen_entry_point(const GenTable *t, const uint8_t *seed, size_t seed_len, uint8_t ep[24])
+{
+	CiSmbiosEntryPoint seed_ep;
+	uint8_t sum = 0;
+
+	memset(ep, 0, 24);
+	memcpy(ep, "_SM3_", 5);
+	ep[6] = 24;
+	ep[7] = 3;
+	ep[9] = 0;
+	ep[10] = 1;
+	if (seed != NULL && ci_smbios_entry_point_parse(seed, seed_len, &seed_ep) == 0) {
+		if (seed_ep.major >= 3) {
+			ep[7] = seed_ep.major;
+			ep[8] = seed_ep.minor;
+		}
+		gen_put_u64(ep + 16, seed_ep.table_addr);
+	}
+	gen_put_u32(ep + 12, t->len);
+	for (unsigned i = 0; i < 24; i++)
+		sum += ep[i];
+	ep[5] = -sum;
+}
+
+static void
+gen_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [OPTION...] SEED_DIR OUTPUT_DIR\n"
+		"  -s, --sockets=N          processor sockets, default %u\n"
+		"  -d, --dimms=N            memory devices per socket, default %u\n"
+		"  -p, --slots=N            system slots per socket, default %u\n",
+		argv0, GEN_SOCKETS_DEFAULT, GEN_DIMMS_DEFAULT, GEN_SLOTS_DEFAULT);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct option options[] = {
+		{ "sockets",		required_argument, NULL, 's' },
+		{ "dimms",		required_argument, NULL, 'd' },
+		{ "slots",		required_argument, NULL, 'p' },
+		{ NULL, 0, NULL, 0 }
+	};
+	GenTable *t = calloc(1, sizeof(GenTable));
+	uint8_t *seed = NULL;
+	uint8_t *seed_ep = NULL;
+	uint8_t ep[24];
+	size_t seed_len = 0;
+	size_t seed_ep_len = 0;
+	char *filename = NULL;
+	int rc = EXIT_FAILURE;
+	int opt;
+
+	if (t == NULL)
+		return EXIT_FAILURE;
+	t->sockets = GEN_SOCKETS_DEFAULT;
+	t->dimms = GEN_DIMMS_DEFAULT;
+	t->slots = GEN_SLOTS_DEFAULT;
+	while ((opt = getopt_long(argc, argv, "s:d:p:", options, NULL)) != -1) {
+		switch (opt) {
+		case 's':
+			t->sockets = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			t->dimms = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			t->slots = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			gen_usage(argv[0]);
+			goto out;
+		}
+	}
+	if (argc - optind != 2 || t->sockets == 0 || t->sockets > 255 ||
+	    t->dimms > 255 || t->slots > 0xffff / t->sockets) {
+		gen_usage(argv[0]);
+		goto out;
+	}
+	filename = ci_manifest_path(argv[optind], "DMI");
+	seed = filename != NULL ? gen_read_file(filename, &seed_len) : NULL;
+	if (seed == NULL)
+		goto out;
+	free(filename);
+	filename = ci_manifest_path(argv[optind], "smbios_entry_point");
+	if (filename == NULL)
+		goto out;
+	seed_ep = gen_read_file(filename, &seed_ep_len);
+	if (gen_run(t, seed, seed_len) < 0)
+		goto out;
+	gen_entry_point(t, seed_ep, seed_ep_len, ep);
+	if (mkdir(argv[optind + 1], 0755) < 0 && errno != EEXIST) {
+		fprintf(stderr, "failed to create %s: %s\n", argv[optind + 1], strerror(errno));
+		goto out;
+	}
+	free(filename);
+	filename = ci_manifest_path(argv[optind + 1], "DMI");
+	if (filename == NULL || gen_write_file(filename, t->buf, t->len) < 0)
+		goto out;
+	free(filename);
+	filename = ci_manifest_path(argv[optind + 1], "smbios_entry_point");
+	if (filename == NULL || gen_write_file(filename, ep, sizeof(ep)) < 0)
+		goto out;
+	printf("%s: %zu bytes, %u structures\n", argv[optind + 1], t->len, t->n_structures);
+	rc = EXIT_SUCCESS;
+out:
+	free(filename);
+	free(seed_ep);
+	free(seed);
+	if (t != NULL)
+		free(t->buf);
+	free(t);
+	return rc;
+}
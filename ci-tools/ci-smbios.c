@@ -0,0 +1,218 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ci-smbios.h"
+
+static uint8_t
+ci_smbios_checksum(const uint8_t *buf, size_t len)
+{
+	uint8_t sum = 0;
+	for (size_t i = 0; i < len; i++)
+		sum += buf[i];
+	return sum;
+}
+
+static uint32_t
+ci_smbios_u32(const uint8_t *buf)
+{
+	return buf[0] | buf[1] << 8 | buf[2] << 16 | (uint32_t) buf[3] << 24;
+}
+
+/* checks the anchors and checksums of an _SM_ or _SM3_ entry point */
+int
+ci_smbios_entry_point_parse(const uint8_t *buf, size_t len, CiSmbiosEntryPoint *ep)
+{
+	memset(ep, 0, sizeof(CiSmbiosEntryPoint));
+	if (len >= 24 && memcmp(buf, "_SM3_", 5) == 0) {
+		if (buf[6] < 24 || buf[6] > len || ci_smbios_checksum(buf, buf[6]) != 0)
+			return -1;
+		ep->major = buf[7];
+		ep->minor = buf[8];
+		ep->is_64 = 1;
+		ep->table_size = ci_smbios_u32(buf + 12);
+		ep->table_addr = ci_smbios_u32(buf + 16) |
+				 (uint64_t) ci_smbios_u32(buf + 20) << 32;
+		return 0;
+	}
+	if (len >= 31 && memcmp(buf, "_SM_", 4) == 0) {
+		if (buf[5] < 31 || buf[5] > len || ci_smbios_checksum(buf, buf[5]) != 0)
+			return -1;
+		if (memcmp(buf + 16, "_DMI_", 5) != 0 ||
+		    ci_smbios_checksum(buf + 16, 15) != 0)
+			return -1;
+		ep->major = buf[6];
+		ep->minor = buf[7];
+		ep->table_size = buf[22] | buf[23] << 8;
+		ep->table_addr = ci_smbios_u32(buf + 24);
+		return 0;
+	}
+	return -1;
+}
+
+void
+ci_smbios_reader_init(CiSmbiosReader *reader, const uint8_t *buf, size_t len)
+{
+	memset(reader, 0, sizeof(CiSmbiosReader));
+	reader->buf = buf;
+	reader->len = len;
+}
+
+/*
+ * Returns 1 for a structure, 0 after the end-of-table structure or at the
+ * end of the buffer, and -1 if a structure is truncated.
+ */
+int
+ci_smbios_reader_next(CiSmbiosReader *reader, CiSmbiosStructure *st)
+{
+	const uint8_t *buf = reader->buf;
+	size_t pos = reader->pos;
+	size_t end = reader->len;
+	const uint8_t *nul;
+
+	if (reader->done || end - pos < CI_SMBIOS_HEADER_LEN)
+		return reader->done || pos == end ? 0 : -1;
+	st->type = buf[pos];
+	st->length = buf[pos + 1];
+	st->handle = buf[pos + 2] | buf[pos + 3] << 8;
+	if (st->length < CI_SMBIOS_HEADER_LEN || st->length > end - pos)
+		return -1;
+	st->data = buf + pos;
+	pos += st->length;
+
+	/* the string set is at least two NULs */
+	st->strings = (const char *) buf + pos;
+	for (;;) {
+		if (end - pos < 2)
+			return -1;
+		nul = memchr(buf + pos + 1, '\0', end - pos - 1);
+		if (nul == NULL)
+			return -1;
+		pos = nul - buf;
+		if (buf[pos - 1] == '\0')
+			break;
+	}
+	st->strings_len = (const char *) buf + pos - st->strings;
+	reader->pos = pos + 1;
+	if (st->type == CI_SMBIOS_TYPE_END)
+		reader->done = 1;
+	return 1;
+}
+
+/* walks the string set, as a consumer without an index does */
+const char *
+ci_smbios_structure_string(const CiSmbiosStructure *st, uint8_t offset)
+{
+	const char *str = st->strings;
+	const char *end = st->strings + st->strings_len;
+	uint8_t idx;
+
+	if (offset >= st->length)
+		return NULL;
+	idx = st->data[offset];
+	if (idx == 0 || st->strings_len <= 1)
+		return NULL;
+	for (uint8_t i = 1; i < idx; i++) {
+		str += strlen(str) + 1;
+		if (str >= end)
+			return NULL;
+	}
+	return str;
+}
+
+/* indexes every structure and string, so lookups do not walk the table */
+int
+ci_smbios_parse(CiSmbios *smbios, const uint8_t *buf, size_t len)
+{
+	CiSmbiosReader reader;
+	CiSmbiosStructure st;
+	size_t structures_max = len / CI_SMBIOS_HEADER_LEN + 1;
+	size_t strings_max = len / 2 + 1;
+	int rc;
+
+	memset(smbios, 0, sizeof(CiSmbios));
+	smbios->structures = malloc(structures_max * sizeof(CiSmbiosStructure));
+	smbios->first_string = malloc((structures_max + 1) * sizeof(uint32_t));
+	smbios->strings = malloc(strings_max * sizeof(const char *));
+	if (smbios->structures == NULL || smbios->first_string == NULL ||
+	    smbios->strings == NULL) {
+		ci_smbios_clear(smbios);
+		return -1;
+	}
+	ci_smbios_reader_init(&reader, buf, len);
+	while ((rc = ci_smbios_reader_next(&reader, &st)) > 0) {
+		const char *str = st.strings;
+		const char *end = st.strings + st.strings_len;
+		smbios->first_string[smbios->n_structures] = smbios->n_strings;
+		smbios->structures[smbios->n_structures++] = st;
+		if (st.strings_len <= 1)
+			continue;
+		while (str < end) {
+			size_t n = strlen(str);
+			smbios->strings[smbios->n_strings++] = str;
+			str += n + 1;
+		}
+	}
+	smbios->first_string[smbios->n_structures] = smbios->n_strings;
+	if (rc < 0) {
+		ci_smbios_clear(smbios);
+		return -1;
+	}
+	return 0;
+}
+
+void
+ci_smbios_clear(CiSmbios *smbios)
+{
+	free(smbios->structures);
+	free(smbios->first_string);
+	free(smbios->strings);
+	memset(smbios, 0, sizeof(CiSmbios));
+}
+
+/* the first structure of a type, as fwupd looks up type 0 or 1 */
+const CiSmbiosStructure *
+ci_smbios_find(const CiSmbios *smbios, uint8_t type)
+{
+	for (size_t i = 0; i < smbios->n_structures; i++) {
+		if (smbios->structures[i].type == type)
+			return &smbios->structures[i];
+	}
+	return NULL;
+}
+
+/* st must be one of the structures of smbios */
+const char *
+ci_smbios_get_string(const CiSmbios *smbios, const CiSmbiosStructure *st, uint8_t offset)
+{
+	size_t i = st - smbios->structures;
+	uint32_t first = smbios->first_string[i];
+	uint8_t idx;
+
+	if (offset >= st->length)
+		return NULL;
+	idx = st->data[offset];
+	if (idx == 0 || idx > smbios->first_string[i + 1] - first)
+		return NULL;
+	return smbios->strings[first + idx - 1];
+}
@@ -0,0 +1,96 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CI_SMBIOS_H
+#define __CI_SMBIOS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * SMBIOS tables as exported in /sys/firmware/dmi/tables: the DMI file holds
+ * the structures, smbios_entry_point the 31 byte _SM_ or the 24 byte _SM3_
+ * anchor that describes them.
+ *
+ * Each structure is a formatted area starting with type, length and handle,
+ * followed by a set of NUL terminated strings ending with an extra NUL.
+ * Fields in the formatted area refer to strings by their index, from 1.
+ */
+
+#define CI_SMBIOS_HEADER_LEN		4
+#define CI_SMBIOS_TYPE_END		127
+
+typedef struct {
+	uint8_t		 major;
+	uint8_t		 minor;
+	int		 is_64;			/* _SM3_ */
+	uint32_t	 table_size;		/* maximum for _SM3_ */
+	uint64_t	 table_addr;
+} CiSmbiosEntryPoint;
+
+typedef struct {
+	uint8_t		 type;
+	uint8_t		 length;
+	uint16_t	 handle;
+	const uint8_t	*data;			/* the formatted area */
+	const char	*strings;		/* the string set */
+	uint32_t	 strings_len;		/* without the final NUL */
+} CiSmbiosStructure;
+
+typedef struct {
+	const uint8_t	*buf;
+	size_t		 len;
+	size_t		 pos;
+	int		 done;
+} CiSmbiosReader;
+
+/* every structure of a table, and the start of each of their strings */
+typedef struct {
+	CiSmbiosStructure *structures;
+	size_t		 n_structures;
+	uint32_t	*first_string;		/* by structure, into strings */
+	const char	**strings;
+	size_t		 n_strings;
+} CiSmbios;
+
+int		 ci_smbios_entry_point_parse	(const uint8_t		*buf,
+						 size_t			 len,
+						 CiSmbiosEntryPoint	*ep);
+
+void		 ci_smbios_reader_init		(CiSmbiosReader		*reader,
+						 const uint8_t		*buf,
+						 size_t			 len);
+int		 ci_smbios_reader_next		(CiSmbiosReader		*reader,
+						 CiSmbiosStructure	*st);
+const char	*ci_smbios_structure_string	(const CiSmbiosStructure *st,
+						 uint8_t		 offset);
+
+int		 ci_smbios_parse		(CiSmbios		*smbios,
+						 const uint8_t		*buf,
+						 size_t			 len);
+void		 ci_smbios_clear		(CiSmbios		*smbios);
+const CiSmbiosStructure *ci_smbios_find	(const CiSmbios		*smbios,
+						 uint8_t		 type);
+const char	*ci_smbios_get_string		(const CiSmbios		*smbios,
+						 const CiSmbiosStructure *st,
+						 uint8_t		 offset);
+
+#endif /* __CI_SMBIOS_H */
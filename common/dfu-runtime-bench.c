@@ -0,0 +1,122 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Host driver for the shared DFU runtime core.
+ *
+ * With no arguments this runs a seeded pseudo-random request mix and prints
+ * the cost per request. With a filename it treats the file as a sequence of
+ * 3 byte records (bRequest, wLength LE) so it can be used directly as an
+ * AFL-style file fuzzer; the state machine invariants are checked after
+ * every request and abort() is called if one fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "dfu-runtime.h"
+
+#define BENCH_ITERATIONS_DEFAULT	10000000
+
+static uint32_t
+bench_xorshift32(uint32_t *seed)
+{
+	uint32_t x = *seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*seed = x;
+	return x;
+}
+
+static void
+bench_check_invariants(uint8_t request, uint16_t length, int8_t rc)
+{
+	if (dfu_runtime_get_state() >= DFU_RUNTIME_STATE_LAST)
+		abort();
+	if (rc > DFU_RUNTIME_BUFFER_SIZE || (rc > 0 && (uint16_t) rc > length))
+		abort();
+	if (request == DFU_RUNTIME_REQUEST_DETACH && !dfu_runtime_detach_pending())
+		abort();
+}
+
+static int
+bench_fuzz_file(const char *filename)
+{
+	FILE *f;
+	uint8_t buf[DFU_RUNTIME_BUFFER_SIZE];
+	uint8_t rec[3];
+
+	f = fopen(filename, "rb");
+	if (f == NULL) {
+		perror(filename);
+		return EXIT_FAILURE;
+	}
+	dfu_runtime_init();
+	while (fread(rec, 1, sizeof(rec), f) == sizeof(rec)) {
+		uint16_t length = rec[1] | ((uint16_t) rec[2] << 8);
+		int8_t rc = dfu_runtime_process_request(rec[0], length, buf);
+		bench_check_invariants(rec[0], length, rc);
+
+		/* the target reboots here, so start afresh */
+		if (dfu_runtime_detach_pending())
+			dfu_runtime_init();
+	}
+	fclose(f);
+	return EXIT_SUCCESS;
+}
+
+int
+main(int argc, char *argv[])
+{
+	uint8_t buf[DFU_RUNTIME_BUFFER_SIZE];
+	uint32_t seed = 0x5eed;
+	unsigned long iterations = BENCH_ITERATIONS_DEFAULT;
+	unsigned long stalls = 0;
+	unsigned long i;
+	struct timespec ts1, ts2;
+	double elapsed;
+
+	if (argc > 1)
+		return bench_fuzz_file(argv[1]);
+	if (getenv("BENCH_ITERATIONS") != NULL)
+		iterations = strtoul(getenv("BENCH_ITERATIONS"), NULL, 10);
+
+	dfu_runtime_init();
+	clock_gettime(CLOCK_MONOTONIC, &ts1);
+	for (i = 0; i < iterations; i++) {
+		uint32_t r = bench_xorshift32(&seed);
+		uint8_t request = r % (DFU_RUNTIME_REQUEST_ABORT + 1);
+		int8_t rc = dfu_runtime_process_request(request, (r >> 8) & 0xff, buf);
+		if (rc < 0)
+			stalls++;
+		if (dfu_runtime_detach_pending())
+			dfu_runtime_init();
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts2);
+
+	elapsed = (ts2.tv_sec - ts1.tv_sec) * 1e9 + (ts2.tv_nsec - ts1.tv_nsec);
+	printf("requests:   %lu\n", iterations);
+	printf("stalled:    %lu\n", stalls);
+	printf("ns/request: %.2f\n", elapsed / iterations);
+	return EXIT_SUCCESS;
+}
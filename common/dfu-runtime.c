@@ -0,0 +1,114 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dfu-runtime.h"
+
+#ifdef DFU_RUNTIME_SUCCESS_FUNC
+void DFU_RUNTIME_SUCCESS_FUNC(void *context);
+#endif
+
+static uint8_t		 _state = DFU_RUNTIME_STATE_APP_IDLE;
+static uint8_t		 _status = DFU_RUNTIME_STATUS_OK;
+#ifdef DFU_RUNTIME_SUCCESS_FUNC
+static uint8_t		 _success_done = 0;
+#endif
+
+void
+dfu_runtime_init(void)
+{
+	_state = DFU_RUNTIME_STATE_APP_IDLE;
+	_status = DFU_RUNTIME_STATUS_OK;
+}
+
+/**
+ * dfu_runtime_process_request:
+ * @request: the DFU bRequest value
+ * @length: the wLength from the SETUP packet
+ * @buf: a buffer of at least DFU_RUNTIME_BUFFER_SIZE bytes
+ *
+ * Processes a DFU class request addressed to the runtime interface.
+ *
+ * Returns: the number of bytes in @buf to send in the data stage, 0 for no
+ * data stage, or -1 if the request should be stalled
+ **/
+int8_t
+dfu_runtime_process_request(uint8_t request, uint16_t length, uint8_t *buf)
+{
+	int8_t len;
+
+	switch (request) {
+	case DFU_RUNTIME_REQUEST_GETSTATUS:
+#ifdef DFU_RUNTIME_SUCCESS_FUNC
+		if (!_success_done && _state == DFU_RUNTIME_STATE_APP_IDLE) {
+			DFU_RUNTIME_SUCCESS_FUNC(NULL);
+			_success_done = 1;
+		}
+#endif
+		buf[0] = _status;
+		buf[1] = 0x00;		/* 24-bit poll timeout */
+		buf[2] = 0x00;
+		buf[3] = 0x00;
+		buf[4] = _state;
+		buf[5] = 0x00;		/* iString */
+		len = 6;
+		break;
+	case DFU_RUNTIME_REQUEST_GETSTATE:
+		buf[0] = _state;
+		len = 1;
+		break;
+	case DFU_RUNTIME_REQUEST_CLRSTATUS:
+		_status = DFU_RUNTIME_STATUS_OK;
+		return 0;
+	case DFU_RUNTIME_REQUEST_DETACH:
+		_state = DFU_RUNTIME_STATE_APP_DETACH;
+		return 0;
+	case DFU_RUNTIME_REQUEST_ABORT:
+		_state = DFU_RUNTIME_STATE_APP_IDLE;
+		return 0;
+	default:
+		/* DNLOAD and UPLOAD are only valid in DFU mode */
+		_status = DFU_RUNTIME_STATUS_ERR_STALLEDPKT;
+		return -1;
+	}
+
+	/* never send more than the host asked for */
+	if (length < (uint16_t) len)
+		len = (int8_t) length;
+	return len;
+}
+
+uint8_t
+dfu_runtime_get_state(void)
+{
+	return _state;
+}
+
+uint8_t
+dfu_runtime_get_status(void)
+{
+	return _status;
+}
+
+uint8_t
+dfu_runtime_detach_pending(void)
+{
+	return _state == DFU_RUNTIME_STATE_APP_DETACH;
+}
@@ -0,0 +1,75 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __DFU_RUNTIME_H
+#define __DFU_RUNTIME_H
+
+#include <stdint.h>
+
+/*
+ * Portable DFU 1.1 runtime (appIDLE/appDETACH) state machine shared by the
+ * AVR and PIC18 test devices and the host build in this directory.
+ *
+ * The core knows nothing about the USB stack: each target decodes the SETUP
+ * packet, calls dfu_runtime_process_request() and then performs the data
+ * and status stages itself. Once dfu_runtime_detach_pending() returns
+ * non-zero the target should finish the status stage and reboot into its
+ * bootloader.
+ *
+ * If DFU_RUNTIME_SUCCESS_FUNC is defined it is called the first time the host
+ * reads the status in appIDLE, which shows the runtime enumerated and works.
+ */
+
+/* the largest response, DFU_GETSTATUS */
+#define DFU_RUNTIME_BUFFER_SIZE		6
+
+typedef enum {
+	DFU_RUNTIME_REQUEST_DETACH	= 0x00,
+	DFU_RUNTIME_REQUEST_DNLOAD	= 0x01,
+	DFU_RUNTIME_REQUEST_UPLOAD	= 0x02,
+	DFU_RUNTIME_REQUEST_GETSTATUS	= 0x03,
+	DFU_RUNTIME_REQUEST_CLRSTATUS	= 0x04,
+	DFU_RUNTIME_REQUEST_GETSTATE	= 0x05,
+	DFU_RUNTIME_REQUEST_ABORT	= 0x06
+} DfuRuntimeRequest;
+
+typedef enum {
+	DFU_RUNTIME_STATE_APP_IDLE	= 0,
+	DFU_RUNTIME_STATE_APP_DETACH	= 1,
+	DFU_RUNTIME_STATE_LAST
+} DfuRuntimeState;
+
+typedef enum {
+	DFU_RUNTIME_STATUS_OK		= 0x00,
+	DFU_RUNTIME_STATUS_ERR_STALLEDPKT = 0x0f
+} DfuRuntimeStatus;
+
+void		 dfu_runtime_init		(void);
+
+int8_t		 dfu_runtime_process_request	(uint8_t	 request,
+						 uint16_t	 length,
+						 uint8_t	*buf);
+
+uint8_t		 dfu_runtime_get_state		(void);
+uint8_t		 dfu_runtime_get_status		(void);
+uint8_t		 dfu_runtime_detach_pending	(void);
+
+#endif /* __DFU_RUNTIME_H */
@@ -0,0 +1,74 @@
+#!/bin/sh
+#
+# Copyright (C) 2026 The fwupd-test-firmware authors
+#
+# Licensed under the GNU General Public License Version 2
+#
+# Creates a reproducible cabinet archive: the files are added in sorted order
+# with their timestamps pinned to SOURCE_DATE_EPOCH, so the same inputs always
+# give a byte-identical cab. Results are cached by a hash of the input names and
+# contents and the gcab version, and on a cache hit gcab is not run at all.
+#
+# Usage: build-cab.sh OUTPUT.cab FILE...
+
+set -e
+
+if [ $# -lt 2 ]; then
+	echo "Usage: $0 OUTPUT.cab FILE..." >&2
+	exit 1
+fi
+output="$1"
+shift
+
+# the earliest time a cabinet can represent; cabinets store local DOS
+# times, so pin the zone or the same epoch gives a different archive
+# depending on who builds it
+epoch="${SOURCE_DATE_EPOCH:-315532800}"
+TZ=UTC0
+export TZ
+
+# shared by every board, next to the build rather than under $HOME
+cachedir="${CAB_CACHE_DIR:-$(cd "$(dirname "$0")/.." && pwd)/.cab-cache}"
+
+# both are used after changing into the staging directory
+case "$output" in /*) ;; *) output="$PWD/$output" ;; esac
+case "$cachedir" in /*) ;; *) cachedir="$PWD/$cachedir" ;; esac
+
+# stage the inputs under their own names; globbing the staging directory
+# in the C locale gives a stable order, whatever order the Makefile lists
+# them in, without splitting names that contain spaces
+tmpdir=$(mktemp -d)
+trap 'rm -rf "$tmpdir"' EXIT
+mkdir "$tmpdir/in"
+for f in "$@"; do
+	cp "$f" "$tmpdir/in/"
+	touch -d "@$epoch" "$tmpdir/in/$(basename "$f")"
+done
+cd "$tmpdir/in"
+LC_ALL=C
+export LC_ALL
+set -- *
+
+# a different gcab may write a different cabinet for the same inputs
+key=$(
+	echo "build-cab.sh 3 $epoch"
+	gcab --version
+	for f in "$@"; do
+		printf '%s ' "$f"
+		sha256sum < "$f"
+	done
+)
+key=$(echo "$key" | sha256sum | cut -d' ' -f1)
+
+if [ -f "$cachedir/$key.cab" ]; then
+	cp "$cachedir/$key.cab" "$output"
+	exit 0
+fi
+
+gcab --create --nopath "$tmpdir/out.cab" "$@"
+
+# populate the cache atomically so parallel builds never see a partial file
+mkdir -p "$cachedir"
+cp "$tmpdir/out.cab" "$cachedir/$key.cab.$$"
+mv "$cachedir/$key.cab.$$" "$cachedir/$key.cab"
+cp "$tmpdir/out.cab" "$output"
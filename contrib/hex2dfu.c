@@ -0,0 +1,335 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Converts an Intel HEX file to a DFU file in one pass, replacing the
+ * sequence of `dfu-tool convert`, `set-target-size`, `set-vendor` and
+ * `set-product` runs that each rewrote the whole file.
+ *
+ * The image starts at the lowest address in the HEX file and gaps are
+ * filled with 0xff, as erased flash reads. As with `set-target-size`, an
+ * image shorter than the target size is padded with zeros and a longer one
+ * is left alone. The DFU 1.0 suffix is appended with its CRC.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HEX2DFU_IMAGE_MAX		(16 * 1024 * 1024)
+#define HEX2DFU_SUFFIX_SIZE		16
+
+typedef enum {
+	HEX2DFU_RECORD_DATA		= 0x00,
+	HEX2DFU_RECORD_EOF		= 0x01,
+	HEX2DFU_RECORD_EXTENDED_SEGMENT	= 0x02,
+	HEX2DFU_RECORD_START_SEGMENT	= 0x03,
+	HEX2DFU_RECORD_EXTENDED_LINEAR	= 0x04,
+	HEX2DFU_RECORD_START_LINEAR	= 0x05
+} Hex2DfuRecord;
+
+typedef struct {
+	uint8_t		*data;
+	uint32_t	 base;
+	uint32_t	 size;		/* bytes written so far, from base */
+	uint32_t	 alloc;
+	uint8_t		 fill;		/* for gaps between records */
+	int		 has_base;
+} Hex2DfuImage;
+
+static uint32_t
+hex2dfu_crc32(uint32_t crc, const uint8_t *buf, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		crc ^= buf[i];
+		for (unsigned j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+	return crc;
+}
+
+static int
+hex2dfu_parse_byte(const char *str, uint8_t *value)
+{
+	unsigned tmp;
+	if (sscanf(str, "%2x", &tmp) != 1)
+		return -1;
+	*value = tmp;
+	return 0;
+}
+
+static int
+hex2dfu_image_ensure(Hex2DfuImage *img, uint64_t size)
+{
+	uint8_t *tmp;
+	uint32_t alloc = img->alloc ? img->alloc : 0x10000;
+
+	if (size > HEX2DFU_IMAGE_MAX)
+		return -1;
+	if (size <= img->alloc)
+		return 0;
+	while (alloc < size)
+		alloc *= 2;
+	tmp = realloc(img->data, alloc);
+	if (tmp == NULL)
+		return -1;
+	memset(tmp + img->alloc, img->fill, alloc - img->alloc);
+	img->data = tmp;
+	img->alloc = alloc;
+	return 0;
+}
+
+static int
+hex2dfu_image_write(Hex2DfuImage *img, uint32_t addr, const uint8_t *buf, uint8_t len)
+{
+	uint64_t end;
+
+	/* records are normally ascending, but move the image up if one is not */
+	if (!img->has_base) {
+		img->base = addr;
+		img->has_base = 1;
+	} else if (addr < img->base) {
+		uint32_t shift = img->base - addr;
+		if (hex2dfu_image_ensure(img, (uint64_t) img->size + shift) < 0)
+			return -1;
+		memmove(img->data + shift, img->data, img->size);
+		memset(img->data, img->fill, shift);
+		img->size += shift;
+		img->base = addr;
+	}
+	/* a record near the top of the address space must not wrap to a small end offset */
+	end = (uint64_t) (addr - img->base) + len;
+	if (hex2dfu_image_ensure(img, end) < 0)
+		return -1;
+	memcpy(img->data + (addr - img->base), buf, len);
+	if (end > img->size)
+		img->size = end;
+	return 0;
+}
+
+static int
+hex2dfu_parse(FILE *f, const char *filename, Hex2DfuImage *img)
+{
+	char line[1024];
+	unsigned lineno = 0;
+	uint32_t addr_hi = 0;
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		uint8_t buf[255];
+		uint8_t len, type, addr_h, addr_l, checksum;
+		uint8_t sum;
+		size_t linelen;
+
+		lineno++;
+		linelen = strcspn(line, "\r\n");
+		line[linelen] = '\0';
+		if (linelen == 0)
+			continue;
+		if (line[0] != ':' || linelen < 11 ||
+		    hex2dfu_parse_byte(line + 1, &len) < 0 ||
+		    linelen != 11 + (size_t) len * 2 ||
+		    hex2dfu_parse_byte(line + 3, &addr_h) < 0 ||
+		    hex2dfu_parse_byte(line + 5, &addr_l) < 0 ||
+		    hex2dfu_parse_byte(line + 7, &type) < 0) {
+			fprintf(stderr, "%s:%u: invalid record\n", filename, lineno);
+			return -1;
+		}
+		sum = len + addr_h + addr_l + type;
+		for (unsigned i = 0; i < len; i++) {
+			if (hex2dfu_parse_byte(line + 9 + i * 2, &buf[i]) < 0) {
+				fprintf(stderr, "%s:%u: invalid data\n", filename, lineno);
+				return -1;
+			}
+			sum += buf[i];
+		}
+		if (hex2dfu_parse_byte(line + 9 + len * 2, &checksum) < 0 ||
+		    (uint8_t) (sum + checksum) != 0) {
+			fprintf(stderr, "%s:%u: invalid checksum\n", filename, lineno);
+			return -1;
+		}
+
+		switch (type) {
+		case HEX2DFU_RECORD_DATA:
+			if (hex2dfu_image_write(img,
+						addr_hi + ((uint32_t) addr_h << 8) + addr_l,
+						buf, len) < 0) {
+				fprintf(stderr, "%s:%u: image too large\n", filename, lineno);
+				return -1;
+			}
+			break;
+		case HEX2DFU_RECORD_EOF:
+			return 0;
+		case HEX2DFU_RECORD_EXTENDED_SEGMENT:
+			if (len != 2)
+				goto bad_len;
+			addr_hi = (((uint32_t) buf[0] << 8) | buf[1]) << 4;
+			break;
+		case HEX2DFU_RECORD_EXTENDED_LINEAR:
+			if (len != 2)
+				goto bad_len;
+			addr_hi = (((uint32_t) buf[0] << 8) | buf[1]) << 16;
+			break;
+		case HEX2DFU_RECORD_START_SEGMENT:
+		case HEX2DFU_RECORD_START_LINEAR:
+			break;
+		default:
+			fprintf(stderr, "%s:%u: unknown record type 0x%02x\n",
+				filename, lineno, type);
+			return -1;
+		}
+		continue;
+bad_len:
+		fprintf(stderr, "%s:%u: invalid record length\n", filename, lineno);
+		return -1;
+	}
+	fprintf(stderr, "%s: no end of file record\n", filename);
+	return -1;
+}
+
+static void
+hex2dfu_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [OPTION...] INPUT.hex OUTPUT.dfu\n"
+		"  -v, --vid=VID            USB vendor ID in hex, default ffff\n"
+		"  -p, --pid=PID            USB product ID in hex, default ffff\n"
+		"  -r, --release=BCD        bcdDevice in hex, default ffff\n"
+		"  -s, --target-size=SIZE   pad the image to at least SIZE bytes, in hex\n"
+		"  -P, --padding=BYTE       byte used to pad to the target size, default 00\n"
+		"  -f, --fill=BYTE          byte used for gaps between records, default ff\n",
+		argv0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct option options[] = {
+		{ "vid",		required_argument, NULL, 'v' },
+		{ "pid",		required_argument, NULL, 'p' },
+		{ "release",		required_argument, NULL, 'r' },
+		{ "target-size",	required_argument, NULL, 's' },
+		{ "padding",		required_argument, NULL, 'P' },
+		{ "fill",		required_argument, NULL, 'f' },
+		{ NULL, 0, NULL, 0 }
+	};
+	Hex2DfuImage img = { 0 };
+	FILE *in;
+	FILE *out;
+	uint8_t suffix[HEX2DFU_SUFFIX_SIZE];
+	uint32_t crc;
+	unsigned long vid = 0xffff;
+	unsigned long pid = 0xffff;
+	unsigned long release = 0xffff;
+	unsigned long target_size = 0;
+	unsigned long padding = 0x00;
+	unsigned long fill = 0xff;
+	int opt;
+	int rc;
+
+	while ((opt = getopt_long(argc, argv, "v:p:r:s:P:f:", options, NULL)) != -1) {
+		switch (opt) {
+		case 'v':
+			vid = strtoul(optarg, NULL, 16);
+			break;
+		case 'p':
+			pid = strtoul(optarg, NULL, 16);
+			break;
+		case 'r':
+			release = strtoul(optarg, NULL, 16);
+			break;
+		case 's':
+			target_size = strtoul(optarg, NULL, 16);
+			break;
+		case 'P':
+			padding = strtoul(optarg, NULL, 16);
+			break;
+		case 'f':
+			fill = strtoul(optarg, NULL, 16);
+			break;
+		default:
+			hex2dfu_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (argc - optind != 2 || vid > 0xffff || pid > 0xffff || release > 0xffff ||
+	    padding > 0xff || fill > 0xff) {
+		hex2dfu_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/* parse */
+	img.fill = fill;
+	in = fopen(argv[optind], "r");
+	if (in == NULL) {
+		fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+		return EXIT_FAILURE;
+	}
+	rc = hex2dfu_parse(in, argv[optind], &img);
+	fclose(in);
+	if (rc < 0)
+		return EXIT_FAILURE;
+
+	/* pad */
+	if (target_size > img.size) {
+		if (hex2dfu_image_ensure(&img, target_size) < 0)
+			return EXIT_FAILURE;
+		memset(img.data + img.size, padding, target_size - img.size);
+		img.size = target_size;
+	}
+
+	/* DFU 1.0 suffix, all little endian, CRC over everything before it */
+	suffix[0] = release & 0xff;
+	suffix[1] = release >> 8;
+	suffix[2] = pid & 0xff;
+	suffix[3] = pid >> 8;
+	suffix[4] = vid & 0xff;
+	suffix[5] = vid >> 8;
+	suffix[6] = 0x00;		/* bcdDFU */
+	suffix[7] = 0x01;
+	suffix[8] = 'U';
+	suffix[9] = 'F';
+	suffix[10] = 'D';
+	suffix[11] = HEX2DFU_SUFFIX_SIZE;
+	crc = hex2dfu_crc32(0xffffffff, img.data, img.size);
+	crc = hex2dfu_crc32(crc, suffix, 12);
+	suffix[12] = crc & 0xff;
+	suffix[13] = (crc >> 8) & 0xff;
+	suffix[14] = (crc >> 16) & 0xff;
+	suffix[15] = crc >> 24;
+
+	/* write */
+	out = fopen(argv[optind + 1], "wb");
+	if (out == NULL) {
+		fprintf(stderr, "%s: %s\n", argv[optind + 1], strerror(errno));
+		return EXIT_FAILURE;
+	}
+	if ((img.size > 0 && fwrite(img.data, 1, img.size, out) != img.size) ||
+	    fwrite(suffix, 1, sizeof(suffix), out) != sizeof(suffix) ||
+	    fclose(out) != 0) {
+		fprintf(stderr, "%s: failed to write\n", argv[optind + 1]);
+		return EXIT_FAILURE;
+	}
+	free(img.data);
+	return EXIT_SUCCESS;
+}
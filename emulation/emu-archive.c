@@ -0,0 +1,385 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "emu-archive.h"
+
+#define EMU_ZIP_LOCAL_SIG		0x04034b50
+#define EMU_ZIP_CENTRAL_SIG		0x02014b50
+#define EMU_ZIP_END_SIG			0x06054b50
+#define EMU_ZIP_END_SIZE		22
+#define EMU_ZIP_CENTRAL_SIZE		46
+#define EMU_ZIP_LOCAL_SIZE		30
+#define EMU_ZIP_METHOD_STORED		0
+#define EMU_ZIP_METHOD_DEFLATE		8
+#define EMU_ZIP_VERSION			20
+#define EMU_ZIP_MADE_BY_UNIX		(3 << 8)
+#define EMU_ZIP_DATE_1980		0x0021
+#define EMU_ZIP_MODE_644		(0100644u << 16)
+
+static uint16_t
+emu_read_u16(const uint8_t *buf)
+{
+	return buf[0] | ((uint16_t) buf[1] << 8);
+}
+
+static uint32_t
+emu_read_u32(const uint8_t *buf)
+{
+	return buf[0] | ((uint32_t) buf[1] << 8) | ((uint32_t) buf[2] << 16) | ((uint32_t) buf[3] << 24);
+}
+
+static int
+emu_archive_read_file(const char *filename, uint8_t **buf, size_t *len)
+{
+	FILE *f;
+	long size;
+	uint8_t *tmp;
+
+	f = fopen(filename, "rb");
+	if (f == NULL) {
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+		return -1;
+	}
+	if (fseek(f, 0, SEEK_END) < 0 || (size = ftell(f)) < 0 || fseek(f, 0, SEEK_SET) < 0) {
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+		fclose(f);
+		return -1;
+	}
+	tmp = malloc(size + 1);
+	if (tmp == NULL || fread(tmp, 1, size, f) != (size_t) size) {
+		fprintf(stderr, "%s: failed to read\n", filename);
+		free(tmp);
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+	tmp[size] = '\0';
+	*buf = tmp;
+	*len = size;
+	return 0;
+}
+
+static int
+emu_archive_inflate(const uint8_t *src, size_t src_len, uint8_t *dst, size_t dst_len)
+{
+	z_stream zs = { 0 };
+	int rc;
+
+	if (inflateInit2(&zs, -MAX_WBITS) != Z_OK)
+		return -1;
+	zs.next_in = (Bytef *) src;
+	zs.avail_in = src_len;
+	zs.next_out = dst;
+	zs.avail_out = dst_len;
+	rc = inflate(&zs, Z_FINISH);
+	inflateEnd(&zs);
+	if (rc != Z_STREAM_END || zs.total_out != dst_len)
+		return -1;
+	return 0;
+}
+
+static int
+emu_archive_extract(const char *filename, const uint8_t *zip, size_t zip_len,
+		    const char *member, char **buf, size_t *len)
+{
+	const uint8_t *end = NULL;
+	size_t member_len = strlen(member);
+	size_t offset;
+	uint16_t entries;
+
+	/* the end of central directory record is followed by a comment */
+	for (size_t i = zip_len >= EMU_ZIP_END_SIZE ? zip_len - EMU_ZIP_END_SIZE + 1 : 0; i-- > 0;) {
+		if (emu_read_u32(zip + i) == EMU_ZIP_END_SIG) {
+			end = zip + i;
+			break;
+		}
+		if (zip_len - i > 0xffff + EMU_ZIP_END_SIZE)
+			break;
+	}
+	if (end == NULL) {
+		fprintf(stderr, "%s: not a zip archive\n", filename);
+		return -1;
+	}
+	entries = emu_read_u16(end + 10);
+	offset = emu_read_u32(end + 16);
+
+	for (unsigned i = 0; i < entries; i++) {
+		const uint8_t *cd = zip + offset;
+		const uint8_t *local;
+		uint16_t method, name_len;
+		uint32_t crc, csize, usize, local_offset;
+		size_t data_offset;
+		uint8_t *tmp;
+
+		if (offset + EMU_ZIP_CENTRAL_SIZE > zip_len || emu_read_u32(cd) != EMU_ZIP_CENTRAL_SIG)
+			break;
+		method = emu_read_u16(cd + 10);
+		crc = emu_read_u32(cd + 16);
+		csize = emu_read_u32(cd + 20);
+		usize = emu_read_u32(cd + 24);
+		name_len = emu_read_u16(cd + 28);
+		local_offset = emu_read_u32(cd + 42);
+		offset += EMU_ZIP_CENTRAL_SIZE + name_len + emu_read_u16(cd + 30) + emu_read_u16(cd + 32);
+		if (offset > zip_len)
+			break;
+		if (name_len != member_len || memcmp(cd + EMU_ZIP_CENTRAL_SIZE, member, member_len) != 0)
+			continue;
+
+		local = zip + local_offset;
+		if ((size_t) local_offset + EMU_ZIP_LOCAL_SIZE > zip_len || emu_read_u32(local) != EMU_ZIP_LOCAL_SIG)
+			break;
+		data_offset = (size_t) local_offset + EMU_ZIP_LOCAL_SIZE +
+			      emu_read_u16(local + 26) + emu_read_u16(local + 28);
+		if (data_offset + csize > zip_len)
+			break;
+
+		tmp = malloc((size_t) usize + 1);
+		if (tmp == NULL)
+			return -1;
+		if (method == EMU_ZIP_METHOD_STORED && csize == usize) {
+			memcpy(tmp, zip + data_offset, usize);
+		} else if (method != EMU_ZIP_METHOD_DEFLATE ||
+			   emu_archive_inflate(zip + data_offset, csize, tmp, usize) < 0) {
+			fprintf(stderr, "%s: cannot decompress %s\n", filename, member);
+			free(tmp);
+			return -1;
+		}
+		if (crc32(0, tmp, usize) != crc) {
+			fprintf(stderr, "%s: %s has an invalid CRC\n", filename, member);
+			free(tmp);
+			return -1;
+		}
+		tmp[usize] = '\0';
+		*buf = (char *) tmp;
+		*len = usize;
+		return 0;
+	}
+	fprintf(stderr, "%s: no %s in archive\n", filename, member);
+	return -1;
+}
+
+int
+emu_archive_load(const char *filename, char **buf, size_t *len)
+{
+	uint8_t *data;
+	size_t data_len;
+	int rc;
+
+	if (emu_archive_read_file(filename, &data, &data_len) < 0)
+		return -1;
+	if (data_len < 4 || emu_read_u32(data) != EMU_ZIP_LOCAL_SIG) {
+		*buf = (char *) data;
+		*len = data_len;
+		return 0;
+	}
+	rc = emu_archive_extract(filename, data, data_len, EMU_ARCHIVE_MEMBER, buf, len);
+	free(data);
+	return rc;
+}
+
+static void
+emu_write_u16(uint8_t *buf, uint16_t value)
+{
+	buf[0] = value;
+	buf[1] = value >> 8;
+}
+
+static void
+emu_write_u32(uint8_t *buf, uint32_t value)
+{
+	buf[0] = value;
+	buf[1] = value >> 8;
+	buf[2] = value >> 16;
+	buf[3] = value >> 24;
+}
+
+/* the CRC and sizes are zero until emu_archive_writer_close() */
+static size_t
+emu_archive_local_header(uint8_t *buf, const char *member, uint32_t crc, uint32_t csize, uint32_t usize)
+{
+	size_t name_len = strlen(member);
+	memset(buf, 0, EMU_ZIP_LOCAL_SIZE);
+	emu_write_u32(buf, EMU_ZIP_LOCAL_SIG);
+	emu_write_u16(buf + 4, EMU_ZIP_VERSION);
+	emu_write_u16(buf + 8, EMU_ZIP_METHOD_DEFLATE);
+	emu_write_u16(buf + 12, EMU_ZIP_DATE_1980);
+	emu_write_u32(buf + 14, crc);
+	emu_write_u32(buf + 18, csize);
+	emu_write_u32(buf + 22, usize);
+	emu_write_u16(buf + 26, name_len);
+	memcpy(buf + EMU_ZIP_LOCAL_SIZE, member, name_len);
+	return EMU_ZIP_LOCAL_SIZE + name_len;
+}
+
+int
+emu_archive_writer_open(EmuArchiveWriter *writer, const char *filename, const char *member)
+{
+	uint8_t hdr[EMU_ZIP_LOCAL_SIZE + 256];
+	size_t hdr_len;
+
+	memset(writer, 0, sizeof(EmuArchiveWriter));
+	if (strlen(member) > 255)
+		return -1;
+	writer->filename = strdup(filename);
+	writer->member = strdup(member);
+	writer->tmpname = malloc(strlen(filename) + 5);
+	if (writer->filename == NULL || writer->member == NULL || writer->tmpname == NULL) {
+		emu_archive_writer_abort(writer);
+		return -1;
+	}
+	sprintf(writer->tmpname, "%s.tmp", filename);
+	writer->f = fopen(writer->tmpname, "wb");
+	if (writer->f == NULL) {
+		fprintf(stderr, "%s: %s\n", writer->tmpname, strerror(errno));
+		emu_archive_writer_abort(writer);
+		return -1;
+	}
+	if (deflateInit2(&writer->zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		fclose(writer->f);
+		writer->f = NULL;
+		emu_archive_writer_abort(writer);
+		return -1;
+	}
+	writer->crc = crc32(0, NULL, 0);
+	hdr_len = emu_archive_local_header(hdr, member, 0, 0, 0);
+	if (fwrite(hdr, 1, hdr_len, writer->f) != hdr_len) {
+		emu_archive_writer_abort(writer);
+		return -1;
+	}
+	return 0;
+}
+
+static int
+emu_archive_writer_deflate(EmuArchiveWriter *writer, int flush)
+{
+	int rc;
+	do {
+		size_t have;
+		writer->zs.next_out = writer->out;
+		writer->zs.avail_out = sizeof(writer->out);
+		rc = deflate(&writer->zs, flush);
+		if (rc == Z_STREAM_ERROR)
+			return -1;
+		have = sizeof(writer->out) - writer->zs.avail_out;
+		if (fwrite(writer->out, 1, have, writer->f) != have)
+			return -1;
+	} while (writer->zs.avail_out == 0 || (flush == Z_FINISH && rc != Z_STREAM_END));
+	return 0;
+}
+
+/* an EmuJsonWriteFunc, user_data is the EmuArchiveWriter */
+int
+emu_archive_writer_write(const char *buf, size_t len, void *user_data)
+{
+	EmuArchiveWriter *writer = user_data;
+
+	if (len == 0)
+		return 0;
+	writer->crc = crc32(writer->crc, (const Bytef *) buf, len);
+	writer->usize += len;
+	writer->zs.next_in = (Bytef *) buf;
+	writer->zs.avail_in = len;
+	return emu_archive_writer_deflate(writer, Z_NO_FLUSH);
+}
+
+int
+emu_archive_writer_close(EmuArchiveWriter *writer)
+{
+	uint8_t hdr[EMU_ZIP_LOCAL_SIZE + 256];
+	uint8_t cd[EMU_ZIP_CENTRAL_SIZE + 256];
+	uint8_t end[EMU_ZIP_END_SIZE] = { 0 };
+	size_t name_len = strlen(writer->member);
+	uint64_t csize;
+	long cd_offset;
+
+	writer->zs.next_in = NULL;
+	writer->zs.avail_in = 0;
+	if (emu_archive_writer_deflate(writer, Z_FINISH) < 0)
+		goto fail;
+	csize = writer->zs.total_out;
+	if (writer->usize > UINT32_MAX || csize > UINT32_MAX) {
+		fprintf(stderr, "%s: %s is too large for a zip archive\n", writer->filename, writer->member);
+		goto fail;
+	}
+
+	/* central directory and end record */
+	cd_offset = ftell(writer->f);
+	emu_archive_local_header(hdr, writer->member, writer->crc, csize, writer->usize);
+	memset(cd, 0, EMU_ZIP_CENTRAL_SIZE);
+	emu_write_u32(cd, EMU_ZIP_CENTRAL_SIG);
+	emu_write_u16(cd + 4, EMU_ZIP_MADE_BY_UNIX | EMU_ZIP_VERSION);
+	memcpy(cd + 6, hdr + 4, 26);
+	emu_write_u32(cd + 38, EMU_ZIP_MODE_644);
+	memcpy(cd + EMU_ZIP_CENTRAL_SIZE, writer->member, name_len);
+	emu_write_u32(end, EMU_ZIP_END_SIG);
+	emu_write_u16(end + 8, 1);
+	emu_write_u16(end + 10, 1);
+	emu_write_u32(end + 12, EMU_ZIP_CENTRAL_SIZE + name_len);
+	emu_write_u32(end + 16, cd_offset);
+	if (cd_offset < 0 ||
+	    fwrite(cd, 1, EMU_ZIP_CENTRAL_SIZE + name_len, writer->f) != EMU_ZIP_CENTRAL_SIZE + name_len ||
+	    fwrite(end, 1, sizeof(end), writer->f) != sizeof(end) ||
+	    fseek(writer->f, 0, SEEK_SET) < 0 ||
+	    fwrite(hdr, 1, EMU_ZIP_LOCAL_SIZE, writer->f) != EMU_ZIP_LOCAL_SIZE)
+		goto fail;
+	if (fclose(writer->f) != 0) {
+		writer->f = NULL;
+		goto fail;
+	}
+	writer->f = NULL;
+	if (rename(writer->tmpname, writer->filename) < 0) {
+		fprintf(stderr, "%s: %s\n", writer->filename, strerror(errno));
+		goto fail;
+	}
+	deflateEnd(&writer->zs);
+	free(writer->filename);
+	free(writer->tmpname);
+	free(writer->member);
+	memset(writer, 0, sizeof(EmuArchiveWriter));
+	return 0;
+fail:
+	fprintf(stderr, "%s: failed to write archive\n", writer->filename);
+	emu_archive_writer_abort(writer);
+	return -1;
+}
+
+void
+emu_archive_writer_abort(EmuArchiveWriter *writer)
+{
+	if (writer->f != NULL)
+		fclose(writer->f);
+	if (writer->tmpname != NULL)
+		unlink(writer->tmpname);
+	if (writer->zs.state != NULL)
+		deflateEnd(&writer->zs);
+	free(writer->filename);
+	free(writer->tmpname);
+	free(writer->member);
+	memset(writer, 0, sizeof(EmuArchiveWriter));
+}
@@ -0,0 +1,69 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __EMU_ARCHIVE_H
+#define __EMU_ARCHIVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <zlib.h>
+
+/*
+ * Loads the setup.json document of an emulation, either from a
+ * device-tests/NAME-emulation.zip archive or from an extracted file.
+ *
+ * The buffer is allocated with one spare byte which is set to NUL, and must
+ * be freed by the caller.
+ *
+ * EmuArchiveWriter streams a single deflated member into a new zip archive
+ * in constant memory. The archive is written to a temporary file and only
+ * renamed over the destination once complete, and uses the fixed
+ * 1980-01-01 timestamp of the existing archives so output is reproducible.
+ */
+
+#define EMU_ARCHIVE_MEMBER		"setup.json"
+
+typedef struct {
+	FILE		*f;
+	char		*filename;
+	char		*tmpname;
+	char		*member;
+	z_stream	 zs;
+	uint32_t	 crc;
+	uint64_t	 usize;
+	uint8_t		 out[16384];
+} EmuArchiveWriter;
+
+int		 emu_archive_load		(const char	*filename,
+						 char		**buf,
+						 size_t		*len);
+
+int		 emu_archive_writer_open	(EmuArchiveWriter *writer,
+						 const char	*filename,
+						 const char	*member);
+int		 emu_archive_writer_write	(const char	*buf,
+						 size_t		 len,
+						 void		*user_data);
+int		 emu_archive_writer_close	(EmuArchiveWriter *writer);
+void		 emu_archive_writer_abort	(EmuArchiveWriter *writer);
+
+#endif /* __EMU_ARCHIVE_H */
@@ -0,0 +1,129 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "emu-base64.h"
+
+static const char emu_base64_alphabet[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* 0xff for characters that are not in the alphabet */
+static const uint8_t emu_base64_values[256] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0xff, 0xff, 0x3f,
+	0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+	0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+
+/*
+ * out must hold EMU_BASE64_DECODED_MAX(len) bytes; it may alias str, or be
+ * NULL to only check the encoding and get the decoded length
+ */
+int
+emu_base64_decode(const char *str, size_t len, uint8_t *out, size_t *out_len)
+{
+	const uint8_t *in = (const uint8_t *) str;
+	size_t pad = 0;
+	size_t n = 0;
+	size_t i;
+
+	if (len % 4 != 0)
+		return -1;
+	if (len == 0) {
+		*out_len = 0;
+		return 0;
+	}
+	if (in[len - 1] == '=')
+		pad = in[len - 2] == '=' ? 2 : 1;
+
+	/* whole quads; the high bit of any value marks a bad character */
+	for (i = 0; i + 4 < len; i += 4) {
+		uint8_t a = emu_base64_values[in[i]];
+		uint8_t b = emu_base64_values[in[i + 1]];
+		uint8_t c = emu_base64_values[in[i + 2]];
+		uint8_t d = emu_base64_values[in[i + 3]];
+		if ((a | b | c | d) & 0x80)
+			return -1;
+		if (out != NULL) {
+			out[n] = (a << 2) | (b >> 4);
+			out[n + 1] = (b << 4) | (c >> 2);
+			out[n + 2] = (c << 6) | d;
+		}
+		n += 3;
+	}
+
+	/* the last quad may be padded */
+	{
+		uint8_t a = emu_base64_values[in[i]];
+		uint8_t b = emu_base64_values[in[i + 1]];
+		uint8_t c = pad < 2 ? emu_base64_values[in[i + 2]] : 0;
+		uint8_t d = pad < 1 ? emu_base64_values[in[i + 3]] : 0;
+		if ((a | b | c | d) & 0x80)
+			return -1;
+		if (out != NULL) {
+			out[n] = (a << 2) | (b >> 4);
+			if (pad < 2)
+				out[n + 1] = (b << 4) | (c >> 2);
+			if (pad < 1)
+				out[n + 2] = (c << 6) | d;
+		}
+		n += 3 - pad;
+	}
+	*out_len = n;
+	return 0;
+}
+
+/* out must hold EMU_BASE64_ENCODED_SIZE(len) bytes; returns the length used */
+size_t
+emu_base64_encode(const uint8_t *buf, size_t len, char *out)
+{
+	size_t n = 0;
+	size_t i;
+
+	for (i = 0; i + 2 < len; i += 3) {
+		uint32_t v = ((uint32_t) buf[i] << 16) | ((uint32_t) buf[i + 1] << 8) | buf[i + 2];
+		out[n++] = emu_base64_alphabet[v >> 18];
+		out[n++] = emu_base64_alphabet[(v >> 12) & 0x3f];
+		out[n++] = emu_base64_alphabet[(v >> 6) & 0x3f];
+		out[n++] = emu_base64_alphabet[v & 0x3f];
+	}
+	if (i < len) {
+		uint32_t v = (uint32_t) buf[i] << 16;
+		if (i + 1 < len)
+			v |= (uint32_t) buf[i + 1] << 8;
+		out[n++] = emu_base64_alphabet[v >> 18];
+		out[n++] = emu_base64_alphabet[(v >> 12) & 0x3f];
+		out[n++] = i + 1 < len ? emu_base64_alphabet[(v >> 6) & 0x3f] : '=';
+		out[n++] = '=';
+	}
+	return n;
+}
@@ -0,0 +1,40 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __EMU_BASE64_H
+#define __EMU_BASE64_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* output sizes, not including a NUL terminator */
+#define EMU_BASE64_DECODED_MAX(len)	(((len) / 4 + 1) * 3)
+#define EMU_BASE64_ENCODED_SIZE(len)	((((len) + 2) / 3) * 4)
+
+int		 emu_base64_decode		(const char	*str,
+						 size_t		 len,
+						 uint8_t	*out,
+						 size_t		*out_len);
+size_t		 emu_base64_encode		(const uint8_t	*buf,
+						 size_t		 len,
+						 char		*out);
+
+#endif /* __EMU_BASE64_H */
@@ -0,0 +1,230 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Converts device-tests emulation archives to the indexed binary format, and
+ * dumps existing index files.
+ *
+ * Each converted file is checked by replaying its events in recorded order
+ * through emu_index_lookup(), which must return every event in turn.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "emu-archive.h"
+#include "emu-index.h"
+#include "emu-json.h"
+
+static int
+emu_convert_verify(const EmuIndex *idx, const char *filename)
+{
+	for (uint32_t d = 0; d < idx->hdr->n_devices; d++) {
+		const EmuIndexDevice *device = &idx->devices[d];
+		uint32_t cursor = device->first_event;
+		for (uint32_t i = device->first_event; i < device->first_event + device->n_events; i++) {
+			const EmuIndexKey *key = &idx->keys[idx->events[i].key];
+			const EmuIndexEvent *event;
+			event = emu_index_lookup(idx, d,
+						 (const char *) emu_index_data(idx, key->id),
+						 key->id.len, &cursor);
+			if (event != &idx->events[i]) {
+				fprintf(stderr, "%s: event %u replays out of order\n", filename, i);
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+static int
+emu_convert_file(const char *filename, const char *output, EmuIndexBuildFlags flags)
+{
+	EmuJson json = { 0 };
+	EmuIndex idx;
+	char *buf = NULL;
+	size_t len;
+	uint8_t *out = NULL;
+	size_t out_len;
+	int rc = -1;
+
+	if (emu_archive_load(filename, &buf, &len) < 0)
+		return -1;
+	if (emu_json_parse(&json, buf, len, filename) < 0)
+		goto out;
+	if (emu_index_build(&json, filename, flags, &out, &out_len) < 0)
+		goto out;
+	if (emu_index_save(out, out_len, output) < 0)
+		goto out;
+	if (emu_index_open_buffer(&idx, out, out_len, output) < 0)
+		goto out;
+	out = NULL;
+	rc = emu_convert_verify(&idx, output);
+	emu_index_close(&idx);
+out:
+	free(out);
+	emu_json_clear(&json);
+	free(buf);
+	return rc;
+}
+
+static void
+emu_convert_dump_data(const EmuIndex *idx, const char *name, EmuIndexRef ref, int binary)
+{
+	const uint8_t *data = emu_index_data(idx, ref);
+	printf("    %s[%u]: ", name, ref.len);
+	for (uint32_t i = 0; i < ref.len && i < 32; i++) {
+		if (binary)
+			printf("%02x", data[i]);
+		else
+			putchar(data[i] >= 0x20 && data[i] < 0x7f ? data[i] : '.');
+	}
+	printf("%s\n", ref.len > 32 ? "…" : "");
+}
+
+static int
+emu_convert_dump(const char *filename)
+{
+	EmuIndex idx;
+
+	if (emu_index_open(&idx, filename) < 0)
+		return -1;
+	printf("%s: %u devices, %u events, %u keys, %u buckets, %u bytes of data\n",
+	       filename, idx.hdr->n_devices, idx.hdr->n_events, idx.hdr->n_keys,
+	       idx.hdr->n_buckets, idx.hdr->data_size);
+	for (uint32_t d = 0; d < idx.hdr->n_devices; d++) {
+		const EmuIndexDevice *device = &idx.devices[d];
+		printf("device %u: %.*s %.*s %04x:%04x\n", d,
+		       (int) device->gtype.len, emu_index_data(&idx, device->gtype),
+		       (int) device->platform_id.len, emu_index_data(&idx, device->platform_id),
+		       device->vid, device->pid);
+		for (uint32_t i = device->first_event; i < device->first_event + device->n_events; i++) {
+			const EmuIndexEvent *event = &idx.events[i];
+			const EmuIndexKey *key = &idx.keys[event->key];
+			printf("  %u: %.*s\n", i, (int) key->id.len, emu_index_data(&idx, key->id));
+			if (event->flags & EMU_INDEX_EVENT_FLAG_DATA)
+				emu_convert_dump_data(&idx, "Data", event->data,
+						      (event->flags & EMU_INDEX_EVENT_FLAG_BASE64) &&
+						      !(event->flags & EMU_INDEX_EVENT_FLAG_ENCODED));
+			if (event->flags & EMU_INDEX_EVENT_FLAG_DATA_OUT)
+				emu_convert_dump_data(&idx, "DataOut", event->data_out,
+						      !(event->flags & EMU_INDEX_EVENT_FLAG_ENCODED));
+			if (event->flags & EMU_INDEX_EVENT_FLAG_ERROR)
+				printf("    Error: %d\n", event->error);
+			if (event->flags & EMU_INDEX_EVENT_FLAG_TIMING)
+				printf("    Timestamp: %luus, Duration: %uus\n",
+				       (unsigned long) event->timestamp_us, event->duration_us);
+		}
+	}
+	emu_index_close(&idx);
+	return 0;
+}
+
+static void
+emu_convert_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [-z] [-d DIR] ARCHIVE...\n"
+		"       %s [-z] -o OUTPUT.emuidx ARCHIVE\n"
+		"       %s --dump INDEX.emuidx...\n"
+		"  -d, --directory=DIR      write NAME.emuidx files to DIR, default .\n"
+		"  -o, --output=FILE        output filename for a single archive\n"
+		"  -z, --dedupe             store identical payloads once\n"
+		"  -D, --dump               print the contents of index files\n",
+		argv0, argv0, argv0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct option options[] = {
+		{ "directory",		required_argument, NULL, 'd' },
+		{ "output",		required_argument, NULL, 'o' },
+		{ "dedupe",		no_argument, NULL, 'z' },
+		{ "dump",		no_argument, NULL, 'D' },
+		{ NULL, 0, NULL, 0 }
+	};
+	const char *directory = ".";
+	const char *output = NULL;
+	EmuIndexBuildFlags flags = EMU_INDEX_BUILD_FLAG_NONE;
+	int dump = 0;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "d:o:zD", options, NULL)) != -1) {
+		switch (opt) {
+		case 'd':
+			directory = optarg;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'z':
+			flags |= EMU_INDEX_BUILD_FLAG_DEDUPE;
+			break;
+		case 'D':
+			dump = 1;
+			break;
+		default:
+			emu_convert_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind >= argc || (output != NULL && argc - optind != 1)) {
+		emu_convert_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (!dump && output == NULL && mkdir(directory, 0755) < 0 && errno != EEXIST) {
+		fprintf(stderr, "%s: %s\n", directory, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	for (int i = optind; i < argc; i++) {
+		char path[4096];
+		char *tmp;
+		char *base;
+		char *dot;
+
+		if (dump) {
+			if (emu_convert_dump(argv[i]) < 0)
+				return EXIT_FAILURE;
+			continue;
+		}
+		if (output == NULL) {
+			tmp = strdup(argv[i]);
+			base = basename(tmp);
+			dot = strrchr(base, '.');
+			if (dot != NULL)
+				*dot = '\0';
+			snprintf(path, sizeof(path), "%s/%s.emuidx", directory, base);
+			free(tmp);
+		} else {
+			snprintf(path, sizeof(path), "%s", output);
+		}
+		if (emu_convert_file(argv[i], path, flags) < 0)
+			return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
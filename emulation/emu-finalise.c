@@ -0,0 +1,259 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Compacts an emulation event log into the setup.json-in-zip layout of the
+ * device-tests archives.
+ *
+ * The events are streamed from the log into the deflate stream, so memory
+ * use depends on the number and size of the device descriptions only, not
+ * on the length of the session. The log is read once per device.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emu-archive.h"
+#include "emu-base64.h"
+#include "emu-json.h"
+#include "emu-record.h"
+
+#define FINALISE_BASE64_BLOCK		(3 * 4096)
+
+typedef struct {
+	char		*json;
+	size_t		 json_len;
+	uint32_t	 flags;
+} FinaliseDevice;
+
+static int
+finalise_write_file(const char *buf, size_t len, void *user_data)
+{
+	return fwrite(buf, 1, len, user_data) == len ? 0 : -1;
+}
+
+#define finalise_lit(func, user_data, lit)	func(lit, sizeof(lit) - 1, user_data)
+
+static int
+finalise_write_base64(EmuJsonWriteFunc func, void *user_data, const uint8_t *buf, size_t len)
+{
+	char out[EMU_BASE64_ENCODED_SIZE(FINALISE_BASE64_BLOCK)];
+
+	if (func("\"", 1, user_data) < 0)
+		return -1;
+	for (size_t i = 0; i < len; i += FINALISE_BASE64_BLOCK) {
+		size_t n = len - i < FINALISE_BASE64_BLOCK ? len - i : FINALISE_BASE64_BLOCK;
+		if (func(out, emu_base64_encode(buf + i, n, out), user_data) < 0)
+			return -1;
+	}
+	return func("\"", 1, user_data);
+}
+
+static int
+finalise_write_event(EmuJsonWriteFunc func, void *user_data, const EmuRecord *record)
+{
+	char num[24];
+
+	if (finalise_lit(func, user_data, "        {\n          \"Id\" : ") < 0 ||
+	    emu_json_write_string(func, user_data, record->id, record->id_len) < 0)
+		return -1;
+	if (record->flags & EMU_RECORD_EVENT_FLAG_DATA) {
+		if (finalise_lit(func, user_data, ",\n          \"Data\" : ") < 0)
+			return -1;
+		if (record->flags & EMU_RECORD_EVENT_FLAG_BASE64) {
+			if (finalise_write_base64(func, user_data, record->data, record->data_len) < 0)
+				return -1;
+		} else if (emu_json_write_string(func, user_data, (const char *) record->data,
+						 record->data_len) < 0) {
+			return -1;
+		}
+	}
+	if (record->flags & EMU_RECORD_EVENT_FLAG_DATA_OUT) {
+		if (finalise_lit(func, user_data, ",\n          \"DataOut\" : ") < 0 ||
+		    finalise_write_base64(func, user_data, record->data_out, record->data_out_len) < 0)
+			return -1;
+	}
+	if (record->flags & EMU_RECORD_EVENT_FLAG_ERROR) {
+		if (finalise_lit(func, user_data, ",\n          \"Error\" : ") < 0 ||
+		    func(num, snprintf(num, sizeof(num), "%d", record->error), user_data) < 0)
+			return -1;
+	}
+	if (record->flags & EMU_RECORD_EVENT_FLAG_TIMING) {
+		if (finalise_lit(func, user_data, ",\n          \"Timestamp\" : ") < 0 ||
+		    func(num, snprintf(num, sizeof(num), "%lu", (unsigned long) record->timestamp_us), user_data) < 0 ||
+		    finalise_lit(func, user_data, ",\n          \"Duration\" : ") < 0 ||
+		    func(num, snprintf(num, sizeof(num), "%u", record->duration_us), user_data) < 0)
+			return -1;
+	}
+	return finalise_lit(func, user_data, "\n        }");
+}
+
+static int
+finalise_write_device(EmuJsonWriteFunc func, void *user_data, EmuRecordReader *reader,
+		      uint32_t device, FinaliseDevice *dev)
+{
+	EmuJson json = { 0 };
+	EmuRecord record;
+	uint64_t n_events = 0;
+	int first = 1;
+	int rc;
+
+	if (emu_json_parse(&json, dev->json, dev->json_len, reader->filename) < 0 ||
+	    emu_json_root(&json)->type != EMU_JSON_OBJECT) {
+		fprintf(stderr, "%s: device %u is not a JSON object\n", reader->filename, device);
+		emu_json_clear(&json);
+		return -1;
+	}
+	if (finalise_lit(func, user_data, "    {") < 0)
+		goto fail;
+	for (const EmuJsonNode *n = emu_json_first(&json, emu_json_root(&json)); n != NULL; n = emu_json_next(&json, n)) {
+		if (func(first ? "\n      " : ",\n      ", first ? 7 : 8, user_data) < 0 ||
+		    emu_json_write_member(func, user_data, &json, n, 6) < 0)
+			goto fail;
+		first = 0;
+	}
+
+	/* the events of this device, in recorded order */
+	emu_record_reader_rewind(reader);
+	while ((rc = emu_record_reader_next(reader, &record)) > 0) {
+		if (record.type != EMU_RECORD_TYPE_EVENT || record.device != device)
+			continue;
+		if (n_events == 0) {
+			const char *key = dev->flags & EMU_RECORD_DEVICE_FLAG_UDEV ? "Events" : "UsbEvents";
+			if (!first && func(",", 1, user_data) < 0)
+				goto fail;
+			if (finalise_lit(func, user_data, "\n      ") < 0 ||
+			    emu_json_write_string(func, user_data, key, strlen(key)) < 0 ||
+			    finalise_lit(func, user_data, " : [\n") < 0)
+				goto fail;
+		} else if (finalise_lit(func, user_data, ",\n") < 0) {
+			goto fail;
+		}
+		if (finalise_write_event(func, user_data, &record) < 0)
+			goto fail;
+		n_events++;
+	}
+	if (rc < 0)
+		goto fail;
+	if (n_events > 0 && finalise_lit(func, user_data, "\n      ]") < 0)
+		goto fail;
+	if (finalise_lit(func, user_data, "\n    }") < 0)
+		goto fail;
+	emu_json_clear(&json);
+	return 0;
+fail:
+	emu_json_clear(&json);
+	return -1;
+}
+
+int
+main(int argc, char *argv[])
+{
+	EmuRecordReader reader;
+	EmuArchiveWriter writer;
+	EmuJsonWriteFunc func;
+	EmuRecord record;
+	FinaliseDevice *devices = NULL;
+	uint32_t n_devices = 0;
+	void *user_data;
+	FILE *f = NULL;
+	size_t len;
+	int rc;
+
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s LOG OUTPUT.zip|OUTPUT.json\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (emu_record_reader_open(&reader, argv[1]) < 0)
+		return EXIT_FAILURE;
+
+	/* the device descriptions are small, keep them */
+	while ((rc = emu_record_reader_next(&reader, &record)) > 0) {
+		FinaliseDevice *tmp;
+		if (record.type != EMU_RECORD_TYPE_DEVICE)
+			continue;
+		if (record.device != n_devices) {
+			fprintf(stderr, "%s: device %u recorded out of order\n", argv[1], record.device);
+			return EXIT_FAILURE;
+		}
+		tmp = realloc(devices, (n_devices + 1) * sizeof(FinaliseDevice));
+		if (tmp == NULL)
+			return EXIT_FAILURE;
+		devices = tmp;
+		devices[n_devices].json = malloc(record.data_len + 1);
+		if (devices[n_devices].json == NULL)
+			return EXIT_FAILURE;
+		memcpy(devices[n_devices].json, record.data, record.data_len);
+		devices[n_devices].json_len = record.data_len;
+		devices[n_devices].flags = record.flags;
+		n_devices++;
+	}
+	if (rc < 0)
+		return EXIT_FAILURE;
+	if (reader.truncated)
+		fprintf(stderr, "%s: ignoring incomplete chunk at offset %lu\n",
+			argv[1], (unsigned long) reader.offset);
+
+	len = strlen(argv[2]);
+	if (len > 4 && strcmp(argv[2] + len - 4, ".zip") == 0) {
+		if (emu_archive_writer_open(&writer, argv[2], EMU_ARCHIVE_MEMBER) < 0)
+			return EXIT_FAILURE;
+		func = emu_archive_writer_write;
+		user_data = &writer;
+	} else {
+		f = fopen(argv[2], "wb");
+		if (f == NULL) {
+			perror(argv[2]);
+			return EXIT_FAILURE;
+		}
+		func = finalise_write_file;
+		user_data = f;
+	}
+
+	rc = finalise_lit(func, user_data, "{\n  \"UsbDevices\" : [\n");
+	for (uint32_t i = 0; rc == 0 && i < n_devices; i++) {
+		if (i > 0)
+			rc = finalise_lit(func, user_data, ",\n");
+		if (rc == 0)
+			rc = finalise_write_device(func, user_data, &reader, i, &devices[i]);
+	}
+	if (rc == 0)
+		rc = finalise_lit(func, user_data, "\n  ]\n}");
+
+	if (f != NULL) {
+		if (fclose(f) != 0)
+			rc = -1;
+	} else if (rc == 0) {
+		rc = emu_archive_writer_close(&writer);
+	} else {
+		emu_archive_writer_abort(&writer);
+	}
+	emu_record_reader_close(&reader);
+	for (uint32_t i = 0; i < n_devices; i++)
+		free(devices[i].json);
+	free(devices);
+	if (rc < 0) {
+		fprintf(stderr, "%s: failed to finalise\n", argv[2]);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * One fuzz iteration: a setup.json document is parsed, indexed and replayed
+ * in recorded order exactly as emu-replay-bench does, then loaded again with
+ * the streaming loader and replayed from its lazily decoded index. Anything
+ * may be rejected, but a document that is accepted must replay every event
+ * as itself, which is checked as well as the absence of crashes.
+ *
+ * Built with -DEMU_FUZZ_LIBFUZZER this is also a libFuzzer or AFL++ target.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "emu-fuzz.h"
+#include "emu-loader.h"
+#include "emu-replay.h"
+
+#define EMU_FUZZ_FILENAME		"fuzz.json"
+
+/* the builders must only ever produce valid indexes; takes ownership of out */
+static EmuFuzzResult
+emu_fuzz_replay(uint8_t *out, size_t out_len, EmuFuzzStats *stats)
+{
+	EmuFuzzResult result = EMU_FUZZ_RESULT_REJECTED;
+	EmuIndex idx;
+	EmuReplay replay;
+	EmuReplaySession session;
+
+	if (emu_index_open_buffer(&idx, out, out_len, EMU_FUZZ_FILENAME) < 0) {
+		free(out);
+		return EMU_FUZZ_RESULT_FAILED;
+	}
+	if (emu_replay_open_index(&replay, &idx) < 0)
+		return result;
+	if (emu_replay_session_init(&session, &replay) == 0) {
+		stats->n_events += session.n_reqs;
+		stats->n_failures += emu_replay_session_run(&replay, &session);
+		result = stats->n_failures > 0 ? EMU_FUZZ_RESULT_FAILED : EMU_FUZZ_RESULT_ACCEPTED;
+		emu_replay_session_clear(&session);
+	}
+	emu_replay_close(&replay);
+	return result;
+}
+
+EmuFuzzResult
+emu_fuzz_target(const uint8_t *data, size_t len, EmuFuzzStats *stats)
+{
+	EmuFuzzResult result = EMU_FUZZ_RESULT_REJECTED;
+	EmuJson json = { 0 };
+	uint8_t *out = NULL;
+	size_t out_len;
+	char *buf;
+
+	memset(stats, 0, sizeof(EmuFuzzStats));
+
+	/* the parsers work in place */
+	buf = malloc(len + 1);
+	if (buf == NULL)
+		return result;
+	memcpy(buf, data, len);
+	buf[len] = '\0';
+	if (emu_json_parse(&json, buf, len, EMU_FUZZ_FILENAME) == 0 &&
+	    emu_index_build(&json, EMU_FUZZ_FILENAME, EMU_INDEX_BUILD_FLAG_DEDUPE, &out, &out_len) == 0)
+		result = emu_fuzz_replay(out, out_len, stats);
+	emu_json_clear(&json);
+
+	/* the streaming loader is stricter, but what it accepts must replay too */
+	if (result != EMU_FUZZ_RESULT_FAILED) {
+		memcpy(buf, data, len);
+		buf[len] = '\0';
+		if (emu_loader_build(buf, len, EMU_FUZZ_FILENAME, 0, &out, &out_len) == 0) {
+			EmuFuzzResult lazy = emu_fuzz_replay(out, out_len, stats);
+			if (lazy != EMU_FUZZ_RESULT_REJECTED)
+				result = lazy;
+		}
+	}
+	free(buf);
+	return result;
+}
+
+#ifdef EMU_FUZZ_LIBFUZZER
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t len);
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t len)
+{
+	EmuFuzzStats stats;
+	if (emu_fuzz_target(data, len, &stats) == EMU_FUZZ_RESULT_FAILED)
+		abort();
+	return 0;
+}
+#endif
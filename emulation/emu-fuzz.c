@@ -0,0 +1,878 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Coverage guided fuzzer and load harness for the emulation parsers.
+ *
+ * The archives are used as seeds and mutated with some knowledge of their
+ * structure: the Data of ControlTransfer and BulkTransfer events is decoded,
+ * mutated and encoded again, numbers in Ids are replaced, and events are
+ * swapped, moved, duplicated and deleted. Occasionally the JSON text itself
+ * is mangled to exercise the parser.
+ *
+ * Every input runs in this process, so there is no per-input start up cost.
+ * The library is built with -fsanitize-coverage=trace-pc and each input's
+ * edge coverage is compared with everything seen so far; inputs that reach
+ * something new join the corpus.
+ *
+ * Hangs and slow paths matter as much as crashes. A watchdog thread saves
+ * and aborts on any input that runs for longer than the timeout, and an
+ * input that takes much longer per byte than the median is re-run to rule
+ * out noise and then reported as an outlier.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "emu-archive.h"
+#include "emu-base64.h"
+#include "emu-fuzz.h"
+#include "emu-histogram.h"
+#include "emu-json.h"
+#include "emu-timer.h"
+
+#define FUZZ_MAP_SIZE			(1 << 16)
+#define FUZZ_INPUT_MAX			(1024 * 1024)
+#define FUZZ_PAYLOAD_MAX		(64 * 1024)
+#define FUZZ_OUTLIERS_MAX		10
+#define FUZZ_OUTLIER_RETRIES		3
+#define FUZZ_OUTLIER_MIN_NS		20000
+#define FUZZ_OUTLIER_FACTOR_DEFAULT	10.0
+#define FUZZ_TIMEOUT_DEFAULT		1000		/* ms */
+#define FUZZ_SECONDS_DEFAULT		10
+
+typedef struct {
+	uint8_t			*data;
+	size_t			 len;
+} FuzzInput;
+
+typedef struct {
+	double			 ratio;		/* against the median time per byte */
+	uint64_t		 ns;
+	size_t			 len;
+	char			 filename[64];
+} FuzzOutlier;
+
+typedef struct {
+	FuzzInput		*corpus;
+	uint32_t		 n_corpus;
+	uint32_t		 n_corpus_alloc;
+	uint8_t			 virgin[FUZZ_MAP_SIZE];
+	uint32_t		 n_edges;
+	uint32_t		 seed;
+	const char		*outdir;
+	double			 outlier_factor;
+	uint64_t		 timeout_ns;
+	FuzzOutlier		 outliers[FUZZ_OUTLIERS_MAX];
+	uint32_t		 n_outliers;
+	EmuHistogram		 ns_per_kib;
+	uint64_t		 median_ns_per_kib;
+	uint64_t		 execs;
+	uint64_t		 events;
+	uint64_t		 rejected;
+	uint64_t		 failed;
+} Fuzzer;
+
+/* the input being run, for the watchdog and the crash handler */
+static const uint8_t *volatile fuzz_current;
+static volatile size_t fuzz_current_len;
+static volatile uint64_t fuzz_current_start;
+static const char *fuzz_outdir;
+
+static uint8_t fuzz_map[FUZZ_MAP_SIZE];
+static uint32_t fuzz_prev;
+
+void __sanitizer_cov_trace_pc(void);
+
+/* called on every basic block of the instrumented objects */
+void
+__sanitizer_cov_trace_pc(void)
+{
+	uintptr_t pc = (uintptr_t) __builtin_return_address(0);
+	uint32_t cur = (uint32_t) (pc ^ (pc >> 16)) & (FUZZ_MAP_SIZE - 1);
+	fuzz_map[cur ^ fuzz_prev]++;
+	fuzz_prev = cur >> 1;
+}
+
+static uint32_t
+fuzz_rand(Fuzzer *fuzzer)
+{
+	uint32_t x = fuzzer->seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	fuzzer->seed = x;
+	return x;
+}
+
+static uint32_t
+fuzz_below(Fuzzer *fuzzer, uint32_t n)
+{
+	return n > 0 ? fuzz_rand(fuzzer) % n : 0;
+}
+
+/* only async-signal-safe calls, as this runs from the signal handlers */
+static void
+fuzz_save_current(const char *name)
+{
+	char path[4096];
+	size_t len = strlen(fuzz_outdir);
+	int fd;
+
+	if (len + strlen(name) + 2 > sizeof(path))
+		return;
+	memcpy(path, fuzz_outdir, len);
+	path[len] = '/';
+	memcpy(path + len + 1, name, strlen(name) + 1);
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return;
+	if (write(fd, (const void *) fuzz_current, fuzz_current_len) < 0)
+		(void) 0;
+	close(fd);
+}
+
+static void
+fuzz_crash_handler(int signum)
+{
+	static const char msg[] = "emu-fuzz: crashed, input saved as crash.json\n";
+	if (fuzz_current != NULL) {
+		fuzz_save_current("crash.json");
+		if (write(STDOUT_FILENO, msg, sizeof(msg) - 1) < 0)
+			(void) 0;
+	}
+	signal(signum, SIG_DFL);
+	raise(signum);
+}
+
+static void *
+fuzz_watchdog_thread(void *user_data)
+{
+	Fuzzer *fuzzer = user_data;
+
+	for (;;) {
+		uint64_t start = fuzz_current_start;
+		usleep(fuzzer->timeout_ns / 4000 + 1);
+		if (start != 0 && start == fuzz_current_start &&
+		    emu_timer_now_ns() - start > fuzzer->timeout_ns) {
+			fuzz_save_current("hang.json");
+			printf("emu-fuzz: input ran for more than %lums, saved as hang.json\n",
+			       (unsigned long) (fuzzer->timeout_ns / 1000000));
+			fflush(stdout);
+			_exit(2);
+		}
+	}
+	return NULL;
+}
+
+static int
+fuzz_corpus_add(Fuzzer *fuzzer, const uint8_t *data, size_t len)
+{
+	FuzzInput *input;
+
+	if (fuzzer->n_corpus == fuzzer->n_corpus_alloc) {
+		uint32_t n_alloc = fuzzer->n_corpus_alloc ? fuzzer->n_corpus_alloc * 2 : 64;
+		FuzzInput *tmp = realloc(fuzzer->corpus, n_alloc * sizeof(FuzzInput));
+		if (tmp == NULL)
+			return -1;
+		fuzzer->corpus = tmp;
+		fuzzer->n_corpus_alloc = n_alloc;
+	}
+	input = &fuzzer->corpus[fuzzer->n_corpus];
+	input->data = malloc(len + 1);
+	if (input->data == NULL)
+		return -1;
+	memcpy(input->data, data, len);
+	input->len = len;
+	fuzzer->n_corpus++;
+	return 0;
+}
+
+/* hit counts are bucketed so that loops only count when they change scale */
+static uint8_t
+fuzz_bucket(uint8_t count)
+{
+	if (count == 0)
+		return 0;
+	if (count <= 3)
+		return 1 << (count - 1);
+	if (count <= 7)
+		return 1 << 3;
+	if (count <= 15)
+		return 1 << 4;
+	if (count <= 31)
+		return 1 << 5;
+	if (count <= 127)
+		return 1 << 6;
+	return 1 << 7;
+}
+
+static int
+fuzz_has_new_coverage(Fuzzer *fuzzer)
+{
+	int found = 0;
+
+	for (uint32_t i = 0; i < FUZZ_MAP_SIZE; i++) {
+		uint8_t bucket;
+		if (fuzz_map[i] == 0)
+			continue;
+		bucket = fuzz_bucket(fuzz_map[i]);
+		if (bucket & fuzzer->virgin[i]) {
+			if (fuzzer->virgin[i] == 0xff)
+				fuzzer->n_edges++;
+			fuzzer->virgin[i] &= ~bucket;
+			found = 1;
+		}
+	}
+	return found;
+}
+
+static uint64_t
+fuzz_run(const uint8_t *data, size_t len, EmuFuzzResult *result, EmuFuzzStats *stats)
+{
+	uint64_t start, elapsed;
+
+	memset(fuzz_map, 0, sizeof(fuzz_map));
+	fuzz_prev = 0;
+	fuzz_current = data;
+	fuzz_current_len = len;
+	start = emu_timer_now_ns();
+	fuzz_current_start = start;
+	*result = emu_fuzz_target(data, len, stats);
+	elapsed = emu_timer_now_ns() - start;
+	fuzz_current_start = 0;
+	return elapsed;
+}
+
+static void
+fuzz_save(Fuzzer *fuzzer, const char *filename, const uint8_t *data, size_t len)
+{
+	char path[4096];
+	FILE *f;
+
+	snprintf(path, sizeof(path), "%s/%s", fuzzer->outdir, filename);
+	f = fopen(path, "wb");
+	if (f == NULL) {
+		printf("emu-fuzz: %s: %s\n", path, strerror(errno));
+		return;
+	}
+	fwrite(data, 1, len, f);
+	fclose(f);
+}
+
+/* keeps the worst few inputs, confirmed by running them again */
+static void
+fuzz_check_outlier(Fuzzer *fuzzer, const uint8_t *data, size_t len, uint64_t ns)
+{
+	double expected = (double) fuzzer->median_ns_per_kib * len / 1024;
+	FuzzOutlier *outlier;
+	uint32_t slot;
+	char path[4096];
+
+	if (fuzzer->median_ns_per_kib == 0 || ns < FUZZ_OUTLIER_MIN_NS ||
+	    ns < expected * fuzzer->outlier_factor)
+		return;
+	for (unsigned i = 0; i < FUZZ_OUTLIER_RETRIES; i++) {
+		EmuFuzzResult result;
+		EmuFuzzStats stats;
+		uint64_t again = fuzz_run(data, len, &result, &stats);
+		if (again < ns)
+			ns = again;
+	}
+	if (ns < FUZZ_OUTLIER_MIN_NS || ns < expected * fuzzer->outlier_factor)
+		return;
+
+	/* replace the mildest outlier once the list is full */
+	if (fuzzer->n_outliers < FUZZ_OUTLIERS_MAX) {
+		slot = fuzzer->n_outliers++;
+	} else {
+		slot = 0;
+		for (uint32_t i = 1; i < FUZZ_OUTLIERS_MAX; i++) {
+			if (fuzzer->outliers[i].ratio < fuzzer->outliers[slot].ratio)
+				slot = i;
+		}
+		if (fuzzer->outliers[slot].ratio >= ns / expected)
+			return;
+		snprintf(path, sizeof(path), "%s/%s", fuzzer->outdir, fuzzer->outliers[slot].filename);
+		unlink(path);
+	}
+	outlier = &fuzzer->outliers[slot];
+	outlier->ratio = ns / expected;
+	outlier->ns = ns;
+	outlier->len = len;
+	snprintf(outlier->filename, sizeof(outlier->filename), "slow-%lu.json",
+		 (unsigned long) fuzzer->execs);
+	fuzz_save(fuzzer, outlier->filename, data, len);
+}
+
+static int
+fuzz_outlier_cmp(const void *a, const void *b)
+{
+	const FuzzOutlier *oa = a;
+	const FuzzOutlier *ob = b;
+	return (oa->ratio < ob->ratio) - (oa->ratio > ob->ratio);
+}
+
+static void
+fuzz_execute(Fuzzer *fuzzer, const uint8_t *data, size_t len)
+{
+	EmuFuzzResult result;
+	EmuFuzzStats stats;
+	uint64_t ns = fuzz_run(data, len, &result, &stats);
+
+	fuzzer->execs++;
+	fuzzer->events += stats.n_events;
+	if (result == EMU_FUZZ_RESULT_REJECTED)
+		fuzzer->rejected++;
+	if (result == EMU_FUZZ_RESULT_FAILED) {
+		char filename[64];
+		snprintf(filename, sizeof(filename), "failed-%lu.json", (unsigned long) fuzzer->execs);
+		printf("emu-fuzz: input %lu broke replay (%u of %u events), saved as %s\n",
+		       (unsigned long) fuzzer->execs, stats.n_failures, stats.n_events, filename);
+		fuzz_save(fuzzer, filename, data, len);
+		fuzzer->failed++;
+	}
+	if (fuzz_has_new_coverage(fuzzer) && len <= FUZZ_INPUT_MAX)
+		fuzz_corpus_add(fuzzer, data, len);
+
+	if (len > 0)
+		emu_histogram_add(&fuzzer->ns_per_kib, ns * 1024 / len);
+	if ((fuzzer->execs & 1023) == 0)
+		fuzzer->median_ns_per_kib = emu_histogram_percentile(&fuzzer->ns_per_kib, 50);
+	fuzz_check_outlier(fuzzer, data, len, ns);
+}
+
+/* mutating the JSON text directly, mostly to exercise the parser */
+
+static const uint8_t fuzz_interesting[] = { 0x00, 0x01, 0x7f, 0x80, 0xff, '"', '\\', '{', '[', ':', ',' };
+
+static size_t
+fuzz_mutate_bytes(Fuzzer *fuzzer, uint8_t *buf, size_t len, size_t max)
+{
+	uint32_t n = 1 + fuzz_below(fuzzer, 4);
+
+	for (uint32_t i = 0; i < n; i++) {
+		size_t pos = fuzz_below(fuzzer, len);
+		size_t span = 1 + fuzz_below(fuzzer, 16);
+		switch (fuzz_below(fuzzer, 6)) {
+		case 0:
+			if (len > 0)
+				buf[pos] ^= 1 << fuzz_below(fuzzer, 8);
+			break;
+		case 1:
+			if (len > 0)
+				buf[pos] = fuzz_interesting[fuzz_below(fuzzer, sizeof(fuzz_interesting))];
+			break;
+		case 2:
+			if (len > 0)
+				buf[pos] = fuzz_rand(fuzzer);
+			break;
+		case 3:
+			/* delete a range */
+			if (span > len - pos)
+				span = len - pos;
+			memmove(buf + pos, buf + pos + span, len - pos - span);
+			len -= span;
+			break;
+		case 4:
+			/* duplicate a range */
+			if (span > len - pos)
+				span = len - pos;
+			if (len + span > max)
+				break;
+			memmove(buf + pos + span, buf + pos, len - pos);
+			len += span;
+			break;
+		default:
+			/* truncate, or grow to a longer run of the same byte */
+			if (len > 0 && fuzz_below(fuzzer, 2) == 0) {
+				len = pos;
+			} else if (len > 0) {
+				size_t grow = fuzz_below(fuzzer, len < max / 2 ? len : max / 2);
+				if (len + grow > max)
+					break;
+				memmove(buf + pos + grow, buf + pos, len - pos);
+				memset(buf + pos, buf[pos], grow);
+				len += grow;
+			}
+			break;
+		}
+	}
+	return len;
+}
+
+/* mutating the document structure */
+
+typedef struct {
+	EmuJson			 json;
+	char			*text;
+	uint32_t		*events;	/* nodes of the UsbEvents and Events arrays */
+	uint32_t		 n_events;
+	char			**strs;		/* replacement strings */
+	uint32_t		 n_strs;
+	uint8_t			*out;
+	size_t			 out_len;
+	size_t			 out_alloc;
+} FuzzDoc;
+
+static void
+fuzz_doc_clear(FuzzDoc *doc)
+{
+	emu_json_clear(&doc->json);
+	free(doc->text);
+	free(doc->events);
+	for (uint32_t i = 0; i < doc->n_strs; i++)
+		free(doc->strs[i]);
+	free(doc->strs);
+	free(doc->out);
+	memset(doc, 0, sizeof(FuzzDoc));
+}
+
+static int
+fuzz_doc_parse(FuzzDoc *doc, const uint8_t *data, size_t len)
+{
+	const EmuJsonNode *devices;
+
+	memset(doc, 0, sizeof(FuzzDoc));
+	doc->text = malloc(len + 1);
+	if (doc->text == NULL)
+		return -1;
+	memcpy(doc->text, data, len);
+	doc->text[len] = '\0';
+	if (emu_json_parse(&doc->json, doc->text, len, "seed") < 0)
+		return -1;
+	devices = emu_json_member(&doc->json, emu_json_root(&doc->json), "UsbDevices");
+	doc->events = calloc(doc->json.n_nodes, sizeof(uint32_t));
+	doc->strs = calloc(64, sizeof(char *));
+	if (devices == NULL || doc->events == NULL || doc->strs == NULL)
+		return -1;
+	for (const EmuJsonNode *d = emu_json_first(&doc->json, devices); d != NULL; d = emu_json_next(&doc->json, d)) {
+		const EmuJsonNode *events = emu_json_member(&doc->json, d, "UsbEvents");
+		if (events == NULL)
+			events = emu_json_member(&doc->json, d, "Events");
+		if (events != NULL && events->type == EMU_JSON_ARRAY)
+			doc->events[doc->n_events++] = events - doc->json.nodes;
+	}
+	return doc->n_events > 0 ? 0 : -1;
+}
+
+/* the string stays owned by the document */
+static char *
+fuzz_doc_alloc_str(FuzzDoc *doc, size_t len)
+{
+	char *str;
+	if (doc->n_strs == 64)
+		return NULL;
+	str = malloc(len + 1);
+	if (str != NULL)
+		doc->strs[doc->n_strs++] = str;
+	return str;
+}
+
+/* children of an array, in order */
+static uint32_t
+fuzz_doc_children(FuzzDoc *doc, uint32_t array, uint32_t *children, uint32_t max)
+{
+	const EmuJsonNode *node = &doc->json.nodes[array];
+	uint32_t n = 0;
+
+	for (const EmuJsonNode *c = emu_json_first(&doc->json, node); c != NULL && n < max; c = emu_json_next(&doc->json, c))
+		children[n++] = c - doc->json.nodes;
+	return n;
+}
+
+static void
+fuzz_doc_relink(FuzzDoc *doc, uint32_t array, const uint32_t *children, uint32_t n)
+{
+	EmuJsonNode *node = &doc->json.nodes[array];
+
+	node->count = n;
+	node->child = n > 0 ? children[0] : 0;
+	for (uint32_t i = 0; i < n; i++)
+		doc->json.nodes[children[i]].next = i + 1 < n ? children[i + 1] : 0;
+}
+
+static int
+fuzz_doc_reorder(Fuzzer *fuzzer, FuzzDoc *doc)
+{
+	uint32_t array = doc->events[fuzz_below(fuzzer, doc->n_events)];
+	uint32_t n_max = doc->json.nodes[array].count + 1;
+	uint32_t *children = calloc(n_max, sizeof(uint32_t));
+	uint32_t n;
+	uint32_t a, b;
+
+	if (children == NULL)
+		return -1;
+	n = fuzz_doc_children(doc, array, children, n_max);
+	if (n == 0) {
+		free(children);
+		return 0;
+	}
+	a = fuzz_below(fuzzer, n);
+	b = fuzz_below(fuzzer, n);
+	switch (fuzz_below(fuzzer, 4)) {
+	case 0: {
+		/* swap */
+		uint32_t tmp = children[a];
+		children[a] = children[b];
+		children[b] = tmp;
+		break;
+	}
+	case 1: {
+		/* move */
+		uint32_t tmp = children[a];
+		memmove(children + a, children + a + 1, (n - a - 1) * sizeof(uint32_t));
+		memmove(children + b + 1, children + b, (n - b - 1) * sizeof(uint32_t));
+		children[b] = tmp;
+		break;
+	}
+	case 2:
+		/* duplicate, sharing the same members */
+		if (doc->json.n_nodes == doc->json.n_alloc) {
+			uint32_t n_alloc = doc->json.n_alloc * 2;
+			EmuJsonNode *tmp = realloc(doc->json.nodes, n_alloc * sizeof(EmuJsonNode));
+			if (tmp == NULL) {
+				free(children);
+				return -1;
+			}
+			doc->json.nodes = tmp;
+			doc->json.n_alloc = n_alloc;
+		}
+		doc->json.nodes[doc->json.n_nodes] = doc->json.nodes[children[a]];
+		memmove(children + b + 1, children + b, (n - b) * sizeof(uint32_t));
+		children[b] = doc->json.n_nodes++;
+		n++;
+		break;
+	default:
+		/* delete */
+		memmove(children + a, children + a + 1, (n - a - 1) * sizeof(uint32_t));
+		n--;
+		break;
+	}
+	fuzz_doc_relink(doc, array, children, n);
+	free(children);
+	return 0;
+}
+
+/* a random event of the given kinds */
+static EmuJsonNode *
+fuzz_doc_pick_event(Fuzzer *fuzzer, FuzzDoc *doc, int transfers_only)
+{
+	for (unsigned tries = 0; tries < 16; tries++) {
+		uint32_t array = doc->events[fuzz_below(fuzzer, doc->n_events)];
+		const EmuJsonNode *node = emu_json_first(&doc->json, &doc->json.nodes[array]);
+		const char *id;
+		for (uint32_t skip = fuzz_below(fuzzer, doc->json.nodes[array].count); node != NULL && skip > 0; skip--)
+			node = emu_json_next(&doc->json, node);
+		if (node == NULL || node->type != EMU_JSON_OBJECT)
+			continue;
+		id = emu_json_member_str(&doc->json, node, "Id");
+		if (id == NULL)
+			continue;
+		if (transfers_only &&
+		    (emu_json_member(&doc->json, node, "Data") == NULL ||
+		     (strncmp(id, "ControlTransfer:", 16) != 0 && strncmp(id, "BulkTransfer:", 13) != 0)))
+			continue;
+		return &doc->json.nodes[node - doc->json.nodes];
+	}
+	return NULL;
+}
+
+static int
+fuzz_doc_mutate_payload(Fuzzer *fuzzer, FuzzDoc *doc)
+{
+	EmuJsonNode *event = fuzz_doc_pick_event(fuzzer, doc, 1);
+	EmuJsonNode *data;
+	uint8_t *buf;
+	size_t len;
+	char *str;
+
+	if (event == NULL)
+		return fuzz_doc_reorder(fuzzer, doc);
+	data = &doc->json.nodes[emu_json_member(&doc->json, event, "Data") - doc->json.nodes];
+	if (data->type != EMU_JSON_STRING)
+		return 0;
+	buf = malloc(FUZZ_PAYLOAD_MAX);
+	if (buf == NULL)
+		return -1;
+	if (data->len > EMU_BASE64_ENCODED_SIZE(FUZZ_PAYLOAD_MAX / 2) ||
+	    emu_base64_decode(data->str, data->len, buf, &len) < 0)
+		len = 0;
+	len = fuzz_mutate_bytes(fuzzer, buf, len, FUZZ_PAYLOAD_MAX);
+	str = fuzz_doc_alloc_str(doc, EMU_BASE64_ENCODED_SIZE(len));
+	if (str == NULL) {
+		free(buf);
+		return 0;
+	}
+	data->len = emu_base64_encode(buf, len, str);
+	str[data->len] = '\0';
+	data->str = str;
+	free(buf);
+	return 0;
+}
+
+/* replace one of the hex numbers in an Id */
+static int
+fuzz_doc_mutate_id(Fuzzer *fuzzer, FuzzDoc *doc)
+{
+	EmuJsonNode *event = fuzz_doc_pick_event(fuzzer, doc, 0);
+	EmuJsonNode *id;
+	const char *p;
+	size_t start, end;
+	char *str;
+	char hex[24];
+	int hex_len;
+
+	if (event == NULL)
+		return 0;
+	id = &doc->json.nodes[emu_json_member(&doc->json, event, "Id") - doc->json.nodes];
+	p = strstr(id->str + fuzz_below(fuzzer, id->len), "0x");
+	if (p == NULL)
+		p = strstr(id->str, "0x");
+	if (p == NULL)
+		return 0;
+	start = p + 2 - id->str;
+	for (end = start; end < id->len && strchr("0123456789abcdef", id->str[end]) != NULL; end++)
+		;
+	hex_len = snprintf(hex, sizeof(hex), "%.*lx", (int) (1 + fuzz_below(fuzzer, 16)),
+			   (unsigned long) fuzz_rand(fuzzer) << fuzz_below(fuzzer, 32));
+	str = fuzz_doc_alloc_str(doc, id->len - (end - start) + hex_len);
+	if (str == NULL)
+		return 0;
+	memcpy(str, id->str, start);
+	memcpy(str + start, hex, hex_len);
+	memcpy(str + start + hex_len, id->str + end, id->len - end);
+	id->len = id->len - (end - start) + hex_len;
+	str[id->len] = '\0';
+	id->str = str;
+	return 0;
+}
+
+static int
+fuzz_doc_write(const char *buf, size_t len, void *user_data)
+{
+	FuzzDoc *doc = user_data;
+	if (doc->out_len + len > FUZZ_INPUT_MAX)
+		return -1;
+	if (doc->out_len + len > doc->out_alloc) {
+		size_t alloc = doc->out_alloc ? doc->out_alloc : 4096;
+		uint8_t *tmp;
+		while (alloc < doc->out_len + len)
+			alloc *= 2;
+		tmp = realloc(doc->out, alloc);
+		if (tmp == NULL)
+			return -1;
+		doc->out = tmp;
+		doc->out_alloc = alloc;
+	}
+	memcpy(doc->out + doc->out_len, buf, len);
+	doc->out_len += len;
+	return 0;
+}
+
+/* returns a new buffer holding the mutated input */
+static uint8_t *
+fuzz_mutate(Fuzzer *fuzzer, const FuzzInput *input, size_t *len)
+{
+	FuzzDoc doc;
+	uint8_t *buf;
+
+	if (fuzz_below(fuzzer, 8) != 0 && fuzz_doc_parse(&doc, input->data, input->len) == 0) {
+		uint32_t n = 1 + fuzz_below(fuzzer, 4);
+		int rc = 0;
+		for (uint32_t i = 0; rc == 0 && i < n; i++) {
+			uint32_t which = fuzz_below(fuzzer, 8);
+			if (which < 4)
+				rc = fuzz_doc_mutate_payload(fuzzer, &doc);
+			else if (which < 5)
+				rc = fuzz_doc_mutate_id(fuzzer, &doc);
+			else
+				rc = fuzz_doc_reorder(fuzzer, &doc);
+		}
+		if (rc == 0 && emu_json_write_value(fuzz_doc_write, &doc, &doc.json,
+						     emu_json_root(&doc.json), -1) == 0) {
+			buf = doc.out;
+			*len = doc.out_len;
+			doc.out = NULL;
+			fuzz_doc_clear(&doc);
+			return buf;
+		}
+	}
+	fuzz_doc_clear(&doc);
+
+	/* fall back to the text */
+	buf = malloc(FUZZ_INPUT_MAX);
+	if (buf == NULL)
+		return NULL;
+	*len = input->len < FUZZ_INPUT_MAX ? input->len : FUZZ_INPUT_MAX;
+	memcpy(buf, input->data, *len);
+	*len = fuzz_mutate_bytes(fuzzer, buf, *len, FUZZ_INPUT_MAX);
+	return buf;
+}
+
+static void
+fuzz_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [OPTION...] ARCHIVE...\n"
+		"  -T, --seconds=N          run for N seconds, default %u\n"
+		"  -n, --execs=N            stop after N inputs\n"
+		"  -t, --timeout=MS         treat inputs running longer as hangs, default %u\n"
+		"  -f, --outlier=FACTOR     report inputs this much slower per byte than\n"
+		"                           the median, default %.0f\n"
+		"  -o, --output=DIR         save hangs, crashes and outliers here, default .\n"
+		"  -s, --seed=N             random seed\n",
+		argv0, FUZZ_SECONDS_DEFAULT, FUZZ_TIMEOUT_DEFAULT, FUZZ_OUTLIER_FACTOR_DEFAULT);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct option options[] = {
+		{ "seconds",		required_argument, NULL, 'T' },
+		{ "execs",		required_argument, NULL, 'n' },
+		{ "timeout",		required_argument, NULL, 't' },
+		{ "outlier",		required_argument, NULL, 'f' },
+		{ "output",		required_argument, NULL, 'o' },
+		{ "seed",		required_argument, NULL, 's' },
+		{ NULL, 0, NULL, 0 }
+	};
+	static Fuzzer fuzzer;
+	pthread_t watchdog;
+	unsigned long seconds = FUZZ_SECONDS_DEFAULT;
+	unsigned long max_execs = 0;
+	uint64_t start, deadline, elapsed;
+	int devnull;
+	int opt;
+
+	fuzzer.outdir = ".";
+	fuzzer.outlier_factor = FUZZ_OUTLIER_FACTOR_DEFAULT;
+	fuzzer.timeout_ns = (uint64_t) FUZZ_TIMEOUT_DEFAULT * 1000000;
+	fuzzer.seed = emu_timer_now_ns() | 1;
+	while ((opt = getopt_long(argc, argv, "T:n:t:f:o:s:", options, NULL)) != -1) {
+		switch (opt) {
+		case 'T':
+			seconds = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			max_execs = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			fuzzer.timeout_ns = strtoull(optarg, NULL, 0) * 1000000;
+			break;
+		case 'f':
+			fuzzer.outlier_factor = strtod(optarg, NULL);
+			break;
+		case 'o':
+			fuzzer.outdir = optarg;
+			break;
+		case 's':
+			fuzzer.seed = strtoul(optarg, NULL, 0) | 1;
+			break;
+		default:
+			fuzz_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind >= argc || fuzzer.timeout_ns == 0 || fuzzer.outlier_factor <= 1) {
+		fuzz_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (mkdir(fuzzer.outdir, 0755) < 0 && errno != EEXIST) {
+		fprintf(stderr, "%s: %s\n", fuzzer.outdir, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	fuzz_outdir = fuzzer.outdir;
+	memset(fuzzer.virgin, 0xff, sizeof(fuzzer.virgin));
+	emu_histogram_init(&fuzzer.ns_per_kib);
+
+	for (int i = optind; i < argc; i++) {
+		char *buf;
+		size_t len;
+		if (emu_archive_load(argv[i], &buf, &len) < 0)
+			return EXIT_FAILURE;
+		if (fuzz_corpus_add(&fuzzer, (const uint8_t *) buf, len) < 0)
+			return EXIT_FAILURE;
+		free(buf);
+	}
+
+	/* rejected inputs complain on stderr, which would dominate the run time */
+	devnull = open("/dev/null", O_WRONLY);
+	if (devnull >= 0) {
+		dup2(devnull, STDERR_FILENO);
+		close(devnull);
+	}
+	signal(SIGSEGV, fuzz_crash_handler);
+	signal(SIGBUS, fuzz_crash_handler);
+	signal(SIGABRT, fuzz_crash_handler);
+	signal(SIGFPE, fuzz_crash_handler);
+	signal(SIGILL, fuzz_crash_handler);
+	if (pthread_create(&watchdog, NULL, fuzz_watchdog_thread, &fuzzer) != 0)
+		return EXIT_FAILURE;
+
+	/* the seeds first, so their coverage is the baseline */
+	for (uint32_t i = 0; i < fuzzer.n_corpus && (uint64_t) i < (uint64_t) argc - optind; i++)
+		fuzz_execute(&fuzzer, fuzzer.corpus[i].data, fuzzer.corpus[i].len);
+
+	start = emu_timer_now_ns();
+	deadline = start + (uint64_t) seconds * 1000000000;
+	while (max_execs == 0 || fuzzer.execs < max_execs) {
+		const FuzzInput *input = &fuzzer.corpus[fuzz_below(&fuzzer, fuzzer.n_corpus)];
+		uint8_t *buf;
+		size_t len;
+
+		if ((fuzzer.execs & 255) == 0 && emu_timer_now_ns() > deadline)
+			break;
+		buf = fuzz_mutate(&fuzzer, input, &len);
+		if (buf == NULL)
+			return EXIT_FAILURE;
+		fuzz_execute(&fuzzer, buf, len);
+		free(buf);
+	}
+	elapsed = emu_timer_now_ns() - start;
+	fuzz_current = NULL;
+
+	printf("%lu inputs in %.1fs, %.0f inputs/s, %.0f events/s\n",
+	       (unsigned long) fuzzer.execs, elapsed / 1e9,
+	       fuzzer.execs / (elapsed / 1e9), fuzzer.events / (elapsed / 1e9));
+	printf("corpus %u inputs, %u edges, %lu rejected, %lu broke replay\n",
+	       fuzzer.n_corpus, fuzzer.n_edges, (unsigned long) fuzzer.rejected,
+	       (unsigned long) fuzzer.failed);
+	printf("median %.1f us/KiB\n", emu_histogram_percentile(&fuzzer.ns_per_kib, 50) / 1e3);
+	if (fuzzer.n_outliers > 0) {
+		qsort(fuzzer.outliers, fuzzer.n_outliers, sizeof(FuzzOutlier), fuzz_outlier_cmp);
+		printf("\n%8s %10s %8s  %s\n", "slower", "time/us", "bytes", "input");
+		for (uint32_t i = 0; i < fuzzer.n_outliers; i++) {
+			const FuzzOutlier *outlier = &fuzzer.outliers[i];
+			printf("%7.1fx %10.1f %8lu  %s/%s\n", outlier->ratio, outlier->ns / 1e3,
+			       (unsigned long) outlier->len, fuzzer.outdir, outlier->filename);
+		}
+	}
+	return fuzzer.failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
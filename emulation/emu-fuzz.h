@@ -0,0 +1,43 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __EMU_FUZZ_H
+#define __EMU_FUZZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+	EMU_FUZZ_RESULT_REJECTED,	/* not a valid document, which is fine */
+	EMU_FUZZ_RESULT_ACCEPTED,
+	EMU_FUZZ_RESULT_FAILED,		/* accepted, but replay broke a property */
+} EmuFuzzResult;
+
+typedef struct {
+	uint32_t	 n_events;	/* replayed */
+	uint32_t	 n_failures;
+} EmuFuzzStats;
+
+EmuFuzzResult	 emu_fuzz_target		(const uint8_t	*data,
+						 size_t		 len,
+						 EmuFuzzStats	*stats);
+
+#endif /* __EMU_FUZZ_H */
@@ -0,0 +1,127 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "emu-histogram.h"
+
+#define EMU_HISTOGRAM_SUB		(1u << EMU_HISTOGRAM_SUB_BITS)
+#define EMU_HISTOGRAM_BAR_WIDTH		50
+
+static unsigned
+emu_histogram_bucket(uint64_t value)
+{
+	unsigned msb;
+
+	if (value < EMU_HISTOGRAM_SUB)
+		return value;
+	msb = 63 - __builtin_clzll(value);
+	return ((msb - EMU_HISTOGRAM_SUB_BITS + 1) << EMU_HISTOGRAM_SUB_BITS) +
+	       ((value >> (msb - EMU_HISTOGRAM_SUB_BITS)) & (EMU_HISTOGRAM_SUB - 1));
+}
+
+/* the smallest value that falls into the bucket */
+static uint64_t
+emu_histogram_bucket_value(unsigned bucket)
+{
+	unsigned msb;
+
+	if (bucket < EMU_HISTOGRAM_SUB)
+		return bucket;
+	msb = (bucket >> EMU_HISTOGRAM_SUB_BITS) + EMU_HISTOGRAM_SUB_BITS - 1;
+	return (uint64_t) (EMU_HISTOGRAM_SUB + (bucket & (EMU_HISTOGRAM_SUB - 1)))
+	       << (msb - EMU_HISTOGRAM_SUB_BITS);
+}
+
+void
+emu_histogram_init(EmuHistogram *h)
+{
+	memset(h, 0, sizeof(EmuHistogram));
+	h->min = UINT64_MAX;
+}
+
+void
+emu_histogram_add(EmuHistogram *h, uint64_t value)
+{
+	h->counts[emu_histogram_bucket(value)]++;
+	h->n++;
+	h->sum += value;
+	if (value < h->min)
+		h->min = value;
+	if (value > h->max)
+		h->max = value;
+}
+
+void
+emu_histogram_merge(EmuHistogram *h, const EmuHistogram *other)
+{
+	for (unsigned i = 0; i < EMU_HISTOGRAM_BUCKETS; i++)
+		h->counts[i] += other->counts[i];
+	h->n += other->n;
+	h->sum += other->sum;
+	if (other->min < h->min)
+		h->min = other->min;
+	if (other->max > h->max)
+		h->max = other->max;
+}
+
+/* percentile is 0..100; the result is the lower bound of its bucket */
+uint64_t
+emu_histogram_percentile(const EmuHistogram *h, double percentile)
+{
+	uint64_t rank = h->n * percentile / 100.0;
+	uint64_t seen = 0;
+
+	if (h->n == 0)
+		return 0;
+	if (rank >= h->n)
+		return h->max;
+	for (unsigned i = 0; i < EMU_HISTOGRAM_BUCKETS; i++) {
+		seen += h->counts[i];
+		if (seen > rank) {
+			uint64_t value = emu_histogram_bucket_value(i);
+			return value < h->min ? h->min : value;
+		}
+	}
+	return h->max;
+}
+
+void
+emu_histogram_print(const EmuHistogram *h, FILE *out)
+{
+	uint64_t peak = 0;
+
+	for (unsigned i = 0; i < EMU_HISTOGRAM_BUCKETS; i++) {
+		if (h->counts[i] > peak)
+			peak = h->counts[i];
+	}
+	for (unsigned i = 0; i < EMU_HISTOGRAM_BUCKETS; i++) {
+		unsigned width;
+		if (h->counts[i] == 0)
+			continue;
+		width = (h->counts[i] * EMU_HISTOGRAM_BAR_WIDTH + peak - 1) / peak;
+		fprintf(out, "  %12lu ns %10lu ", (unsigned long) emu_histogram_bucket_value(i),
+			(unsigned long) h->counts[i]);
+		for (unsigned j = 0; j < width; j++)
+			fputc('#', out);
+		fputc('\n', out);
+	}
+}
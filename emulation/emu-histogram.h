@@ -0,0 +1,55 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __EMU_HISTOGRAM_H
+#define __EMU_HISTOGRAM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Log-linear histogram of durations in nanoseconds: every power of two is
+ * split into 8 buckets, so any value is recorded to within 12.5% in constant
+ * time and histograms from different threads can simply be added together.
+ */
+
+#define EMU_HISTOGRAM_SUB_BITS		3
+#define EMU_HISTOGRAM_BUCKETS		((64 - EMU_HISTOGRAM_SUB_BITS + 1) << EMU_HISTOGRAM_SUB_BITS)
+
+typedef struct {
+	uint64_t	 counts[EMU_HISTOGRAM_BUCKETS];
+	uint64_t	 n;
+	uint64_t	 min;
+	uint64_t	 max;
+	double		 sum;
+} EmuHistogram;
+
+void		 emu_histogram_init		(EmuHistogram	*h);
+void		 emu_histogram_add		(EmuHistogram	*h,
+						 uint64_t	 value);
+void		 emu_histogram_merge		(EmuHistogram	*h,
+						 const EmuHistogram *other);
+uint64_t	 emu_histogram_percentile	(const EmuHistogram *h,
+						 double		 percentile);
+void		 emu_histogram_print		(const EmuHistogram *h,
+						 FILE		*out);
+
+#endif /* __EMU_HISTOGRAM_H */
@@ -0,0 +1,824 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "emu-base64.h"
+#include "emu-index.h"
+
+#define EMU_INDEX_ALIGN(x)		(((x) + 7) & ~(uint64_t) 7)
+
+typedef struct {
+	uint8_t		*buf;
+	size_t		 len;
+	size_t		 alloc;
+} EmuIndexBuf;
+
+typedef struct {
+	const char	*filename;
+	EmuIndexBuildFlags flags;
+	EmuIndexBuf	 data;
+	EmuIndexDevice	*devices;
+	EmuIndexEvent	*events;
+	EmuIndexKey	*keys;
+	uint32_t	*slots;
+	uint32_t	*buckets;
+	uint32_t	 n_devices;
+	uint32_t	 n_events;
+	uint32_t	 n_keys;
+	uint32_t	 n_buckets;
+	EmuIndexRef	*strings;	/* intern table of the data section, len 0 = empty */
+	uint32_t	 n_strings;
+	uint32_t	 n_strings_alloc;	/* power of two */
+} EmuIndexBuilder;
+
+/* Data of these events is a plain string, everything else is base64 */
+static const char *emu_index_string_kinds[] = {
+	"ReadAttr",
+	"ReadProp",
+	"GetSymlinkTarget",
+	NULL
+};
+
+uint32_t
+emu_index_hash(uint32_t device, const char *id, size_t id_len)
+{
+	uint32_t hash = 2166136261u;
+	for (unsigned i = 0; i < 4; i++) {
+		hash ^= (device >> (i * 8)) & 0xff;
+		hash *= 16777619u;
+	}
+	for (size_t i = 0; i < id_len; i++) {
+		hash ^= (uint8_t) id[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static int
+emu_index_buf_reserve(EmuIndexBuf *b, size_t len)
+{
+	size_t alloc = b->alloc ? b->alloc : 4096;
+	uint8_t *tmp;
+
+	if (b->len + len <= b->alloc)
+		return 0;
+	if (b->len + len > UINT32_MAX)
+		return -1;
+	while (alloc < b->len + len)
+		alloc *= 2;
+	tmp = realloc(b->buf, alloc);
+	if (tmp == NULL)
+		return -1;
+	b->buf = tmp;
+	b->alloc = alloc;
+	return 0;
+}
+
+static int
+emu_index_buf_append(EmuIndexBuf *b, const void *data, size_t len, EmuIndexRef *ref)
+{
+	if (emu_index_buf_reserve(b, len) < 0)
+		return -1;
+	memcpy(b->buf + b->len, data, len);
+	ref->offset = b->len;
+	ref->len = len;
+	b->len += len;
+	return 0;
+}
+
+static int
+emu_index_builder_intern_grow(EmuIndexBuilder *b)
+{
+	uint32_t n_alloc = b->n_strings_alloc ? b->n_strings_alloc * 2 : 64;
+	EmuIndexRef *tmp = calloc(n_alloc, sizeof(EmuIndexRef));
+
+	if (tmp == NULL)
+		return -1;
+	for (uint32_t j = 0; j < b->n_strings_alloc; j++) {
+		EmuIndexRef r = b->strings[j];
+		uint32_t i;
+		if (r.len == 0)
+			continue;
+		i = emu_index_hash(0, (const char *) b->data.buf + r.offset, r.len) & (n_alloc - 1);
+		while (tmp[i].len != 0)
+			i = (i + 1) & (n_alloc - 1);
+		tmp[i] = r;
+	}
+	free(b->strings);
+	b->strings = tmp;
+	b->n_strings_alloc = n_alloc;
+	return 0;
+}
+
+/* the range was just appended to the data section; drop it if it is a copy */
+static int
+emu_index_builder_intern_tail(EmuIndexBuilder *b, EmuIndexRef *ref)
+{
+	const char *str = (const char *) b->data.buf + ref->offset;
+	uint32_t mask;
+	uint32_t i;
+
+	if (ref->len == 0)
+		return 0;
+
+	/* keep the table at most half full */
+	if ((b->n_strings + 1) * 2 > b->n_strings_alloc && emu_index_builder_intern_grow(b) < 0)
+		return -1;
+	mask = b->n_strings_alloc - 1;
+	for (i = emu_index_hash(0, str, ref->len) & mask; b->strings[i].len != 0; i = (i + 1) & mask) {
+		EmuIndexRef r = b->strings[i];
+		if (r.len == ref->len && memcmp(b->data.buf + r.offset, str, r.len) == 0) {
+			b->data.len = ref->offset;
+			*ref = r;
+			return 0;
+		}
+	}
+	b->strings[i] = *ref;
+	b->n_strings++;
+	return 0;
+}
+
+static int
+emu_index_builder_intern(EmuIndexBuilder *b, const char *str, size_t len, EmuIndexRef *ref)
+{
+	if (emu_index_buf_append(&b->data, str, len, ref) < 0)
+		return -1;
+	return emu_index_builder_intern_tail(b, ref);
+}
+
+/* payloads are only interned when asked, as most are unique */
+static int
+emu_index_builder_payload(EmuIndexBuilder *b, EmuIndexRef *ref)
+{
+	if ((b->flags & EMU_INDEX_BUILD_FLAG_DEDUPE) == 0)
+		return 0;
+	return emu_index_builder_intern_tail(b, ref);
+}
+
+/* lazy indexes keep the text, which is checked but only decoded on use */
+static int
+emu_index_builder_base64(EmuIndexBuilder *b, const char *str, size_t len, EmuIndexRef *ref)
+{
+	size_t out_len;
+
+	if (b->flags & EMU_INDEX_BUILD_FLAG_LAZY) {
+		if (emu_base64_decode(str, len, NULL, &out_len) < 0)
+			return -1;
+		return emu_index_buf_append(&b->data, str, len, ref);
+	}
+	if (emu_index_buf_reserve(&b->data, EMU_BASE64_DECODED_MAX(len)) < 0)
+		return -1;
+	if (emu_base64_decode(str, len, b->data.buf + b->data.len, &out_len) < 0)
+		return -1;
+	ref->offset = b->data.len;
+	ref->len = out_len;
+	b->data.len += out_len;
+	return 0;
+}
+
+static int
+emu_index_is_string_kind(const char *id, size_t id_len)
+{
+	const char *colon = memchr(id, ':', id_len);
+	size_t kind_len = colon != NULL ? (size_t) (colon - id) : id_len;
+	for (unsigned i = 0; emu_index_string_kinds[i] != NULL; i++) {
+		if (strlen(emu_index_string_kinds[i]) == kind_len &&
+		    strncmp(id, emu_index_string_kinds[i], kind_len) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+static int
+emu_index_builder_add_key(EmuIndexBuilder *b, uint32_t device, const char *id, size_t id_len)
+{
+	uint32_t hash = emu_index_hash(device, id, id_len);
+	uint32_t mask = b->n_buckets - 1;
+	uint32_t i;
+	EmuIndexKey *key;
+
+	for (i = hash & mask; b->buckets[i] != 0; i = (i + 1) & mask) {
+		key = &b->keys[b->buckets[i] - 1];
+		if (key->hash == hash && key->device == device && key->id.len == id_len &&
+		    memcmp(b->data.buf + key->id.offset, id, id_len) == 0) {
+			key->n_events++;
+			return b->buckets[i] - 1;
+		}
+	}
+
+	key = &b->keys[b->n_keys];
+	if (emu_index_builder_intern(b, id, id_len, &key->id) < 0)
+		return -1;
+	key->device = device;
+	key->hash = hash;
+	key->n_events = 1;
+	b->buckets[i] = ++b->n_keys;
+	return b->n_keys - 1;
+}
+
+static int
+emu_index_builder_add_event(EmuIndexBuilder *b, uint32_t device, const EmuIndexEventSource *src)
+{
+	EmuIndexEvent *event = &b->events[b->n_events];
+	int key;
+
+	if (src->id == NULL || src->id_len == 0) {
+		fprintf(stderr, "%s: event %u has no Id\n", b->filename, b->n_events);
+		return -1;
+	}
+	memset(event, 0, sizeof(EmuIndexEvent));
+	key = emu_index_builder_add_key(b, device, src->id, src->id_len);
+	if (key < 0)
+		return -1;
+	event->key = key;
+	if (b->flags & EMU_INDEX_BUILD_FLAG_LAZY)
+		event->flags |= EMU_INDEX_EVENT_FLAG_ENCODED;
+
+	if (src->data != NULL) {
+		event->flags |= EMU_INDEX_EVENT_FLAG_DATA;
+		if (!emu_index_is_string_kind(src->id, src->id_len) &&
+		    emu_index_builder_base64(b, src->data, src->data_len, &event->data) == 0) {
+			event->flags |= EMU_INDEX_EVENT_FLAG_BASE64;
+		} else if (emu_index_buf_append(&b->data, src->data, src->data_len, &event->data) < 0) {
+			return -1;
+		}
+		if (emu_index_builder_payload(b, &event->data) < 0)
+			return -1;
+	}
+	if (src->data_out != NULL) {
+		event->flags |= EMU_INDEX_EVENT_FLAG_DATA_OUT;
+		if (emu_index_builder_base64(b, src->data_out, src->data_out_len, &event->data_out) < 0) {
+			fprintf(stderr, "%s: %.*s has invalid DataOut\n", b->filename, (int) src->id_len, src->id);
+			return -1;
+		}
+		if (emu_index_builder_payload(b, &event->data_out) < 0)
+			return -1;
+	}
+	event->flags |= src->flags & (EMU_INDEX_EVENT_FLAG_ERROR | EMU_INDEX_EVENT_FLAG_TIMING);
+	event->error = src->error;
+	event->timestamp_us = src->timestamp_us;
+	event->duration_us = src->duration_us;
+	b->n_events++;
+	return 0;
+}
+
+static int
+emu_index_builder_add_device(EmuIndexBuilder *b, const EmuIndexDeviceSource *src, const EmuIndexEventSource *events)
+{
+	EmuIndexDevice *device = &b->devices[b->n_devices];
+
+	memset(device, 0, sizeof(EmuIndexDevice));
+	device->flags = src->flags;
+	device->vid = src->vid;
+	device->pid = src->pid;
+	if (src->gtype != NULL && emu_index_builder_intern(b, src->gtype, src->gtype_len, &device->gtype) < 0)
+		return -1;
+	if (src->platform_id != NULL &&
+	    (emu_index_buf_append(&b->data, src->platform_id, src->platform_id_len, &device->platform_id) < 0 ||
+	     emu_index_builder_payload(b, &device->platform_id) < 0))
+		return -1;
+	device->first_event = b->n_events;
+	for (uint32_t i = 0; i < src->n_events; i++) {
+		if (emu_index_builder_add_event(b, b->n_devices, &events[src->first_event + i]) < 0)
+			return -1;
+	}
+	device->n_events = b->n_events - device->first_event;
+	b->n_devices++;
+	return 0;
+}
+
+/* group the events by key, which keeps them in recorded order */
+static int
+emu_index_builder_slots(EmuIndexBuilder *b)
+{
+	uint32_t *fill = calloc(b->n_keys + 1, sizeof(uint32_t));
+	uint32_t slot = 0;
+
+	if (fill == NULL)
+		return -1;
+	for (uint32_t k = 0; k < b->n_keys; k++) {
+		b->keys[k].first_slot = slot;
+		slot += b->keys[k].n_events;
+	}
+	for (uint32_t i = 0; i < b->n_events; i++) {
+		EmuIndexKey *key = &b->keys[b->events[i].key];
+		b->slots[key->first_slot + fill[b->events[i].key]++] = i;
+	}
+	free(fill);
+	return 0;
+}
+
+static int
+emu_index_builder_write(EmuIndexBuilder *b, uint8_t **buf, size_t *len)
+{
+	EmuIndexHeader hdr = { 0 };
+	uint64_t offset = EMU_INDEX_ALIGN(sizeof(EmuIndexHeader));
+	uint8_t *tmp;
+
+	memcpy(hdr.magic, EMU_INDEX_MAGIC, sizeof(hdr.magic));
+	hdr.version = EMU_INDEX_VERSION;
+	hdr.n_devices = b->n_devices;
+	hdr.n_events = b->n_events;
+	hdr.n_keys = b->n_keys;
+	hdr.n_buckets = b->n_buckets;
+	hdr.data_size = b->data.len;
+	hdr.devices_offset = offset;
+	offset = EMU_INDEX_ALIGN(offset + (uint64_t) b->n_devices * sizeof(EmuIndexDevice));
+	hdr.events_offset = offset;
+	offset = EMU_INDEX_ALIGN(offset + (uint64_t) b->n_events * sizeof(EmuIndexEvent));
+	hdr.keys_offset = offset;
+	offset = EMU_INDEX_ALIGN(offset + (uint64_t) b->n_keys * sizeof(EmuIndexKey));
+	hdr.slots_offset = offset;
+	offset = EMU_INDEX_ALIGN(offset + (uint64_t) b->n_events * sizeof(uint32_t));
+	hdr.buckets_offset = offset;
+	offset = EMU_INDEX_ALIGN(offset + (uint64_t) b->n_buckets * sizeof(uint32_t));
+	hdr.data_offset = offset;
+	offset += b->data.len;
+
+	tmp = calloc(1, offset);
+	if (tmp == NULL)
+		return -1;
+	memcpy(tmp, &hdr, sizeof(hdr));
+	memcpy(tmp + hdr.devices_offset, b->devices, b->n_devices * sizeof(EmuIndexDevice));
+	memcpy(tmp + hdr.events_offset, b->events, b->n_events * sizeof(EmuIndexEvent));
+	memcpy(tmp + hdr.keys_offset, b->keys, b->n_keys * sizeof(EmuIndexKey));
+	memcpy(tmp + hdr.slots_offset, b->slots, b->n_events * sizeof(uint32_t));
+	memcpy(tmp + hdr.buckets_offset, b->buckets, b->n_buckets * sizeof(uint32_t));
+	if (b->data.len > 0)
+		memcpy(tmp + hdr.data_offset, b->data.buf, b->data.len);
+	*buf = tmp;
+	*len = offset;
+	return 0;
+}
+
+int
+emu_index_build_sources(const EmuIndexDeviceSource *devices,
+			uint32_t n_devices,
+			const EmuIndexEventSource *events,
+			uint32_t n_events,
+			const char *filename,
+			EmuIndexBuildFlags flags,
+			uint8_t **buf,
+			size_t *len)
+{
+	EmuIndexBuilder b = { .filename = filename, .flags = flags };
+	uint64_t data_len = 0;
+	int rc = -1;
+
+	/* size everything up front so the tables never move */
+	b.n_buckets = 16;
+	while (b.n_buckets < n_events * 2)
+		b.n_buckets *= 2;
+	b.devices = calloc(n_devices + 1, sizeof(EmuIndexDevice));
+	b.events = calloc(n_events + 1, sizeof(EmuIndexEvent));
+	b.keys = calloc(n_events + 1, sizeof(EmuIndexKey));
+	b.slots = calloc(n_events + 1, sizeof(uint32_t));
+	b.buckets = calloc(b.n_buckets, sizeof(uint32_t));
+	if (b.devices == NULL || b.events == NULL || b.keys == NULL ||
+	    b.slots == NULL || b.buckets == NULL)
+		goto out;
+
+	/* reserve the data block once; decoded payloads only make it smaller */
+	for (uint32_t i = 0; i < n_events; i++)
+		data_len += events[i].id_len + events[i].data_len + events[i].data_out_len + 2;
+	if (data_len <= UINT32_MAX && emu_index_buf_reserve(&b.data, data_len) < 0)
+		goto out;
+
+	for (uint32_t i = 0; i < n_devices; i++) {
+		if ((uint64_t) devices[i].first_event + devices[i].n_events > n_events)
+			goto out;
+		if (emu_index_builder_add_device(&b, &devices[i], events) < 0)
+			goto out;
+	}
+	if (emu_index_builder_slots(&b) < 0)
+		goto out;
+	rc = emu_index_builder_write(&b, buf, len);
+out:
+	if (rc < 0)
+		fprintf(stderr, "%s: failed to build index\n", filename);
+	free(b.data.buf);
+	free(b.devices);
+	free(b.events);
+	free(b.keys);
+	free(b.slots);
+	free(b.buckets);
+	free(b.strings);
+	return rc;
+}
+
+static const EmuJsonNode *
+emu_index_device_events(const EmuJson *json, const EmuJsonNode *node, uint32_t *flags)
+{
+	const EmuJsonNode *events = emu_json_member(json, node, "UsbEvents");
+	if (events == NULL) {
+		events = emu_json_member(json, node, "Events");
+		if (events != NULL)
+			*flags |= EMU_INDEX_DEVICE_FLAG_UDEV;
+	}
+	if (events != NULL && events->type != EMU_JSON_ARRAY)
+		return NULL;
+	return events;
+}
+
+static void
+emu_index_json_str(const EmuJson *json, const EmuJsonNode *node, const char *key,
+		   const char **str, size_t *len)
+{
+	const EmuJsonNode *n = emu_json_member(json, node, key);
+	if (n == NULL || n->type != EMU_JSON_STRING)
+		return;
+	*str = n->str;
+	*len = n->len;
+}
+
+static void
+emu_index_json_event(const EmuJson *json, const EmuJsonNode *node, EmuIndexEventSource *src)
+{
+	const EmuJsonNode *error = emu_json_member(json, node, "Error");
+	const EmuJsonNode *timestamp = emu_json_member(json, node, "Timestamp");
+	const EmuJsonNode *duration = emu_json_member(json, node, "Duration");
+
+	memset(src, 0, sizeof(EmuIndexEventSource));
+	emu_index_json_str(json, node, "Id", &src->id, &src->id_len);
+	emu_index_json_str(json, node, "Data", &src->data, &src->data_len);
+	emu_index_json_str(json, node, "DataOut", &src->data_out, &src->data_out_len);
+	if (error != NULL && error->type == EMU_JSON_NUMBER) {
+		src->flags |= EMU_INDEX_EVENT_FLAG_ERROR;
+		src->error = error->num;
+	}
+	if (timestamp != NULL && timestamp->type == EMU_JSON_NUMBER && timestamp->num >= 0 &&
+	    duration != NULL && duration->type == EMU_JSON_NUMBER && duration->num >= 0 &&
+	    duration->num <= UINT32_MAX) {
+		src->flags |= EMU_INDEX_EVENT_FLAG_TIMING;
+		src->timestamp_us = timestamp->num;
+		src->duration_us = duration->num;
+	}
+}
+
+int
+emu_index_build(const EmuJson *json,
+		const char *filename,
+		EmuIndexBuildFlags flags,
+		uint8_t **buf,
+		size_t *len)
+{
+	const EmuJsonNode *devices = emu_json_member(json, emu_json_root(json), "UsbDevices");
+	EmuIndexDeviceSource *device_srcs = NULL;
+	EmuIndexEventSource *event_srcs = NULL;
+	uint32_t n_devices = 0;
+	uint32_t n_events = 0;
+	int rc = -1;
+
+	if (devices == NULL || devices->type != EMU_JSON_ARRAY) {
+		fprintf(stderr, "%s: no UsbDevices array\n", filename);
+		return -1;
+	}
+	for (const EmuJsonNode *n = emu_json_first(json, devices); n != NULL; n = emu_json_next(json, n)) {
+		uint32_t device_flags = 0;
+		const EmuJsonNode *events = emu_index_device_events(json, n, &device_flags);
+		if (n->type != EMU_JSON_OBJECT) {
+			fprintf(stderr, "%s: device %u is not an object\n", filename, n_devices);
+			return -1;
+		}
+		if (events != NULL)
+			n_events += events->count;
+		n_devices++;
+	}
+	device_srcs = calloc(n_devices + 1, sizeof(EmuIndexDeviceSource));
+	event_srcs = calloc(n_events + 1, sizeof(EmuIndexEventSource));
+	if (device_srcs == NULL || event_srcs == NULL)
+		goto out;
+
+	n_devices = 0;
+	n_events = 0;
+	for (const EmuJsonNode *n = emu_json_first(json, devices); n != NULL; n = emu_json_next(json, n)) {
+		EmuIndexDeviceSource *src = &device_srcs[n_devices++];
+		const EmuJsonNode *events = emu_index_device_events(json, n, &src->flags);
+
+		emu_index_json_str(json, n, "GType", &src->gtype, &src->gtype_len);
+		emu_index_json_str(json, n, "PlatformId", &src->platform_id, &src->platform_id_len);
+		if (src->platform_id == NULL)
+			emu_index_json_str(json, n, "BackendId", &src->platform_id, &src->platform_id_len);
+		if (src->flags & EMU_INDEX_DEVICE_FLAG_UDEV) {
+			src->vid = emu_json_member_int(json, n, "Vendor", 0);
+			src->pid = emu_json_member_int(json, n, "Model", 0);
+		} else {
+			src->vid = emu_json_member_int(json, n, "IdVendor", 0);
+			src->pid = emu_json_member_int(json, n, "IdProduct", 0);
+		}
+		src->first_event = n_events;
+		for (const EmuJsonNode *e = emu_json_first(json, events); e != NULL; e = emu_json_next(json, e))
+			emu_index_json_event(json, e, &event_srcs[n_events++]);
+		src->n_events = n_events - src->first_event;
+	}
+	rc = emu_index_build_sources(device_srcs, n_devices, event_srcs, n_events,
+				     filename, flags, buf, len);
+out:
+	free(device_srcs);
+	free(event_srcs);
+	return rc;
+}
+
+int
+emu_index_save(const uint8_t *buf, size_t len, const char *filename)
+{
+	FILE *f = fopen(filename, "wb");
+	if (f == NULL) {
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+		return -1;
+	}
+	if (fwrite(buf, 1, len, f) != len || fclose(f) != 0) {
+		fprintf(stderr, "%s: failed to write\n", filename);
+		return -1;
+	}
+	return 0;
+}
+
+static int
+emu_index_ref_valid(const EmuIndex *idx, EmuIndexRef ref)
+{
+	return (uint64_t) ref.offset + ref.len <= idx->hdr->data_size;
+}
+
+static int
+emu_index_section_valid(const EmuIndex *idx, uint64_t offset, uint64_t count, size_t size)
+{
+	return offset % 8 == 0 && offset <= idx->len && count * size <= idx->len - offset;
+}
+
+/* everything is checked once here so lookups can trust the file */
+static int
+emu_index_validate(EmuIndex *idx)
+{
+	const EmuIndexHeader *hdr = idx->hdr;
+
+	if (idx->len < sizeof(EmuIndexHeader) ||
+	    memcmp(hdr->magic, EMU_INDEX_MAGIC, sizeof(hdr->magic)) != 0 ||
+	    hdr->version != EMU_INDEX_VERSION)
+		return -1;
+	if (hdr->n_buckets == 0 || (hdr->n_buckets & (hdr->n_buckets - 1)) != 0 ||
+	    hdr->n_keys >= hdr->n_buckets)
+		return -1;
+	if (!emu_index_section_valid(idx, hdr->devices_offset, hdr->n_devices, sizeof(EmuIndexDevice)) ||
+	    !emu_index_section_valid(idx, hdr->events_offset, hdr->n_events, sizeof(EmuIndexEvent)) ||
+	    !emu_index_section_valid(idx, hdr->keys_offset, hdr->n_keys, sizeof(EmuIndexKey)) ||
+	    !emu_index_section_valid(idx, hdr->slots_offset, hdr->n_events, sizeof(uint32_t)) ||
+	    !emu_index_section_valid(idx, hdr->buckets_offset, hdr->n_buckets, sizeof(uint32_t)) ||
+	    !emu_index_section_valid(idx, hdr->data_offset, hdr->data_size, 1))
+		return -1;
+
+	idx->devices = (const EmuIndexDevice *) (idx->buf + hdr->devices_offset);
+	idx->events = (const EmuIndexEvent *) (idx->buf + hdr->events_offset);
+	idx->keys = (const EmuIndexKey *) (idx->buf + hdr->keys_offset);
+	idx->slots = (const uint32_t *) (idx->buf + hdr->slots_offset);
+	idx->buckets = (const uint32_t *) (idx->buf + hdr->buckets_offset);
+	idx->data = idx->buf + hdr->data_offset;
+
+	for (uint32_t i = 0; i < hdr->n_devices; i++) {
+		const EmuIndexDevice *device = &idx->devices[i];
+		if (!emu_index_ref_valid(idx, device->gtype) ||
+		    !emu_index_ref_valid(idx, device->platform_id) ||
+		    (uint64_t) device->first_event + device->n_events > hdr->n_events)
+			return -1;
+	}
+	for (uint32_t i = 0; i < hdr->n_events; i++) {
+		const EmuIndexEvent *event = &idx->events[i];
+		if (event->key >= hdr->n_keys ||
+		    idx->slots[i] >= hdr->n_events ||
+		    !emu_index_ref_valid(idx, event->data) ||
+		    !emu_index_ref_valid(idx, event->data_out))
+			return -1;
+	}
+	for (uint32_t i = 0; i < hdr->n_keys; i++) {
+		const EmuIndexKey *key = &idx->keys[i];
+		if (!emu_index_ref_valid(idx, key->id) ||
+		    key->device >= hdr->n_devices ||
+		    key->n_events == 0 ||
+		    (uint64_t) key->first_slot + key->n_events > hdr->n_events)
+			return -1;
+	}
+	for (uint32_t i = 0; i < hdr->n_buckets; i++) {
+		if (idx->buckets[i] > hdr->n_keys)
+			return -1;
+	}
+	return 0;
+}
+
+int
+emu_index_open_buffer(EmuIndex *idx, uint8_t *buf, size_t len, const char *filename)
+{
+	memset(idx, 0, sizeof(EmuIndex));
+	idx->buf = buf;
+	idx->len = len;
+	idx->hdr = (const EmuIndexHeader *) buf;
+	if (emu_index_validate(idx) < 0) {
+		fprintf(stderr, "%s: invalid emulation index\n", filename);
+		idx->buf = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+int
+emu_index_open(EmuIndex *idx, const char *filename)
+{
+	struct stat st;
+	void *map;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+		if (fd >= 0)
+			close(fd);
+		return -1;
+	}
+	if (st.st_size < (off_t) sizeof(EmuIndexHeader)) {
+		fprintf(stderr, "%s: invalid emulation index\n", filename);
+		close(fd);
+		return -1;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+		return -1;
+	}
+	if (emu_index_open_buffer(idx, map, st.st_size, filename) < 0) {
+		munmap(map, st.st_size);
+		return -1;
+	}
+	idx->mapped = 1;
+	return 0;
+}
+
+void
+emu_index_close(EmuIndex *idx)
+{
+	if (idx->buf == NULL)
+		return;
+	if (idx->mapped)
+		munmap((void *) idx->buf, idx->len);
+	else
+		free((void *) idx->buf);
+	memset(idx, 0, sizeof(EmuIndex));
+}
+
+static int
+emu_index_share_ref(EmuPayloadTable *table, const uint8_t *data, EmuIndexRef *ref)
+{
+	return emu_payload_table_intern(table, data + ref->offset, ref->len, &ref->offset);
+}
+
+/*
+ * Moves every Id and payload into the table, so identical payloads of all
+ * the indexes sharing it are held once, and frees the data section. A
+ * mapped file is copied first, as the tables have to be rewritten.
+ */
+int
+emu_index_share(EmuIndex *idx, EmuPayloadTable *table, const char *filename)
+{
+	EmuIndexHeader *hdr;
+	EmuIndexDevice *devices;
+	EmuIndexEvent *events;
+	EmuIndexKey *keys;
+	size_t len = idx->hdr->data_offset;
+	uint8_t *buf;
+	int rc = 0;
+
+	if (idx->mapped) {
+		buf = malloc(len);
+		if (buf == NULL) {
+			emu_index_close(idx);
+			return -1;
+		}
+		memcpy(buf, idx->buf, len);
+	} else {
+		buf = (uint8_t *) idx->buf;
+	}
+	hdr = (EmuIndexHeader *) buf;
+	devices = (EmuIndexDevice *) (buf + hdr->devices_offset);
+	events = (EmuIndexEvent *) (buf + hdr->events_offset);
+	keys = (EmuIndexKey *) (buf + hdr->keys_offset);
+	for (uint32_t i = 0; rc == 0 && i < hdr->n_devices; i++) {
+		rc = emu_index_share_ref(table, idx->data, &devices[i].gtype);
+		if (rc == 0)
+			rc = emu_index_share_ref(table, idx->data, &devices[i].platform_id);
+	}
+	for (uint32_t i = 0; rc == 0 && i < hdr->n_events; i++) {
+		rc = emu_index_share_ref(table, idx->data, &events[i].data);
+		if (rc == 0)
+			rc = emu_index_share_ref(table, idx->data, &events[i].data_out);
+	}
+	for (uint32_t i = 0; rc == 0 && i < hdr->n_keys; i++)
+		rc = emu_index_share_ref(table, idx->data, &keys[i].id);
+	if (idx->mapped) {
+		munmap((void *) idx->buf, idx->len);
+		idx->mapped = 0;
+	}
+	idx->buf = buf;
+	if (rc < 0) {
+		fprintf(stderr, "%s: failed to share payloads\n", filename);
+		emu_index_close(idx);
+		return -1;
+	}
+
+	/* the data section is always last */
+	hdr->data_size = 0;
+	buf = realloc(buf, len);
+	if (buf != NULL)
+		idx->buf = buf;
+	idx->len = len;
+	idx->hdr = (const EmuIndexHeader *) idx->buf;
+	idx->devices = (const EmuIndexDevice *) (idx->buf + idx->hdr->devices_offset);
+	idx->events = (const EmuIndexEvent *) (idx->buf + idx->hdr->events_offset);
+	idx->keys = (const EmuIndexKey *) (idx->buf + idx->hdr->keys_offset);
+	idx->slots = (const uint32_t *) (idx->buf + idx->hdr->slots_offset);
+	idx->buckets = (const uint32_t *) (idx->buf + idx->hdr->buckets_offset);
+	idx->data = table->buf;
+	return 0;
+}
+
+const EmuIndexKey *
+emu_index_lookup_key(const EmuIndex *idx, uint32_t device, const char *id, size_t id_len)
+{
+	uint32_t hash = emu_index_hash(device, id, id_len);
+	uint32_t mask = idx->hdr->n_buckets - 1;
+	uint32_t i = hash & mask;
+
+	/* bounded, as a hostile file may have no empty bucket */
+	for (uint32_t probes = 0; probes < idx->hdr->n_buckets && idx->buckets[i] != 0; probes++) {
+		const EmuIndexKey *key = &idx->keys[idx->buckets[i] - 1];
+		if (key->hash == hash && key->device == device && key->id.len == id_len &&
+		    memcmp(idx->data + key->id.offset, id, id_len) == 0)
+			return key;
+		i = (i + 1) & mask;
+	}
+	return NULL;
+}
+
+/*
+ * Same order as fwupd: the next matching event at or after the cursor, or
+ * failing that the first matching event. The cursor wraps to the start of
+ * the device once every event has been used.
+ *
+ * The events of a key are sorted, so even a session that repeats one
+ * request many thousands of times is a binary search.
+ */
+const EmuIndexEvent *
+emu_index_lookup(const EmuIndex *idx, uint32_t device, const char *id, size_t id_len, uint32_t *cursor)
+{
+	const EmuIndexDevice *dev;
+	const EmuIndexKey *key;
+	const uint32_t *slots;
+	uint32_t lo = 0;
+	uint32_t hi;
+	uint32_t i;
+
+	if (device >= idx->hdr->n_devices)
+		return NULL;
+	dev = &idx->devices[device];
+	key = emu_index_lookup_key(idx, device, id, id_len);
+	if (key == NULL)
+		return NULL;
+	if (*cursor < dev->first_event || *cursor >= dev->first_event + dev->n_events)
+		*cursor = dev->first_event;
+	slots = idx->slots + key->first_slot;
+	hi = key->n_events;
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		if (slots[mid] < *cursor)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	i = slots[lo < key->n_events ? lo : 0];
+	*cursor = i + 1;
+	return &idx->events[i];
+}
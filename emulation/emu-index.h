@@ -0,0 +1,225 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __EMU_INDEX_H
+#define __EMU_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "emu-json.h"
+#include "emu-payload.h"
+
+/*
+ * Indexed binary companion to an emulation setup.json.
+ *
+ * The file is designed to be mapped read-only and used in place:
+ *
+ *   EmuIndexHeader
+ *   EmuIndexDevice[n_devices]
+ *   EmuIndexEvent[n_events]	in recorded order, grouped by device
+ *   EmuIndexKey[n_keys]		one per distinct (device, Id) pair
+ *   uint32_t[n_events]		event numbers grouped by key, ascending
+ *   uint32_t[n_buckets]		open addressed hash table of key + 1
+ *   data			interned Id strings and raw payloads
+ *
+ * Refs may overlap: Ids are always interned, and payloads too when built
+ * with EMU_INDEX_BUILD_FLAG_DEDUPE. emu_index_share() moves the data of a
+ * loaded index into an EmuPayloadTable shared with other indexes.
+ *
+ * Every section starts on an 8 byte boundary and all integers are in host
+ * (little endian) byte order. Payloads that were base64 in the JSON are
+ * stored decoded, so replay never has to decode or compare long Id strings
+ * other than the one being looked up. Indexes built in memory with
+ * EMU_INDEX_BUILD_FLAG_LAZY keep them as base64 instead, so loading does
+ * not pay for payloads that are never requested; emu_replay_request()
+ * decodes them on first use.
+ *
+ * emu_index_build() indexes a parsed document. emu_index_build_sources()
+ * takes the devices and events from any other reader, such as the
+ * streaming loader in emu-loader.h.
+ */
+
+#define EMU_INDEX_MAGIC			"FWEMUIX1"
+#define EMU_INDEX_VERSION		4
+#define EMU_INDEX_NONE			0xffffffff
+
+typedef enum {
+	EMU_INDEX_EVENT_FLAG_DATA	= 1 << 0,
+	EMU_INDEX_EVENT_FLAG_DATA_OUT	= 1 << 1,
+	EMU_INDEX_EVENT_FLAG_ERROR	= 1 << 2,
+	EMU_INDEX_EVENT_FLAG_BASE64	= 1 << 3,	/* Data was base64 encoded */
+	EMU_INDEX_EVENT_FLAG_TIMING	= 1 << 4,	/* Timestamp and Duration are valid */
+	EMU_INDEX_EVENT_FLAG_ENCODED	= 1 << 5	/* base64 payloads are not decoded yet */
+} EmuIndexEventFlags;
+
+typedef enum {
+	EMU_INDEX_BUILD_FLAG_NONE	= 0,
+	EMU_INDEX_BUILD_FLAG_DEDUPE	= 1 << 0,	/* store identical payloads once */
+	EMU_INDEX_BUILD_FLAG_LAZY	= 1 << 1	/* keep base64 payloads encoded */
+} EmuIndexBuildFlags;
+
+typedef enum {
+	EMU_INDEX_DEVICE_FLAG_UDEV	= 1 << 0	/* "Events" rather than "UsbEvents" */
+} EmuIndexDeviceFlags;
+
+/* a range of the data section */
+typedef struct {
+	uint32_t	 offset;
+	uint32_t	 len;
+} EmuIndexRef;
+
+typedef struct {
+	char		 magic[8];
+	uint32_t	 version;
+	uint32_t	 n_devices;
+	uint32_t	 n_events;
+	uint32_t	 n_keys;
+	uint32_t	 n_buckets;	/* power of two */
+	uint32_t	 data_size;
+	uint64_t	 devices_offset;
+	uint64_t	 events_offset;
+	uint64_t	 keys_offset;
+	uint64_t	 slots_offset;
+	uint64_t	 buckets_offset;
+	uint64_t	 data_offset;
+} EmuIndexHeader;
+
+typedef struct {
+	EmuIndexRef	 gtype;
+	EmuIndexRef	 platform_id;	/* or BackendId for udev devices */
+	uint32_t	 first_event;
+	uint32_t	 n_events;
+	uint16_t	 vid;		/* or Vendor for udev devices */
+	uint16_t	 pid;		/* or Model for udev devices */
+	uint32_t	 flags;
+} EmuIndexDevice;
+
+typedef struct {
+	uint32_t	 key;
+	uint32_t	 flags;
+	int32_t		 error;
+	uint32_t	 duration_us;	/* from request to response */
+	EmuIndexRef	 data;
+	EmuIndexRef	 data_out;
+	uint64_t	 timestamp_us;	/* since the device was created */
+} EmuIndexEvent;
+
+typedef struct {
+	EmuIndexRef	 id;		/* shared by identical Ids of all devices */
+	uint32_t	 device;
+	uint32_t	 hash;
+	uint32_t	 first_slot;	/* the events of this key are slots[first_slot...] */
+	uint32_t	 n_events;
+} EmuIndexKey;
+
+/* strings are not NUL terminated, and are NULL when absent */
+typedef struct {
+	const char	*gtype;
+	size_t		 gtype_len;
+	const char	*platform_id;
+	size_t		 platform_id_len;
+	uint16_t	 vid;
+	uint16_t	 pid;
+	uint32_t	 flags;		/* EmuIndexDeviceFlags */
+	uint32_t	 first_event;
+	uint32_t	 n_events;
+} EmuIndexDeviceSource;
+
+typedef struct {
+	const char	*id;
+	size_t		 id_len;
+	const char	*data;
+	size_t		 data_len;
+	const char	*data_out;
+	size_t		 data_out_len;
+	uint32_t	 flags;		/* only EMU_INDEX_EVENT_FLAG_ERROR and _TIMING */
+	int32_t		 error;
+	uint32_t	 duration_us;
+	uint64_t	 timestamp_us;
+} EmuIndexEventSource;
+
+typedef struct {
+	const uint8_t		*buf;
+	size_t			 len;
+	const EmuIndexHeader	*hdr;
+	const EmuIndexDevice	*devices;
+	const EmuIndexEvent	*events;
+	const EmuIndexKey	*keys;
+	const uint32_t		*slots;
+	const uint32_t		*buckets;
+	const uint8_t		*data;
+	int			 mapped;
+} EmuIndex;
+
+/* building */
+int			 emu_index_build	(const EmuJson	*json,
+						 const char	*filename,
+						 EmuIndexBuildFlags flags,
+						 uint8_t	**buf,
+						 size_t		*len);
+int			 emu_index_build_sources(const EmuIndexDeviceSource *devices,
+						 uint32_t	 n_devices,
+						 const EmuIndexEventSource *events,
+						 uint32_t	 n_events,
+						 const char	*filename,
+						 EmuIndexBuildFlags flags,
+						 uint8_t	**buf,
+						 size_t		*len);
+int			 emu_index_save		(const uint8_t	*buf,
+						 size_t		 len,
+						 const char	*filename);
+
+/* loading, the buffer is owned and freed by emu_index_close() */
+int			 emu_index_open		(EmuIndex	*idx,
+						 const char	*filename);
+int			 emu_index_open_buffer	(EmuIndex	*idx,
+						 uint8_t	*buf,
+						 size_t		 len,
+						 const char	*filename);
+void			 emu_index_close	(EmuIndex	*idx);
+
+/* on failure the index is closed */
+int			 emu_index_share	(EmuIndex	*idx,
+						 EmuPayloadTable *table,
+						 const char	*filename);
+
+/* lookup */
+uint32_t		 emu_index_hash		(uint32_t	 device,
+						 const char	*id,
+						 size_t		 id_len);
+const EmuIndexKey	*emu_index_lookup_key	(const EmuIndex	*idx,
+						 uint32_t	 device,
+						 const char	*id,
+						 size_t		 id_len);
+const EmuIndexEvent	*emu_index_lookup	(const EmuIndex	*idx,
+						 uint32_t	 device,
+						 const char	*id,
+						 size_t		 id_len,
+						 uint32_t	*cursor);
+
+static inline const uint8_t *
+emu_index_data(const EmuIndex *idx, EmuIndexRef ref)
+{
+	return idx->data + ref.offset;
+}
+
+#endif /* __EMU_INDEX_H */
@@ -0,0 +1,723 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emu-json.h"
+
+/* deep enough for UsbInterfaces → UsbEndpoints, shallow enough for fuzzing */
+#define EMU_JSON_DEPTH_MAX		32
+
+static int
+emu_json_error(EmuJsonReader *p, const char *msg)
+{
+	fprintf(stderr, "%s:%zu: %s\n", p->filename, (size_t) (p->pos - p->buf), msg);
+	return -1;
+}
+
+static void
+emu_json_skip_ws(EmuJsonReader *p)
+{
+	while (p->pos < p->end &&
+	       (*p->pos == ' ' || *p->pos == '\t' || *p->pos == '\n' || *p->pos == '\r'))
+		p->pos++;
+}
+
+static int64_t
+emu_json_node_new(EmuJsonReader *p, EmuJsonType type)
+{
+	EmuJson *json = p->json;
+	if (json->n_nodes == json->n_alloc) {
+		uint32_t n_alloc = json->n_alloc ? json->n_alloc * 2 : 256;
+		EmuJsonNode *tmp = realloc(json->nodes, n_alloc * sizeof(EmuJsonNode));
+		if (tmp == NULL)
+			return emu_json_error(p, "out of memory");
+		json->nodes = tmp;
+		json->n_alloc = n_alloc;
+	}
+	memset(&json->nodes[json->n_nodes], 0, sizeof(EmuJsonNode));
+	json->nodes[json->n_nodes].type = type;
+	return json->n_nodes++;
+}
+
+static int
+emu_json_hex4(const char *s, unsigned *value)
+{
+	*value = 0;
+	for (unsigned i = 0; i < 4; i++) {
+		char c = s[i];
+		*value <<= 4;
+		if (c >= '0' && c <= '9')
+			*value |= c - '0';
+		else if (c >= 'a' && c <= 'f')
+			*value |= c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			*value |= c - 'A' + 10;
+		else
+			return -1;
+	}
+	return 0;
+}
+
+/* bytewise tests on eight bytes at once, from Bit Twiddling Hacks */
+#define EMU_JSON_ONES			0x0101010101010101ull
+#define EMU_JSON_HIGHS			0x8080808080808080ull
+
+static inline uint64_t
+emu_json_has_zero(uint64_t v)
+{
+	return (v - EMU_JSON_ONES) & ~v & EMU_JSON_HIGHS;
+}
+
+/* any byte below n, for n <= 128 */
+static inline uint64_t
+emu_json_has_less(uint64_t v, unsigned n)
+{
+	return (v - EMU_JSON_ONES * n) & ~v & EMU_JSON_HIGHS;
+}
+
+/* unescapes in place, the closing quote becomes the NUL terminator */
+static int
+emu_json_parse_string(EmuJsonReader *p, const char **str, size_t *len)
+{
+	char *out;
+
+	*str = ++p->pos;
+
+	/*
+	 * most strings have no escapes, so nothing moves until the first one;
+	 * skip eight plain bytes at a time while none is a quote, a backslash
+	 * or a control character
+	 */
+	while (p->end - p->pos >= 8) {
+		uint64_t v;
+		memcpy(&v, p->pos, sizeof(v));
+		if (emu_json_has_zero(v ^ (EMU_JSON_ONES * '"')) |
+		    emu_json_has_zero(v ^ (EMU_JSON_ONES * '\\')) |
+		    emu_json_has_less(v, 0x20))
+			break;
+		p->pos += 8;
+	}
+	while (p->pos < p->end) {
+		unsigned char c = *p->pos;
+		if (c == '"' || c == '\\' || c < 0x20)
+			break;
+		p->pos++;
+	}
+	out = p->pos;
+	while (p->pos < p->end) {
+		char c = *p->pos++;
+		if (c == '"') {
+			*len = out - *str;
+			*out = '\0';
+			return 0;
+		}
+		if ((unsigned char) c < 0x20)
+			return emu_json_error(p, "control character in string");
+		if (c != '\\') {
+			*out++ = c;
+			continue;
+		}
+		if (p->pos >= p->end)
+			break;
+		c = *p->pos++;
+		switch (c) {
+		case '"':
+		case '\\':
+		case '/':
+			*out++ = c;
+			break;
+		case 'b':
+			*out++ = '\b';
+			break;
+		case 'f':
+			*out++ = '\f';
+			break;
+		case 'n':
+			*out++ = '\n';
+			break;
+		case 'r':
+			*out++ = '\r';
+			break;
+		case 't':
+			*out++ = '\t';
+			break;
+		case 'u': {
+			unsigned cp;
+			if (p->end - p->pos < 4 || emu_json_hex4(p->pos, &cp) < 0)
+				return emu_json_error(p, "invalid \\u escape");
+			p->pos += 4;
+			/* surrogate pairs are not used by fwupd, keep them as-is */
+			if (cp < 0x80) {
+				*out++ = cp;
+			} else if (cp < 0x800) {
+				*out++ = 0xc0 | (cp >> 6);
+				*out++ = 0x80 | (cp & 0x3f);
+			} else {
+				*out++ = 0xe0 | (cp >> 12);
+				*out++ = 0x80 | ((cp >> 6) & 0x3f);
+				*out++ = 0x80 | (cp & 0x3f);
+			}
+			break;
+		}
+		default:
+			return emu_json_error(p, "invalid escape");
+		}
+	}
+	return emu_json_error(p, "unterminated string");
+}
+
+static int
+emu_json_parse_number(EmuJsonReader *p, int64_t *num)
+{
+	int negative = 0;
+	uint64_t value = 0;
+	char *start = p->pos;
+
+	if (*p->pos == '-') {
+		negative = 1;
+		p->pos++;
+	}
+	while (p->pos < p->end && *p->pos >= '0' && *p->pos <= '9') {
+		value = value * 10 + (*p->pos - '0');
+		p->pos++;
+	}
+	if (p->pos == start + negative)
+		return emu_json_error(p, "invalid number");
+
+	/* fractions and exponents are accepted but truncated */
+	if (p->pos < p->end && *p->pos == '.') {
+		p->pos++;
+		while (p->pos < p->end && *p->pos >= '0' && *p->pos <= '9')
+			p->pos++;
+	}
+	if (p->pos < p->end && (*p->pos == 'e' || *p->pos == 'E')) {
+		p->pos++;
+		if (p->pos < p->end && (*p->pos == '+' || *p->pos == '-'))
+			p->pos++;
+		while (p->pos < p->end && *p->pos >= '0' && *p->pos <= '9')
+			p->pos++;
+	}
+	*num = negative ? -(int64_t) value : (int64_t) value;
+	return 0;
+}
+
+static int
+emu_json_parse_literal(EmuJsonReader *p, const char *literal)
+{
+	size_t len = strlen(literal);
+	if ((size_t) (p->end - p->pos) < len || memcmp(p->pos, literal, len) != 0)
+		return emu_json_error(p, "invalid literal");
+	p->pos += len;
+	return 0;
+}
+
+static int64_t emu_json_parse_value(EmuJsonReader *p, unsigned depth);
+
+static int64_t
+emu_json_parse_container(EmuJsonReader *p, unsigned depth, EmuJsonType type)
+{
+	char close = type == EMU_JSON_OBJECT ? '}' : ']';
+	int64_t idx = emu_json_node_new(p, type);
+	int64_t last = -1;
+
+	if (idx < 0)
+		return -1;
+	if (depth >= EMU_JSON_DEPTH_MAX)
+		return emu_json_error(p, "nested too deeply");
+	p->pos++;
+	emu_json_skip_ws(p);
+	if (p->pos < p->end && *p->pos == close) {
+		p->pos++;
+		return idx;
+	}
+	for (;;) {
+		const char *key = NULL;
+		size_t key_len;
+		int64_t child;
+
+		emu_json_skip_ws(p);
+		if (type == EMU_JSON_OBJECT) {
+			if (p->pos >= p->end || *p->pos != '"')
+				return emu_json_error(p, "expected member name");
+			if (emu_json_parse_string(p, &key, &key_len) < 0)
+				return -1;
+			emu_json_skip_ws(p);
+			if (p->pos >= p->end || *p->pos != ':')
+				return emu_json_error(p, "expected ':'");
+			p->pos++;
+		}
+		child = emu_json_parse_value(p, depth + 1);
+		if (child < 0)
+			return -1;
+		p->json->nodes[child].key = key;
+		if (last < 0)
+			p->json->nodes[idx].child = child;
+		else
+			p->json->nodes[last].next = child;
+		p->json->nodes[idx].count++;
+		last = child;
+
+		emu_json_skip_ws(p);
+		if (p->pos >= p->end)
+			return emu_json_error(p, "unexpected end of document");
+		if (*p->pos == ',') {
+			p->pos++;
+			continue;
+		}
+		if (*p->pos == close) {
+			p->pos++;
+			return idx;
+		}
+		return emu_json_error(p, "expected ',' or end of container");
+	}
+}
+
+static int64_t
+emu_json_parse_value(EmuJsonReader *p, unsigned depth)
+{
+	int64_t idx;
+
+	emu_json_skip_ws(p);
+	if (p->pos >= p->end)
+		return emu_json_error(p, "unexpected end of document");
+	switch (*p->pos) {
+	case '{':
+		return emu_json_parse_container(p, depth, EMU_JSON_OBJECT);
+	case '[':
+		return emu_json_parse_container(p, depth, EMU_JSON_ARRAY);
+	case '"': {
+		const char *str;
+		size_t len;
+		idx = emu_json_node_new(p, EMU_JSON_STRING);
+		if (idx < 0 || emu_json_parse_string(p, &str, &len) < 0)
+			return -1;
+		p->json->nodes[idx].str = str;
+		p->json->nodes[idx].len = len;
+		return idx;
+	}
+	case 't':
+		idx = emu_json_node_new(p, EMU_JSON_TRUE);
+		if (idx < 0 || emu_json_parse_literal(p, "true") < 0)
+			return -1;
+		return idx;
+	case 'f':
+		idx = emu_json_node_new(p, EMU_JSON_FALSE);
+		if (idx < 0 || emu_json_parse_literal(p, "false") < 0)
+			return -1;
+		return idx;
+	case 'n':
+		idx = emu_json_node_new(p, EMU_JSON_NULL);
+		if (idx < 0 || emu_json_parse_literal(p, "null") < 0)
+			return -1;
+		return idx;
+	default: {
+		int64_t num;
+		idx = emu_json_node_new(p, EMU_JSON_NUMBER);
+		if (idx < 0 || emu_json_parse_number(p, &num) < 0)
+			return -1;
+		p->json->nodes[idx].num = num;
+		return idx;
+	}
+	}
+}
+
+int
+emu_json_parse(EmuJson *json, char *buf, size_t len, const char *filename)
+{
+	EmuJsonReader p;
+
+	emu_json_reader_init(&p, buf, len, filename);
+	p.json = json;
+	json->n_nodes = 0;
+	if (emu_json_parse_value(&p, 0) < 0)
+		return -1;
+	emu_json_skip_ws(&p);
+	if (p.pos != p.end)
+		return emu_json_error(&p, "trailing data after document");
+	return 0;
+}
+
+void
+emu_json_reader_init(EmuJsonReader *reader, char *buf, size_t len, const char *filename)
+{
+	memset(reader, 0, sizeof(EmuJsonReader));
+	reader->buf = buf;
+	reader->end = buf + len;
+	reader->pos = buf;
+	reader->filename = filename;
+}
+
+/* reports a problem at the current offset, always returns -1 */
+int
+emu_json_reader_error(EmuJsonReader *reader, const char *msg)
+{
+	return emu_json_error(reader, msg);
+}
+
+/* the type of the next value, or -1 at the end of the document */
+int
+emu_json_reader_peek(EmuJsonReader *reader)
+{
+	emu_json_skip_ws(reader);
+	if (reader->pos >= reader->end)
+		return -1;
+	switch (*reader->pos) {
+	case '{':
+		return EMU_JSON_OBJECT;
+	case '[':
+		return EMU_JSON_ARRAY;
+	case '"':
+		return EMU_JSON_STRING;
+	case 't':
+		return EMU_JSON_TRUE;
+	case 'f':
+		return EMU_JSON_FALSE;
+	case 'n':
+		return EMU_JSON_NULL;
+	default:
+		return EMU_JSON_NUMBER;
+	}
+}
+
+int
+emu_json_reader_enter(EmuJsonReader *reader, EmuJsonType type)
+{
+	if (emu_json_reader_peek(reader) != (int) type)
+		return emu_json_error(reader, type == EMU_JSON_OBJECT ? "expected an object" : "expected an array");
+	if (reader->depth >= EMU_JSON_DEPTH_MAX)
+		return emu_json_error(reader, "nested too deeply");
+	reader->pos++;
+	reader->depth++;
+	reader->first = 1;
+	return 0;
+}
+
+/*
+ * Moves to the next member of the innermost object, or element of the
+ * innermost array when key is NULL. Returns 1 with the reader at the value,
+ * 0 once the container has been closed, or -1 on error.
+ */
+int
+emu_json_reader_next(EmuJsonReader *reader, const char **key, size_t *key_len)
+{
+	char close = key != NULL ? '}' : ']';
+
+	emu_json_skip_ws(reader);
+	if (reader->pos >= reader->end)
+		return emu_json_error(reader, "unexpected end of document");
+	if (*reader->pos == close) {
+		reader->pos++;
+		reader->depth--;
+		reader->first = 0;
+		return 0;
+	}
+	if (!reader->first) {
+		if (*reader->pos != ',')
+			return emu_json_error(reader, "expected ',' or end of container");
+		reader->pos++;
+		emu_json_skip_ws(reader);
+	}
+	reader->first = 0;
+	if (key == NULL)
+		return 1;
+	if (reader->pos >= reader->end || *reader->pos != '"')
+		return emu_json_error(reader, "expected member name");
+	if (emu_json_parse_string(reader, key, key_len) < 0)
+		return -1;
+	emu_json_skip_ws(reader);
+	if (reader->pos >= reader->end || *reader->pos != ':')
+		return emu_json_error(reader, "expected ':'");
+	reader->pos++;
+	return 1;
+}
+
+int
+emu_json_reader_string(EmuJsonReader *reader, const char **str, size_t *len)
+{
+	if (emu_json_reader_peek(reader) != EMU_JSON_STRING)
+		return emu_json_error(reader, "expected a string");
+	return emu_json_parse_string(reader, str, len);
+}
+
+int
+emu_json_reader_number(EmuJsonReader *reader, int64_t *num)
+{
+	if (emu_json_reader_peek(reader) != EMU_JSON_NUMBER)
+		return emu_json_error(reader, "expected a number");
+	return emu_json_parse_number(reader, num);
+}
+
+static int
+emu_json_skip_value(EmuJsonReader *reader, unsigned depth)
+{
+	int type = emu_json_reader_peek(reader);
+
+	switch (type) {
+	case EMU_JSON_OBJECT:
+	case EMU_JSON_ARRAY: {
+		const char *key;
+		size_t key_len;
+		int rc;
+		if (depth >= EMU_JSON_DEPTH_MAX)
+			return emu_json_error(reader, "nested too deeply");
+		reader->pos++;
+		reader->first = 1;
+		while ((rc = emu_json_reader_next(reader, type == EMU_JSON_OBJECT ? &key : NULL, &key_len)) > 0) {
+			if (emu_json_skip_value(reader, depth + 1) < 0)
+				return -1;
+		}
+		/* emu_json_reader_next() closed a level this never entered */
+		reader->depth++;
+		return rc;
+	}
+	case EMU_JSON_STRING: {
+		const char *str;
+		size_t len;
+		return emu_json_parse_string(reader, &str, &len);
+	}
+	case EMU_JSON_TRUE:
+		return emu_json_parse_literal(reader, "true");
+	case EMU_JSON_FALSE:
+		return emu_json_parse_literal(reader, "false");
+	case EMU_JSON_NULL:
+		return emu_json_parse_literal(reader, "null");
+	case EMU_JSON_NUMBER: {
+		int64_t num;
+		return emu_json_parse_number(reader, &num);
+	}
+	default:
+		return emu_json_error(reader, "unexpected end of document");
+	}
+}
+
+/* skips the next value, checking it is well formed */
+int
+emu_json_reader_skip(EmuJsonReader *reader)
+{
+	int rc = emu_json_skip_value(reader, reader->depth);
+	reader->first = 0;
+	return rc;
+}
+
+/* checks nothing but whitespace follows the document */
+int
+emu_json_reader_end(EmuJsonReader *reader)
+{
+	emu_json_skip_ws(reader);
+	if (reader->depth != 0 || reader->pos != reader->end)
+		return emu_json_error(reader, "trailing data after document");
+	return 0;
+}
+
+void
+emu_json_clear(EmuJson *json)
+{
+	free(json->nodes);
+	memset(json, 0, sizeof(EmuJson));
+}
+
+const EmuJsonNode *
+emu_json_root(const EmuJson *json)
+{
+	return json->n_nodes > 0 ? &json->nodes[0] : NULL;
+}
+
+const EmuJsonNode *
+emu_json_first(const EmuJson *json, const EmuJsonNode *node)
+{
+	if (node == NULL || node->count == 0)
+		return NULL;
+	return &json->nodes[node->child];
+}
+
+const EmuJsonNode *
+emu_json_next(const EmuJson *json, const EmuJsonNode *node)
+{
+	if (node->next == 0)
+		return NULL;
+	return &json->nodes[node->next];
+}
+
+const EmuJsonNode *
+emu_json_member(const EmuJson *json, const EmuJsonNode *node, const char *key)
+{
+	if (node == NULL || node->type != EMU_JSON_OBJECT)
+		return NULL;
+	for (const EmuJsonNode *n = emu_json_first(json, node); n != NULL; n = emu_json_next(json, n)) {
+		if (strcmp(n->key, key) == 0)
+			return n;
+	}
+	return NULL;
+}
+
+const char *
+emu_json_member_str(const EmuJson *json, const EmuJsonNode *node, const char *key)
+{
+	const EmuJsonNode *n = emu_json_member(json, node, key);
+	if (n == NULL || n->type != EMU_JSON_STRING)
+		return NULL;
+	return n->str;
+}
+
+int64_t
+emu_json_member_int(const EmuJson *json, const EmuJsonNode *node, const char *key, int64_t fallback)
+{
+	const EmuJsonNode *n = emu_json_member(json, node, key);
+	if (n == NULL || n->type != EMU_JSON_NUMBER)
+		return fallback;
+	return n->num;
+}
+
+static int
+emu_json_write_indent(EmuJsonWriteFunc func, void *user_data, int indent)
+{
+	static const char spaces[] = "                                ";
+	while (indent > 0) {
+		int n = indent < (int) sizeof(spaces) - 1 ? indent : (int) sizeof(spaces) - 1;
+		if (func(spaces, n, user_data) < 0)
+			return -1;
+		indent -= n;
+	}
+	return 0;
+}
+
+int
+emu_json_write_string(EmuJsonWriteFunc func, void *user_data, const char *str, size_t len)
+{
+	size_t start = 0;
+
+	if (func("\"", 1, user_data) < 0)
+		return -1;
+	for (size_t i = 0; i < len; i++) {
+		uint8_t c = str[i];
+		char esc[7];
+		size_t esc_len = 2;
+
+		if (c >= 0x20 && c != '"' && c != '\\')
+			continue;
+		esc[0] = '\\';
+		switch (c) {
+		case '"':
+			esc[1] = '"';
+			break;
+		case '\\':
+			esc[1] = '\\';
+			break;
+		case '\b':
+			esc[1] = 'b';
+			break;
+		case '\f':
+			esc[1] = 'f';
+			break;
+		case '\n':
+			esc[1] = 'n';
+			break;
+		case '\r':
+			esc[1] = 'r';
+			break;
+		case '\t':
+			esc[1] = 't';
+			break;
+		default:
+			esc_len = snprintf(esc, sizeof(esc), "\\u%04x", c);
+			break;
+		}
+		if (func(str + start, i - start, user_data) < 0 ||
+		    func(esc, esc_len, user_data) < 0)
+			return -1;
+		start = i + 1;
+	}
+	if (func(str + start, len - start, user_data) < 0)
+		return -1;
+	return func("\"", 1, user_data);
+}
+
+static int
+emu_json_write_container(EmuJsonWriteFunc func, void *user_data,
+			 const EmuJson *json, const EmuJsonNode *node, int indent)
+{
+	int object = node->type == EMU_JSON_OBJECT;
+
+	if (func(object ? "{" : "[", 1, user_data) < 0)
+		return -1;
+	for (const EmuJsonNode *n = emu_json_first(json, node); n != NULL; n = emu_json_next(json, n)) {
+		if (n != emu_json_first(json, node) && func(",", 1, user_data) < 0)
+			return -1;
+		if (indent >= 0) {
+			if (func("\n", 1, user_data) < 0 ||
+			    emu_json_write_indent(func, user_data, indent + 2) < 0)
+				return -1;
+		}
+		if (object) {
+			if (emu_json_write_member(func, user_data, json, n, indent < 0 ? -1 : indent + 2) < 0)
+				return -1;
+		} else {
+			if (emu_json_write_value(func, user_data, json, n, indent < 0 ? -1 : indent + 2) < 0)
+				return -1;
+		}
+	}
+	if (indent >= 0 && node->count > 0) {
+		if (func("\n", 1, user_data) < 0 ||
+		    emu_json_write_indent(func, user_data, indent) < 0)
+			return -1;
+	}
+	return func(object ? "}" : "]", 1, user_data);
+}
+
+/* the value only, starting at the current position; indent is its level */
+int
+emu_json_write_value(EmuJsonWriteFunc func, void *user_data,
+		     const EmuJson *json, const EmuJsonNode *node, int indent)
+{
+	char buf[24];
+
+	switch (node->type) {
+	case EMU_JSON_NULL:
+		return func("null", 4, user_data);
+	case EMU_JSON_FALSE:
+		return func("false", 5, user_data);
+	case EMU_JSON_TRUE:
+		return func("true", 4, user_data);
+	case EMU_JSON_NUMBER:
+		return func(buf, snprintf(buf, sizeof(buf), "%lld", (long long) node->num), user_data);
+	case EMU_JSON_STRING:
+		return emu_json_write_string(func, user_data, node->str, node->len);
+	case EMU_JSON_ARRAY:
+	case EMU_JSON_OBJECT:
+		return emu_json_write_container(func, user_data, json, node, indent);
+	}
+	return -1;
+}
+
+/* "Key" : value for a member of an object */
+int
+emu_json_write_member(EmuJsonWriteFunc func, void *user_data,
+		      const EmuJson *json, const EmuJsonNode *node, int indent)
+{
+	if (emu_json_write_string(func, user_data, node->key, strlen(node->key)) < 0)
+		return -1;
+	if (func(indent >= 0 ? " : " : ":", indent >= 0 ? 3 : 1, user_data) < 0)
+		return -1;
+	return emu_json_write_value(func, user_data, json, node, indent);
+}
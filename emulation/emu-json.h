@@ -0,0 +1,145 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __EMU_JSON_H
+#define __EMU_JSON_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Minimal JSON reader for the fwupd emulation documents.
+ *
+ * The document is parsed in place: strings are unescaped inside the caller's
+ * buffer, which must stay alive and writable for as long as the tree is used.
+ * Nodes are stored in one array and linked by index, so walking the tree does
+ * not chase allocations.
+ *
+ * EmuJsonReader walks the same syntax without building a tree, for callers
+ * that only need a few values and want to skip the rest: containers are
+ * entered with emu_json_reader_enter() and iterated with
+ * emu_json_reader_next(), and any value can be skipped, which still checks
+ * that it is well formed.
+ *
+ * The writer produces the same layout as the json-glib generator fwupd uses,
+ * two spaces per level and " : " after member names, or with an indent of -1
+ * a compact document with no whitespace.
+ */
+
+typedef enum {
+	EMU_JSON_NULL,
+	EMU_JSON_FALSE,
+	EMU_JSON_TRUE,
+	EMU_JSON_NUMBER,
+	EMU_JSON_STRING,
+	EMU_JSON_ARRAY,
+	EMU_JSON_OBJECT
+} EmuJsonType;
+
+typedef struct {
+	EmuJsonType	 type;
+	uint32_t	 next;		/* next sibling, 0 for none */
+	uint32_t	 child;		/* first child of an array or object */
+	uint32_t	 count;		/* number of children */
+	const char	*key;		/* member name if the parent is an object */
+	const char	*str;		/* string value, NUL terminated */
+	size_t		 len;		/* string length in bytes */
+	int64_t		 num;		/* numbers are always integers here */
+} EmuJsonNode;
+
+typedef int (*EmuJsonWriteFunc)		(const char	*buf,
+						 size_t		 len,
+						 void		*user_data);
+
+typedef struct {
+	EmuJsonNode	*nodes;
+	uint32_t	 n_nodes;
+	uint32_t	 n_alloc;
+} EmuJson;
+
+typedef struct {
+	char		*buf;
+	char		*end;
+	char		*pos;
+	const char	*filename;
+	EmuJson		*json;		/* only while building a tree */
+	unsigned	 depth;
+	int		 first;		/* nothing read yet from the innermost container */
+} EmuJsonReader;
+
+int			 emu_json_parse		(EmuJson	*json,
+						 char		*buf,
+						 size_t		 len,
+						 const char	*filename);
+void			 emu_json_clear		(EmuJson	*json);
+
+const EmuJsonNode	*emu_json_root		(const EmuJson	*json);
+const EmuJsonNode	*emu_json_first		(const EmuJson	*json,
+						 const EmuJsonNode *node);
+const EmuJsonNode	*emu_json_next		(const EmuJson	*json,
+						 const EmuJsonNode *node);
+const EmuJsonNode	*emu_json_member	(const EmuJson	*json,
+						 const EmuJsonNode *node,
+						 const char	*key);
+const char		*emu_json_member_str	(const EmuJson	*json,
+						 const EmuJsonNode *node,
+						 const char	*key);
+int64_t			 emu_json_member_int	(const EmuJson	*json,
+						 const EmuJsonNode *node,
+						 const char	*key,
+						 int64_t	 fallback);
+
+void			 emu_json_reader_init	(EmuJsonReader	*reader,
+						 char		*buf,
+						 size_t		 len,
+						 const char	*filename);
+int			 emu_json_reader_error	(EmuJsonReader	*reader,
+						 const char	*msg);
+int			 emu_json_reader_peek	(EmuJsonReader	*reader);
+int			 emu_json_reader_enter	(EmuJsonReader	*reader,
+						 EmuJsonType	 type);
+int			 emu_json_reader_next	(EmuJsonReader	*reader,
+						 const char	**key,
+						 size_t		*key_len);
+int			 emu_json_reader_string	(EmuJsonReader	*reader,
+						 const char	**str,
+						 size_t		*len);
+int			 emu_json_reader_number	(EmuJsonReader	*reader,
+						 int64_t	*num);
+int			 emu_json_reader_skip	(EmuJsonReader	*reader);
+int			 emu_json_reader_end	(EmuJsonReader	*reader);
+
+int			 emu_json_write_string	(EmuJsonWriteFunc func,
+						 void		*user_data,
+						 const char	*str,
+						 size_t		 len);
+int			 emu_json_write_value	(EmuJsonWriteFunc func,
+						 void		*user_data,
+						 const EmuJson	*json,
+						 const EmuJsonNode *node,
+						 int		 indent);
+int			 emu_json_write_member	(EmuJsonWriteFunc func,
+						 void		*user_data,
+						 const EmuJson	*json,
+						 const EmuJsonNode *node,
+						 int		 indent);
+
+#endif /* __EMU_JSON_H */
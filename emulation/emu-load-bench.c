@@ -0,0 +1,161 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Compares the two ways of turning an emulation document into an index: the
+ * eager path parses a full JSON tree and builds the index from it, decoding
+ * every payload, while the loader validates the document against the schema
+ * in one streaming pass and leaves the payloads encoded until replay asks
+ * for them.
+ *
+ * The archive is inflated once up front and copied before every iteration,
+ * as both paths unescape the buffer in place, so only parsing and building
+ * are timed.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "emu-archive.h"
+#include "emu-index.h"
+#include "emu-json.h"
+#include "emu-loader.h"
+
+#define LOAD_ITERATIONS_DEFAULT		100
+
+static double
+load_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+load_archive(const char *filename, unsigned iterations, double *total_eager, double *total_lazy)
+{
+	const char *name = strrchr(filename, '/');
+	char *buf = NULL;
+	char *scratch;
+	size_t len = 0;
+	size_t eager_len = 0, lazy_len = 0, tree_len = 0;
+	double eager = 0, lazy = 0, start;
+	int rc = 0;
+
+	if (emu_archive_load(filename, &buf, &len) < 0)
+		return -1;
+	scratch = malloc(len + 1);
+	if (scratch == NULL) {
+		free(buf);
+		return -1;
+	}
+
+	for (unsigned i = 0; i < iterations && rc == 0; i++) {
+		EmuJson json = { 0 };
+		uint8_t *out = NULL;
+		size_t out_len = 0;
+
+		memcpy(scratch, buf, len + 1);
+		start = load_now();
+		if (emu_json_parse(&json, scratch, len, filename) < 0 ||
+		    emu_index_build(&json, filename, 0, &out, &out_len) < 0)
+			rc = -1;
+		eager += load_now() - start;
+		tree_len = json.n_alloc * sizeof(EmuJsonNode);
+		eager_len = out_len;
+		emu_json_clear(&json);
+		free(out);
+		if (rc < 0)
+			break;
+
+		out = NULL;
+		memcpy(scratch, buf, len + 1);
+		start = load_now();
+		if (emu_loader_build(scratch, len, filename, 0, &out, &out_len) < 0)
+			rc = -1;
+		lazy += load_now() - start;
+		lazy_len = out_len;
+		free(out);
+	}
+	if (rc == 0) {
+		printf("%-52s %9.1f %9.1f %6.2fx %8.1f %8.1f\n",
+		       name != NULL ? name + 1 : filename,
+		       eager * 1e6 / iterations, lazy * 1e6 / iterations, eager / lazy,
+		       (tree_len + eager_len) / 1024.0, lazy_len / 1024.0);
+		*total_eager += eager;
+		*total_lazy += lazy;
+	}
+	free(scratch);
+	free(buf);
+	return rc;
+}
+
+static void
+load_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [OPTION...] ARCHIVE...\n"
+		"  -n, --iterations=N       load every archive N times, default %u\n",
+		argv0, LOAD_ITERATIONS_DEFAULT);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct option options[] = {
+		{ "iterations",		required_argument, NULL, 'n' },
+		{ NULL, 0, NULL, 0 }
+	};
+	unsigned iterations = LOAD_ITERATIONS_DEFAULT;
+	double total_eager = 0, total_lazy = 0;
+	int rc = EXIT_SUCCESS;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "n:", options, NULL)) != -1) {
+		switch (opt) {
+		case 'n':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			load_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind >= argc || iterations == 0) {
+		load_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	printf("%-52s %9s %9s %7s %8s %8s\n",
+	       "archive", "eager us", "lazy us", "speedup", "eager KiB", "lazy KiB");
+	for (int i = optind; i < argc; i++) {
+		if (load_archive(argv[i], iterations, &total_eager, &total_lazy) < 0)
+			rc = EXIT_FAILURE;
+	}
+	if (total_lazy > 0) {
+		printf("total: eager %.3f s, lazy %.3f s, %.2fx\n",
+		       total_eager, total_lazy, total_eager / total_lazy);
+	}
+	return rc;
+}
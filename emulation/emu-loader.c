@@ -0,0 +1,495 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emu-archive.h"
+#include "emu-json.h"
+#include "emu-loader.h"
+
+typedef enum {
+	EMU_LOADER_FIELD_NONE,
+	EMU_LOADER_FIELD_GTYPE,
+	EMU_LOADER_FIELD_PLATFORM_ID,
+	EMU_LOADER_FIELD_BACKEND_ID,
+	EMU_LOADER_FIELD_ID_VENDOR,
+	EMU_LOADER_FIELD_ID_PRODUCT,
+	EMU_LOADER_FIELD_VENDOR,
+	EMU_LOADER_FIELD_MODEL,
+	EMU_LOADER_FIELD_USB_EVENTS,
+	EMU_LOADER_FIELD_UDEV_EVENTS,
+	EMU_LOADER_FIELD_EVENT_ID,
+	EMU_LOADER_FIELD_EVENT_DATA,
+	EMU_LOADER_FIELD_EVENT_DATA_OUT,
+	EMU_LOADER_FIELD_EVENT_ERROR,
+	EMU_LOADER_FIELD_EVENT_TIMESTAMP,
+	EMU_LOADER_FIELD_EVENT_DURATION,
+	EMU_LOADER_FIELD_DEVICES,
+} EmuLoaderField;
+
+typedef struct EmuLoaderObject EmuLoaderObject;
+
+typedef struct {
+	const char		*key;
+	EmuJsonType		 type;		/* STRING, NUMBER or ARRAY */
+	EmuJsonType		 element_type;	/* of an array */
+	const EmuLoaderObject	*element;	/* for arrays of objects */
+	EmuLoaderField		 field;
+} EmuLoaderMember;
+
+struct EmuLoaderObject {
+	const char		*name;
+	const EmuLoaderMember	*members;
+	int			 strict;	/* unknown members are errors */
+};
+
+#define S(key, field)		{ key, EMU_JSON_STRING, 0, NULL, field }
+#define N(key, field)		{ key, EMU_JSON_NUMBER, 0, NULL, field }
+#define A(key, type, field)	{ key, EMU_JSON_ARRAY, type, NULL, field }
+#define O(key, object, field)	{ key, EMU_JSON_ARRAY, EMU_JSON_OBJECT, &object, field }
+
+static const EmuLoaderMember emu_loader_endpoint_members[] = {
+	N("Length",			EMU_LOADER_FIELD_NONE),
+	N("DescriptorType",		EMU_LOADER_FIELD_NONE),
+	N("EndpointAddress",		EMU_LOADER_FIELD_NONE),
+	N("Attributes",			EMU_LOADER_FIELD_NONE),
+	N("MaxPacketSize",		EMU_LOADER_FIELD_NONE),
+	N("Interval",			EMU_LOADER_FIELD_NONE),
+	N("Refresh",			EMU_LOADER_FIELD_NONE),
+	N("SynchAddress",		EMU_LOADER_FIELD_NONE),
+	S("ExtraData",			EMU_LOADER_FIELD_NONE),
+	{ NULL }
+};
+static const EmuLoaderObject emu_loader_endpoint = { "UsbEndpoint", emu_loader_endpoint_members, 0 };
+
+static const EmuLoaderMember emu_loader_interface_members[] = {
+	N("Length",			EMU_LOADER_FIELD_NONE),
+	N("DescriptorType",		EMU_LOADER_FIELD_NONE),
+	N("InterfaceNumber",		EMU_LOADER_FIELD_NONE),
+	N("AlternateSetting",		EMU_LOADER_FIELD_NONE),
+	N("InterfaceClass",		EMU_LOADER_FIELD_NONE),
+	N("InterfaceSubClass",		EMU_LOADER_FIELD_NONE),
+	N("InterfaceProtocol",		EMU_LOADER_FIELD_NONE),
+	N("Interface",			EMU_LOADER_FIELD_NONE),
+	S("ExtraData",			EMU_LOADER_FIELD_NONE),
+	O("UsbEndpoints",		emu_loader_endpoint, EMU_LOADER_FIELD_NONE),
+	{ NULL }
+};
+static const EmuLoaderObject emu_loader_interface = { "UsbInterface", emu_loader_interface_members, 0 };
+
+static const EmuLoaderMember emu_loader_config_members[] = {
+	N("Configuration",		EMU_LOADER_FIELD_NONE),
+	N("ConfigurationValue",		EMU_LOADER_FIELD_NONE),
+	{ NULL }
+};
+static const EmuLoaderObject emu_loader_config = { "UsbConfigDescriptor", emu_loader_config_members, 0 };
+
+static const EmuLoaderMember emu_loader_bos_members[] = {
+	N("DevCapabilityType",		EMU_LOADER_FIELD_NONE),
+	S("ExtraData",			EMU_LOADER_FIELD_NONE),
+	{ NULL }
+};
+static const EmuLoaderObject emu_loader_bos = { "UsbBosDescriptor", emu_loader_bos_members, 0 };
+
+static const EmuLoaderMember emu_loader_event_members[] = {
+	S("Id",				EMU_LOADER_FIELD_EVENT_ID),
+	S("Data",			EMU_LOADER_FIELD_EVENT_DATA),
+	S("DataOut",			EMU_LOADER_FIELD_EVENT_DATA_OUT),
+	N("Error",			EMU_LOADER_FIELD_EVENT_ERROR),
+	N("Timestamp",			EMU_LOADER_FIELD_EVENT_TIMESTAMP),
+	N("Duration",			EMU_LOADER_FIELD_EVENT_DURATION),
+	{ NULL }
+};
+static const EmuLoaderObject emu_loader_event = { "event", emu_loader_event_members, 1 };
+
+static const EmuLoaderMember emu_loader_device_members[] = {
+	S("GType",			EMU_LOADER_FIELD_GTYPE),
+	S("PlatformId",			EMU_LOADER_FIELD_PLATFORM_ID),
+	S("BackendId",			EMU_LOADER_FIELD_BACKEND_ID),
+	S("Created",			EMU_LOADER_FIELD_NONE),
+	S("Subsystem",			EMU_LOADER_FIELD_NONE),
+	S("Driver",			EMU_LOADER_FIELD_NONE),
+	S("BindId",			EMU_LOADER_FIELD_NONE),
+	S("DeviceFile",			EMU_LOADER_FIELD_NONE),
+	N("IdVendor",			EMU_LOADER_FIELD_ID_VENDOR),
+	N("IdProduct",			EMU_LOADER_FIELD_ID_PRODUCT),
+	N("Vendor",			EMU_LOADER_FIELD_VENDOR),
+	N("Model",			EMU_LOADER_FIELD_MODEL),
+	N("Device",			EMU_LOADER_FIELD_NONE),
+	N("USB",			EMU_LOADER_FIELD_NONE),
+	N("Manufacturer",		EMU_LOADER_FIELD_NONE),
+	N("Product",			EMU_LOADER_FIELD_NONE),
+	N("SerialNumber",		EMU_LOADER_FIELD_NONE),
+	N("DeviceClass",		EMU_LOADER_FIELD_NONE),
+	N("DeviceSubClass",		EMU_LOADER_FIELD_NONE),
+	N("DeviceProtocol",		EMU_LOADER_FIELD_NONE),
+	O("UsbConfigDescriptors",	emu_loader_config, EMU_LOADER_FIELD_NONE),
+	O("UsbInterfaces",		emu_loader_interface, EMU_LOADER_FIELD_NONE),
+	O("UsbBosDescriptors",		emu_loader_bos, EMU_LOADER_FIELD_NONE),
+	A("UsbHidDescriptors",		EMU_JSON_STRING, EMU_LOADER_FIELD_NONE),
+	O("UsbEvents",			emu_loader_event, EMU_LOADER_FIELD_USB_EVENTS),
+	O("Events",			emu_loader_event, EMU_LOADER_FIELD_UDEV_EVENTS),
+	{ NULL }
+};
+static const EmuLoaderObject emu_loader_device = { "device", emu_loader_device_members, 0 };
+
+static const EmuLoaderMember emu_loader_root_members[] = {
+	O("UsbDevices",			emu_loader_device, EMU_LOADER_FIELD_DEVICES),
+	{ NULL }
+};
+static const EmuLoaderObject emu_loader_root = { "document", emu_loader_root_members, 0 };
+
+#undef S
+#undef N
+#undef A
+#undef O
+
+/* a device as read, before choosing between the USB and udev properties */
+typedef struct {
+	EmuIndexDeviceSource	 src;
+	int64_t			 ids[4];	/* IdVendor, IdProduct, Vendor, Model */
+	const char		*backend_id;
+	size_t			 backend_id_len;
+	int			 seen_events;
+} EmuLoaderDevice;
+
+typedef struct {
+	EmuJsonReader		 reader;
+	EmuLoaderDevice		*devices;
+	uint32_t		 n_devices;
+	uint32_t		 n_devices_alloc;
+	EmuIndexEventSource	*events;
+	uint32_t		 n_events;
+	uint32_t		 n_events_alloc;
+	int			 has_timestamp;
+	int			 has_duration;
+} EmuLoader;
+
+static int
+emu_loader_error(EmuLoader *loader, const char *object, const char *key, const char *msg)
+{
+	char buf[256];
+	snprintf(buf, sizeof(buf), "%s member %s %s", object, key, msg);
+	return emu_json_reader_error(&loader->reader, buf);
+}
+
+static int
+emu_loader_grow(void **array, uint32_t n, uint32_t *n_alloc, size_t size)
+{
+	uint32_t alloc;
+	void *tmp;
+
+	if (n < *n_alloc)
+		return 0;
+	alloc = *n_alloc ? *n_alloc * 2 : 64;
+	tmp = realloc(*array, (size_t) alloc * size);
+	if (tmp == NULL)
+		return -1;
+	memset((uint8_t *) tmp + (size_t) *n_alloc * size, 0, (size_t) (alloc - *n_alloc) * size);
+	*array = tmp;
+	*n_alloc = alloc;
+	return 0;
+}
+
+static int emu_loader_object(EmuLoader *loader, const EmuLoaderObject *object);
+
+/* starts whatever the elements of an array stand for */
+static int
+emu_loader_element_begin(EmuLoader *loader, EmuLoaderField field)
+{
+	switch (field) {
+	case EMU_LOADER_FIELD_DEVICES:
+		if (loader->n_devices == UINT32_MAX - 1 ||
+		    emu_loader_grow((void **) &loader->devices, loader->n_devices,
+				    &loader->n_devices_alloc, sizeof(EmuLoaderDevice)) < 0)
+			return -1;
+		memset(&loader->devices[loader->n_devices], 0, sizeof(EmuLoaderDevice));
+		for (unsigned i = 0; i < 4; i++)
+			loader->devices[loader->n_devices].ids[i] = -1;
+		loader->devices[loader->n_devices].src.first_event = loader->n_events;
+		loader->n_devices++;
+		return 0;
+	case EMU_LOADER_FIELD_USB_EVENTS:
+	case EMU_LOADER_FIELD_UDEV_EVENTS:
+		if (loader->n_events == UINT32_MAX - 1 ||
+		    emu_loader_grow((void **) &loader->events, loader->n_events,
+				    &loader->n_events_alloc, sizeof(EmuIndexEventSource)) < 0)
+			return -1;
+		memset(&loader->events[loader->n_events], 0, sizeof(EmuIndexEventSource));
+		loader->n_events++;
+		loader->has_timestamp = 0;
+		loader->has_duration = 0;
+		return 0;
+	default:
+		return 0;
+	}
+}
+
+static int
+emu_loader_element_end(EmuLoader *loader, EmuLoaderField field)
+{
+	EmuIndexEventSource *event;
+
+	if (field != EMU_LOADER_FIELD_USB_EVENTS && field != EMU_LOADER_FIELD_UDEV_EVENTS)
+		return 0;
+	event = &loader->events[loader->n_events - 1];
+	if (event->id == NULL || event->id_len == 0)
+		return emu_json_reader_error(&loader->reader, "event has no Id");
+	if (loader->has_timestamp && loader->has_duration)
+		event->flags |= EMU_INDEX_EVENT_FLAG_TIMING;
+	return 0;
+}
+
+static int
+emu_loader_array(EmuLoader *loader, const EmuLoaderObject *object, const EmuLoaderMember *member)
+{
+	EmuLoaderDevice *device = loader->n_devices > 0 ? &loader->devices[loader->n_devices - 1] : NULL;
+	int rc;
+
+	if (member->field == EMU_LOADER_FIELD_USB_EVENTS || member->field == EMU_LOADER_FIELD_UDEV_EVENTS) {
+		if (device->seen_events)
+			return emu_json_reader_error(&loader->reader, "device has both UsbEvents and Events");
+		device->seen_events = 1;
+		if (member->field == EMU_LOADER_FIELD_UDEV_EVENTS)
+			device->src.flags |= EMU_INDEX_DEVICE_FLAG_UDEV;
+	}
+	if (emu_json_reader_enter(&loader->reader, EMU_JSON_ARRAY) < 0)
+		return -1;
+	while ((rc = emu_json_reader_next(&loader->reader, NULL, NULL)) > 0) {
+		if (member->element != NULL) {
+			if (emu_loader_element_begin(loader, member->field) < 0 ||
+			    emu_loader_object(loader, member->element) < 0 ||
+			    emu_loader_element_end(loader, member->field) < 0)
+				return -1;
+		} else if (emu_json_reader_peek(&loader->reader) != (int) member->element_type) {
+			return emu_loader_error(loader, object->name, member->key, "has an element of the wrong type");
+		} else if (emu_json_reader_skip(&loader->reader) < 0) {
+			return -1;
+		}
+	}
+	if (rc == 0 && (member->field == EMU_LOADER_FIELD_USB_EVENTS ||
+			member->field == EMU_LOADER_FIELD_UDEV_EVENTS))
+		device->src.n_events = loader->n_events - device->src.first_event;
+	return rc;
+}
+
+static int
+emu_loader_string(EmuLoader *loader, EmuLoaderField field)
+{
+	EmuLoaderDevice *device = loader->n_devices > 0 ? &loader->devices[loader->n_devices - 1] : NULL;
+	EmuIndexEventSource *event = loader->n_events > 0 ? &loader->events[loader->n_events - 1] : NULL;
+	const char *str;
+	size_t len;
+
+	if (emu_json_reader_string(&loader->reader, &str, &len) < 0)
+		return -1;
+	switch (field) {
+	case EMU_LOADER_FIELD_GTYPE:
+		device->src.gtype = str;
+		device->src.gtype_len = len;
+		break;
+	case EMU_LOADER_FIELD_PLATFORM_ID:
+		device->src.platform_id = str;
+		device->src.platform_id_len = len;
+		break;
+	case EMU_LOADER_FIELD_BACKEND_ID:
+		device->backend_id = str;
+		device->backend_id_len = len;
+		break;
+	case EMU_LOADER_FIELD_EVENT_ID:
+		event->id = str;
+		event->id_len = len;
+		break;
+	case EMU_LOADER_FIELD_EVENT_DATA:
+		event->data = str;
+		event->data_len = len;
+		break;
+	case EMU_LOADER_FIELD_EVENT_DATA_OUT:
+		event->data_out = str;
+		event->data_out_len = len;
+		break;
+	default:
+		break;
+	}
+	return 0;
+}
+
+static int
+emu_loader_number(EmuLoader *loader, const EmuLoaderObject *object, const EmuLoaderMember *member)
+{
+	EmuLoaderDevice *device = loader->n_devices > 0 ? &loader->devices[loader->n_devices - 1] : NULL;
+	EmuIndexEventSource *event = loader->n_events > 0 ? &loader->events[loader->n_events - 1] : NULL;
+	int64_t num;
+
+	if (emu_json_reader_number(&loader->reader, &num) < 0)
+		return -1;
+	switch (member->field) {
+	case EMU_LOADER_FIELD_ID_VENDOR:
+	case EMU_LOADER_FIELD_ID_PRODUCT:
+	case EMU_LOADER_FIELD_VENDOR:
+	case EMU_LOADER_FIELD_MODEL:
+		if (num < 0 || num > 0xffff)
+			return emu_loader_error(loader, object->name, member->key, "is out of range");
+		device->ids[member->field - EMU_LOADER_FIELD_ID_VENDOR] = num;
+		break;
+	case EMU_LOADER_FIELD_EVENT_ERROR:
+		if (num < INT32_MIN || num > INT32_MAX)
+			return emu_loader_error(loader, object->name, member->key, "is out of range");
+		event->flags |= EMU_INDEX_EVENT_FLAG_ERROR;
+		event->error = num;
+		break;
+	case EMU_LOADER_FIELD_EVENT_TIMESTAMP:
+		if (num < 0)
+			return emu_loader_error(loader, object->name, member->key, "is out of range");
+		event->timestamp_us = num;
+		loader->has_timestamp = 1;
+		break;
+	case EMU_LOADER_FIELD_EVENT_DURATION:
+		if (num < 0 || num > UINT32_MAX)
+			return emu_loader_error(loader, object->name, member->key, "is out of range");
+		event->duration_us = num;
+		loader->has_duration = 1;
+		break;
+	default:
+		break;
+	}
+	return 0;
+}
+
+static int
+emu_loader_object(EmuLoader *loader, const EmuLoaderObject *object)
+{
+	uint64_t seen = 0;
+	const char *key;
+	size_t key_len;
+	int rc;
+
+	if (emu_json_reader_enter(&loader->reader, EMU_JSON_OBJECT) < 0)
+		return -1;
+	while ((rc = emu_json_reader_next(&loader->reader, &key, &key_len)) > 0) {
+		const EmuLoaderMember *member = NULL;
+		unsigned i;
+
+		for (i = 0; object->members[i].key != NULL; i++) {
+			if (strlen(object->members[i].key) == key_len &&
+			    memcmp(object->members[i].key, key, key_len) == 0) {
+				member = &object->members[i];
+				break;
+			}
+		}
+		if (member == NULL) {
+			if (object->strict)
+				return emu_loader_error(loader, object->name, key, "is not known");
+			if (emu_json_reader_skip(&loader->reader) < 0)
+				return -1;
+			continue;
+		}
+		if (seen & (1ull << i))
+			return emu_loader_error(loader, object->name, key, "is repeated");
+		seen |= 1ull << i;
+		if (emu_json_reader_peek(&loader->reader) != (int) member->type) {
+			return emu_loader_error(loader, object->name, key,
+						member->type == EMU_JSON_STRING ? "is not a string" :
+						member->type == EMU_JSON_NUMBER ? "is not a number" :
+						"is not an array");
+		}
+		switch (member->type) {
+		case EMU_JSON_STRING:
+			rc = emu_loader_string(loader, member->field);
+			break;
+		case EMU_JSON_NUMBER:
+			rc = emu_loader_number(loader, object, member);
+			break;
+		default:
+			rc = emu_loader_array(loader, object, member);
+			break;
+		}
+		if (rc < 0)
+			return -1;
+	}
+	return rc;
+}
+
+int
+emu_loader_build(char *buf, size_t len, const char *filename, EmuIndexBuildFlags flags,
+		 uint8_t **out, size_t *out_len)
+{
+	EmuLoader loader = { 0 };
+	EmuIndexDeviceSource *devices = NULL;
+	int rc = -1;
+
+	emu_json_reader_init(&loader.reader, buf, len, filename);
+	if (emu_loader_object(&loader, &emu_loader_root) < 0 ||
+	    emu_json_reader_end(&loader.reader) < 0)
+		goto out;
+	if (loader.n_devices == 0) {
+		fprintf(stderr, "%s: no UsbDevices\n", filename);
+		goto out;
+	}
+
+	/* udev devices describe themselves with Vendor and Model */
+	devices = calloc(loader.n_devices, sizeof(EmuIndexDeviceSource));
+	if (devices == NULL)
+		goto out;
+	for (uint32_t i = 0; i < loader.n_devices; i++) {
+		EmuLoaderDevice *device = &loader.devices[i];
+		unsigned first = device->src.flags & EMU_INDEX_DEVICE_FLAG_UDEV ? 2 : 0;
+		devices[i] = device->src;
+		if (devices[i].platform_id == NULL) {
+			devices[i].platform_id = device->backend_id;
+			devices[i].platform_id_len = device->backend_id_len;
+		}
+		devices[i].vid = device->ids[first] >= 0 ? device->ids[first] : 0;
+		devices[i].pid = device->ids[first + 1] >= 0 ? device->ids[first + 1] : 0;
+	}
+	rc = emu_index_build_sources(devices, loader.n_devices, loader.events, loader.n_events,
+				     filename, flags | EMU_INDEX_BUILD_FLAG_LAZY, out, out_len);
+out:
+	free(devices);
+	free(loader.devices);
+	free(loader.events);
+	return rc;
+}
+
+/* loads a zip archive or setup.json, the text is freed once indexed */
+int
+emu_loader_open(EmuIndex *idx, const char *filename, EmuIndexBuildFlags flags)
+{
+	char *buf;
+	uint8_t *out;
+	size_t len;
+	size_t out_len;
+	int rc;
+
+	if (emu_archive_load(filename, &buf, &len) < 0)
+		return -1;
+	rc = emu_loader_build(buf, len, filename, flags, &out, &out_len);
+	free(buf);
+	if (rc < 0)
+		return -1;
+	if (emu_index_open_buffer(idx, out, out_len, filename) < 0) {
+		free(out);
+		return -1;
+	}
+	return 0;
+}
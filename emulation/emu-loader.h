@@ -0,0 +1,55 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __EMU_LOADER_H
+#define __EMU_LOADER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "emu-index.h"
+
+/*
+ * Streaming loader for emulation setup.json documents.
+ *
+ * One pass over the text checks every device, descriptor and event against
+ * the schema fwupd writes and collects only what replay needs: the Ids and
+ * payloads of the events and a few device properties. The descriptor trees
+ * are checked and skipped, no tree is built, and the payloads are indexed
+ * with EMU_INDEX_BUILD_FLAG_LAZY so they are decoded only when requested.
+ *
+ * Unknown members of devices and descriptors are skipped, as fwupd adds
+ * properties over time, but events may only have the members replay knows.
+ *
+ * The buffer is unescaped in place, as with emu_json_parse().
+ */
+
+int		 emu_loader_build		(char		*buf,
+						 size_t		 len,
+						 const char	*filename,
+						 EmuIndexBuildFlags flags,
+						 uint8_t	**out,
+						 size_t		*out_len);
+int		 emu_loader_open		(EmuIndex	*idx,
+						 const char	*filename,
+						 EmuIndexBuildFlags flags);
+
+#endif /* __EMU_LOADER_H */
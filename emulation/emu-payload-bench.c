@@ -0,0 +1,121 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Loads many emulation archives at once, as a test rig emulating lots of
+ * devices would, and reports the memory they hold. With --share every index
+ * moves its Ids and payloads into one EmuPayloadTable, so identical
+ * payloads are held once whichever archive and copy they came from.
+ *
+ * Run once with and once without --share to compare; the peak RSS is only
+ * meaningful for a single mode per process.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include "emu-replay.h"
+
+static void
+payload_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [OPTION...] ARCHIVE|INDEX...\n"
+		"  -n, --copies=N           load every archive N times, default 1\n"
+		"  -s, --share              share identical payloads between indexes\n",
+		argv0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct option options[] = {
+		{ "copies",		required_argument, NULL, 'n' },
+		{ "share",		no_argument, NULL, 's' },
+		{ NULL, 0, NULL, 0 }
+	};
+	EmuPayloadTable table = { 0 };
+	EmuReplay *replays;
+	struct rusage usage;
+	unsigned copies = 1;
+	unsigned n_replays;
+	uint64_t n_events = 0;
+	uint64_t index_bytes = 0;
+	uint64_t data_bytes = 0;
+	int share = 0;
+	int rc = EXIT_SUCCESS;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "n:s", options, NULL)) != -1) {
+		switch (opt) {
+		case 'n':
+			copies = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			share = 1;
+			break;
+		default:
+			payload_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind >= argc || copies == 0) {
+		payload_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (share && emu_payload_table_init(&table) < 0)
+		return EXIT_FAILURE;
+
+	n_replays = (argc - optind) * copies;
+	replays = calloc(n_replays, sizeof(EmuReplay));
+	if (replays == NULL)
+		return EXIT_FAILURE;
+	for (unsigned i = 0; i < n_replays; i++) {
+		const char *filename = argv[optind + i % (argc - optind)];
+		if (emu_replay_open_with_table(&replays[i], filename, share ? &table : NULL) < 0) {
+			rc = EXIT_FAILURE;
+			continue;
+		}
+		n_events += replays[i].idx.hdr->n_events;
+		index_bytes += replays[i].idx.len - replays[i].idx.hdr->data_size;
+		data_bytes += replays[i].idx.hdr->data_size;
+	}
+	if (share)
+		data_bytes = table.len;
+	getrusage(RUSAGE_SELF, &usage);
+
+	printf("%u indexes, %lu events\n", n_replays, (unsigned long) n_events);
+	printf("tables: %.1f KiB, data: %.1f KiB, peak RSS %ld KiB\n",
+	       index_bytes / 1024.0, data_bytes / 1024.0, usage.ru_maxrss);
+	if (share) {
+		printf("%lu payloads of %.1f KiB interned into %u unique of %.1f KiB\n",
+		       (unsigned long) table.n_interned, table.bytes_interned / 1024.0,
+		       table.n_slots, table.len / 1024.0);
+	}
+
+	for (unsigned i = 0; i < n_replays; i++)
+		emu_replay_close(&replays[i]);
+	free(replays);
+	emu_payload_table_clear(&table);
+	return rc;
+}
@@ -0,0 +1,127 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "emu-payload.h"
+
+/* the most a 32 bit offset can address */
+#define EMU_PAYLOAD_TABLE_RESERVE	(sizeof(size_t) > 4 ? (size_t) UINT32_MAX : (size_t) 256 << 20)
+
+int
+emu_payload_table_init(EmuPayloadTable *table)
+{
+	void *map;
+
+	memset(table, 0, sizeof(EmuPayloadTable));
+	map = mmap(NULL, EMU_PAYLOAD_TABLE_RESERVE, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (map == MAP_FAILED) {
+		perror("failed to reserve payload table");
+		return -1;
+	}
+	table->buf = map;
+	table->reserved = EMU_PAYLOAD_TABLE_RESERVE;
+	return 0;
+}
+
+void
+emu_payload_table_clear(EmuPayloadTable *table)
+{
+	if (table->buf != NULL)
+		munmap(table->buf, table->reserved);
+	free(table->slots);
+	memset(table, 0, sizeof(EmuPayloadTable));
+}
+
+static uint32_t
+emu_payload_hash(const uint8_t *data, size_t len)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static int
+emu_payload_table_grow(EmuPayloadTable *table)
+{
+	uint32_t n_alloc = table->n_slots_alloc ? table->n_slots_alloc * 2 : 1024;
+	uint64_t *tmp = calloc(n_alloc, sizeof(uint64_t));
+
+	if (tmp == NULL)
+		return -1;
+	for (uint32_t j = 0; j < table->n_slots_alloc; j++) {
+		uint64_t slot = table->slots[j];
+		uint32_t i;
+		if (slot == 0)
+			continue;
+		i = emu_payload_hash(table->buf + (slot >> 32), (uint32_t) slot) & (n_alloc - 1);
+		while (tmp[i] != 0)
+			i = (i + 1) & (n_alloc - 1);
+		tmp[i] = slot;
+	}
+	free(table->slots);
+	table->slots = tmp;
+	table->n_slots_alloc = n_alloc;
+	return 0;
+}
+
+int
+emu_payload_table_intern(EmuPayloadTable *table, const void *data, size_t len, uint32_t *offset)
+{
+	uint32_t mask;
+	uint32_t i;
+
+	table->n_interned++;
+	table->bytes_interned += len;
+	if (len == 0) {
+		*offset = 0;
+		return 0;
+	}
+
+	/* keep the table at most half full */
+	if ((table->n_slots + 1) * 2 > table->n_slots_alloc && emu_payload_table_grow(table) < 0)
+		return -1;
+	mask = table->n_slots_alloc - 1;
+	for (i = emu_payload_hash(data, len) & mask; table->slots[i] != 0; i = (i + 1) & mask) {
+		uint64_t slot = table->slots[i];
+		if ((uint32_t) slot == len && memcmp(table->buf + (slot >> 32), data, len) == 0) {
+			*offset = slot >> 32;
+			return 0;
+		}
+	}
+	if (len > table->reserved - table->len) {
+		fprintf(stderr, "payload table is full\n");
+		return -1;
+	}
+	memcpy(table->buf + table->len, data, len);
+	*offset = table->len;
+	table->slots[i] = (uint64_t) table->len << 32 | len;
+	table->n_slots++;
+	table->len += len;
+	return 0;
+}
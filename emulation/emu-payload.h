@@ -0,0 +1,56 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __EMU_PAYLOAD_H
+#define __EMU_PAYLOAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Content addressed payload table.
+ *
+ * Interning a payload returns the offset of the first identical payload
+ * already in the table, or appends a new copy. The whole address range is
+ * reserved up front and only touched pages are backed by memory, so the
+ * table never moves and indexes loaded at different times can point into
+ * it. Offsets are 32 bit, like the rest of the index.
+ */
+
+typedef struct {
+	uint8_t		*buf;
+	size_t		 len;
+	size_t		 reserved;
+	uint64_t	*slots;		/* offset << 32 | len, 0 = empty */
+	uint32_t	 n_slots;
+	uint32_t	 n_slots_alloc;	/* power of two */
+	uint64_t	 n_interned;	/* payloads offered */
+	uint64_t	 bytes_interned;
+} EmuPayloadTable;
+
+int		 emu_payload_table_init		(EmuPayloadTable *table);
+void		 emu_payload_table_clear	(EmuPayloadTable *table);
+int		 emu_payload_table_intern	(EmuPayloadTable *table,
+						 const void	*data,
+						 size_t		 len,
+						 uint32_t	*offset);
+
+#endif /* __EMU_PAYLOAD_H */
@@ -0,0 +1,252 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Records an emulation archive into an event log, optionally repeating its
+ * events many times to stand in for a long flashing session, and reports
+ * the recording rate and peak memory use.
+ *
+ * The log can then be compacted with emu-finalise; with one repetition the
+ * result is identical to the original setup.json.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "emu-archive.h"
+#include "emu-index.h"
+#include "emu-json.h"
+#include "emu-record.h"
+
+typedef struct {
+	char		*buf;
+	size_t		 len;
+	size_t		 alloc;
+} RecordBuf;
+
+static int
+record_buf_write(const char *buf, size_t len, void *user_data)
+{
+	RecordBuf *b = user_data;
+	if (b->len + len > b->alloc) {
+		size_t alloc = b->alloc ? b->alloc : 1024;
+		char *tmp;
+		while (alloc < b->len + len)
+			alloc *= 2;
+		tmp = realloc(b->buf, alloc);
+		if (tmp == NULL)
+			return -1;
+		b->buf = tmp;
+		b->alloc = alloc;
+	}
+	memcpy(b->buf + b->len, buf, len);
+	b->len += len;
+	return 0;
+}
+
+static double
+record_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* the device as compact JSON, without its events */
+static int
+record_add_devices(EmuRecorder *rec, const EmuJson *json)
+{
+	const EmuJsonNode *devices = emu_json_member(json, emu_json_root(json), "UsbDevices");
+	RecordBuf b = { 0 };
+
+	for (const EmuJsonNode *d = emu_json_first(json, devices); d != NULL; d = emu_json_next(json, d)) {
+		uint32_t flags = 0;
+		int first = 1;
+
+		b.len = 0;
+		if (record_buf_write("{", 1, &b) < 0)
+			goto fail;
+		for (const EmuJsonNode *n = emu_json_first(json, d); n != NULL; n = emu_json_next(json, n)) {
+			if (strcmp(n->key, "UsbEvents") == 0)
+				continue;
+			if (strcmp(n->key, "Events") == 0) {
+				flags |= EMU_RECORD_DEVICE_FLAG_UDEV;
+				continue;
+			}
+			if ((!first && record_buf_write(",", 1, &b) < 0) ||
+			    emu_json_write_member(record_buf_write, &b, json, n, -1) < 0)
+				goto fail;
+			first = 0;
+		}
+		if (record_buf_write("}", 1, &b) < 0 ||
+		    emu_recorder_add_device(rec, b.buf, b.len, flags) < 0)
+			goto fail;
+	}
+	free(b.buf);
+	return 0;
+fail:
+	free(b.buf);
+	return -1;
+}
+
+/*
+ * Recorded timing is carried over, each repetition starting where the last
+ * one ended; without it every event can be given a fixed latency instead.
+ */
+static int
+record_add_events(EmuRecorder *rec, const EmuIndex *idx, uint64_t *clock_us, uint32_t latency_us)
+{
+	for (uint32_t d = 0; d < idx->hdr->n_devices; d++) {
+		const EmuIndexDevice *device = &idx->devices[d];
+		uint64_t base_us = clock_us[d];
+		for (uint32_t i = device->first_event; i < device->first_event + device->n_events; i++) {
+			const EmuIndexEvent *event = &idx->events[i];
+			const EmuIndexKey *key = &idx->keys[event->key];
+			EmuRecord record = {
+				.type = EMU_RECORD_TYPE_EVENT,
+				.device = d,
+				.flags = event->flags,
+				.error = event->error,
+				.id = (const char *) emu_index_data(idx, key->id),
+				.id_len = key->id.len,
+				.data = emu_index_data(idx, event->data),
+				.data_len = event->data.len,
+				.data_out = emu_index_data(idx, event->data_out),
+				.data_out_len = event->data_out.len,
+			};
+			if (event->flags & EMU_INDEX_EVENT_FLAG_TIMING) {
+				record.timestamp_us = base_us + event->timestamp_us;
+				record.duration_us = event->duration_us;
+			} else if (latency_us > 0) {
+				record.flags |= EMU_RECORD_EVENT_FLAG_TIMING;
+				record.timestamp_us = clock_us[d];
+				record.duration_us = latency_us;
+			}
+			if ((record.flags & EMU_RECORD_EVENT_FLAG_TIMING) &&
+			    record.timestamp_us + record.duration_us > clock_us[d])
+				clock_us[d] = record.timestamp_us + record.duration_us;
+			if (emu_recorder_add_event(rec, &record) < 0)
+				return -1;
+		}
+	}
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct option options[] = {
+		{ "repeat",		required_argument, NULL, 'n' },
+		{ "chunk-size",		required_argument, NULL, 's' },
+		{ "sync",		no_argument, NULL, 'S' },
+		{ "latency",		required_argument, NULL, 'l' },
+		{ NULL, 0, NULL, 0 }
+	};
+	EmuRecorder rec;
+	EmuJson json = { 0 };
+	EmuIndex idx;
+	struct rusage usage;
+	unsigned long repeat = 1;
+	size_t chunk_size = EMU_RECORD_CHUNK_SIZE_DEFAULT;
+	uint32_t latency_us = 0;
+	uint64_t *clock_us;
+	uint8_t *out;
+	size_t out_len;
+	char *buf;
+	size_t len;
+	double start, elapsed;
+	int sync = 0;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "n:s:Sl:", options, NULL)) != -1) {
+		switch (opt) {
+		case 'n':
+			repeat = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			chunk_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'S':
+			sync = 1;
+			break;
+		case 'l':
+			latency_us = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (argc - optind != 2 || repeat == 0)
+		goto usage;
+
+	if (emu_archive_load(argv[optind], &buf, &len) < 0)
+		return EXIT_FAILURE;
+	if (emu_json_parse(&json, buf, len, argv[optind]) < 0 ||
+	    emu_index_build(&json, argv[optind], EMU_INDEX_BUILD_FLAG_NONE, &out, &out_len) < 0 ||
+	    emu_index_open_buffer(&idx, out, out_len, argv[optind]) < 0)
+		return EXIT_FAILURE;
+
+	clock_us = calloc(idx.hdr->n_devices + 1, sizeof(uint64_t));
+	if (clock_us == NULL)
+		return EXIT_FAILURE;
+	if (emu_recorder_open(&rec, argv[optind + 1], chunk_size, sync) < 0)
+		return EXIT_FAILURE;
+	if (rec.n_devices > 0) {
+		fprintf(stderr, "%s: already has devices, not appending\n", argv[optind + 1]);
+		return EXIT_FAILURE;
+	}
+	start = record_now();
+	if (record_add_devices(&rec, &json) < 0)
+		return EXIT_FAILURE;
+	for (unsigned long i = 0; i < repeat; i++) {
+		if (record_add_events(&rec, &idx, clock_us, latency_us) < 0)
+			return EXIT_FAILURE;
+	}
+	if (emu_recorder_flush(&rec) < 0)
+		return EXIT_FAILURE;
+	elapsed = record_now() - start;
+
+	getrusage(RUSAGE_SELF, &usage);
+	printf("%lu events, %.1f MiB in %.3fs: %.0f events/s, %.1f MiB/s, peak RSS %ld KiB\n",
+	       (unsigned long) idx.hdr->n_events * repeat, rec.bytes_written / 1048576.0, elapsed,
+	       idx.hdr->n_events * repeat / elapsed, rec.bytes_written / 1048576.0 / elapsed,
+	       usage.ru_maxrss);
+	if (emu_recorder_close(&rec) < 0)
+		return EXIT_FAILURE;
+	free(clock_us);
+	emu_index_close(&idx);
+	emu_json_clear(&json);
+	free(buf);
+	return EXIT_SUCCESS;
+usage:
+	fprintf(stderr,
+		"Usage: %s [OPTION...] ARCHIVE LOG\n"
+		"  -n, --repeat=N           record the events N times, default 1\n"
+		"  -s, --chunk-size=BYTES   chunk size, default %u\n"
+		"  -S, --sync               fdatasync() after every chunk\n"
+		"  -l, --latency=USEC       time events without recorded timing\n",
+		argv[0], EMU_RECORD_CHUNK_SIZE_DEFAULT);
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,408 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "emu-record.h"
+
+#define EMU_RECORD_RECORD_HEADER_SIZE	8
+#define EMU_RECORD_DEVICE_SIZE		8
+#define EMU_RECORD_EVENT_SIZE		40
+#define EMU_RECORD_EVENT_SIZE_V1	24
+/* anything larger is corruption rather than a real chunk */
+#define EMU_RECORD_CHUNK_SIZE_MAX	(256 * 1024 * 1024)
+
+static uint32_t
+emu_record_get_u32(const uint8_t *buf)
+{
+	return buf[0] | ((uint32_t) buf[1] << 8) | ((uint32_t) buf[2] << 16) | ((uint32_t) buf[3] << 24);
+}
+
+static void
+emu_record_set_u32(uint8_t *buf, uint32_t value)
+{
+	buf[0] = value;
+	buf[1] = value >> 8;
+	buf[2] = value >> 16;
+	buf[3] = value >> 24;
+}
+
+static uint64_t
+emu_record_get_u64(const uint8_t *buf)
+{
+	return emu_record_get_u32(buf) | ((uint64_t) emu_record_get_u32(buf + 4) << 32);
+}
+
+static void
+emu_record_set_u64(uint8_t *buf, uint64_t value)
+{
+	emu_record_set_u32(buf, value);
+	emu_record_set_u32(buf + 4, value >> 32);
+}
+
+static int
+emu_record_write_all(int fd, const struct iovec *iov, int iovcnt, size_t len)
+{
+	ssize_t rc = writev(fd, iov, iovcnt);
+	return rc == (ssize_t) len ? 0 : -1;
+}
+
+int
+emu_recorder_flush(EmuRecorder *rec)
+{
+	uint8_t hdr[EMU_RECORD_CHUNK_HEADER_SIZE];
+	struct iovec iov[2];
+
+	if (rec->n_records == 0)
+		return 0;
+	emu_record_set_u32(hdr, EMU_RECORD_CHUNK_MAGIC);
+	emu_record_set_u32(hdr + 4, rec->chunk_len);
+	emu_record_set_u32(hdr + 8, crc32(0, rec->chunk, rec->chunk_len));
+	emu_record_set_u32(hdr + 12, rec->n_records);
+	iov[0].iov_base = hdr;
+	iov[0].iov_len = sizeof(hdr);
+	iov[1].iov_base = rec->chunk;
+	iov[1].iov_len = rec->chunk_len;
+	if (emu_record_write_all(rec->fd, iov, 2, sizeof(hdr) + rec->chunk_len) < 0 ||
+	    (rec->sync && fdatasync(rec->fd) < 0)) {
+		fprintf(stderr, "%s: %s\n", rec->filename, strerror(errno));
+		return -1;
+	}
+	rec->bytes_written += sizeof(hdr) + rec->chunk_len;
+	rec->chunk_len = 0;
+	rec->n_records = 0;
+
+	/* give back an oversized chunk */
+	if (rec->chunk_size < EMU_RECORD_CHUNK_SIZE_MAX) {
+		uint8_t *tmp = realloc(rec->chunk, rec->chunk_size);
+		if (tmp != NULL)
+			rec->chunk = tmp;
+	}
+	return 0;
+}
+
+/* returns where the record body goes, flushing the chunk if it is full */
+static uint8_t *
+emu_recorder_reserve(EmuRecorder *rec, EmuRecordType type, size_t body_len)
+{
+	size_t len = EMU_RECORD_RECORD_HEADER_SIZE + body_len;
+	uint8_t *p;
+
+	if (len > EMU_RECORD_CHUNK_SIZE_MAX)
+		return NULL;
+	if (rec->chunk_len + len > rec->chunk_size && emu_recorder_flush(rec) < 0)
+		return NULL;
+	if (len > rec->chunk_size) {
+		uint8_t *tmp = realloc(rec->chunk, len);
+		if (tmp == NULL)
+			return NULL;
+		rec->chunk = tmp;
+	}
+	p = rec->chunk + rec->chunk_len;
+	memset(p, 0, EMU_RECORD_RECORD_HEADER_SIZE);
+	p[0] = type;
+	emu_record_set_u32(p + 4, body_len);
+	rec->chunk_len += len;
+	rec->n_records++;
+	return p + EMU_RECORD_RECORD_HEADER_SIZE;
+}
+
+/* returns the device number used by its events */
+int
+emu_recorder_add_device(EmuRecorder *rec, const char *json, size_t json_len, uint32_t flags)
+{
+	uint8_t *p = emu_recorder_reserve(rec, EMU_RECORD_TYPE_DEVICE, EMU_RECORD_DEVICE_SIZE + json_len);
+	if (p == NULL)
+		return -1;
+	emu_record_set_u32(p, rec->n_devices);
+	emu_record_set_u32(p + 4, flags);
+	memcpy(p + EMU_RECORD_DEVICE_SIZE, json, json_len);
+	return rec->n_devices++;
+}
+
+int
+emu_recorder_add_event(EmuRecorder *rec, const EmuRecord *record)
+{
+	uint8_t *p;
+
+	if (record->device >= rec->n_devices)
+		return -1;
+	p = emu_recorder_reserve(rec, EMU_RECORD_TYPE_EVENT,
+				 EMU_RECORD_EVENT_SIZE + record->id_len +
+				 record->data_len + record->data_out_len);
+	if (p == NULL)
+		return -1;
+	emu_record_set_u32(p, record->device);
+	emu_record_set_u32(p + 4, record->flags);
+	emu_record_set_u32(p + 8, record->error);
+	emu_record_set_u32(p + 12, record->id_len);
+	emu_record_set_u32(p + 16, record->data_len);
+	emu_record_set_u32(p + 20, record->data_out_len);
+	emu_record_set_u64(p + 24, record->timestamp_us);
+	emu_record_set_u32(p + 32, record->duration_us);
+	emu_record_set_u32(p + 36, 0);
+	p += EMU_RECORD_EVENT_SIZE;
+	memcpy(p, record->id, record->id_len);
+	p += record->id_len;
+	if (record->data_len > 0)
+		memcpy(p, record->data, record->data_len);
+	p += record->data_len;
+	if (record->data_out_len > 0)
+		memcpy(p, record->data_out, record->data_out_len);
+	return 0;
+}
+
+/* continues an existing log after its last complete chunk */
+static int
+emu_recorder_recover(EmuRecorder *rec)
+{
+	EmuRecordReader reader;
+	EmuRecord record;
+	int rc;
+
+	if (emu_record_reader_open(&reader, rec->filename) < 0)
+		return -1;
+	if (reader.version != EMU_RECORD_VERSION) {
+		fprintf(stderr, "%s: log version %u, not appending\n", rec->filename, reader.version);
+		emu_record_reader_close(&reader);
+		return -1;
+	}
+	while ((rc = emu_record_reader_next(&reader, &record)) > 0) {
+		if (record.type == EMU_RECORD_TYPE_DEVICE)
+			rec->n_devices++;
+	}
+	if (rc == 0 && reader.truncated) {
+		fprintf(stderr, "%s: discarding incomplete chunk at offset %lu\n",
+			rec->filename, (unsigned long) reader.offset);
+		if (truncate(rec->filename, reader.offset) < 0)
+			rc = -1;
+	}
+	emu_record_reader_close(&reader);
+	return rc;
+}
+
+int
+emu_recorder_open(EmuRecorder *rec, const char *filename, size_t chunk_size, int sync)
+{
+	off_t size;
+
+	memset(rec, 0, sizeof(EmuRecorder));
+	rec->fd = -1;
+	rec->sync = sync;
+	rec->chunk_size = chunk_size > 0 ? chunk_size : EMU_RECORD_CHUNK_SIZE_DEFAULT;
+	rec->filename = strdup(filename);
+	rec->chunk = malloc(rec->chunk_size);
+	if (rec->filename == NULL || rec->chunk == NULL)
+		goto fail;
+
+	rec->fd = open(filename, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (rec->fd < 0 || (size = lseek(rec->fd, 0, SEEK_END)) < 0) {
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+		goto fail;
+	}
+	if (size > 0) {
+		if (emu_recorder_recover(rec) < 0)
+			goto fail;
+	} else {
+		uint8_t hdr[EMU_RECORD_HEADER_SIZE] = { 0 };
+		struct iovec iov = { .iov_base = hdr, .iov_len = sizeof(hdr) };
+		memcpy(hdr, EMU_RECORD_MAGIC, 8);
+		emu_record_set_u32(hdr + 8, EMU_RECORD_VERSION);
+		if (emu_record_write_all(rec->fd, &iov, 1, sizeof(hdr)) < 0) {
+			fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+			goto fail;
+		}
+	}
+	return 0;
+fail:
+	if (rec->fd >= 0)
+		close(rec->fd);
+	free(rec->filename);
+	free(rec->chunk);
+	memset(rec, 0, sizeof(EmuRecorder));
+	return -1;
+}
+
+int
+emu_recorder_close(EmuRecorder *rec)
+{
+	int rc = emu_recorder_flush(rec);
+	if (close(rec->fd) < 0)
+		rc = -1;
+	free(rec->filename);
+	free(rec->chunk);
+	memset(rec, 0, sizeof(EmuRecorder));
+	return rc;
+}
+
+int
+emu_record_reader_open(EmuRecordReader *reader, const char *filename)
+{
+	uint8_t hdr[EMU_RECORD_HEADER_SIZE] = { 0 };
+
+	memset(reader, 0, sizeof(EmuRecordReader));
+	reader->filename = filename;
+	reader->f = fopen(filename, "rb");
+	if (reader->f == NULL) {
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+		return -1;
+	}
+	if (fread(hdr, 1, sizeof(hdr), reader->f) == sizeof(hdr))
+		reader->version = emu_record_get_u32(hdr + 8);
+	if (memcmp(hdr, EMU_RECORD_MAGIC, 8) != 0 ||
+	    reader->version == 0 || reader->version > EMU_RECORD_VERSION) {
+		fprintf(stderr, "%s: not an emulation event log\n", filename);
+		fclose(reader->f);
+		reader->f = NULL;
+		return -1;
+	}
+	reader->offset = EMU_RECORD_HEADER_SIZE;
+	return 0;
+}
+
+/* returns 1 if a chunk was loaded, 0 at the end of the valid log */
+static int
+emu_record_reader_load_chunk(EmuRecordReader *reader)
+{
+	uint8_t hdr[EMU_RECORD_CHUNK_HEADER_SIZE];
+	uint32_t size;
+
+	reader->chunk_len = 0;
+	reader->pos = 0;
+	if (fseek(reader->f, reader->offset, SEEK_SET) < 0)
+		return -1;
+	if (fread(hdr, 1, sizeof(hdr), reader->f) != sizeof(hdr)) {
+		reader->truncated = !feof(reader->f) || ftell(reader->f) != (long) reader->offset;
+		return 0;
+	}
+	size = emu_record_get_u32(hdr + 4);
+	if (emu_record_get_u32(hdr) != EMU_RECORD_CHUNK_MAGIC || size > EMU_RECORD_CHUNK_SIZE_MAX) {
+		reader->truncated = 1;
+		return 0;
+	}
+	if (size > reader->chunk_alloc) {
+		uint8_t *tmp = realloc(reader->chunk, size);
+		if (tmp == NULL)
+			return -1;
+		reader->chunk = tmp;
+		reader->chunk_alloc = size;
+	}
+	if (fread(reader->chunk, 1, size, reader->f) != size ||
+	    crc32(0, reader->chunk, size) != emu_record_get_u32(hdr + 8)) {
+		reader->truncated = 1;
+		return 0;
+	}
+	reader->chunk_len = size;
+	reader->offset += sizeof(hdr) + size;
+	reader->n_chunks++;
+	return 1;
+}
+
+/* returns 1 for a record, 0 at the end of the log and -1 on error */
+int
+emu_record_reader_next(EmuRecordReader *reader, EmuRecord *record)
+{
+	const uint8_t *p;
+	size_t body_len;
+	size_t event_size;
+
+	while (reader->pos >= reader->chunk_len) {
+		int rc = emu_record_reader_load_chunk(reader);
+		if (rc <= 0)
+			return rc;
+	}
+	if (reader->chunk_len - reader->pos < EMU_RECORD_RECORD_HEADER_SIZE)
+		goto invalid;
+	p = reader->chunk + reader->pos;
+	body_len = emu_record_get_u32(p + 4);
+	if (body_len > reader->chunk_len - reader->pos - EMU_RECORD_RECORD_HEADER_SIZE)
+		goto invalid;
+	reader->pos += EMU_RECORD_RECORD_HEADER_SIZE + body_len;
+
+	memset(record, 0, sizeof(EmuRecord));
+	record->type = p[0];
+	p += EMU_RECORD_RECORD_HEADER_SIZE;
+	switch (record->type) {
+	case EMU_RECORD_TYPE_DEVICE:
+		if (body_len < EMU_RECORD_DEVICE_SIZE)
+			goto invalid;
+		record->device = emu_record_get_u32(p);
+		record->flags = emu_record_get_u32(p + 4);
+		record->data = p + EMU_RECORD_DEVICE_SIZE;
+		record->data_len = body_len - EMU_RECORD_DEVICE_SIZE;
+		return 1;
+	case EMU_RECORD_TYPE_EVENT:
+		event_size = reader->version == 1 ? EMU_RECORD_EVENT_SIZE_V1 : EMU_RECORD_EVENT_SIZE;
+		if (body_len < event_size)
+			goto invalid;
+		record->device = emu_record_get_u32(p);
+		record->flags = emu_record_get_u32(p + 4);
+		record->error = emu_record_get_u32(p + 8);
+		record->id_len = emu_record_get_u32(p + 12);
+		record->data_len = emu_record_get_u32(p + 16);
+		record->data_out_len = emu_record_get_u32(p + 20);
+		if ((uint64_t) record->id_len + record->data_len + record->data_out_len !=
+		    body_len - event_size)
+			goto invalid;
+		if (event_size >= EMU_RECORD_EVENT_SIZE) {
+			record->timestamp_us = emu_record_get_u64(p + 24);
+			record->duration_us = emu_record_get_u32(p + 32);
+		} else {
+			record->flags &= ~EMU_RECORD_EVENT_FLAG_TIMING;
+		}
+		p += event_size;
+		record->id = (const char *) p;
+		record->data = p + record->id_len;
+		record->data_out = record->data + record->data_len;
+		return 1;
+	default:
+		break;
+	}
+invalid:
+	fprintf(stderr, "%s: invalid record in chunk %u\n", reader->filename, reader->n_chunks);
+	return -1;
+}
+
+int
+emu_record_reader_rewind(EmuRecordReader *reader)
+{
+	reader->offset = EMU_RECORD_HEADER_SIZE;
+	reader->chunk_len = 0;
+	reader->pos = 0;
+	reader->n_chunks = 0;
+	reader->truncated = 0;
+	return 0;
+}
+
+void
+emu_record_reader_close(EmuRecordReader *reader)
+{
+	if (reader->f != NULL)
+		fclose(reader->f);
+	free(reader->chunk);
+	memset(reader, 0, sizeof(EmuRecordReader));
+}
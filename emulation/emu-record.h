@@ -0,0 +1,135 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __EMU_RECORD_H
+#define __EMU_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Append-only event log for recording long emulation sessions.
+ *
+ *   "FWEMULOG" uint32_t version, uint32_t reserved
+ *   chunk*	uint32_t magic, uint32_t size, uint32_t crc32, uint32_t n_records
+ *		followed by size bytes of records
+ *
+ * A record never spans chunks. The recorder holds at most one chunk in
+ * memory and writes each with a single write(), so a crash can only lose or
+ * tear the last chunk; the reader stops at the first chunk that is short or
+ * fails its CRC, and reopening a log for recording truncates it there and
+ * carries on.
+ *
+ * Devices are recorded as a compact JSON object without the events, and the
+ * events reference their device by the order the devices were added. An
+ * event with EMU_RECORD_EVENT_FLAG_TIMING also has the time it was sent,
+ * relative to the Created time of its device, and how long the device took
+ * to answer.
+ * emu-finalise compacts a log into the setup.json-in-zip layout.
+ */
+
+#define EMU_RECORD_MAGIC		"FWEMULOG"
+#define EMU_RECORD_VERSION		2	/* version 1 had no event timing */
+#define EMU_RECORD_CHUNK_MAGIC		0x4b4e4843	/* "CHNK" */
+#define EMU_RECORD_CHUNK_SIZE_DEFAULT	(64 * 1024)
+#define EMU_RECORD_HEADER_SIZE		16
+#define EMU_RECORD_CHUNK_HEADER_SIZE	16
+
+typedef enum {
+	EMU_RECORD_TYPE_DEVICE		= 1,
+	EMU_RECORD_TYPE_EVENT		= 2
+} EmuRecordType;
+
+typedef enum {
+	EMU_RECORD_DEVICE_FLAG_UDEV	= 1 << 0	/* "Events" rather than "UsbEvents" */
+} EmuRecordDeviceFlags;
+
+/* the same values as EmuIndexEventFlags */
+typedef enum {
+	EMU_RECORD_EVENT_FLAG_DATA	= 1 << 0,
+	EMU_RECORD_EVENT_FLAG_DATA_OUT	= 1 << 1,
+	EMU_RECORD_EVENT_FLAG_ERROR	= 1 << 2,
+	EMU_RECORD_EVENT_FLAG_BASE64	= 1 << 3,
+	EMU_RECORD_EVENT_FLAG_TIMING	= 1 << 4
+} EmuRecordEventFlags;
+
+typedef struct {
+	EmuRecordType	 type;
+	uint32_t	 device;
+	uint32_t	 flags;
+	int32_t		 error;		/* events only */
+	uint64_t	 timestamp_us;	/* since the device was created */
+	uint32_t	 duration_us;	/* from request to response */
+	const char	*id;		/* events only */
+	size_t		 id_len;
+	const uint8_t	*data;		/* device JSON, or event Data */
+	size_t		 data_len;
+	const uint8_t	*data_out;
+	size_t		 data_out_len;
+} EmuRecord;
+
+typedef struct {
+	int		 fd;
+	char		*filename;
+	uint8_t		*chunk;
+	size_t		 chunk_len;
+	size_t		 chunk_size;
+	uint32_t	 n_records;
+	uint32_t	 n_devices;
+	int		 sync;
+	uint64_t	 bytes_written;
+} EmuRecorder;
+
+typedef struct {
+	FILE		*f;
+	const char	*filename;
+	uint8_t		*chunk;
+	size_t		 chunk_alloc;
+	size_t		 chunk_len;
+	size_t		 pos;
+	uint64_t	 offset;	/* end of the last valid chunk */
+	uint32_t	 n_chunks;
+	uint32_t	 version;
+	int		 truncated;
+} EmuRecordReader;
+
+int		 emu_recorder_open		(EmuRecorder	*rec,
+						 const char	*filename,
+						 size_t		 chunk_size,
+						 int		 sync);
+int		 emu_recorder_add_device	(EmuRecorder	*rec,
+						 const char	*json,
+						 size_t		 json_len,
+						 uint32_t	 flags);
+int		 emu_recorder_add_event		(EmuRecorder	*rec,
+						 const EmuRecord *record);
+int		 emu_recorder_flush		(EmuRecorder	*rec);
+int		 emu_recorder_close		(EmuRecorder	*rec);
+
+int		 emu_record_reader_open		(EmuRecordReader *reader,
+						 const char	*filename);
+int		 emu_record_reader_next		(EmuRecordReader *reader,
+						 EmuRecord	*record);
+int		 emu_record_reader_rewind	(EmuRecordReader *reader);
+void		 emu_record_reader_close	(EmuRecordReader *reader);
+
+#endif /* __EMU_RECORD_H */
@@ -0,0 +1,129 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Replays emulation archives as fast as possible.
+ *
+ * The requests are recovered from the recorded Ids once, then every session
+ * formats them again and asks the replay engine for the response, checking
+ * that each one is answered by the event it was recorded as. This is the
+ * work an emulated device does for the host, without the host.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "emu-replay.h"
+
+#define BENCH_ITERATIONS_DEFAULT	10000
+
+static uint64_t bench_kinds[EMU_REPLAY_KIND_LAST];
+
+static double
+bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+bench_archive(const char *filename, unsigned iterations, uint64_t *total_events, double *total_time)
+{
+	EmuReplay replay;
+	EmuReplaySession session;
+	uint32_t n_events;
+	uint64_t failures = 0;
+	double start, load, elapsed;
+	const char *name = strrchr(filename, '/');
+
+	start = bench_now();
+	if (emu_replay_open(&replay, filename) < 0)
+		return -1;
+	load = bench_now() - start;
+	n_events = replay.idx.hdr->n_events;
+	if (emu_replay_session_init(&session, &replay) < 0) {
+		emu_replay_close(&replay);
+		return -1;
+	}
+	for (uint32_t i = 0; i < n_events; i++)
+		bench_kinds[session.reqs[i].kind] += iterations;
+
+	start = bench_now();
+	for (unsigned it = 0; it < iterations; it++)
+		failures += emu_replay_session_run(&replay, &session);
+	elapsed = bench_now() - start;
+	*total_time += elapsed;
+	*total_events += (uint64_t) n_events * iterations;
+
+	printf("%-44s %6u %8.1f %12.0f %8.1f %6u %6lu\n",
+	       name != NULL ? name + 1 : filename, n_events, load * 1e6,
+	       n_events * iterations / elapsed,
+	       elapsed * 1e9 / ((double) n_events * iterations),
+	       session.n_raw, (unsigned long) failures);
+	emu_replay_session_clear(&session);
+	emu_replay_close(&replay);
+	return failures > 0 ? -1 : 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	unsigned iterations = BENCH_ITERATIONS_DEFAULT;
+	uint64_t total_events = 0;
+	double total_time = 0;
+	int rc = EXIT_SUCCESS;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n ITERATIONS] ARCHIVE|INDEX...\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind >= argc || iterations == 0) {
+		fprintf(stderr, "Usage: %s [-n ITERATIONS] ARCHIVE|INDEX...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	printf("%-44s %6s %8s %12s %8s %6s %6s\n",
+	       "archive", "events", "load/us", "events/s", "ns/event", "raw-id", "failed");
+	for (int i = optind; i < argc; i++) {
+		if (bench_archive(argv[i], iterations, &total_events, &total_time) < 0)
+			rc = EXIT_FAILURE;
+	}
+	if (total_time > 0) {
+		printf("\n%lu events in %.3fs, %.0f events/s, %u sessions per archive\n",
+		       (unsigned long) total_events, total_time, total_events / total_time, iterations);
+	}
+	for (unsigned k = 0; k < EMU_REPLAY_KIND_LAST; k++) {
+		if (bench_kinds[k] > 0)
+			printf("  %-28s %12lu\n", emu_replay_kind_to_string(k), (unsigned long) bench_kinds[k]);
+	}
+	return rc;
+}
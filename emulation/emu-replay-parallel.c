@@ -0,0 +1,412 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Replays many emulation archives on all cores.
+ *
+ * Every archive is loaded once and its index shared read-only; each worker
+ * thread has its own cursors for every archive, so sessions are isolated
+ * from each other. The sessions are split into tasks of a few sessions each
+ * and dealt round-robin onto per-worker deques. A worker takes tasks from
+ * the back of its own deque and, once that is empty, steals from the front
+ * of another worker's. No task creates more work, so a worker exits when it
+ * finds every deque empty.
+ *
+ * Statistics are kept per worker and merged at the end, so the only shared
+ * writes while running are the deque locks.
+ */
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "emu-histogram.h"
+#include "emu-replay.h"
+
+#define PARALLEL_ITERATIONS_DEFAULT	10000
+#define PARALLEL_CHUNK_DEFAULT		64
+
+typedef struct {
+	uint32_t		 archive;
+	uint32_t		 sessions;
+} ParallelTask;
+
+typedef struct {
+	pthread_mutex_t		 lock;
+	ParallelTask		*tasks;
+	uint32_t		 head;		/* thieves take from here */
+	uint32_t		 tail;		/* the owner takes from here */
+} ParallelDeque;
+
+typedef struct {
+	uint64_t		 sessions;
+	uint64_t		 failed_sessions;
+	uint64_t		 events;
+	EmuHistogram		 latency;	/* per session */
+} ParallelStats;
+
+typedef struct _ParallelPool ParallelPool;
+
+typedef struct {
+	ParallelPool		*pool;
+	pthread_t		 thread;
+	unsigned		 id;
+	ParallelDeque		 deque;
+	ParallelStats		*stats;		/* per archive */
+	EmuReplay		*replays;	/* per archive, opened on first use */
+	uint64_t		 tasks;
+	uint64_t		 steals;
+	uint32_t		 seed;
+	int			 failed;
+} ParallelWorker;
+
+struct _ParallelPool {
+	const char		**filenames;
+	EmuReplay		*archives;
+	EmuReplaySession	*sessions;
+	int			*loaded;
+	uint32_t		 n_archives;
+	ParallelWorker		*workers;
+	unsigned		 n_workers;
+};
+
+static uint64_t
+parallel_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint32_t
+parallel_xorshift32(uint32_t *seed)
+{
+	uint32_t x = *seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*seed = x;
+	return x;
+}
+
+static int
+parallel_deque_pop(ParallelDeque *deque, ParallelTask *task)
+{
+	int rc = 0;
+	pthread_mutex_lock(&deque->lock);
+	if (deque->head < deque->tail) {
+		*task = deque->tasks[--deque->tail];
+		rc = 1;
+	}
+	pthread_mutex_unlock(&deque->lock);
+	return rc;
+}
+
+static int
+parallel_deque_steal(ParallelDeque *deque, ParallelTask *task)
+{
+	int rc = 0;
+	pthread_mutex_lock(&deque->lock);
+	if (deque->head < deque->tail) {
+		*task = deque->tasks[deque->head++];
+		rc = 1;
+	}
+	pthread_mutex_unlock(&deque->lock);
+	return rc;
+}
+
+static int
+parallel_worker_next(ParallelWorker *worker, ParallelTask *task)
+{
+	ParallelPool *pool = worker->pool;
+	unsigned victim;
+
+	if (parallel_deque_pop(&worker->deque, task))
+		return 1;
+	victim = parallel_xorshift32(&worker->seed) % pool->n_workers;
+	for (unsigned i = 0; i < pool->n_workers; i++) {
+		ParallelWorker *other = &pool->workers[(victim + i) % pool->n_workers];
+		if (other == worker)
+			continue;
+		if (parallel_deque_steal(&other->deque, task)) {
+			worker->steals++;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void
+parallel_worker_run_task(ParallelWorker *worker, const ParallelTask *task)
+{
+	ParallelPool *pool = worker->pool;
+	EmuReplay *replay = &worker->replays[task->archive];
+	const EmuReplaySession *session = &pool->sessions[task->archive];
+	ParallelStats *stats = &worker->stats[task->archive];
+
+	if (replay->cursors == NULL &&
+	    emu_replay_open_shared(replay, &pool->archives[task->archive]) < 0) {
+		worker->failed = 1;
+		return;
+	}
+	for (uint32_t i = 0; i < task->sessions; i++) {
+		uint64_t start = parallel_now_ns();
+		uint32_t failures = emu_replay_session_run(replay, session);
+		emu_histogram_add(&stats->latency, parallel_now_ns() - start);
+		stats->sessions++;
+		stats->events += session->n_reqs;
+		if (failures > 0)
+			stats->failed_sessions++;
+	}
+}
+
+static void *
+parallel_worker_thread(void *user_data)
+{
+	ParallelWorker *worker = user_data;
+	ParallelTask task;
+
+	while (parallel_worker_next(worker, &task)) {
+		parallel_worker_run_task(worker, &task);
+		worker->tasks++;
+	}
+	return NULL;
+}
+
+/* deals every task out before any worker starts */
+static int
+parallel_pool_fill(ParallelPool *pool, unsigned iterations, unsigned chunk)
+{
+	uint32_t per_archive = (iterations + chunk - 1) / chunk;
+	uint32_t n_tasks = per_archive * pool->n_archives;
+	uint32_t per_worker = (n_tasks + pool->n_workers - 1) / pool->n_workers;
+	unsigned w = 0;
+
+	for (unsigned i = 0; i < pool->n_workers; i++) {
+		ParallelWorker *worker = &pool->workers[i];
+		worker->pool = pool;
+		worker->id = i;
+		worker->seed = 0x9e3779b9 * (i + 1);
+		worker->deque.tasks = calloc(per_worker + 1, sizeof(ParallelTask));
+		worker->stats = calloc(pool->n_archives, sizeof(ParallelStats));
+		worker->replays = calloc(pool->n_archives, sizeof(EmuReplay));
+		if (worker->deque.tasks == NULL || worker->stats == NULL || worker->replays == NULL)
+			return -1;
+		pthread_mutex_init(&worker->deque.lock, NULL);
+		for (uint32_t a = 0; a < pool->n_archives; a++)
+			emu_histogram_init(&worker->stats[a].latency);
+	}
+
+	/* interleave archives so every worker starts with a mix */
+	for (uint32_t t = 0; t < per_archive; t++) {
+		for (uint32_t a = 0; a < pool->n_archives; a++) {
+			ParallelDeque *deque = &pool->workers[w].deque;
+			uint32_t left = iterations - t * chunk;
+			if (!pool->loaded[a])
+				continue;
+			deque->tasks[deque->tail].archive = a;
+			deque->tasks[deque->tail].sessions = left < chunk ? left : chunk;
+			deque->tail++;
+			w = (w + 1) % pool->n_workers;
+		}
+	}
+	return 0;
+}
+
+static void
+parallel_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [OPTION...] ARCHIVE|INDEX...\n"
+		"  -j, --jobs=N             worker threads, default one per CPU\n"
+		"  -n, --iterations=N       sessions per archive, default %u\n"
+		"  -c, --chunk=N            sessions per task, default %u\n"
+		"  -H, --histogram          print the session latency histogram\n"
+		"  -s, --share              share identical payloads between archives\n",
+		argv0, PARALLEL_ITERATIONS_DEFAULT, PARALLEL_CHUNK_DEFAULT);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct option options[] = {
+		{ "jobs",		required_argument, NULL, 'j' },
+		{ "iterations",		required_argument, NULL, 'n' },
+		{ "chunk",		required_argument, NULL, 'c' },
+		{ "histogram",		no_argument, NULL, 'H' },
+		{ "share",		no_argument, NULL, 's' },
+		{ NULL, 0, NULL, 0 }
+	};
+	ParallelPool pool = { 0 };
+	ParallelStats total = { 0 };
+	EmuPayloadTable table = { 0 };
+	unsigned iterations = PARALLEL_ITERATIONS_DEFAULT;
+	unsigned chunk = PARALLEL_CHUNK_DEFAULT;
+	long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	uint64_t steals = 0;
+	uint64_t start, elapsed;
+	int histogram = 0;
+	int share = 0;
+	int rc = EXIT_SUCCESS;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "j:n:c:Hs", options, NULL)) != -1) {
+		switch (opt) {
+		case 'j':
+			jobs = strtol(optarg, NULL, 0);
+			break;
+		case 'n':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			chunk = strtoul(optarg, NULL, 0);
+			break;
+		case 'H':
+			histogram = 1;
+			break;
+		case 's':
+			share = 1;
+			break;
+		default:
+			parallel_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind >= argc || jobs < 1 || iterations == 0 || chunk == 0) {
+		parallel_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (share && emu_payload_table_init(&table) < 0)
+		return EXIT_FAILURE;
+
+	/* a broken archive is reported, but does not stop the others */
+	pool.n_archives = argc - optind;
+	pool.filenames = (const char **) argv + optind;
+	pool.archives = calloc(pool.n_archives, sizeof(EmuReplay));
+	pool.sessions = calloc(pool.n_archives, sizeof(EmuReplaySession));
+	pool.loaded = calloc(pool.n_archives, sizeof(int));
+	pool.n_workers = jobs;
+	pool.workers = calloc(pool.n_workers, sizeof(ParallelWorker));
+	if (pool.archives == NULL || pool.sessions == NULL || pool.loaded == NULL || pool.workers == NULL)
+		return EXIT_FAILURE;
+	for (uint32_t a = 0; a < pool.n_archives; a++) {
+		if (emu_replay_open_with_table(&pool.archives[a], pool.filenames[a],
+					       share ? &table : NULL) < 0)
+			continue;
+		if (emu_replay_session_init(&pool.sessions[a], &pool.archives[a]) < 0) {
+			emu_replay_close(&pool.archives[a]);
+			continue;
+		}
+		pool.loaded[a] = 1;
+	}
+	if (parallel_pool_fill(&pool, iterations, chunk) < 0)
+		return EXIT_FAILURE;
+
+	start = parallel_now_ns();
+	for (unsigned i = 0; i < pool.n_workers; i++) {
+		if (pthread_create(&pool.workers[i].thread, NULL, parallel_worker_thread, &pool.workers[i]) != 0) {
+			fprintf(stderr, "failed to start worker %u\n", i);
+			return EXIT_FAILURE;
+		}
+	}
+	for (unsigned i = 0; i < pool.n_workers; i++)
+		pthread_join(pool.workers[i].thread, NULL);
+	elapsed = parallel_now_ns() - start;
+
+	emu_histogram_init(&total.latency);
+	printf("%-44s %8s %6s %10s %10s %10s %10s\n",
+	       "archive", "sessions", "failed", "p50/us", "p90/us", "p99/us", "max/us");
+	for (uint32_t a = 0; a < pool.n_archives; a++) {
+		ParallelStats stats = { 0 };
+		const char *name = strrchr(pool.filenames[a], '/');
+
+		name = name != NULL ? name + 1 : pool.filenames[a];
+		if (!pool.loaded[a]) {
+			printf("%-44s failed to load\n", name);
+			rc = EXIT_FAILURE;
+			continue;
+		}
+		emu_histogram_init(&stats.latency);
+		for (unsigned i = 0; i < pool.n_workers; i++) {
+			ParallelStats *ws = &pool.workers[i].stats[a];
+			stats.sessions += ws->sessions;
+			stats.failed_sessions += ws->failed_sessions;
+			stats.events += ws->events;
+			emu_histogram_merge(&stats.latency, &ws->latency);
+		}
+		printf("%-44s %8lu %6lu %10.2f %10.2f %10.2f %10.2f\n", name,
+		       (unsigned long) stats.sessions, (unsigned long) stats.failed_sessions,
+		       emu_histogram_percentile(&stats.latency, 50) / 1e3,
+		       emu_histogram_percentile(&stats.latency, 90) / 1e3,
+		       emu_histogram_percentile(&stats.latency, 99) / 1e3,
+		       stats.latency.max / 1e3);
+		if (stats.failed_sessions > 0 || stats.sessions != iterations)
+			rc = EXIT_FAILURE;
+		total.sessions += stats.sessions;
+		total.failed_sessions += stats.failed_sessions;
+		total.events += stats.events;
+		emu_histogram_merge(&total.latency, &stats.latency);
+	}
+	for (unsigned i = 0; i < pool.n_workers; i++) {
+		steals += pool.workers[i].steals;
+		if (pool.workers[i].failed)
+			rc = EXIT_FAILURE;
+	}
+
+	printf("\n%lu sessions, %lu failed, %lu events in %.3fs on %u threads\n",
+	       (unsigned long) total.sessions, (unsigned long) total.failed_sessions,
+	       (unsigned long) total.events, elapsed / 1e9, pool.n_workers);
+	printf("%.0f sessions/s, %.0f events/s, %lu tasks stolen\n",
+	       total.sessions / (elapsed / 1e9), total.events / (elapsed / 1e9),
+	       (unsigned long) steals);
+	if (histogram) {
+		printf("\nsession latency:\n");
+		emu_histogram_print(&total.latency, stdout);
+	}
+
+	for (unsigned i = 0; i < pool.n_workers; i++) {
+		for (uint32_t a = 0; a < pool.n_archives; a++) {
+			if (pool.workers[i].replays[a].cursors != NULL)
+				emu_replay_close(&pool.workers[i].replays[a]);
+		}
+		pthread_mutex_destroy(&pool.workers[i].deque.lock);
+		free(pool.workers[i].deque.tasks);
+		free(pool.workers[i].stats);
+		free(pool.workers[i].replays);
+	}
+	for (uint32_t a = 0; a < pool.n_archives; a++) {
+		if (!pool.loaded[a])
+			continue;
+		emu_replay_session_clear(&pool.sessions[a]);
+		emu_replay_close(&pool.archives[a]);
+	}
+	free(pool.workers);
+	free(pool.archives);
+	free(pool.sessions);
+	free(pool.loaded);
+	emu_payload_table_clear(&table);
+	return rc;
+}
@@ -0,0 +1,285 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Replays emulation archives at the pace they were recorded.
+ *
+ * Many sessions of each archive run concurrently on one thread: every
+ * response that is not due yet is put on a timer wheel, and the next request
+ * of that session is only sent once it fires, as a host waiting on the real
+ * device would. The wall-clock time of each session is compared with what
+ * the recorded timing says it should take, and how late each timer fired is
+ * reported, which is what a test of timeouts and poll intervals relies on.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emu-histogram.h"
+#include "emu-replay.h"
+#include "emu-timer.h"
+
+typedef struct {
+	uint64_t		 sessions;
+	uint64_t		 failed_sessions;
+	uint64_t		 events;
+	EmuHistogram		 duration;	/* per session */
+	EmuHistogram		 lateness;	/* per timer */
+} TimedStats;
+
+typedef struct {
+	EmuReplay		 replay;
+	const EmuReplaySession	*session;
+	TimedStats		*stats;
+	EmuTimerWheel		*wheel;
+	EmuTimer		 timer;
+	uint32_t		 next;		/* the request to send */
+	uint32_t		 failures;
+	uint64_t		 start_ns;
+} TimedSession;
+
+static void timed_session_fire (EmuTimer *timer, uint64_t now_ns, void *user_data);
+
+/* sends requests until one has to be waited for, or the session ends */
+static void
+timed_session_send(TimedSession *ts)
+{
+	const EmuReplaySession *session = ts->session;
+
+	while (ts->next < session->n_reqs) {
+		EmuReplayResponse rsp;
+		uint32_t i = ts->next++;
+		if (emu_replay_request(&ts->replay, session->devices[i], &session->reqs[i], &rsp) < 0 ||
+		    rsp.event != i) {
+			ts->failures++;
+			continue;
+		}
+		ts->stats->events++;
+		if (rsp.ready_ns != 0) {
+			emu_timer_wheel_add(ts->wheel, &ts->timer, rsp.ready_ns);
+			return;
+		}
+	}
+	ts->stats->sessions++;
+	if (ts->failures > 0)
+		ts->stats->failed_sessions++;
+	emu_histogram_add(&ts->stats->duration, emu_timer_now_ns() - ts->start_ns);
+}
+
+static void
+timed_session_fire(EmuTimer *timer, uint64_t now_ns, void *user_data)
+{
+	TimedSession *ts = user_data;
+	emu_histogram_add(&ts->stats->lateness, now_ns > timer->deadline_ns ? now_ns - timer->deadline_ns : 0);
+	timed_session_send(ts);
+}
+
+/* how long a session should take with the given timing */
+static uint64_t
+timed_expected_ns(const EmuIndex *idx, EmuReplayTiming timing, double scale)
+{
+	uint64_t total_us = 0;
+
+	for (uint32_t d = 0; d < idx->hdr->n_devices; d++) {
+		const EmuIndexDevice *device = &idx->devices[d];
+		uint64_t first_us = UINT64_MAX;
+		uint64_t end_us = 0;
+		for (uint32_t i = device->first_event; i < device->first_event + device->n_events; i++) {
+			const EmuIndexEvent *event = &idx->events[i];
+			if ((event->flags & EMU_INDEX_EVENT_FLAG_TIMING) == 0)
+				continue;
+			if (timing == EMU_REPLAY_TIMING_DURATION) {
+				total_us += event->duration_us;
+				continue;
+			}
+			if (first_us == UINT64_MAX)
+				first_us = event->timestamp_us;
+			if (event->timestamp_us + event->duration_us > end_us)
+				end_us = event->timestamp_us + event->duration_us;
+		}
+		if (first_us != UINT64_MAX && end_us > first_us)
+			total_us += end_us - first_us;
+	}
+	return total_us * 1000.0 * scale;
+}
+
+static int
+timed_run_archive(const char *filename, EmuReplayTiming timing, double scale,
+		  unsigned concurrent, uint64_t resolution_ns, uint64_t spin_ns,
+		  TimedStats *stats)
+{
+	EmuReplay parent;
+	EmuReplaySession session;
+	EmuTimerWheel wheel = { 0 };
+	TimedSession *sessions;
+	uint64_t start;
+	int rc = -1;
+
+	if (emu_replay_open(&parent, filename) < 0)
+		return -1;
+	emu_replay_set_timing(&parent, timing, scale);
+	if (emu_replay_session_init(&session, &parent) < 0) {
+		emu_replay_close(&parent);
+		return -1;
+	}
+	sessions = calloc(concurrent, sizeof(TimedSession));
+	if (sessions == NULL || emu_timer_wheel_init(&wheel, resolution_ns, EMU_TIMER_SLOTS_DEFAULT) < 0)
+		goto out;
+	wheel.spin_ns = spin_ns;
+
+	/* every session starts together, as when many devices are flashed at once */
+	start = emu_timer_now_ns();
+	for (unsigned i = 0; i < concurrent; i++) {
+		TimedSession *ts = &sessions[i];
+		if (emu_replay_open_shared(&ts->replay, &parent) < 0)
+			goto out;
+		ts->session = &session;
+		ts->stats = stats;
+		ts->wheel = &wheel;
+		ts->timer.func = timed_session_fire;
+		ts->timer.user_data = ts;
+		ts->start_ns = start;
+		timed_session_send(ts);
+	}
+	emu_timer_wheel_run(&wheel);
+	rc = 0;
+out:
+	for (unsigned i = 0; sessions != NULL && i < concurrent; i++) {
+		if (sessions[i].replay.cursors != NULL)
+			emu_replay_close(&sessions[i].replay);
+	}
+	free(sessions);
+	emu_timer_wheel_clear(&wheel);
+	emu_replay_session_clear(&session);
+	emu_replay_close(&parent);
+	return rc;
+}
+
+static void
+timed_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [OPTION...] ARCHIVE|INDEX...\n"
+		"  -m, --mode=MODE          duration, timestamp or none, default duration\n"
+		"  -s, --scale=FACTOR       multiply the recorded timing, default 1.0\n"
+		"  -c, --concurrent=N       sessions run at once per archive, default 1\n"
+		"  -r, --resolution=NS      timer wheel tick, default %u\n"
+		"  -S, --spin=NS            spin rather than sleep this close to a deadline, default %u\n"
+		"  -H, --histogram          print the timer lateness histogram\n",
+		argv0, EMU_TIMER_RESOLUTION_DEFAULT, EMU_TIMER_SPIN_DEFAULT);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct option options[] = {
+		{ "mode",		required_argument, NULL, 'm' },
+		{ "scale",		required_argument, NULL, 's' },
+		{ "concurrent",		required_argument, NULL, 'c' },
+		{ "resolution",		required_argument, NULL, 'r' },
+		{ "spin",		required_argument, NULL, 'S' },
+		{ "histogram",		no_argument, NULL, 'H' },
+		{ NULL, 0, NULL, 0 }
+	};
+	EmuReplayTiming timing = EMU_REPLAY_TIMING_DURATION;
+	EmuHistogram lateness;
+	double scale = 1.0;
+	unsigned concurrent = 1;
+	uint64_t resolution_ns = EMU_TIMER_RESOLUTION_DEFAULT;
+	uint64_t spin_ns = EMU_TIMER_SPIN_DEFAULT;
+	int histogram = 0;
+	int rc = EXIT_SUCCESS;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "m:s:c:r:S:H", options, NULL)) != -1) {
+		switch (opt) {
+		case 'm':
+			timing = emu_replay_timing_from_string(optarg);
+			break;
+		case 's':
+			scale = strtod(optarg, NULL);
+			break;
+		case 'c':
+			concurrent = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			resolution_ns = strtoull(optarg, NULL, 0);
+			break;
+		case 'S':
+			spin_ns = strtoull(optarg, NULL, 0);
+			break;
+		case 'H':
+			histogram = 1;
+			break;
+		default:
+			timed_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind >= argc || timing == EMU_REPLAY_TIMING_LAST || scale < 0 ||
+	    concurrent == 0 || resolution_ns == 0) {
+		timed_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	emu_histogram_init(&lateness);
+	printf("%-44s %8s %6s %12s %12s %12s %10s %10s\n", "archive", "sessions", "failed",
+	       "expected/ms", "p50/ms", "max/ms", "late50/us", "late99/us");
+	for (int i = optind; i < argc; i++) {
+		const char *name = strrchr(argv[i], '/');
+		TimedStats stats = { 0 };
+		EmuReplay replay;
+		uint64_t expected;
+
+		name = name != NULL ? name + 1 : argv[i];
+		emu_histogram_init(&stats.duration);
+		emu_histogram_init(&stats.lateness);
+		if (emu_replay_open(&replay, argv[i]) < 0) {
+			printf("%-44s failed to load\n", name);
+			rc = EXIT_FAILURE;
+			continue;
+		}
+		expected = timing == EMU_REPLAY_TIMING_NONE ? 0 : timed_expected_ns(&replay.idx, timing, scale);
+		emu_replay_close(&replay);
+		if (timed_run_archive(argv[i], timing, scale, concurrent, resolution_ns, spin_ns, &stats) < 0) {
+			printf("%-44s failed to replay\n", name);
+			rc = EXIT_FAILURE;
+			continue;
+		}
+		printf("%-44s %8lu %6lu %12.3f %12.3f %12.3f %10.1f %10.1f\n", name,
+		       (unsigned long) stats.sessions, (unsigned long) stats.failed_sessions,
+		       expected / 1e6,
+		       emu_histogram_percentile(&stats.duration, 50) / 1e6,
+		       stats.duration.max / 1e6,
+		       emu_histogram_percentile(&stats.lateness, 50) / 1e3,
+		       emu_histogram_percentile(&stats.lateness, 99) / 1e3);
+		if (stats.failed_sessions > 0 || stats.sessions != concurrent)
+			rc = EXIT_FAILURE;
+		emu_histogram_merge(&lateness, &stats.lateness);
+	}
+	if (histogram) {
+		printf("\ntimer lateness:\n");
+		emu_histogram_print(&lateness, stdout);
+	}
+	return rc;
+}
@@ -0,0 +1,595 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emu-base64.h"
+#include "emu-loader.h"
+#include "emu-replay.h"
+#include "emu-timer.h"
+
+/* longest Id without the Data and the Attr or Key */
+#define EMU_REPLAY_ID_FIXED_MAX		192
+
+static const char *emu_replay_kinds[] = {
+	[EMU_REPLAY_KIND_UNKNOWN]			= "Unknown",
+	[EMU_REPLAY_KIND_CONTROL_TRANSFER]		= "ControlTransfer",
+	[EMU_REPLAY_KIND_BULK_TRANSFER]			= "BulkTransfer",
+	[EMU_REPLAY_KIND_GET_STRING_DESCRIPTOR]		= "GetStringDescriptor",
+	[EMU_REPLAY_KIND_GET_STRING_DESCRIPTOR_BYTES]	= "GetStringDescriptorBytes",
+	[EMU_REPLAY_KIND_READ_ATTR]			= "ReadAttr",
+	[EMU_REPLAY_KIND_READ_PROP]			= "ReadProp",
+	[EMU_REPLAY_KIND_IOCTL]				= "Ioctl",
+	[EMU_REPLAY_KIND_SIOCETHTOOL_IOCTL]		= "SiocethtoolIoctl",
+	[EMU_REPLAY_KIND_GET_SYMLINK_TARGET]		= "GetSymlinkTarget",
+};
+
+static const char *emu_replay_timings[] = {
+	[EMU_REPLAY_TIMING_NONE]			= "none",
+	[EMU_REPLAY_TIMING_DURATION]			= "duration",
+	[EMU_REPLAY_TIMING_TIMESTAMP]			= "timestamp",
+};
+
+const char *
+emu_replay_timing_to_string(EmuReplayTiming timing)
+{
+	if (timing >= EMU_REPLAY_TIMING_LAST)
+		return NULL;
+	return emu_replay_timings[timing];
+}
+
+EmuReplayTiming
+emu_replay_timing_from_string(const char *str)
+{
+	for (unsigned i = 0; i < EMU_REPLAY_TIMING_LAST; i++) {
+		if (strcmp(str, emu_replay_timings[i]) == 0)
+			return i;
+	}
+	return EMU_REPLAY_TIMING_LAST;
+}
+
+const char *
+emu_replay_kind_to_string(EmuReplayKind kind)
+{
+	if (kind >= EMU_REPLAY_KIND_LAST)
+		return NULL;
+	return emu_replay_kinds[kind];
+}
+
+int
+emu_replay_open(EmuReplay *replay, const char *filename)
+{
+	return emu_replay_open_with_table(replay, filename, NULL);
+}
+
+/* takes ownership of an index that is already open */
+int
+emu_replay_open_index(EmuReplay *replay, EmuIndex *idx)
+{
+	memset(replay, 0, sizeof(EmuReplay));
+	replay->idx = *idx;
+	memset(idx, 0, sizeof(EmuIndex));
+	replay->cursors = calloc(replay->idx.hdr->n_devices + 1, sizeof(uint32_t));
+	replay->created_ns = calloc(replay->idx.hdr->n_devices + 1, sizeof(uint64_t));
+	replay->scale = 1.0;
+	if (replay->cursors == NULL || replay->created_ns == NULL) {
+		emu_replay_close(replay);
+		return -1;
+	}
+	emu_replay_reset(replay);
+	return 0;
+}
+
+/* with a payload table, identical payloads of every archive are held once */
+int
+emu_replay_open_with_table(EmuReplay *replay, const char *filename, EmuPayloadTable *table)
+{
+	EmuIndex idx;
+	size_t len = strlen(filename);
+
+	memset(replay, 0, sizeof(EmuReplay));
+	if (len > 7 && strcmp(filename + len - 7, ".emuidx") == 0) {
+		if (emu_index_open(&idx, filename) < 0)
+			return -1;
+	} else if (emu_loader_open(&idx, filename, EMU_INDEX_BUILD_FLAG_NONE) < 0) {
+		return -1;
+	}
+	if (table != NULL && emu_index_share(&idx, table, filename) < 0)
+		return -1;
+	return emu_replay_open_index(replay, &idx);
+}
+
+int
+emu_replay_open_shared(EmuReplay *replay, const EmuReplay *parent)
+{
+	memset(replay, 0, sizeof(EmuReplay));
+	replay->idx = parent->idx;
+	replay->shared = 1;
+	replay->timing = parent->timing;
+	replay->scale = parent->scale;
+	replay->cursors = calloc(replay->idx.hdr->n_devices + 1, sizeof(uint32_t));
+	replay->created_ns = calloc(replay->idx.hdr->n_devices + 1, sizeof(uint64_t));
+	if (replay->cursors == NULL || replay->created_ns == NULL) {
+		free(replay->cursors);
+		free(replay->created_ns);
+		return -1;
+	}
+	emu_replay_reset(replay);
+	return 0;
+}
+
+void
+emu_replay_close(EmuReplay *replay)
+{
+	if (replay->decoded != NULL) {
+		for (size_t i = 0; i < (size_t) replay->idx.hdr->n_events * 2; i++)
+			free(replay->decoded[i].data);
+		free(replay->decoded);
+	}
+	if (!replay->shared)
+		emu_index_close(&replay->idx);
+	free(replay->cursors);
+	free(replay->created_ns);
+	free(replay->id);
+	memset(replay, 0, sizeof(EmuReplay));
+}
+
+void
+emu_replay_reset(EmuReplay *replay)
+{
+	for (uint32_t i = 0; i < replay->idx.hdr->n_devices; i++)
+		replay->cursors[i] = replay->idx.devices[i].first_event;
+	memset(replay->created_ns, 0, replay->idx.hdr->n_devices * sizeof(uint64_t));
+}
+
+/* a scale of 0.5 replays twice as fast as recorded */
+void
+emu_replay_set_timing(EmuReplay *replay, EmuReplayTiming timing, double scale)
+{
+	replay->timing = timing;
+	replay->scale = scale;
+}
+
+void
+emu_replay_wait(const EmuReplayResponse *rsp)
+{
+	if (rsp->ready_ns != 0)
+		emu_timer_sleep_until(rsp->ready_ns, EMU_TIMER_SPIN_DEFAULT);
+}
+
+/*
+ * The device is taken to have been created when it is first used in the
+ * session, so its first request is answered as promptly as recorded. After
+ * that a host that runs ahead of the recording is held back to it, while
+ * one that falls behind still waits the full Duration.
+ */
+static uint64_t
+emu_replay_ready_ns(EmuReplay *replay, uint32_t device, const EmuIndexEvent *event)
+{
+	uint64_t now = emu_timer_now_ns();
+	uint64_t ready = now + (uint64_t) (event->duration_us * 1000.0 * replay->scale);
+
+	if (replay->timing == EMU_REPLAY_TIMING_TIMESTAMP) {
+		uint64_t offset = event->timestamp_us * 1000.0 * replay->scale;
+		uint64_t due;
+		if (replay->created_ns[device] == 0)
+			replay->created_ns[device] = now > offset ? now - offset : 1;
+		due = replay->created_ns[device] + offset +
+		      (uint64_t) (event->duration_us * 1000.0 * replay->scale);
+		if (due > ready)
+			ready = due;
+	}
+	return ready;
+}
+
+static char *
+emu_replay_put_str(char *p, const char *str, size_t len)
+{
+	memcpy(p, str, len);
+	return p + len;
+}
+
+#define emu_replay_put_lit(p, lit)	emu_replay_put_str(p, lit, sizeof(lit) - 1)
+
+/* lowercase hex with at least the given number of digits, as fwupd does */
+static char *
+emu_replay_put_hex(char *p, uint32_t value, unsigned digits)
+{
+	static const char hex[] = "0123456789abcdef";
+	char tmp[8];
+	unsigned n = 0;
+
+	do {
+		tmp[n++] = hex[value & 0xf];
+		value >>= 4;
+	} while (value != 0);
+	while (n < digits)
+		tmp[n++] = '0';
+	*p++ = '0';
+	*p++ = 'x';
+	while (n > 0)
+		*p++ = tmp[--n];
+	return p;
+}
+
+static char *
+emu_replay_put_data(char *p, const EmuReplayRequest *req)
+{
+	p = emu_replay_put_lit(p, "Data=");
+	return p + emu_base64_encode(req->data, req->data_len, p);
+}
+
+/* returns the length of the Id, or -1 if bufsz is too small */
+int
+emu_replay_request_format(const EmuReplayRequest *req, char *buf, size_t bufsz)
+{
+	char *p = buf;
+
+	if (bufsz < EMU_REPLAY_ID_FIXED_MAX + EMU_BASE64_ENCODED_SIZE(req->data_len) + req->name_len)
+		return -1;
+	if (req->kind == EMU_REPLAY_KIND_UNKNOWN) {
+		p = emu_replay_put_str(p, req->name, req->name_len);
+		*p = '\0';
+		return p - buf;
+	}
+	p = emu_replay_put_str(p, emu_replay_kinds[req->kind], strlen(emu_replay_kinds[req->kind]));
+	*p++ = ':';
+	switch (req->kind) {
+	case EMU_REPLAY_KIND_CONTROL_TRANSFER:
+		p = emu_replay_put_lit(p, "Direction=");
+		p = emu_replay_put_hex(p, req->direction, 2);
+		p = emu_replay_put_lit(p, ",RequestType=");
+		p = emu_replay_put_hex(p, req->request_type, 2);
+		p = emu_replay_put_lit(p, ",Recipient=");
+		p = emu_replay_put_hex(p, req->recipient, 2);
+		p = emu_replay_put_lit(p, ",Request=");
+		p = emu_replay_put_hex(p, req->request, 2);
+		p = emu_replay_put_lit(p, ",Value=");
+		p = emu_replay_put_hex(p, req->value, 4);
+		p = emu_replay_put_lit(p, ",Idx=");
+		p = emu_replay_put_hex(p, req->idx, 4);
+		*p++ = ',';
+		p = emu_replay_put_data(p, req);
+		p = emu_replay_put_lit(p, ",Length=");
+		p = emu_replay_put_hex(p, req->length, 1);
+		break;
+	case EMU_REPLAY_KIND_BULK_TRANSFER:
+		p = emu_replay_put_lit(p, "Endpoint=");
+		p = emu_replay_put_hex(p, req->endpoint, 2);
+		*p++ = ',';
+		p = emu_replay_put_data(p, req);
+		p = emu_replay_put_lit(p, ",Length=");
+		p = emu_replay_put_hex(p, req->length, 1);
+		break;
+	case EMU_REPLAY_KIND_GET_STRING_DESCRIPTOR:
+		p = emu_replay_put_lit(p, "DescIndex=");
+		p = emu_replay_put_hex(p, req->desc_index, 2);
+		break;
+	case EMU_REPLAY_KIND_GET_STRING_DESCRIPTOR_BYTES:
+		p = emu_replay_put_lit(p, "DescIndex=");
+		p = emu_replay_put_hex(p, req->desc_index, 2);
+		p = emu_replay_put_lit(p, ",Langid=");
+		p = emu_replay_put_hex(p, req->langid, 4);
+		p = emu_replay_put_lit(p, ",Length=");
+		p = emu_replay_put_hex(p, req->length, 1);
+		break;
+	case EMU_REPLAY_KIND_READ_ATTR:
+	case EMU_REPLAY_KIND_GET_SYMLINK_TARGET:
+		p = emu_replay_put_lit(p, "Attr=");
+		p = emu_replay_put_str(p, req->name, req->name_len);
+		break;
+	case EMU_REPLAY_KIND_READ_PROP:
+		p = emu_replay_put_lit(p, "Key=");
+		p = emu_replay_put_str(p, req->name, req->name_len);
+		break;
+	case EMU_REPLAY_KIND_IOCTL:
+		p = emu_replay_put_lit(p, "Request=");
+		p = emu_replay_put_hex(p, req->ioctl_request, 4);
+		*p++ = ',';
+		p = emu_replay_put_data(p, req);
+		p = emu_replay_put_lit(p, ",Length=");
+		p = emu_replay_put_hex(p, req->length, 1);
+		break;
+	case EMU_REPLAY_KIND_SIOCETHTOOL_IOCTL:
+		p = emu_replay_put_data(p, req);
+		p = emu_replay_put_lit(p, ",Length=");
+		p = emu_replay_put_hex(p, req->length, 1);
+		break;
+	default:
+		return -1;
+	}
+	*p = '\0';
+	return p - buf;
+}
+
+static int
+emu_replay_parse_hex(const char *str, size_t len, uint32_t *value)
+{
+	if (len < 3 || len > 10 || str[0] != '0' || str[1] != 'x')
+		return -1;
+	*value = 0;
+	for (size_t i = 2; i < len; i++) {
+		char c = str[i];
+		*value <<= 4;
+		if (c >= '0' && c <= '9')
+			*value |= c - '0';
+		else if (c >= 'a' && c <= 'f')
+			*value |= c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			*value |= c - 'A' + 10;
+		else
+			return -1;
+	}
+	return 0;
+}
+
+/*
+ * Recovers the request from a recorded Id. Data is decoded into scratch,
+ * which must be at least id_len bytes. Ids of unknown kinds are kept as-is.
+ */
+int
+emu_replay_request_parse(EmuReplayRequest *req, const char *id, size_t id_len, uint8_t *scratch)
+{
+	const char *end = id + id_len;
+	const char *p = memchr(id, ':', id_len);
+	size_t kind_len;
+
+	memset(req, 0, sizeof(EmuReplayRequest));
+	req->kind = EMU_REPLAY_KIND_UNKNOWN;
+	req->name = id;
+	req->name_len = id_len;
+	if (p == NULL)
+		return 0;
+	kind_len = p - id;
+	for (unsigned i = EMU_REPLAY_KIND_UNKNOWN + 1; i < EMU_REPLAY_KIND_LAST; i++) {
+		if (strlen(emu_replay_kinds[i]) == kind_len &&
+		    memcmp(id, emu_replay_kinds[i], kind_len) == 0) {
+			req->kind = i;
+			break;
+		}
+	}
+	if (req->kind == EMU_REPLAY_KIND_UNKNOWN)
+		return 0;
+	p++;
+
+	/* the Attr or Key is everything after the '=' */
+	if (req->kind == EMU_REPLAY_KIND_READ_ATTR ||
+	    req->kind == EMU_REPLAY_KIND_READ_PROP ||
+	    req->kind == EMU_REPLAY_KIND_GET_SYMLINK_TARGET) {
+		const char *eq = memchr(p, '=', end - p);
+		if (eq == NULL)
+			return -1;
+		req->name = eq + 1;
+		req->name_len = end - req->name;
+		return 0;
+	}
+
+	req->name = NULL;
+	req->name_len = 0;
+	while (p < end) {
+		const char *comma = memchr(p, ',', end - p);
+		const char *eq = memchr(p, '=', end - p);
+		const char *value;
+		size_t key_len, value_len;
+		uint32_t tmp = 0;
+
+		if (comma == NULL)
+			comma = end;
+		if (eq == NULL || eq > comma)
+			return -1;
+		key_len = eq - p;
+		value = eq + 1;
+		value_len = comma - value;
+
+		if (key_len == 4 && memcmp(p, "Data", 4) == 0) {
+			if (emu_base64_decode(value, value_len, scratch, &req->data_len) < 0)
+				return -1;
+			req->data = scratch;
+		} else if (emu_replay_parse_hex(value, value_len, &tmp) < 0) {
+			return -1;
+		} else if (key_len == 9 && memcmp(p, "Direction", 9) == 0) {
+			req->direction = tmp;
+		} else if (key_len == 11 && memcmp(p, "RequestType", 11) == 0) {
+			req->request_type = tmp;
+		} else if (key_len == 9 && memcmp(p, "Recipient", 9) == 0) {
+			req->recipient = tmp;
+		} else if (key_len == 7 && memcmp(p, "Request", 7) == 0) {
+			req->request = tmp;
+			req->ioctl_request = tmp;
+		} else if (key_len == 5 && memcmp(p, "Value", 5) == 0) {
+			req->value = tmp;
+		} else if (key_len == 3 && memcmp(p, "Idx", 3) == 0) {
+			req->idx = tmp;
+		} else if (key_len == 6 && memcmp(p, "Length", 6) == 0) {
+			req->length = tmp;
+		} else if (key_len == 8 && memcmp(p, "Endpoint", 8) == 0) {
+			req->endpoint = tmp;
+		} else if (key_len == 9 && memcmp(p, "DescIndex", 9) == 0) {
+			req->desc_index = tmp;
+		} else if (key_len == 6 && memcmp(p, "Langid", 6) == 0) {
+			req->langid = tmp;
+		} else {
+			return -1;
+		}
+		p = comma + 1;
+	}
+	return 0;
+}
+
+/* base64 payloads of lazily loaded indexes are decoded once, on first use */
+static int
+emu_replay_payload(EmuReplay *replay, const EmuIndexEvent *event, int out, const uint8_t **data, size_t *len)
+{
+	EmuIndexRef ref = out ? event->data_out : event->data;
+	int encoded = (event->flags & EMU_INDEX_EVENT_FLAG_ENCODED) &&
+		      (out || (event->flags & EMU_INDEX_EVENT_FLAG_BASE64));
+	EmuReplayPayload *payload;
+
+	if (!encoded) {
+		*data = emu_index_data(&replay->idx, ref);
+		*len = ref.len;
+		return 0;
+	}
+	if (replay->decoded == NULL) {
+		replay->decoded = calloc((size_t) replay->idx.hdr->n_events * 2, sizeof(EmuReplayPayload));
+		if (replay->decoded == NULL)
+			return -1;
+	}
+	payload = &replay->decoded[(event - replay->idx.events) * 2 + out];
+	if (payload->data == NULL) {
+		/* one spare byte so that empty payloads are cached too */
+		payload->data = malloc(EMU_BASE64_DECODED_MAX(ref.len) + 1);
+		if (payload->data == NULL)
+			return -1;
+		if (emu_base64_decode((const char *) emu_index_data(&replay->idx, ref), ref.len,
+				      payload->data, &payload->len) < 0) {
+			free(payload->data);
+			payload->data = NULL;
+			return -1;
+		}
+	}
+	*data = payload->data;
+	*len = payload->len;
+	return 0;
+}
+
+/* returns 0 with the recorded response, or -1 if nothing was recorded */
+int
+emu_replay_request(EmuReplay *replay, uint32_t device, const EmuReplayRequest *req, EmuReplayResponse *rsp)
+{
+	size_t needed = EMU_REPLAY_ID_FIXED_MAX + EMU_BASE64_ENCODED_SIZE(req->data_len) + req->name_len;
+	const EmuIndexEvent *event;
+	int id_len;
+
+	if (device >= replay->idx.hdr->n_devices)
+		return -1;
+	if (needed > replay->id_alloc) {
+		char *tmp = realloc(replay->id, needed);
+		if (tmp == NULL)
+			return -1;
+		replay->id = tmp;
+		replay->id_alloc = needed;
+	}
+	id_len = emu_replay_request_format(req, replay->id, replay->id_alloc);
+	if (id_len < 0)
+		return -1;
+	event = emu_index_lookup(&replay->idx, device, replay->id, id_len, &replay->cursors[device]);
+	if (event == NULL)
+		return -1;
+
+	/* ioctls return the buffer as modified by the kernel */
+	if (emu_replay_payload(replay, event, (event->flags & EMU_INDEX_EVENT_FLAG_DATA_OUT) != 0,
+			       &rsp->data, &rsp->len) < 0)
+		return -1;
+	rsp->error = event->flags & EMU_INDEX_EVENT_FLAG_ERROR ? event->error : 0;
+	rsp->event = event - replay->idx.events;
+	rsp->ready_ns = 0;
+	if (replay->timing != EMU_REPLAY_TIMING_NONE && (event->flags & EMU_INDEX_EVENT_FLAG_TIMING))
+		rsp->ready_ns = emu_replay_ready_ns(replay, device, event);
+	return 0;
+}
+
+int
+emu_replay_session_init(EmuReplaySession *session, const EmuReplay *replay)
+{
+	const EmuIndex *idx = &replay->idx;
+	size_t scratch_len = 0;
+	size_t offset = 0;
+	size_t tmp_len = 0;
+	char *tmp;
+
+	memset(session, 0, sizeof(EmuReplaySession));
+	for (uint32_t i = 0; i < idx->hdr->n_keys; i++) {
+		scratch_len += idx->keys[i].id.len;
+		if (idx->keys[i].id.len > tmp_len)
+			tmp_len = idx->keys[i].id.len;
+	}
+	tmp_len = tmp_len * 2 + EMU_REPLAY_ID_FIXED_MAX;
+	tmp = malloc(tmp_len);
+	session->reqs = calloc(idx->hdr->n_events + 1, sizeof(EmuReplayRequest));
+	session->devices = calloc(idx->hdr->n_events + 1, sizeof(uint32_t));
+	session->scratch = malloc(scratch_len + 1);
+	if (tmp == NULL || session->reqs == NULL || session->devices == NULL || session->scratch == NULL) {
+		free(tmp);
+		emu_replay_session_clear(session);
+		return -1;
+	}
+
+	for (uint32_t d = 0; d < idx->hdr->n_devices; d++) {
+		const EmuIndexDevice *device = &idx->devices[d];
+		for (uint32_t i = device->first_event; i < device->first_event + device->n_events; i++) {
+			const EmuIndexKey *key = &idx->keys[idx->events[i].key];
+			const char *id = (const char *) emu_index_data(idx, key->id);
+			EmuReplayRequest *req = &session->reqs[i];
+
+			/* a repeated Id is the same request */
+			session->devices[i] = d;
+			if (idx->slots[key->first_slot] != i) {
+				*req = session->reqs[idx->slots[key->first_slot]];
+				if (req->kind == EMU_REPLAY_KIND_UNKNOWN)
+					session->n_raw++;
+				continue;
+			}
+
+			/* keep the raw Id unless it formats back exactly */
+			if (emu_replay_request_parse(req, id, key->id.len, session->scratch + offset) < 0 ||
+			    emu_replay_request_format(req, tmp, tmp_len) != (int) key->id.len ||
+			    memcmp(tmp, id, key->id.len) != 0) {
+				memset(req, 0, sizeof(EmuReplayRequest));
+				req->name = id;
+				req->name_len = key->id.len;
+			}
+			if (req->kind == EMU_REPLAY_KIND_UNKNOWN)
+				session->n_raw++;
+			offset += req->data_len;
+		}
+	}
+	session->n_reqs = idx->hdr->n_events;
+	free(tmp);
+	return 0;
+}
+
+void
+emu_replay_session_clear(EmuReplaySession *session)
+{
+	free(session->reqs);
+	free(session->devices);
+	free(session->scratch);
+	memset(session, 0, sizeof(EmuReplaySession));
+}
+
+/* replays one whole session, returning the number of requests that failed */
+uint32_t
+emu_replay_session_run(EmuReplay *replay, const EmuReplaySession *session)
+{
+	uint32_t failures = 0;
+
+	emu_replay_reset(replay);
+	for (uint32_t i = 0; i < session->n_reqs; i++) {
+		EmuReplayResponse rsp;
+		if (emu_replay_request(replay, session->devices[i], &session->reqs[i], &rsp) < 0 ||
+		    rsp.event != i)
+			failures++;
+	}
+	return failures;
+}
@@ -0,0 +1,167 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __EMU_REPLAY_H
+#define __EMU_REPLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "emu-index.h"
+
+/*
+ * Replay engine for emulation archives.
+ *
+ * A request is described by an EmuReplayRequest, formatted into the same Id
+ * string fwupd records and looked up in the index. The response points into
+ * the index, so answering a request copies nothing.
+ *
+ * Each device has a cursor, so repeated requests with the same Id are
+ * answered in recorded order. emu_replay_reset() rewinds every cursor to
+ * start a new session.
+ *
+ * The index is never written after loading, so emu_replay_open_shared()
+ * gives another thread its own cursors over the same index. Archives are
+ * loaded with emu_loader_open(), which leaves the base64 payloads encoded;
+ * each EmuReplay decodes those it is asked for once and keeps them.
+ *
+ * An EmuReplaySession holds the requests recovered from the recorded Ids,
+ * one per event, for driving the engine as the original host did.
+ *
+ * Archives that recorded Timestamp and Duration can be replayed at the
+ * pace of the real device: emu_replay_set_timing() makes every response
+ * carry the CLOCK_MONOTONIC time it is due, scaled by a factor, and the
+ * caller either waits for it with emu_replay_wait() or schedules it on an
+ * EmuTimerWheel. Events without timing are always due at once.
+ */
+
+typedef enum {
+	EMU_REPLAY_KIND_UNKNOWN,	/* replayed by raw Id */
+	EMU_REPLAY_KIND_CONTROL_TRANSFER,
+	EMU_REPLAY_KIND_BULK_TRANSFER,
+	EMU_REPLAY_KIND_GET_STRING_DESCRIPTOR,
+	EMU_REPLAY_KIND_GET_STRING_DESCRIPTOR_BYTES,
+	EMU_REPLAY_KIND_READ_ATTR,
+	EMU_REPLAY_KIND_READ_PROP,
+	EMU_REPLAY_KIND_IOCTL,
+	EMU_REPLAY_KIND_SIOCETHTOOL_IOCTL,
+	EMU_REPLAY_KIND_GET_SYMLINK_TARGET,
+	EMU_REPLAY_KIND_LAST
+} EmuReplayKind;
+
+typedef enum {
+	EMU_REPLAY_TIMING_NONE,		/* answer at once */
+	EMU_REPLAY_TIMING_DURATION,	/* each answer takes its recorded Duration */
+	EMU_REPLAY_TIMING_TIMESTAMP,	/* and is never earlier than its Timestamp */
+	EMU_REPLAY_TIMING_LAST
+} EmuReplayTiming;
+
+typedef struct {
+	EmuReplayKind	 kind;
+	uint8_t		 direction;
+	uint8_t		 request_type;
+	uint8_t		 recipient;
+	uint8_t		 request;
+	uint16_t	 value;
+	uint16_t	 idx;
+	uint8_t		 endpoint;
+	uint8_t		 desc_index;
+	uint16_t	 langid;
+	uint32_t	 ioctl_request;
+	uint32_t	 length;
+	const char	*name;		/* Attr or Key, or the Id if unknown */
+	size_t		 name_len;
+	const uint8_t	*data;		/* sent to the device */
+	size_t		 data_len;
+} EmuReplayRequest;
+
+typedef struct {
+	const uint8_t	*data;
+	size_t		 len;
+	int32_t		 error;		/* recorded error, 0 for none */
+	uint32_t	 event;		/* index of the event that answered */
+	uint64_t	 ready_ns;	/* when the answer is due, 0 for at once */
+} EmuReplayResponse;
+
+/* a payload decoded on first use */
+typedef struct {
+	uint8_t		*data;
+	size_t		 len;
+} EmuReplayPayload;
+
+typedef struct {
+	EmuIndex	 idx;
+	uint32_t	*cursors;
+	char		*id;		/* scratch for formatting Ids */
+	size_t		 id_alloc;
+	int		 shared;	/* idx belongs to another EmuReplay */
+	EmuReplayTiming	 timing;
+	double		 scale;
+	uint64_t	*created_ns;	/* per device, 0 until first used */
+	EmuReplayPayload *decoded;	/* two per event, Data and DataOut */
+} EmuReplay;
+
+typedef struct {
+	EmuReplayRequest *reqs;		/* indexed by event */
+	uint32_t	*devices;
+	uint32_t	 n_reqs;
+	uint32_t	 n_raw;		/* replayed by raw Id */
+	uint8_t		*scratch;	/* decoded request Data */
+} EmuReplaySession;
+
+int		 emu_replay_open		(EmuReplay	*replay,
+						 const char	*filename);
+int		 emu_replay_open_index		(EmuReplay	*replay,
+						 EmuIndex	*idx);
+int		 emu_replay_open_with_table	(EmuReplay	*replay,
+						 const char	*filename,
+						 EmuPayloadTable *table);
+int		 emu_replay_open_shared	(EmuReplay	*replay,
+						 const EmuReplay *parent);
+void		 emu_replay_close		(EmuReplay	*replay);
+void		 emu_replay_reset		(EmuReplay	*replay);
+void		 emu_replay_set_timing		(EmuReplay	*replay,
+						 EmuReplayTiming timing,
+						 double		 scale);
+void		 emu_replay_wait		(const EmuReplayResponse *rsp);
+int		 emu_replay_request		(EmuReplay	*replay,
+						 uint32_t	 device,
+						 const EmuReplayRequest *req,
+						 EmuReplayResponse *rsp);
+
+const char	*emu_replay_kind_to_string	(EmuReplayKind	 kind);
+const char	*emu_replay_timing_to_string	(EmuReplayTiming timing);
+EmuReplayTiming	 emu_replay_timing_from_string	(const char	*str);
+int		 emu_replay_request_parse	(EmuReplayRequest *req,
+						 const char	*id,
+						 size_t		 id_len,
+						 uint8_t	*scratch);
+int		 emu_replay_request_format	(const EmuReplayRequest *req,
+						 char		*buf,
+						 size_t		 bufsz);
+
+int		 emu_replay_session_init	(EmuReplaySession *session,
+						 const EmuReplay *replay);
+void		 emu_replay_session_clear	(EmuReplaySession *session);
+uint32_t	 emu_replay_session_run		(EmuReplay	*replay,
+						 const EmuReplaySession *session);
+
+#endif /* __EMU_REPLAY_H */
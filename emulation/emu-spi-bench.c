@@ -0,0 +1,780 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Models reading and writing a whole SPI flash through a CH341A or CH347,
+ * once with the transfer pattern in the winchiphead archives and once with
+ * aggregated, pipelined transfers, and reports the time each would take.
+ *
+ * The recorded pattern is the one fwupd uses: every SPI command is its own
+ * chip select frame, its bytes go in the chunk size seen in the recording
+ * with an OUT and an IN transfer per chunk, and every transfer completes
+ * before the next is submitted. The aggregated pattern sends each command
+ * in one OUT transfer, several commands per packet on the CH347, and keeps
+ * up to --queue transfers in flight, only waiting when it needs the status
+ * register to decide what to do next.
+ *
+ * The recorded transfers of every archive are replayed against the
+ * simulator first, with no flash fitted as when they were recorded, and must
+ * give the recorded responses.
+ *
+ * Time is modelled, not measured. A transfer starts latency_ns after it is
+ * submitted, once the bridge has finished the one before, and then takes
+ * the bus time of its packets plus the SPI clocks it needs.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emu-replay.h"
+#include "emu-spi.h"
+
+#define SPI_BENCH_SIZE_DEFAULT		0x1000000	/* 16 MiB */
+#define SPI_BENCH_QUEUE_DEFAULT		32
+#define SPI_BENCH_CH341A_PACKETS_MAX	256		/* per OUT transfer */
+#define SPI_BENCH_CH347_BATCH_MAX	4096		/* bytes of commands per OUT transfer */
+#define SPI_BENCH_POLLS_MAX		1000000
+
+typedef struct {
+	EmuSpiBridgeKind kind;
+	uint16_t	 vid;
+	uint16_t	 pid;
+	uint8_t		 miso_idle;	/* what the bridge reads with no flash */
+	uint64_t	 packet_ns;	/* bus time of a full packet */
+	uint64_t	 latency_ns;	/* from submitting a transfer to its first packet */
+	uint64_t	 spi_hz;
+	size_t		 chunk;		/* SPI bytes per transfer, from the recording */
+	int		 recorded;	/* chunk was seen in an archive */
+} SpiBenchBridge;
+
+static SpiBenchBridge spi_bench_bridges[] = {
+	/* full speed, a transfer completes in the next 1 ms frame, SPI at ~1.5 MHz */
+	{ EMU_SPI_BRIDGE_CH341A, 0x1a86, 0x5512, 0xff, 30000, 1000000, 1500000, 26, 0 },
+	/* high speed, a transfer completes in the next 125 us microframe */
+	{ EMU_SPI_BRIDGE_CH347, 0x1a86, 0x55db, 0x00, 9000, 125000, 15000000, 507, 0 },
+};
+
+typedef enum {
+	SPI_BENCH_PATTERN_RECORDED,
+	SPI_BENCH_PATTERN_AGGREGATED,
+	SPI_BENCH_PATTERN_LAST
+} SpiBenchPattern;
+
+typedef struct {
+	uint8_t		*buf;		/* NULL to drop the data */
+	size_t		 len;
+} SpiBenchRead;
+
+typedef struct {
+	const SpiBenchBridge *profile;
+	SpiBenchPattern	 pattern;
+	EmuSpiFlash	 flash;
+	EmuSpiBridge	 bridge;
+	unsigned	 depth;		/* transfers in flight */
+	uint64_t	*done_ns;	/* completion of the last depth transfers */
+	uint64_t	 n_transfers;
+	uint64_t	 bridge_free_ns;
+	uint64_t	 barrier_ns;	/* nothing is submitted before this */
+	uint64_t	 end_ns;
+	/* CH347 commands not sent yet, and the reads they will return */
+	uint8_t		 batch[SPI_BENCH_CH347_BATCH_MAX + EMU_SPI_CH347_PACKET_SIZE];
+	size_t		 batch_len;
+	SpiBenchRead	*reads;
+	size_t		 n_reads;
+	size_t		 n_reads_alloc;
+} SpiBenchHost;
+
+static const char *
+spi_bench_pattern_to_string(SpiBenchPattern pattern)
+{
+	return pattern == SPI_BENCH_PATTERN_RECORDED ? "recorded" : "aggregated";
+}
+
+static int
+spi_bench_host_init(SpiBenchHost *host, const SpiBenchBridge *profile, SpiBenchPattern pattern,
+		    unsigned depth, size_t size)
+{
+	memset(host, 0, sizeof(SpiBenchHost));
+	host->profile = profile;
+	host->pattern = pattern;
+	host->depth = pattern == SPI_BENCH_PATTERN_RECORDED ? 1 : depth;
+	host->done_ns = calloc(host->depth, sizeof(uint64_t));
+	if (host->done_ns == NULL || emu_spi_flash_init(&host->flash, size) < 0)
+		return -1;
+	host->flash.byte_ns = 8000000000ull / profile->spi_hz;
+	emu_spi_bridge_init(&host->bridge, profile->kind, &host->flash);
+	return 0;
+}
+
+static void
+spi_bench_host_clear(SpiBenchHost *host)
+{
+	emu_spi_bridge_clear(&host->bridge);
+	emu_spi_flash_clear(&host->flash);
+	free(host->done_ns);
+	free(host->reads);
+}
+
+/* one bulk transfer, OUT if actual is NULL */
+static int
+spi_bench_transfer(SpiBenchHost *host, uint8_t *buf, size_t len, size_t *actual)
+{
+	uint64_t *done = &host->done_ns[host->n_transfers % host->depth];
+	uint64_t start = (*done > host->barrier_ns ? *done : host->barrier_ns) + host->profile->latency_ns;
+	size_t packet_size = host->bridge.packet_size;
+	size_t n = len;
+	int rc;
+
+	if (start < host->bridge_free_ns)
+		start = host->bridge_free_ns;
+	host->flash.now_ns = start;
+	if (actual == NULL) {
+		rc = emu_spi_bridge_out(&host->bridge, buf, len);
+	} else {
+		rc = emu_spi_bridge_in(&host->bridge, buf, len, actual);
+		n = *actual;
+	}
+	if (rc < 0) {
+		fprintf(stderr, "%s: bulk %s transfer %lu failed\n",
+			emu_spi_bridge_kind_to_string(host->profile->kind),
+			actual == NULL ? "OUT" : "IN", (unsigned long) host->n_transfers);
+		return -1;
+	}
+
+	/* the SPI clocks advanced the flash, then the packets cross the bus */
+	*done = host->flash.now_ns + (n / packet_size + 1) * host->profile->packet_ns;
+	host->bridge_free_ns = *done;
+	if (*done > host->end_ns)
+		host->end_ns = *done;
+	host->n_transfers++;
+	return 0;
+}
+
+/* the results of everything submitted are needed before going on */
+static void
+spi_bench_wait(SpiBenchHost *host)
+{
+	host->barrier_ns = host->end_ns;
+}
+
+static int
+spi_bench_ch341a_recorded(SpiBenchHost *host, const uint8_t *wbuf, size_t wlen, uint8_t *rbuf, size_t rlen)
+{
+	uint8_t cs_assert[] = { EMU_SPI_CH341A_CMD_UIO_STREAM,
+				EMU_SPI_CH341A_UIO_STM_OUT | 0x36,
+				EMU_SPI_CH341A_UIO_STM_DIR | 0x3f,
+				EMU_SPI_CH341A_UIO_STM_END };
+	uint8_t cs_deassert[] = { EMU_SPI_CH341A_CMD_UIO_STREAM,
+				  EMU_SPI_CH341A_UIO_STM_OUT | 0x37,
+				  EMU_SPI_CH341A_UIO_STM_DIR,
+				  EMU_SPI_CH341A_UIO_STM_END };
+	uint8_t pkt[EMU_SPI_CH341A_PACKET_SIZE];
+	size_t chunk = host->profile->chunk;
+
+	if (spi_bench_transfer(host, cs_assert, sizeof(cs_assert), NULL) < 0)
+		return -1;
+	for (size_t off = 0; off < wlen + rlen; off += chunk) {
+		size_t n = wlen + rlen - off < chunk ? wlen + rlen - off : chunk;
+		size_t actual;
+
+		pkt[0] = EMU_SPI_CH341A_CMD_SPI_STREAM;
+		for (size_t i = 0; i < n; i++)
+			pkt[i + 1] = emu_spi_reverse(off + i < wlen ? wbuf[off + i] : 0x00);
+		if (spi_bench_transfer(host, pkt, n + 1, NULL) < 0 ||
+		    spi_bench_transfer(host, pkt, n, &actual) < 0 || actual != n)
+			return -1;
+		for (size_t i = 0; i < n; i++) {
+			if (off + i >= wlen && rbuf != NULL)
+				rbuf[off + i - wlen] = emu_spi_reverse(pkt[i]);
+		}
+	}
+	return spi_bench_transfer(host, cs_deassert, sizeof(cs_deassert), NULL);
+}
+
+/* CH347 command header, returns the length */
+static size_t
+spi_bench_ch347_header(uint8_t *buf, uint8_t cmd, size_t len)
+{
+	buf[0] = cmd;
+	buf[1] = len;
+	buf[2] = len >> 8;
+	return 3;
+}
+
+static size_t
+spi_bench_ch347_cs(uint8_t *buf, int selected)
+{
+	size_t n = spi_bench_ch347_header(buf, EMU_SPI_CH347_CMD_SPI_CS_CTRL, 10);
+	memset(buf + n, 0, 10);
+	buf[n] = EMU_SPI_CH347_CS_VALID | (selected ? 0 : EMU_SPI_CH347_CS_DEASSERT);
+	return n + 10;
+}
+
+static size_t
+spi_bench_ch347_read(uint8_t *buf, uint32_t count)
+{
+	size_t n = spi_bench_ch347_header(buf, EMU_SPI_CH347_CMD_SPI_IN, 4);
+	buf[n++] = count;
+	buf[n++] = count >> 8;
+	buf[n++] = count >> 16;
+	buf[n++] = count >> 24;
+	return n;
+}
+
+/* each reply is one packet, a header and up to 507 bytes */
+static int
+spi_bench_ch347_replies(SpiBenchHost *host, uint8_t *rbuf, size_t rlen)
+{
+	uint8_t pkt[EMU_SPI_CH347_PACKET_SIZE];
+
+	for (size_t off = 0; off < rlen;) {
+		size_t actual, n;
+		if (spi_bench_transfer(host, pkt, EMU_SPI_CH347_PAYLOAD_MAX + 3, &actual) < 0)
+			return -1;
+		n = actual >= 3 ? (size_t) (pkt[1] | pkt[2] << 8) : 0;
+		if (n == 0 || n + 3 != actual || n > rlen - off)
+			return -1;
+		if (rbuf != NULL)
+			memcpy(rbuf + off, pkt + 3, n);
+		off += n;
+	}
+	return 0;
+}
+
+static int
+spi_bench_ch347_recorded(SpiBenchHost *host, const uint8_t *wbuf, size_t wlen, uint8_t *rbuf, size_t rlen)
+{
+	uint8_t pkt[EMU_SPI_CH347_PACKET_SIZE];
+	size_t chunk = host->profile->chunk;
+	size_t n;
+
+	n = spi_bench_ch347_cs(pkt, 1);
+	if (spi_bench_transfer(host, pkt, n, NULL) < 0)
+		return -1;
+	for (size_t off = 0; off < wlen; off += chunk) {
+		size_t len = wlen - off < chunk ? wlen - off : chunk;
+		n = spi_bench_ch347_header(pkt, EMU_SPI_CH347_CMD_SPI_OUT_IN, len);
+		memcpy(pkt + n, wbuf + off, len);
+		if (spi_bench_transfer(host, pkt, n + len, NULL) < 0 ||
+		    spi_bench_ch347_replies(host, NULL, len) < 0)
+			return -1;
+	}
+	if (rlen > 0) {
+		n = spi_bench_ch347_read(pkt, rlen);
+		if (spi_bench_transfer(host, pkt, n, NULL) < 0 ||
+		    spi_bench_ch347_replies(host, rbuf, rlen) < 0)
+			return -1;
+	}
+	n = spi_bench_ch347_cs(pkt, 0);
+	return spi_bench_transfer(host, pkt, n, NULL);
+}
+
+/*
+ * Chip select is plucked, raised then lowered, at the start of a command and
+ * left low after it, so a command takes effect when the next one begins.
+ * The SPI stream runs to the end of its packet, so a command ends its OUT
+ * transfer rather than sharing a packet with the next one.
+ */
+static int
+spi_bench_ch341a_aggregated(SpiBenchHost *host, const uint8_t *wbuf, size_t wlen, uint8_t *rbuf, size_t rlen)
+{
+	const size_t per_packet = EMU_SPI_CH341A_PACKET_SIZE - 1;
+	uint8_t out[SPI_BENCH_CH341A_PACKETS_MAX * EMU_SPI_CH341A_PACKET_SIZE];
+	size_t total = wlen + rlen;
+	size_t off = 0;
+	size_t len = 0;
+
+	memset(out, 0, EMU_SPI_CH341A_PACKET_SIZE);
+	out[0] = EMU_SPI_CH341A_CMD_UIO_STREAM;
+	out[1] = EMU_SPI_CH341A_UIO_STM_OUT | 0x37;
+	out[2] = EMU_SPI_CH341A_UIO_STM_OUT | 0x36;
+	out[3] = EMU_SPI_CH341A_UIO_STM_DIR | 0x3f;
+	out[4] = EMU_SPI_CH341A_UIO_STM_END;
+	len = EMU_SPI_CH341A_PACKET_SIZE;
+
+	while (off < total) {
+		size_t start = off;
+
+		/* fill one OUT transfer, then queue an IN for each packet */
+		while (off < total && len + EMU_SPI_CH341A_PACKET_SIZE <= sizeof(out)) {
+			size_t n = total - off < per_packet ? total - off : per_packet;
+			out[len++] = EMU_SPI_CH341A_CMD_SPI_STREAM;
+			for (size_t i = 0; i < n; i++)
+				out[len++] = emu_spi_reverse(off + i < wlen ? wbuf[off + i] : 0x00);
+			off += n;
+		}
+		if (spi_bench_transfer(host, out, len, NULL) < 0)
+			return -1;
+		len = 0;
+		while (start < off) {
+			uint8_t pkt[EMU_SPI_CH341A_PACKET_SIZE];
+			size_t n = off - start < per_packet ? off - start : per_packet;
+			size_t actual;
+			if (spi_bench_transfer(host, pkt, per_packet, &actual) < 0 || actual != n)
+				return -1;
+			for (size_t i = 0; i < n; i++) {
+				if (start + i >= wlen && rbuf != NULL)
+					rbuf[start + i - wlen] = emu_spi_reverse(pkt[i]);
+			}
+			start += n;
+		}
+	}
+	return 0;
+}
+
+static int
+spi_bench_ch347_flush(SpiBenchHost *host)
+{
+	if (host->batch_len == 0)
+		return 0;
+	if (spi_bench_transfer(host, host->batch, host->batch_len, NULL) < 0)
+		return -1;
+	host->batch_len = 0;
+	for (size_t i = 0; i < host->n_reads; i++) {
+		if (spi_bench_ch347_replies(host, host->reads[i].buf, host->reads[i].len) < 0)
+			return -1;
+	}
+	host->n_reads = 0;
+	return 0;
+}
+
+/* whole commands are batched, several to a packet, and sent when needed */
+static int
+spi_bench_ch347_aggregated(SpiBenchHost *host, const uint8_t *wbuf, size_t wlen, uint8_t *rbuf, size_t rlen)
+{
+	size_t needed = 2 * 13 + (wlen / EMU_SPI_CH347_PAYLOAD_MAX + 1) * 3 + wlen + 7;
+
+	if (host->batch_len + needed > SPI_BENCH_CH347_BATCH_MAX && spi_bench_ch347_flush(host) < 0)
+		return -1;
+	if (needed > SPI_BENCH_CH347_BATCH_MAX)
+		return -1;
+	host->batch_len += spi_bench_ch347_cs(host->batch + host->batch_len, 1);
+	for (size_t off = 0; off < wlen; off += EMU_SPI_CH347_PAYLOAD_MAX) {
+		size_t len = wlen - off < EMU_SPI_CH347_PAYLOAD_MAX ? wlen - off : EMU_SPI_CH347_PAYLOAD_MAX;
+		host->batch_len += spi_bench_ch347_header(host->batch + host->batch_len,
+							  EMU_SPI_CH347_CMD_SPI_OUT, len);
+		memcpy(host->batch + host->batch_len, wbuf + off, len);
+		host->batch_len += len;
+	}
+	if (rlen > 0) {
+		if (host->n_reads == host->n_reads_alloc) {
+			size_t n_alloc = host->n_reads_alloc ? host->n_reads_alloc * 2 : 16;
+			SpiBenchRead *tmp = realloc(host->reads, n_alloc * sizeof(SpiBenchRead));
+			if (tmp == NULL)
+				return -1;
+			host->reads = tmp;
+			host->n_reads_alloc = n_alloc;
+		}
+		host->reads[host->n_reads].buf = rbuf;
+		host->reads[host->n_reads].len = rlen;
+		host->n_reads++;
+		host->batch_len += spi_bench_ch347_read(host->batch + host->batch_len, rlen);
+	}
+	host->batch_len += spi_bench_ch347_cs(host->batch + host->batch_len, 0);
+	return 0;
+}
+
+/* one SPI command: wlen bytes out, then rlen bytes in */
+static int
+spi_bench_command(SpiBenchHost *host, const uint8_t *wbuf, size_t wlen, uint8_t *rbuf, size_t rlen, int wait)
+{
+	int rc;
+
+	if (host->pattern == SPI_BENCH_PATTERN_RECORDED) {
+		if (host->profile->kind == EMU_SPI_BRIDGE_CH341A)
+			return spi_bench_ch341a_recorded(host, wbuf, wlen, rbuf, rlen);
+		return spi_bench_ch347_recorded(host, wbuf, wlen, rbuf, rlen);
+	}
+	if (host->profile->kind == EMU_SPI_BRIDGE_CH341A) {
+		rc = spi_bench_ch341a_aggregated(host, wbuf, wlen, rbuf, rlen);
+	} else {
+		rc = spi_bench_ch347_aggregated(host, wbuf, wlen, rbuf, rlen);
+		if (rc == 0 && wait)
+			rc = spi_bench_ch347_flush(host);
+	}
+	if (rc == 0 && wait)
+		spi_bench_wait(host);
+	return rc;
+}
+
+/* sends anything still batched and ends the last command */
+static int
+spi_bench_finish(SpiBenchHost *host)
+{
+	uint8_t buf[16];
+	size_t n = 0;
+
+	if (host->pattern == SPI_BENCH_PATTERN_AGGREGATED) {
+		if (host->profile->kind == EMU_SPI_BRIDGE_CH347) {
+			if (spi_bench_ch347_flush(host) < 0)
+				return -1;
+		} else {
+			buf[n++] = EMU_SPI_CH341A_CMD_UIO_STREAM;
+			buf[n++] = EMU_SPI_CH341A_UIO_STM_OUT | 0x37;
+			buf[n++] = EMU_SPI_CH341A_UIO_STM_DIR;
+			buf[n++] = EMU_SPI_CH341A_UIO_STM_END;
+			if (spi_bench_transfer(host, buf, n, NULL) < 0)
+				return -1;
+		}
+	}
+	spi_bench_wait(host);
+	return 0;
+}
+
+static int
+spi_bench_probe(SpiBenchHost *host)
+{
+	const uint8_t cmd = EMU_SPI_FLASH_CMD_READ_ID;
+	uint8_t id[3];
+
+	if (spi_bench_command(host, &cmd, 1, id, sizeof(id), 1) < 0)
+		return -1;
+	if (memcmp(id, host->flash.jedec_id, sizeof(id)) != 0) {
+		fprintf(stderr, "%s: read JEDEC ID %02x%02x%02x\n",
+			emu_spi_bridge_kind_to_string(host->profile->kind), id[0], id[1], id[2]);
+		return -1;
+	}
+	return 0;
+}
+
+static int
+spi_bench_poll(SpiBenchHost *host)
+{
+	const uint8_t cmd = EMU_SPI_FLASH_CMD_READ_STATUS;
+
+	for (unsigned i = 0; i < SPI_BENCH_POLLS_MAX; i++) {
+		uint8_t status;
+		if (spi_bench_command(host, &cmd, 1, &status, 1, 1) < 0)
+			return -1;
+		if ((status & EMU_SPI_FLASH_STATUS_WIP) == 0)
+			return 0;
+	}
+	return -1;
+}
+
+/* reading is one command per chunk when recorded, one for the chip otherwise */
+static int
+spi_bench_read(SpiBenchHost *host, uint8_t *buf, size_t size)
+{
+	size_t chunk = size;
+
+	if (host->pattern == SPI_BENCH_PATTERN_RECORDED) {
+		/* the CH341A sends the command in the same chunk as the data */
+		chunk = host->profile->chunk;
+		if (host->profile->kind == EMU_SPI_BRIDGE_CH341A)
+			chunk -= 4;
+	}
+	for (size_t addr = 0; addr < size; addr += chunk) {
+		uint8_t cmd[] = { EMU_SPI_FLASH_CMD_READ, addr >> 16, addr >> 8, addr };
+		size_t n = size - addr < chunk ? size - addr : chunk;
+		if (spi_bench_command(host, cmd, sizeof(cmd), buf + addr, n, 0) < 0)
+			return -1;
+	}
+	return spi_bench_finish(host);
+}
+
+static int
+spi_bench_write(SpiBenchHost *host, const uint8_t *image, size_t size)
+{
+	const uint8_t wren = EMU_SPI_FLASH_CMD_WRITE_ENABLE;
+	uint8_t cmd[4 + EMU_SPI_FLASH_PAGE_SIZE];
+
+	for (size_t addr = 0; addr < size; addr += EMU_SPI_FLASH_SECTOR_SIZE) {
+		cmd[0] = EMU_SPI_FLASH_CMD_SECTOR_ERASE;
+		cmd[1] = addr >> 16;
+		cmd[2] = addr >> 8;
+		cmd[3] = addr;
+		if (spi_bench_command(host, &wren, 1, NULL, 0, 0) < 0 ||
+		    spi_bench_command(host, cmd, 4, NULL, 0, 0) < 0 ||
+		    spi_bench_poll(host) < 0)
+			return -1;
+	}
+	for (size_t addr = 0; addr < size; addr += EMU_SPI_FLASH_PAGE_SIZE) {
+		cmd[0] = EMU_SPI_FLASH_CMD_PAGE_PROGRAM;
+		cmd[1] = addr >> 16;
+		cmd[2] = addr >> 8;
+		cmd[3] = addr;
+		memcpy(cmd + 4, image + addr, EMU_SPI_FLASH_PAGE_SIZE);
+		if (spi_bench_command(host, &wren, 1, NULL, 0, 0) < 0 ||
+		    spi_bench_command(host, cmd, sizeof(cmd), NULL, 0, 0) < 0 ||
+		    spi_bench_poll(host) < 0)
+			return -1;
+	}
+	return spi_bench_finish(host);
+}
+
+static SpiBenchBridge *
+spi_bench_bridge_find(uint16_t vid, uint16_t pid)
+{
+	for (unsigned i = 0; i < EMU_SPI_BRIDGE_LAST; i++) {
+		if (spi_bench_bridges[i].vid == vid && spi_bench_bridges[i].pid == pid)
+			return &spi_bench_bridges[i];
+	}
+	return NULL;
+}
+
+/* the recorded transfers must get the recorded responses from the simulator */
+static int
+spi_bench_check_archive(const char *filename)
+{
+	const char *name = strrchr(filename, '/');
+	EmuReplay replay;
+	EmuReplaySession session;
+	int rc = 0;
+
+	name = name != NULL ? name + 1 : filename;
+	if (emu_replay_open(&replay, filename) < 0)
+		return -1;
+	if (emu_replay_session_init(&session, &replay) < 0) {
+		emu_replay_close(&replay);
+		return -1;
+	}
+	for (uint32_t d = 0; d < replay.idx.hdr->n_devices; d++) {
+		const EmuIndexDevice *device = &replay.idx.devices[d];
+		SpiBenchBridge *profile = spi_bench_bridge_find(device->vid, device->pid);
+		EmuSpiFlash flash;
+		EmuSpiBridge bridge;
+		unsigned n_transfers = 0, n_differ = 0;
+		size_t chunk = 0;
+
+		if (profile == NULL) {
+			fprintf(stderr, "%s: %04x:%04x is not a CH341A or CH347\n", name, device->vid, device->pid);
+			rc = -1;
+			continue;
+		}
+		emu_spi_flash_init(&flash, 0);
+		flash.miso_idle = profile->miso_idle;
+		emu_spi_bridge_init(&bridge, profile->kind, &flash);
+		emu_replay_reset(&replay);
+		for (uint32_t i = 0; i < session.n_reqs; i++) {
+			const EmuReplayRequest *req = &session.reqs[i];
+			EmuReplayResponse rsp;
+
+			if (session.devices[i] != d || emu_replay_request(&replay, d, req, &rsp) < 0 ||
+			    req->kind != EMU_REPLAY_KIND_BULK_TRANSFER)
+				continue;
+			n_transfers++;
+			if (req->endpoint & 0x80) {
+				uint8_t *buf = malloc(req->length + 1);
+				size_t actual = 0;
+				if (buf == NULL ||
+				    emu_spi_bridge_in(&bridge, buf, req->length, &actual) < 0 ||
+				    actual != rsp.len || memcmp(buf, rsp.data, actual) != 0)
+					n_differ++;
+				free(buf);
+				if (profile->kind == EMU_SPI_BRIDGE_CH347 && req->length > chunk + 3)
+					chunk = req->length - 3;
+			} else {
+				if (emu_spi_bridge_out(&bridge, req->data, req->data_len) < 0)
+					n_differ++;
+				if (profile->kind == EMU_SPI_BRIDGE_CH341A && req->data_len > chunk + 1 &&
+				    req->data[0] == EMU_SPI_CH341A_CMD_SPI_STREAM)
+					chunk = req->data_len - 1;
+			}
+		}
+		emu_spi_bridge_clear(&bridge);
+		emu_spi_flash_clear(&flash);
+
+		printf("%s: %s, %u bulk transfers replayed, %u differ, %zu byte chunks\n",
+		       name, emu_spi_bridge_kind_to_string(profile->kind), n_transfers, n_differ, chunk);
+		if (n_differ > 0 || chunk == 0 || chunk > EMU_SPI_CH347_PAYLOAD_MAX ||
+		    (profile->kind == EMU_SPI_BRIDGE_CH341A &&
+		     (chunk <= 4 || chunk >= EMU_SPI_CH341A_PACKET_SIZE))) {
+			rc = -1;
+			continue;
+		}
+		profile->chunk = chunk;
+		profile->recorded = 1;
+	}
+	emu_replay_session_clear(&session);
+	emu_replay_close(&replay);
+	return rc;
+}
+
+typedef struct {
+	uint64_t	 ns;
+	uint64_t	 n_transfers;
+} SpiBenchResult;
+
+static int
+spi_bench_run(const SpiBenchBridge *profile, SpiBenchPattern pattern, int write,
+	      unsigned depth, const uint8_t *image, uint8_t *buf, size_t size, SpiBenchResult *result)
+{
+	SpiBenchHost host;
+	int rc = -1;
+
+	if (spi_bench_host_init(&host, profile, pattern, depth, size) < 0)
+		goto out;
+
+	/* reads find the image already there, writes start from something else */
+	if (write) {
+		for (size_t i = 0; i < size; i++)
+			host.flash.data[i] = ~image[i];
+	} else {
+		memcpy(host.flash.data, image, size);
+	}
+	if (spi_bench_probe(&host) < 0)
+		goto out;
+	if (write ? spi_bench_write(&host, image, size) : spi_bench_read(&host, buf, size) < 0)
+		goto out;
+	if (memcmp(write ? host.flash.data : buf, image, size) != 0 || host.flash.n_ignored > 0) {
+		fprintf(stderr, "%s %s %s: data does not match, %lu commands ignored\n",
+			emu_spi_bridge_kind_to_string(profile->kind), write ? "write" : "read",
+			spi_bench_pattern_to_string(pattern), (unsigned long) host.flash.n_ignored);
+		goto out;
+	}
+	result->ns = host.end_ns;
+	result->n_transfers = host.n_transfers;
+	rc = 0;
+out:
+	spi_bench_host_clear(&host);
+	return rc;
+}
+
+/* the time the flash itself needs: clocking the data, and erasing and programming */
+static double
+spi_bench_floor(const SpiBenchBridge *profile, int write, size_t size)
+{
+	EmuSpiFlash flash;
+	double ns = (double) size * (8e9 / profile->spi_hz);
+
+	emu_spi_flash_init(&flash, 0);
+	if (write) {
+		ns += (double) (size / EMU_SPI_FLASH_SECTOR_SIZE) * flash.sector_erase_ns;
+		ns += (double) (size / EMU_SPI_FLASH_PAGE_SIZE) * flash.page_program_ns;
+	}
+	return ns / 1e9;
+}
+
+static void
+spi_bench_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [OPTION...] ARCHIVE...\n"
+		"  -s, --size=BYTES         flash size, default %u\n"
+		"  -q, --queue=N            transfers in flight when aggregated, default %u\n"
+		"  -l, --latency=US         override the transfer latency of both bridges\n"
+		"  -c, --clock=HZ           override the SPI clock of both bridges\n",
+		argv0, SPI_BENCH_SIZE_DEFAULT, SPI_BENCH_QUEUE_DEFAULT);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct option options[] = {
+		{ "size",		required_argument, NULL, 's' },
+		{ "queue",		required_argument, NULL, 'q' },
+		{ "latency",		required_argument, NULL, 'l' },
+		{ "clock",		required_argument, NULL, 'c' },
+		{ NULL, 0, NULL, 0 }
+	};
+	size_t size = SPI_BENCH_SIZE_DEFAULT;
+	unsigned depth = SPI_BENCH_QUEUE_DEFAULT;
+	uint64_t latency_us = 0;
+	uint64_t clock_hz = 0;
+	uint8_t *image;
+	uint8_t *buf;
+	uint32_t seed = 0x12345678;
+	int rc = EXIT_SUCCESS;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "s:q:l:c:", options, NULL)) != -1) {
+		switch (opt) {
+		case 's':
+			size = strtoul(optarg, NULL, 0);
+			break;
+		case 'q':
+			depth = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			latency_us = strtoull(optarg, NULL, 0);
+			break;
+		case 'c':
+			clock_hz = strtoull(optarg, NULL, 0);
+			break;
+		default:
+			spi_bench_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind >= argc || depth == 0 || size == 0 || size > 0x1000000 ||
+	    (size & (size - 1)) != 0 || size < EMU_SPI_FLASH_BLOCK_SIZE) {
+		spi_bench_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	for (unsigned i = 0; i < EMU_SPI_BRIDGE_LAST; i++) {
+		if (latency_us > 0)
+			spi_bench_bridges[i].latency_ns = latency_us * 1000;
+		if (clock_hz > 0)
+			spi_bench_bridges[i].spi_hz = clock_hz;
+	}
+
+	for (int i = optind; i < argc; i++) {
+		if (spi_bench_check_archive(argv[i]) < 0)
+			rc = EXIT_FAILURE;
+	}
+	if (rc != EXIT_SUCCESS)
+		return rc;
+
+	image = malloc(size);
+	buf = malloc(size);
+	if (image == NULL || buf == NULL)
+		return EXIT_FAILURE;
+	for (size_t i = 0; i < size; i++) {
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		image[i] = seed;
+	}
+
+	printf("\n%zu KiB flash, %u transfers queued when aggregated\n", size / 1024, depth);
+	printf("%-7s %-6s %-11s %10s %12s %10s %8s %10s\n",
+	       "bridge", "op", "pattern", "transfers", "modelled", "KiB/s", "speedup", "flash");
+	for (unsigned i = 0; i < EMU_SPI_BRIDGE_LAST; i++) {
+		const SpiBenchBridge *profile = &spi_bench_bridges[i];
+		if (!profile->recorded)
+			continue;
+		for (int write = 0; write <= 1; write++) {
+			SpiBenchResult results[SPI_BENCH_PATTERN_LAST];
+			for (unsigned p = 0; p < SPI_BENCH_PATTERN_LAST; p++) {
+				if (spi_bench_run(profile, p, write, depth, image, buf, size, &results[p]) < 0) {
+					rc = EXIT_FAILURE;
+					break;
+				}
+				printf("%-7s %-6s %-11s %10lu %10.1f s %10.1f",
+				       emu_spi_bridge_kind_to_string(profile->kind),
+				       write ? "write" : "read", spi_bench_pattern_to_string(p),
+				       (unsigned long) results[p].n_transfers, results[p].ns / 1e9,
+				       size / 1024.0 / (results[p].ns / 1e9));
+				if (p == SPI_BENCH_PATTERN_RECORDED)
+					printf(" %8s", "");
+				else
+					printf(" %7.1fx", (double) results[0].ns / results[p].ns);
+				printf(" %8.1f s\n", spi_bench_floor(profile, write, size));
+			}
+		}
+	}
+	free(image);
+	free(buf);
+	return rc;
+}
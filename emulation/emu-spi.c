@@ -0,0 +1,441 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emu-spi.h"
+
+/* typical times for a Winbond W25Q128JV */
+#define EMU_SPI_FLASH_PAGE_PROGRAM_NS	700000ull
+#define EMU_SPI_FLASH_SECTOR_ERASE_NS	45000000ull
+#define EMU_SPI_FLASH_BLOCK_ERASE_NS	150000000ull
+#define EMU_SPI_FLASH_CHIP_ERASE_NS	40000000000ull
+
+int
+emu_spi_flash_init(EmuSpiFlash *flash, size_t size)
+{
+	unsigned order = 0;
+
+	memset(flash, 0, sizeof(EmuSpiFlash));
+	flash->miso_idle = 0xff;
+	flash->page_program_ns = EMU_SPI_FLASH_PAGE_PROGRAM_NS;
+	flash->sector_erase_ns = EMU_SPI_FLASH_SECTOR_ERASE_NS;
+	flash->block_erase_ns = EMU_SPI_FLASH_BLOCK_ERASE_NS;
+	flash->chip_erase_ns = EMU_SPI_FLASH_CHIP_ERASE_NS;
+	if (size == 0)
+		return 0;
+
+	/* a power of two no smaller than a block, as the erases assume */
+	if (size < EMU_SPI_FLASH_BLOCK_SIZE || (size & (size - 1)) != 0) {
+		fprintf(stderr, "flash size %zu is not a power of two of at least 64 KiB\n", size);
+		return -1;
+	}
+	while (((size_t) 1 << order) < size)
+		order++;
+	flash->data = malloc(size);
+	if (flash->data == NULL)
+		return -1;
+	memset(flash->data, 0xff, size);
+	flash->size = size;
+	flash->jedec_id[0] = 0xef;	/* Winbond */
+	flash->jedec_id[1] = 0x40;
+	flash->jedec_id[2] = order;
+	return 0;
+}
+
+void
+emu_spi_flash_clear(EmuSpiFlash *flash)
+{
+	free(flash->data);
+	memset(flash, 0, sizeof(EmuSpiFlash));
+}
+
+static void
+emu_spi_flash_erase(EmuSpiFlash *flash, uint32_t size, uint64_t ns)
+{
+	uint32_t start = (flash->addr & (flash->size - 1)) & ~(size - 1);
+	memset(flash->data + start, 0xff, size);
+	flash->busy_until_ns = flash->now_ns + ns;
+}
+
+/* program and erase start when chip select rises after a whole command */
+static void
+emu_spi_flash_execute(EmuSpiFlash *flash)
+{
+	if (flash->pos == 0)
+		return;
+	if (flash->busy && flash->cmd != EMU_SPI_FLASH_CMD_READ_STATUS) {
+		flash->n_ignored++;
+		return;
+	}
+	switch (flash->cmd) {
+	case EMU_SPI_FLASH_CMD_WRITE_ENABLE:
+		flash->wel = 1;
+		return;
+	case EMU_SPI_FLASH_CMD_WRITE_DISABLE:
+		flash->wel = 0;
+		return;
+	case EMU_SPI_FLASH_CMD_PAGE_PROGRAM:
+	case EMU_SPI_FLASH_CMD_SECTOR_ERASE:
+	case EMU_SPI_FLASH_CMD_BLOCK_ERASE:
+	case EMU_SPI_FLASH_CMD_CHIP_ERASE:
+		break;
+	default:
+		return;
+	}
+	if (!flash->write_enabled ||
+	    (flash->cmd == EMU_SPI_FLASH_CMD_CHIP_ERASE && flash->pos != 1) ||
+	    (flash->cmd != EMU_SPI_FLASH_CMD_CHIP_ERASE && flash->pos < 4)) {
+		flash->n_ignored++;
+		return;
+	}
+	flash->wel = 0;
+	switch (flash->cmd) {
+	case EMU_SPI_FLASH_CMD_PAGE_PROGRAM:
+		flash->busy_until_ns = flash->now_ns + flash->page_program_ns;
+		break;
+	case EMU_SPI_FLASH_CMD_SECTOR_ERASE:
+		emu_spi_flash_erase(flash, EMU_SPI_FLASH_SECTOR_SIZE, flash->sector_erase_ns);
+		break;
+	case EMU_SPI_FLASH_CMD_BLOCK_ERASE:
+		emu_spi_flash_erase(flash, EMU_SPI_FLASH_BLOCK_SIZE, flash->block_erase_ns);
+		break;
+	default:
+		flash->addr = 0;
+		emu_spi_flash_erase(flash, flash->size, flash->chip_erase_ns);
+		break;
+	}
+}
+
+void
+emu_spi_flash_select(EmuSpiFlash *flash, int selected)
+{
+	if (flash->data == NULL || flash->selected == selected)
+		return;
+	flash->selected = selected;
+	if (!selected) {
+		emu_spi_flash_execute(flash);
+		return;
+	}
+	flash->pos = 0;
+	flash->addr = 0;
+	flash->write_enabled = flash->wel;
+	flash->busy = flash->now_ns < flash->busy_until_ns;
+}
+
+uint8_t
+emu_spi_flash_xfer(EmuSpiFlash *flash, uint8_t mosi)
+{
+	uint32_t pos = flash->pos;
+	uint8_t miso = flash->miso_idle;
+
+	flash->now_ns += flash->byte_ns;
+	if (flash->data == NULL || !flash->selected)
+		return miso;
+	if (flash->pos < UINT32_MAX)
+		flash->pos++;
+	if (pos == 0) {
+		flash->cmd = mosi;
+		return miso;
+	}
+	switch (flash->cmd) {
+	case EMU_SPI_FLASH_CMD_READ_ID:
+		if (pos <= 3)
+			miso = flash->jedec_id[pos - 1];
+		break;
+	case EMU_SPI_FLASH_CMD_READ_STATUS:
+		miso = 0;
+		if (flash->now_ns < flash->busy_until_ns)
+			miso |= EMU_SPI_FLASH_STATUS_WIP;
+		if (flash->wel)
+			miso |= EMU_SPI_FLASH_STATUS_WEL;
+		break;
+	case EMU_SPI_FLASH_CMD_READ:
+		if (pos <= 3) {
+			flash->addr = (flash->addr << 8) | mosi;
+			break;
+		}
+		if (flash->busy)
+			break;
+		miso = flash->data[flash->addr & (flash->size - 1)];
+		flash->addr++;
+		break;
+	case EMU_SPI_FLASH_CMD_PAGE_PROGRAM:
+		if (pos <= 3) {
+			flash->addr = (flash->addr << 8) | mosi;
+			break;
+		}
+		/* bits only go from 1 to 0, and the address wraps within the page */
+		if (flash->write_enabled && !flash->busy) {
+			uint32_t addr = (flash->addr & ~(EMU_SPI_FLASH_PAGE_SIZE - 1)) |
+					((flash->addr + pos - 4) & (EMU_SPI_FLASH_PAGE_SIZE - 1));
+			flash->data[addr & (flash->size - 1)] &= mosi;
+		}
+		break;
+	case EMU_SPI_FLASH_CMD_SECTOR_ERASE:
+	case EMU_SPI_FLASH_CMD_BLOCK_ERASE:
+		if (pos <= 3)
+			flash->addr = (flash->addr << 8) | mosi;
+		break;
+	default:
+		break;
+	}
+	return miso;
+}
+
+const char *
+emu_spi_bridge_kind_to_string(EmuSpiBridgeKind kind)
+{
+	switch (kind) {
+	case EMU_SPI_BRIDGE_CH341A:
+		return "ch341a";
+	case EMU_SPI_BRIDGE_CH347:
+		return "ch347";
+	default:
+		return NULL;
+	}
+}
+
+void
+emu_spi_bridge_init(EmuSpiBridge *bridge, EmuSpiBridgeKind kind, EmuSpiFlash *flash)
+{
+	memset(bridge, 0, sizeof(EmuSpiBridge));
+	bridge->kind = kind;
+	bridge->flash = flash;
+	bridge->packet_size = kind == EMU_SPI_BRIDGE_CH341A ? EMU_SPI_CH341A_PACKET_SIZE
+							    : EMU_SPI_CH347_PACKET_SIZE;
+}
+
+void
+emu_spi_bridge_clear(EmuSpiBridge *bridge)
+{
+	for (size_t i = bridge->first_packet; i < bridge->n_packets; i++)
+		free(bridge->packets[i].data);
+	free(bridge->packets);
+	free(bridge->reply);
+	memset(bridge, 0, sizeof(EmuSpiBridge));
+}
+
+/* takes ownership of data */
+static int
+emu_spi_bridge_queue(EmuSpiBridge *bridge, uint8_t *data, size_t len)
+{
+	if (data == NULL)
+		return -1;
+	if (bridge->first_packet == bridge->n_packets) {
+		bridge->first_packet = 0;
+		bridge->n_packets = 0;
+	}
+	if (bridge->n_packets == bridge->n_alloc) {
+		size_t n_alloc = bridge->n_alloc ? bridge->n_alloc * 2 : 64;
+		EmuSpiPacket *tmp = realloc(bridge->packets, n_alloc * sizeof(EmuSpiPacket));
+		if (tmp == NULL) {
+			free(data);
+			return -1;
+		}
+		bridge->packets = tmp;
+		bridge->n_alloc = n_alloc;
+	}
+	bridge->packets[bridge->n_packets].data = data;
+	bridge->packets[bridge->n_packets].len = len;
+	bridge->n_packets++;
+	return 0;
+}
+
+static uint8_t
+emu_spi_bridge_xfer(EmuSpiBridge *bridge, uint8_t mosi)
+{
+	bridge->spi_bytes++;
+	return emu_spi_flash_xfer(bridge->flash, mosi);
+}
+
+/* the CH341A shifts bytes out least significant bit first */
+uint8_t
+emu_spi_reverse(uint8_t v)
+{
+	v = (v & 0xf0) >> 4 | (v & 0x0f) << 4;
+	v = (v & 0xcc) >> 2 | (v & 0x33) << 2;
+	v = (v & 0xaa) >> 1 | (v & 0x55) << 1;
+	return v;
+}
+
+static int
+emu_spi_ch341a_packet(EmuSpiBridge *bridge, const uint8_t *buf, size_t len)
+{
+	switch (buf[0]) {
+	case EMU_SPI_CH341A_CMD_SPI_STREAM: {
+		uint8_t *reply = malloc(len);
+		if (reply == NULL)
+			return -1;
+		for (size_t i = 1; i < len; i++)
+			reply[i - 1] = emu_spi_reverse(emu_spi_bridge_xfer(bridge, emu_spi_reverse(buf[i])));
+		return emu_spi_bridge_queue(bridge, reply, len - 1);
+	}
+	case EMU_SPI_CH341A_CMD_UIO_STREAM:
+		for (size_t i = 1; i < len && buf[i] != EMU_SPI_CH341A_UIO_STM_END; i++) {
+			switch (buf[i] & 0xc0) {
+			case EMU_SPI_CH341A_UIO_STM_OUT:
+				/* D0 is chip select, active low */
+				emu_spi_flash_select(bridge->flash, !(buf[i] & 0x01));
+				break;
+			case EMU_SPI_CH341A_UIO_STM_DIR:
+			case EMU_SPI_CH341A_UIO_STM_US:
+				break;
+			default:
+				return -1;
+			}
+		}
+		return 0;
+	case EMU_SPI_CH341A_CMD_I2C_STREAM:
+		/* only used to set the clock, nothing on the SPI bus */
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+static int
+emu_spi_ch347_reply(EmuSpiBridge *bridge, uint8_t cmd, const uint8_t *buf, size_t len)
+{
+	uint8_t *reply = malloc(len + 3);
+	if (reply == NULL)
+		return -1;
+	reply[0] = cmd;
+	reply[1] = len;
+	reply[2] = len >> 8;
+	memcpy(reply + 3, buf, len);
+	return emu_spi_bridge_queue(bridge, reply, len + 3);
+}
+
+/* the command is complete */
+static int
+emu_spi_ch347_command(EmuSpiBridge *bridge)
+{
+	switch (bridge->hdr[0]) {
+	case EMU_SPI_CH347_CMD_SPI_SET_CFG: {
+		const uint8_t ok = 0x00;
+		return emu_spi_ch347_reply(bridge, bridge->hdr[0], &ok, 1);
+	}
+	case EMU_SPI_CH347_CMD_SPI_CS_CTRL:
+		if (bridge->payload_len >= 1 && (bridge->args[0] & EMU_SPI_CH347_CS_VALID))
+			emu_spi_flash_select(bridge->flash, !(bridge->args[0] & EMU_SPI_CH347_CS_DEASSERT));
+		return 0;
+	case EMU_SPI_CH347_CMD_SPI_OUT:
+		return 0;
+	case EMU_SPI_CH347_CMD_SPI_IN: {
+		uint32_t count;
+		uint8_t buf[EMU_SPI_CH347_PAYLOAD_MAX];
+		if (bridge->payload_len != 4)
+			return -1;
+		count = bridge->args[0] | bridge->args[1] << 8 | bridge->args[2] << 16 |
+			(uint32_t) bridge->args[3] << 24;
+		while (count > 0) {
+			size_t n = count < sizeof(buf) ? count : sizeof(buf);
+			for (size_t i = 0; i < n; i++)
+				buf[i] = emu_spi_bridge_xfer(bridge, 0xff);
+			if (emu_spi_ch347_reply(bridge, bridge->hdr[0], buf, n) < 0)
+				return -1;
+			count -= n;
+		}
+		return 0;
+	}
+	case EMU_SPI_CH347_CMD_SPI_OUT_IN: {
+		int rc = emu_spi_ch347_reply(bridge, bridge->hdr[0], bridge->reply, bridge->payload_len);
+		free(bridge->reply);
+		bridge->reply = NULL;
+		return rc;
+	}
+	default:
+		return -1;
+	}
+}
+
+static int
+emu_spi_ch347_byte(EmuSpiBridge *bridge, uint8_t b)
+{
+	uint8_t cmd = bridge->hdr[0];
+
+	if (bridge->hdr_len < sizeof(bridge->hdr)) {
+		bridge->hdr[bridge->hdr_len++] = b;
+		if (bridge->hdr_len < sizeof(bridge->hdr))
+			return 0;
+		cmd = bridge->hdr[0];
+		bridge->payload_len = bridge->hdr[1] | bridge->hdr[2] << 8;
+		bridge->payload_pos = 0;
+		if (bridge->payload_len > EMU_SPI_CH347_PAYLOAD_MAX)
+			return -1;
+		if (cmd == EMU_SPI_CH347_CMD_SPI_OUT_IN) {
+			bridge->reply = malloc(bridge->payload_len + 1);
+			if (bridge->reply == NULL)
+				return -1;
+		}
+	} else {
+		if (cmd == EMU_SPI_CH347_CMD_SPI_OUT) {
+			emu_spi_bridge_xfer(bridge, b);
+		} else if (cmd == EMU_SPI_CH347_CMD_SPI_OUT_IN) {
+			bridge->reply[bridge->payload_pos] = emu_spi_bridge_xfer(bridge, b);
+		} else if (bridge->payload_pos < sizeof(bridge->args)) {
+			bridge->args[bridge->payload_pos] = b;
+		}
+		bridge->payload_pos++;
+	}
+	if (bridge->payload_pos < bridge->payload_len)
+		return 0;
+	bridge->hdr_len = 0;
+	return emu_spi_ch347_command(bridge);
+}
+
+/* returns -1 for anything the bridge firmware would not understand */
+int
+emu_spi_bridge_out(EmuSpiBridge *bridge, const uint8_t *buf, size_t len)
+{
+	if (bridge->kind == EMU_SPI_BRIDGE_CH341A) {
+		for (size_t i = 0; i < len; i += EMU_SPI_CH341A_PACKET_SIZE) {
+			size_t n = len - i < EMU_SPI_CH341A_PACKET_SIZE ? len - i : EMU_SPI_CH341A_PACKET_SIZE;
+			if (emu_spi_ch341a_packet(bridge, buf + i, n) < 0)
+				return -1;
+		}
+		return 0;
+	}
+	for (size_t i = 0; i < len; i++) {
+		if (emu_spi_ch347_byte(bridge, buf[i]) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+/* returns -1 if nothing is waiting, where the real bridge would NAK */
+int
+emu_spi_bridge_in(EmuSpiBridge *bridge, uint8_t *buf, size_t len, size_t *actual)
+{
+	EmuSpiPacket *packet;
+
+	if (bridge->first_packet == bridge->n_packets)
+		return -1;
+	packet = &bridge->packets[bridge->first_packet++];
+	*actual = packet->len < len ? packet->len : len;
+	if (buf != NULL)
+		memcpy(buf, packet->data, *actual);
+	free(packet->data);
+	return packet->len <= len ? 0 : -1;
+}
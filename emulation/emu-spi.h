@@ -0,0 +1,166 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __EMU_SPI_H
+#define __EMU_SPI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Simulated SPI NOR flash and the USB to SPI bridges that drive it.
+ *
+ * EmuSpiFlash implements the JEDEC commands the fwupd SPI plugins use:
+ * RDID, READ, WREN, WRDI, RDSR, PP and the sector, block and chip erases.
+ * Time is virtual: the caller sets now_ns, every byte clocked advances it by
+ * byte_ns, and program and erase keep WIP set in the status register for the
+ * typical time from the datasheet. Like a real chip, commands other than RDSR are ignored while
+ * it is busy, and program and erase are ignored without WREN. With no chip
+ * present every byte reads back as miso_idle.
+ *
+ * EmuSpiBridge decodes the bulk OUT transfers of a CH341A or CH347 the way
+ * the bridge firmware does, clocks the SPI bytes through the flash and
+ * queues the packets the bridge returns on its bulk IN endpoint:
+ *
+ *  - CH341A: 32 byte packets, each starting with a command. A UIO stream
+ *    (0xAB) drives chip select until its end marker; an SPI stream (0xA8)
+ *    clocks the rest of the packet, least significant bit first, and
+ *    returns one packet with a byte for each byte clocked.
+ *  - CH347: a stream of commands, each a byte, a 16 bit length and a
+ *    payload, which may share or cross 512 byte packets. 0xC1 drives chip
+ *    select, 0xC2 writes, 0xC3 reads a 32 bit count of bytes returned in
+ *    packets of up to 507, and 0xC4 writes and returns what was read.
+ *
+ * Every IN transfer returns one packet, as the bridges end each response
+ * with a short packet.
+ */
+
+#define EMU_SPI_FLASH_PAGE_SIZE		256
+#define EMU_SPI_FLASH_SECTOR_SIZE	0x1000
+#define EMU_SPI_FLASH_BLOCK_SIZE	0x10000
+
+#define EMU_SPI_CH341A_PACKET_SIZE	32
+#define EMU_SPI_CH341A_CMD_SPI_STREAM	0xa8
+#define EMU_SPI_CH341A_CMD_I2C_STREAM	0xaa
+#define EMU_SPI_CH341A_CMD_UIO_STREAM	0xab
+#define EMU_SPI_CH341A_UIO_STM_END	0x20
+#define EMU_SPI_CH341A_UIO_STM_DIR	0x40
+#define EMU_SPI_CH341A_UIO_STM_OUT	0x80
+#define EMU_SPI_CH341A_UIO_STM_US	0xc0
+
+#define EMU_SPI_CH347_PACKET_SIZE	512
+#define EMU_SPI_CH347_PAYLOAD_MAX	507
+#define EMU_SPI_CH347_CMD_SPI_SET_CFG	0xc0
+#define EMU_SPI_CH347_CMD_SPI_CS_CTRL	0xc1
+#define EMU_SPI_CH347_CMD_SPI_OUT	0xc2
+#define EMU_SPI_CH347_CMD_SPI_IN	0xc3
+#define EMU_SPI_CH347_CMD_SPI_OUT_IN	0xc4
+#define EMU_SPI_CH347_CS_VALID		0x80
+#define EMU_SPI_CH347_CS_DEASSERT	0x40
+
+#define EMU_SPI_FLASH_STATUS_WIP	(1 << 0)
+#define EMU_SPI_FLASH_STATUS_WEL	(1 << 1)
+
+typedef enum {
+	EMU_SPI_FLASH_CMD_PAGE_PROGRAM	= 0x02,
+	EMU_SPI_FLASH_CMD_READ		= 0x03,
+	EMU_SPI_FLASH_CMD_WRITE_DISABLE	= 0x04,
+	EMU_SPI_FLASH_CMD_READ_STATUS	= 0x05,
+	EMU_SPI_FLASH_CMD_WRITE_ENABLE	= 0x06,
+	EMU_SPI_FLASH_CMD_SECTOR_ERASE	= 0x20,
+	EMU_SPI_FLASH_CMD_CHIP_ERASE	= 0xc7,
+	EMU_SPI_FLASH_CMD_BLOCK_ERASE	= 0xd8,
+	EMU_SPI_FLASH_CMD_READ_ID	= 0x9f,
+} EmuSpiFlashCmd;
+
+typedef struct {
+	uint8_t		*data;		/* NULL when no chip is present */
+	size_t		 size;
+	uint8_t		 jedec_id[3];
+	uint8_t		 miso_idle;	/* what the bus reads with no chip */
+	uint64_t	 page_program_ns;
+	uint64_t	 sector_erase_ns;
+	uint64_t	 block_erase_ns;
+	uint64_t	 chip_erase_ns;
+	uint64_t	 byte_ns;	/* eight SPI clocks */
+	uint64_t	 now_ns;
+	uint64_t	 busy_until_ns;
+	uint64_t	 n_ignored;	/* commands dropped while busy or without WREN */
+	int		 wel;
+	int		 selected;
+	int		 write_enabled;	/* WEL was set when this frame began */
+	int		 busy;		/* and so was WIP */
+	uint8_t		 cmd;
+	uint32_t	 pos;		/* bytes clocked since chip select */
+	uint32_t	 addr;
+} EmuSpiFlash;
+
+typedef enum {
+	EMU_SPI_BRIDGE_CH341A,
+	EMU_SPI_BRIDGE_CH347,
+	EMU_SPI_BRIDGE_LAST
+} EmuSpiBridgeKind;
+
+typedef struct {
+	uint8_t		*data;
+	size_t		 len;
+} EmuSpiPacket;
+
+typedef struct {
+	EmuSpiBridgeKind kind;
+	EmuSpiFlash	*flash;
+	size_t		 packet_size;
+	EmuSpiPacket	*packets;	/* waiting for bulk IN */
+	size_t		 n_packets;
+	size_t		 first_packet;
+	size_t		 n_alloc;
+	uint64_t	 spi_bytes;	/* clocked so far */
+	uint8_t		 hdr[3];	/* CH347 command, which may cross packets */
+	size_t		 hdr_len;
+	size_t		 payload_len;
+	size_t		 payload_pos;
+	uint8_t		 args[10];	/* CH347 payload that is not SPI data */
+	uint8_t		*reply;		/* CH347 0xC4 response being built */
+} EmuSpiBridge;
+
+int		 emu_spi_flash_init		(EmuSpiFlash	*flash,
+						 size_t		 size);
+void		 emu_spi_flash_clear		(EmuSpiFlash	*flash);
+void		 emu_spi_flash_select		(EmuSpiFlash	*flash,
+						 int		 selected);
+uint8_t		 emu_spi_flash_xfer		(EmuSpiFlash	*flash,
+						 uint8_t	 mosi);
+
+const char	*emu_spi_bridge_kind_to_string	(EmuSpiBridgeKind kind);
+void		 emu_spi_bridge_init		(EmuSpiBridge	*bridge,
+						 EmuSpiBridgeKind kind,
+						 EmuSpiFlash	*flash);
+void		 emu_spi_bridge_clear		(EmuSpiBridge	*bridge);
+int		 emu_spi_bridge_out		(EmuSpiBridge	*bridge,
+						 const uint8_t	*buf,
+						 size_t		 len);
+int		 emu_spi_bridge_in		(EmuSpiBridge	*bridge,
+						 uint8_t	*buf,
+						 size_t		 len,
+						 size_t		*actual);
+uint8_t		 emu_spi_reverse		(uint8_t	 v);
+
+#endif /* __EMU_SPI_H */
@@ -0,0 +1,679 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Generates any number of distinct emulated USB devices from the recorded
+ * archives, for load testing the host with a large fleet.
+ *
+ * Each clone gets its own PlatformId, bus and device number and serial
+ * number, and optionally its own IdVendor and IdProduct. Everything that
+ * repeats those values is rewritten to match: the udev uevent, DEVNAME,
+ * BUSNUM and DEVNUM properties, the serial number string descriptor, and any
+ * transfer that returns the serial number, such as fastboot's getvar.
+ *
+ * The archives are parsed once. A clone only patches the nodes found while
+ * preparing its template and writes the tree out again, so the output is
+ * limited by the deflate stream rather than by parsing.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "emu-archive.h"
+#include "emu-base64.h"
+#include "emu-json.h"
+#include "emu-timer.h"
+
+#define SYNTH_DEVNUM_MAX		127
+#define SYNTH_HUB_PORTS			15
+#define SYNTH_SERIAL_MAX		126
+#define SYNTH_SERIAL_OFFSETS_MAX	8
+#define SYNTH_SERIAL_DIGITS_MAX		6
+
+typedef enum {
+	SYNTH_PATCH_PLATFORM_ID,
+	SYNTH_PATCH_ID_VENDOR,
+	SYNTH_PATCH_ID_PRODUCT,
+	SYNTH_PATCH_UEVENT,
+	SYNTH_PATCH_DEVNAME,
+	SYNTH_PATCH_BUSNUM,
+	SYNTH_PATCH_DEVNUM,
+	SYNTH_PATCH_SERIAL,
+} SynthPatchKind;
+
+typedef struct {
+	SynthPatchKind		 kind;
+	uint32_t		 node;
+	const char		*str;		/* as recorded */
+	size_t			 len;
+	uint8_t			*data;		/* decoded payload holding the serial */
+	size_t			 data_len;
+	uint32_t		 offsets[SYNTH_SERIAL_OFFSETS_MAX];
+	uint8_t			 utf16[SYNTH_SERIAL_OFFSETS_MAX];
+	uint32_t		 n_offsets;
+} SynthPatch;
+
+typedef struct {
+	char			*name;		/* archive name without -emulation.zip */
+	EmuJson			*json;
+	uint32_t		 device;
+	char			 serial[SYNTH_SERIAL_MAX + 1];
+	size_t			 serial_len;
+	SynthPatch		*patches;
+	uint32_t		 n_patches;
+	char			*arena;		/* the patched strings of one clone */
+	size_t			 arena_size;
+} SynthTemplate;
+
+typedef struct {
+	char			*buf;
+	EmuJson			 json;
+} SynthArchive;
+
+typedef struct {
+	uint32_t		 index;
+	uint32_t		 busnum;
+	uint32_t		 devnum;
+	int			 vid;		/* -1 to keep the recorded one */
+	int			 pid;
+} SynthClone;
+
+static const char synth_digits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+static SynthPatch *
+synth_template_add_patch(SynthTemplate *tmpl, SynthPatchKind kind, const EmuJsonNode *node, size_t size)
+{
+	SynthPatch *tmp = realloc(tmpl->patches, (tmpl->n_patches + 1) * sizeof(SynthPatch));
+	SynthPatch *patch;
+
+	if (tmp == NULL)
+		return NULL;
+	tmpl->patches = tmp;
+	patch = &tmpl->patches[tmpl->n_patches++];
+	memset(patch, 0, sizeof(SynthPatch));
+	patch->kind = kind;
+	patch->node = node - tmpl->json->nodes;
+	patch->str = node->str;
+	patch->len = node->len;
+	tmpl->arena_size += size;
+	return patch;
+}
+
+/* the serial number as the device reports it in its string descriptor */
+static void
+synth_template_find_serial(SynthTemplate *tmpl, const EmuJsonNode *events, int64_t idx)
+{
+	char id_str[64];
+	char id_bytes[64];
+
+	snprintf(id_str, sizeof(id_str), "GetStringDescriptor:DescIndex=0x%02x", (unsigned) idx);
+	snprintf(id_bytes, sizeof(id_bytes), "GetStringDescriptorBytes:DescIndex=0x%02x,", (unsigned) idx);
+	for (const EmuJsonNode *e = emu_json_first(tmpl->json, events); e != NULL; e = emu_json_next(tmpl->json, e)) {
+		const char *id = emu_json_member_str(tmpl->json, e, "Id");
+		const char *data = emu_json_member_str(tmpl->json, e, "Data");
+		uint8_t buf[512];
+		size_t len;
+
+		if (id == NULL || data == NULL || strlen(data) > EMU_BASE64_ENCODED_SIZE(sizeof(buf)) - 4 ||
+		    emu_base64_decode(data, strlen(data), buf, &len) < 0)
+			continue;
+		if (strcmp(id, id_str) == 0) {
+			for (tmpl->serial_len = 0; tmpl->serial_len < len && tmpl->serial_len < SYNTH_SERIAL_MAX; tmpl->serial_len++) {
+				if (buf[tmpl->serial_len] == '\0')
+					break;
+				tmpl->serial[tmpl->serial_len] = buf[tmpl->serial_len];
+			}
+			return;
+		}
+		if (strncmp(id, id_bytes, strlen(id_bytes)) == 0 && len > 2) {
+			/* a raw descriptor, which is usually UTF-16LE */
+			size_t n = buf[0] < len ? buf[0] : len;
+			int utf16 = n >= 4 && n % 2 == 0;
+			for (size_t i = 3; utf16 && i < n; i += 2) {
+				if (buf[i] != 0)
+					utf16 = 0;
+			}
+			tmpl->serial_len = 0;
+			for (size_t i = 2; i < n && tmpl->serial_len < SYNTH_SERIAL_MAX; i += utf16 ? 2 : 1)
+				tmpl->serial[tmpl->serial_len++] = buf[i];
+			return;
+		}
+	}
+}
+
+/* every payload that contains the serial number, as ASCII or UTF-16LE */
+static int
+synth_template_find_serial_payloads(SynthTemplate *tmpl, const EmuJsonNode *events)
+{
+	uint8_t utf16[2 * SYNTH_SERIAL_MAX];
+
+	for (size_t i = 0; i < tmpl->serial_len; i++) {
+		utf16[2 * i] = tmpl->serial[i];
+		utf16[2 * i + 1] = 0;
+	}
+	for (const EmuJsonNode *e = emu_json_first(tmpl->json, events); e != NULL; e = emu_json_next(tmpl->json, e)) {
+		const char *id = emu_json_member_str(tmpl->json, e, "Id");
+		const EmuJsonNode *data = emu_json_member(tmpl->json, e, "Data");
+		SynthPatch *patch;
+		uint8_t *buf;
+		size_t len;
+
+		if (id == NULL || data == NULL || data->type != EMU_JSON_STRING ||
+		    (strncmp(id, "GetStringDescriptor", 19) != 0 &&
+		     strncmp(id, "ControlTransfer:", 16) != 0 &&
+		     strncmp(id, "BulkTransfer:", 13) != 0 &&
+		     strncmp(id, "InterruptTransfer:", 18) != 0))
+			continue;
+		buf = malloc(data->len / 4 * 3 + 3);
+		if (buf == NULL)
+			return -1;
+		if (emu_base64_decode(data->str, data->len, buf, &len) < 0) {
+			free(buf);
+			continue;
+		}
+		patch = NULL;
+		for (size_t off = 0; off + tmpl->serial_len <= len; off++) {
+			int is_utf16 = 0;
+			if (memcmp(buf + off, tmpl->serial, tmpl->serial_len) != 0) {
+				if (off + 2 * tmpl->serial_len > len ||
+				    memcmp(buf + off, utf16, 2 * tmpl->serial_len) != 0)
+					continue;
+				is_utf16 = 1;
+			}
+			if (patch == NULL) {
+				patch = synth_template_add_patch(tmpl, SYNTH_PATCH_SERIAL, data,
+								 EMU_BASE64_ENCODED_SIZE(len) + 1);
+				if (patch == NULL) {
+					free(buf);
+					return -1;
+				}
+				patch->data = buf;
+				patch->data_len = len;
+			}
+			if (patch->n_offsets < SYNTH_SERIAL_OFFSETS_MAX) {
+				patch->offsets[patch->n_offsets] = off;
+				patch->utf16[patch->n_offsets] = is_utf16;
+				patch->n_offsets++;
+			}
+			off += (is_utf16 ? 2 : 1) * tmpl->serial_len - 1;
+		}
+		if (patch == NULL)
+			free(buf);
+	}
+	return 0;
+}
+
+static int
+synth_template_init(SynthTemplate *tmpl, EmuJson *json, const EmuJsonNode *device, const char *name)
+{
+	const EmuJsonNode *events = emu_json_member(json, device, "UsbEvents");
+	const struct {
+		const char	*key;
+		SynthPatchKind	 kind;
+		size_t		 size;
+	} members[] = {
+		{ "PlatformId",		SYNTH_PATCH_PLATFORM_ID,	32 },
+		{ "IdVendor",		SYNTH_PATCH_ID_VENDOR,		0 },
+		{ "IdProduct",		SYNTH_PATCH_ID_PRODUCT,		0 },
+	};
+	int64_t serial_idx;
+
+	memset(tmpl, 0, sizeof(SynthTemplate));
+	tmpl->json = json;
+	tmpl->device = device - json->nodes;
+	tmpl->name = strdup(name);
+	if (tmpl->name == NULL)
+		return -1;
+	for (unsigned i = 0; i < sizeof(members) / sizeof(members[0]); i++) {
+		const EmuJsonNode *node = emu_json_member(json, device, members[i].key);
+		if (node == NULL)
+			continue;
+		if (synth_template_add_patch(tmpl, members[i].kind, node, members[i].size) == NULL)
+			return -1;
+	}
+	if (events == NULL)
+		return 0;
+
+	for (const EmuJsonNode *e = emu_json_first(json, events); e != NULL; e = emu_json_next(json, e)) {
+		const char *id = emu_json_member_str(json, e, "Id");
+		const EmuJsonNode *data = emu_json_member(json, e, "Data");
+		SynthPatch *patch = NULL;
+
+		if (id == NULL || data == NULL || data->type != EMU_JSON_STRING)
+			continue;
+		if (strcmp(id, "ReadAttr:Attr=uevent") == 0)
+			patch = synth_template_add_patch(tmpl, SYNTH_PATCH_UEVENT, data, data->len + 64);
+		else if (strcmp(id, "ReadProp:Key=DEVNAME") == 0)
+			patch = synth_template_add_patch(tmpl, SYNTH_PATCH_DEVNAME, data, 32);
+		else if (strcmp(id, "ReadProp:Key=BUSNUM") == 0)
+			patch = synth_template_add_patch(tmpl, SYNTH_PATCH_BUSNUM, data, 16);
+		else if (strcmp(id, "ReadProp:Key=DEVNUM") == 0)
+			patch = synth_template_add_patch(tmpl, SYNTH_PATCH_DEVNUM, data, 16);
+		else
+			continue;
+		if (patch == NULL)
+			return -1;
+	}
+
+	serial_idx = emu_json_member_int(json, device, "SerialNumber", 0);
+	if (serial_idx > 0 && serial_idx < 256)
+		synth_template_find_serial(tmpl, events, serial_idx);
+	if (tmpl->serial_len > 0 && synth_template_find_serial_payloads(tmpl, events) < 0)
+		return -1;
+
+	tmpl->arena = malloc(tmpl->arena_size + 1);
+	return tmpl->arena != NULL ? 0 : -1;
+}
+
+static void
+synth_template_clear(SynthTemplate *tmpl)
+{
+	for (uint32_t i = 0; i < tmpl->n_patches; i++)
+		free(tmpl->patches[i].data);
+	free(tmpl->patches);
+	free(tmpl->arena);
+	free(tmpl->name);
+}
+
+/* keeps every recorded line except the ones naming the device */
+static size_t
+synth_patch_uevent(char *out, const char *str, size_t len, const SynthClone *clone)
+{
+	size_t n = 0;
+
+	while (len > 0) {
+		const char *nl = memchr(str, '\n', len);
+		size_t line = nl != NULL ? (size_t) (nl - str) : len;
+
+		if (n > 0)
+			out[n++] = '\n';
+		if (line > 6 && strncmp(str, "MINOR=", 6) == 0) {
+			n += sprintf(out + n, "MINOR=%u", (clone->busnum - 1) * 128 + clone->devnum - 1);
+		} else if (line > 8 && strncmp(str, "DEVNAME=", 8) == 0) {
+			n += sprintf(out + n, "DEVNAME=bus/usb/%03u/%03u", clone->busnum, clone->devnum);
+		} else if (line > 7 && strncmp(str, "BUSNUM=", 7) == 0) {
+			n += sprintf(out + n, "BUSNUM=%03u", clone->busnum);
+		} else if (line > 7 && strncmp(str, "DEVNUM=", 7) == 0) {
+			n += sprintf(out + n, "DEVNUM=%03u", clone->devnum);
+		} else if (line > 8 && strncmp(str, "PRODUCT=", 8) == 0 && (clone->vid >= 0 || clone->pid >= 0)) {
+			/* vendor/product/bcdDevice in lower case hex without padding */
+			unsigned vid = 0, pid = 0;
+			const char *bcd = memchr(str + 8, '/', line - 8);
+			if (bcd != NULL)
+				bcd = memchr(bcd + 1, '/', line - (bcd + 1 - str));
+			sscanf(str + 8, "%x/%x", &vid, &pid);
+			n += sprintf(out + n, "PRODUCT=%x/%x",
+				     clone->vid >= 0 ? (unsigned) clone->vid : vid,
+				     clone->pid >= 0 ? (unsigned) clone->pid : pid);
+			if (bcd != NULL) {
+				memcpy(out + n, bcd, line - (bcd - str));
+				n += line - (bcd - str);
+			}
+		} else {
+			memcpy(out + n, str, line);
+			n += line;
+		}
+		if (nl == NULL)
+			break;
+		str += line + 1;
+		len -= line + 1;
+	}
+	out[n] = '\0';
+	return n;
+}
+
+/* the recorded serial with its tail replaced by the clone number */
+static void
+synth_template_serial(const SynthTemplate *tmpl, const SynthClone *clone, char *serial)
+{
+	size_t digits = tmpl->serial_len < SYNTH_SERIAL_DIGITS_MAX ? tmpl->serial_len : SYNTH_SERIAL_DIGITS_MAX;
+	uint32_t value = clone->index;
+
+	memcpy(serial, tmpl->serial, tmpl->serial_len);
+	for (size_t i = 0; i < digits; i++) {
+		serial[tmpl->serial_len - 1 - i] = synth_digits[value % 36];
+		value /= 36;
+	}
+}
+
+static void
+synth_template_apply(SynthTemplate *tmpl, const SynthClone *clone)
+{
+	char serial[SYNTH_SERIAL_MAX];
+	char *arena = tmpl->arena;
+
+	if (tmpl->serial_len > 0)
+		synth_template_serial(tmpl, clone, serial);
+	for (uint32_t i = 0; i < tmpl->n_patches; i++) {
+		SynthPatch *patch = &tmpl->patches[i];
+		EmuJsonNode *node = &tmpl->json->nodes[patch->node];
+		size_t len = 0;
+
+		switch (patch->kind) {
+		case SYNTH_PATCH_PLATFORM_ID:
+			/* two levels of hubs below each root port */
+			len = sprintf(arena, "%u-%u.%u", clone->busnum,
+				      1 + (clone->devnum - 2) / SYNTH_HUB_PORTS,
+				      1 + (clone->devnum - 2) % SYNTH_HUB_PORTS);
+			break;
+		case SYNTH_PATCH_ID_VENDOR:
+			if (clone->vid >= 0)
+				node->num = clone->vid;
+			continue;
+		case SYNTH_PATCH_ID_PRODUCT:
+			if (clone->pid >= 0)
+				node->num = clone->pid;
+			continue;
+		case SYNTH_PATCH_UEVENT:
+			len = synth_patch_uevent(arena, patch->str, patch->len, clone);
+			break;
+		case SYNTH_PATCH_DEVNAME:
+			len = sprintf(arena, "bus/usb/%03u/%03u", clone->busnum, clone->devnum);
+			break;
+		case SYNTH_PATCH_BUSNUM:
+			len = sprintf(arena, "%03u", clone->busnum);
+			break;
+		case SYNTH_PATCH_DEVNUM:
+			len = sprintf(arena, "%03u", clone->devnum);
+			break;
+		case SYNTH_PATCH_SERIAL:
+			for (uint32_t j = 0; j < patch->n_offsets; j++) {
+				uint8_t *p = patch->data + patch->offsets[j];
+				for (size_t k = 0; k < tmpl->serial_len; k++) {
+					if (patch->utf16[j])
+						p[2 * k] = serial[k];
+					else
+						p[k] = serial[k];
+				}
+			}
+			len = emu_base64_encode(patch->data, patch->data_len, arena);
+			arena[len] = '\0';
+			break;
+		}
+		node->str = arena;
+		node->len = len;
+		arena += len + 1;
+	}
+}
+
+static int
+synth_write_header(EmuJsonWriteFunc func, void *user_data)
+{
+	static const char header[] = "{\n  \"UsbDevices\" : [\n";
+	return func(header, sizeof(header) - 1, user_data);
+}
+
+static int
+synth_write_footer(EmuJsonWriteFunc func, void *user_data)
+{
+	static const char footer[] = "\n  ]\n}";
+	return func(footer, sizeof(footer) - 1, user_data);
+}
+
+static int
+synth_write_device(EmuJsonWriteFunc func, void *user_data, const SynthTemplate *tmpl)
+{
+	if (func("    ", 4, user_data) < 0)
+		return -1;
+	return emu_json_write_value(func, user_data, tmpl->json, &tmpl->json->nodes[tmpl->device], 4);
+}
+
+static int
+synth_write_file(const char *buf, size_t len, void *user_data)
+{
+	return fwrite(buf, 1, len, user_data) == len ? 0 : -1;
+}
+
+typedef struct {
+	EmuArchiveWriter	 writer;
+	FILE			*f;
+	uint64_t		 size;
+} SynthOutput;
+
+static int
+synth_output_write(const char *buf, size_t len, void *user_data)
+{
+	SynthOutput *output = user_data;
+	output->size += len;
+	if (output->f != NULL)
+		return synth_write_file(buf, len, output->f);
+	return emu_archive_writer_write(buf, len, &output->writer);
+}
+
+/* a zip archive, or plain JSON for any other extension */
+static int
+synth_output_open(SynthOutput *output, const char *filename)
+{
+	size_t len = strlen(filename);
+
+	memset(output, 0, sizeof(SynthOutput));
+	if (len > 4 && strcmp(filename + len - 4, ".zip") == 0)
+		return emu_archive_writer_open(&output->writer, filename, EMU_ARCHIVE_MEMBER);
+	output->f = fopen(filename, "wb");
+	if (output->f == NULL) {
+		perror(filename);
+		return -1;
+	}
+	return 0;
+}
+
+static int
+synth_output_close(SynthOutput *output, int rc)
+{
+	if (output->f != NULL) {
+		if (fclose(output->f) != 0)
+			rc = -1;
+	} else if (rc == 0) {
+		rc = emu_archive_writer_close(&output->writer);
+	} else {
+		emu_archive_writer_abort(&output->writer);
+	}
+	return rc;
+}
+
+static void
+synth_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [OPTION...] ARCHIVE...\n"
+		"  -n, --count=N            generate N devices, default one per recorded device\n"
+		"  -d, --directory=DIR      write one NAME-NNNNNN-emulation.zip per device\n"
+		"  -c, --combined=FILE      write every device into one .zip or .json\n"
+		"  -v, --vid=VID            use this IdVendor for every device\n"
+		"  -p, --pid=PID            give device N the IdProduct PID+N\n",
+		argv0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct option options[] = {
+		{ "count",		required_argument, NULL, 'n' },
+		{ "directory",		required_argument, NULL, 'd' },
+		{ "combined",		required_argument, NULL, 'c' },
+		{ "vid",		required_argument, NULL, 'v' },
+		{ "pid",		required_argument, NULL, 'p' },
+		{ NULL, 0, NULL, 0 }
+	};
+	SynthArchive *archives;
+	SynthTemplate *templates = NULL;
+	uint32_t n_archives = 0;
+	uint32_t n_templates = 0;
+	unsigned long count = 0;
+	const char *directory = NULL;
+	const char *combined = NULL;
+	long vid = -1;
+	long pid = -1;
+	SynthOutput output;
+	uint64_t start, size = 0;
+	double elapsed;
+	int rc = 0;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "n:d:c:v:p:", options, NULL)) != -1) {
+		switch (opt) {
+		case 'n':
+			count = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			directory = optarg;
+			break;
+		case 'c':
+			combined = optarg;
+			break;
+		case 'v':
+			vid = strtol(optarg, NULL, 0);
+			break;
+		case 'p':
+			pid = strtol(optarg, NULL, 0);
+			break;
+		default:
+			synth_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind >= argc || (directory == NULL && combined == NULL) ||
+	    vid > 0xffff || pid > 0xffff) {
+		synth_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (directory != NULL && mkdir(directory, 0755) < 0 && errno != EEXIST) {
+		perror(directory);
+		return EXIT_FAILURE;
+	}
+
+	archives = calloc(argc - optind, sizeof(SynthArchive));
+	if (archives == NULL)
+		return EXIT_FAILURE;
+	for (int i = optind; i < argc; i++) {
+		SynthArchive *archive = &archives[n_archives++];
+		const EmuJsonNode *devices;
+		char *tmp, *name, *suffix;
+		size_t len;
+
+		if (emu_archive_load(argv[i], &archive->buf, &len) < 0 ||
+		    emu_json_parse(&archive->json, archive->buf, len, argv[i]) < 0)
+			return EXIT_FAILURE;
+		devices = emu_json_member(&archive->json, emu_json_root(&archive->json), "UsbDevices");
+		if (devices == NULL) {
+			fprintf(stderr, "%s: no UsbDevices\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+		tmp = strdup(argv[i]);
+		if (tmp == NULL)
+			return EXIT_FAILURE;
+		name = basename(tmp);
+		suffix = strstr(name, "-emulation");
+		if (suffix == NULL)
+			suffix = strrchr(name, '.');
+		if (suffix != NULL)
+			*suffix = '\0';
+		for (const EmuJsonNode *d = emu_json_first(&archive->json, devices); d != NULL; d = emu_json_next(&archive->json, d)) {
+			SynthTemplate *t;
+			if (emu_json_member(&archive->json, d, "IdVendor") == NULL) {
+				fprintf(stderr, "%s: skipping a device that is not USB\n", argv[i]);
+				continue;
+			}
+			t = realloc(templates, (n_templates + 1) * sizeof(SynthTemplate));
+			if (t == NULL)
+				return EXIT_FAILURE;
+			templates = t;
+			if (synth_template_init(&templates[n_templates++], &archive->json, d, name) < 0)
+				return EXIT_FAILURE;
+		}
+		free(tmp);
+	}
+	if (n_templates == 0) {
+		fprintf(stderr, "no USB devices to clone\n");
+		return EXIT_FAILURE;
+	}
+	if (count == 0)
+		count = n_templates;
+
+	start = emu_timer_now_ns();
+	if (combined != NULL) {
+		if (synth_output_open(&output, combined) < 0)
+			return EXIT_FAILURE;
+		rc = synth_write_header(synth_output_write, &output);
+	}
+	for (unsigned long i = 0; rc == 0 && i < count; i++) {
+		SynthTemplate *tmpl = &templates[i % n_templates];
+		SynthClone clone = {
+			.index = i,
+			.busnum = 1 + i / (SYNTH_DEVNUM_MAX - 1),
+			.devnum = 2 + i % (SYNTH_DEVNUM_MAX - 1),
+			.vid = vid,
+			.pid = pid >= 0 ? (int) ((pid + i) & 0xffff) : -1,
+		};
+
+		synth_template_apply(tmpl, &clone);
+		if (combined != NULL) {
+			if (i > 0)
+				rc = synth_output_write(",\n", 2, &output);
+			if (rc == 0)
+				rc = synth_write_device(synth_output_write, &output, tmpl);
+		}
+		if (rc == 0 && directory != NULL) {
+			SynthOutput single;
+			char filename[4096];
+			snprintf(filename, sizeof(filename), "%s/%s-%06lu-emulation.zip", directory, tmpl->name, i);
+			if (synth_output_open(&single, filename) < 0) {
+				rc = -1;
+				break;
+			}
+			rc = synth_write_header(synth_output_write, &single);
+			if (rc == 0)
+				rc = synth_write_device(synth_output_write, &single, tmpl);
+			if (rc == 0)
+				rc = synth_write_footer(synth_output_write, &single);
+			rc = synth_output_close(&single, rc);
+			size += single.size;
+		}
+	}
+	if (combined != NULL) {
+		if (rc == 0)
+			rc = synth_write_footer(synth_output_write, &output);
+		rc = synth_output_close(&output, rc);
+		size += output.size;
+	}
+	elapsed = (emu_timer_now_ns() - start) / 1e9;
+	if (rc < 0) {
+		fprintf(stderr, "failed to write the devices\n");
+		return EXIT_FAILURE;
+	}
+	printf("%lu devices from %u templates in %.2fs, %.0f devices/s, %.1f MiB of JSON\n",
+	       count, n_templates, elapsed, count / elapsed, size / (1024.0 * 1024.0));
+
+	for (uint32_t i = 0; i < n_templates; i++)
+		synth_template_clear(&templates[i]);
+	free(templates);
+	for (uint32_t i = 0; i < n_archives; i++) {
+		emu_json_clear(&archives[i].json);
+		free(archives[i].buf);
+	}
+	free(archives);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,191 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <time.h>
+
+#include "emu-timer.h"
+
+uint64_t
+emu_timer_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* sleeping is only accurate to tens of microseconds, so spin for the rest */
+void
+emu_timer_sleep_until(uint64_t deadline_ns, uint64_t spin_ns)
+{
+	uint64_t now = emu_timer_now_ns();
+
+	if (deadline_ns > now + spin_ns) {
+		uint64_t wake = deadline_ns - spin_ns;
+		struct timespec ts = {
+			.tv_sec = wake / 1000000000,
+			.tv_nsec = wake % 1000000000,
+		};
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+			;
+	}
+	while (emu_timer_now_ns() < deadline_ns)
+		;
+}
+
+int
+emu_timer_wheel_init(EmuTimerWheel *wheel, uint64_t resolution_ns, uint32_t n_slots)
+{
+	memset(wheel, 0, sizeof(EmuTimerWheel));
+	wheel->resolution_ns = resolution_ns > 0 ? resolution_ns : EMU_TIMER_RESOLUTION_DEFAULT;
+	wheel->spin_ns = EMU_TIMER_SPIN_DEFAULT;
+	wheel->n_slots = 1;
+	while (wheel->n_slots < n_slots)
+		wheel->n_slots *= 2;
+	wheel->slots = calloc(wheel->n_slots, sizeof(EmuTimer));
+	if (wheel->slots == NULL)
+		return -1;
+	for (uint32_t i = 0; i < wheel->n_slots; i++) {
+		wheel->slots[i].next = &wheel->slots[i];
+		wheel->slots[i].prev = &wheel->slots[i];
+	}
+	wheel->tick = emu_timer_now_ns() / wheel->resolution_ns;
+#ifdef PR_SET_TIMERSLACK
+	/* the default 50us of slack is added to every sleep */
+	prctl(PR_SET_TIMERSLACK, 1);
+#endif
+	return 0;
+}
+
+void
+emu_timer_wheel_clear(EmuTimerWheel *wheel)
+{
+	free(wheel->slots);
+	memset(wheel, 0, sizeof(EmuTimerWheel));
+}
+
+void
+emu_timer_wheel_add(EmuTimerWheel *wheel, EmuTimer *timer, uint64_t deadline_ns)
+{
+	EmuTimer *head;
+
+	/* anything already due fires on the next tick */
+	timer->deadline_ns = deadline_ns;
+	timer->tick = deadline_ns / wheel->resolution_ns;
+	if (timer->tick < wheel->tick)
+		timer->tick = wheel->tick;
+	head = &wheel->slots[timer->tick & (wheel->n_slots - 1)];
+	timer->next = head->next;
+	timer->prev = head;
+	head->next->prev = timer;
+	head->next = timer;
+	wheel->n_pending++;
+}
+
+void
+emu_timer_wheel_remove(EmuTimerWheel *wheel, EmuTimer *timer)
+{
+	timer->prev->next = timer->next;
+	timer->next->prev = timer->prev;
+	timer->next = timer->prev = NULL;
+	wheel->n_pending--;
+}
+
+/* fires every timer due by now_ns, returning how many fired */
+uint32_t
+emu_timer_wheel_advance(EmuTimerWheel *wheel, uint64_t now_ns)
+{
+	uint64_t now_tick = now_ns / wheel->resolution_ns;
+	uint32_t n_fired = 0;
+
+	while (wheel->tick <= now_tick) {
+		EmuTimer *head = &wheel->slots[wheel->tick & (wheel->n_slots - 1)];
+		EmuTimer *expired = NULL;
+		EmuTimer *timer;
+
+		/* unlink first, as the callbacks may add timers to this slot */
+		for (timer = head->next; timer != head; ) {
+			EmuTimer *next = timer->next;
+			if (timer->tick <= wheel->tick) {
+				emu_timer_wheel_remove(wheel, timer);
+				timer->next = expired;
+				expired = timer;
+			}
+			timer = next;
+		}
+		wheel->tick++;
+		while (expired != NULL) {
+			timer = expired;
+			expired = timer->next;
+			timer->next = NULL;
+			timer->func(timer, now_ns, timer->user_data);
+			n_fired++;
+		}
+
+		/* skip empty revolutions when nothing is pending */
+		if (wheel->n_pending == 0) {
+			wheel->tick = now_tick + 1;
+			break;
+		}
+	}
+	return n_fired;
+}
+
+/* the earliest deadline, or UINT64_MAX if nothing is pending */
+uint64_t
+emu_timer_wheel_next(const EmuTimerWheel *wheel)
+{
+	uint64_t best = UINT64_MAX;
+
+	if (wheel->n_pending == 0)
+		return best;
+	for (uint64_t tick = wheel->tick; tick < wheel->tick + wheel->n_slots; tick++) {
+		const EmuTimer *head = &wheel->slots[tick & (wheel->n_slots - 1)];
+		for (const EmuTimer *timer = head->next; timer != head; timer = timer->next) {
+			if (timer->tick == tick && timer->deadline_ns < best)
+				best = timer->deadline_ns;
+		}
+		if (best != UINT64_MAX)
+			return best;
+	}
+
+	/* everything is more than one revolution away */
+	for (uint32_t i = 0; i < wheel->n_slots; i++) {
+		const EmuTimer *head = &wheel->slots[i];
+		for (const EmuTimer *timer = head->next; timer != head; timer = timer->next) {
+			if (timer->deadline_ns < best)
+				best = timer->deadline_ns;
+		}
+	}
+	return best;
+}
+
+void
+emu_timer_wheel_run(EmuTimerWheel *wheel)
+{
+	while (wheel->n_pending > 0) {
+		emu_timer_sleep_until(emu_timer_wheel_next(wheel), wheel->spin_ns);
+		emu_timer_wheel_advance(wheel, emu_timer_now_ns());
+	}
+}
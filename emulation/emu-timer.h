@@ -0,0 +1,87 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The fwupd-test-firmware authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __EMU_TIMER_H
+#define __EMU_TIMER_H
+
+#include <stdint.h>
+
+/*
+ * Hashed timer wheel for pacing replayed responses.
+ *
+ * Timers are bucketed by deadline into a ring of slots, each one tick of
+ * resolution_ns wide, so adding, removing and expiring a timer are constant
+ * time however many sessions are waiting. Timers more than one revolution
+ * ahead stay in their slot until the wheel comes round to their tick.
+ *
+ * emu_timer_wheel_run() sleeps until the earliest deadline and spins for the
+ * last spin_ns, so timers fire within a microsecond or so of their deadline
+ * as long as the kernel wakes the thread within that window. Timer callbacks
+ * may add more timers.
+ */
+
+#define EMU_TIMER_RESOLUTION_DEFAULT	10000		/* ns */
+#define EMU_TIMER_SLOTS_DEFAULT		4096
+#define EMU_TIMER_SPIN_DEFAULT		100000		/* ns */
+
+typedef struct _EmuTimer EmuTimer;
+
+typedef void (*EmuTimerFunc)			(EmuTimer	*timer,
+						 uint64_t	 now_ns,
+						 void		*user_data);
+
+struct _EmuTimer {
+	EmuTimer	*next;
+	EmuTimer	*prev;
+	uint64_t	 deadline_ns;	/* CLOCK_MONOTONIC */
+	uint64_t	 tick;
+	EmuTimerFunc	 func;
+	void		*user_data;
+};
+
+typedef struct {
+	EmuTimer	*slots;		/* list heads */
+	uint32_t	 n_slots;	/* power of two */
+	uint64_t	 resolution_ns;
+	uint64_t	 spin_ns;
+	uint64_t	 tick;		/* the next tick to expire */
+	uint32_t	 n_pending;
+} EmuTimerWheel;
+
+uint64_t	 emu_timer_now_ns		(void);
+void		 emu_timer_sleep_until		(uint64_t	 deadline_ns,
+						 uint64_t	 spin_ns);
+
+int		 emu_timer_wheel_init		(EmuTimerWheel	*wheel,
+						 uint64_t	 resolution_ns,
+						 uint32_t	 n_slots);
+void		 emu_timer_wheel_clear		(EmuTimerWheel	*wheel);
+void		 emu_timer_wheel_add		(EmuTimerWheel	*wheel,
+						 EmuTimer	*timer,
+						 uint64_t	 deadline_ns);
+void		 emu_timer_wheel_remove		(EmuTimerWheel	*wheel,
+						 EmuTimer	*timer);
+uint32_t	 emu_timer_wheel_advance	(EmuTimerWheel	*wheel,
+						 uint64_t	 now_ns);
+uint64_t	 emu_timer_wheel_next		(const EmuTimerWheel *wheel);
+void		 emu_timer_wheel_run		(EmuTimerWheel	*wheel);
+
+#endif /* __EMU_TIMER_H */